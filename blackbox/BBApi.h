@@ -372,6 +372,10 @@ typedef char bool;
 /* win9x: left/right winkey pressed */
 #define BB_WINKEY               10886
 
+/* returns how many WM_TIMER messages the blackbox thread (core and
+   plugins) has had since startup. Use with SendMessage */
+#define BB_TIMERWAKEUPS         10887
+
 /* bbstylemaker 1.3+ */
 #define BB_SENDDATA             10890
 #define BB_GETSTYLE             10891
@@ -19,13 +19,19 @@
 
   ========================================================================== */
 
-// execute a bsetroot command and load the generated <tempfile.bmp>
-// file into a HBITMAP, for Desk.cpp to paint the wallpaper.
+// make the wallpaper HBITMAP for Desk.cpp from a bsetroot command.
+// Image commands are rendered in-process with the bsetroot pipeline
+// (tools/bsetroot/rootimg.cpp). bsetroot.exe is still run when that
+// fails to parse the command, and when there is no desktop to paint.
 
 #include "BB.h"
 #include "Settings.h"
 #include "bbroot.h"
 #include "Workspaces.h"
+#ifndef BBTINY
+#include "BImage.h"
+#include "rootimg.h"
+#endif
 #define ST static
 
 //===========================================================================
@@ -84,11 +90,307 @@ HBITMAP make_root_bmp(const char *command)
     return bmp;
 }
 
- HBITMAP read_bitmap(const char* path, bool delete_after)
+//===========================================================================
+// cache of rendered wallpapers, in 'wpcache' next to blackbox.exe.
+// An entry is named after a hash of the parsed command, the image file
+// (path, size, time) and the sizes, and holds these as text to compare,
+// then the pixels. Entries used last are kept, up to
+// blackbox.background.cacheSize MB.
+
+#define WPC_MAGIC "bbwpc01"
+#define WPC_EXT ".wpc"
+
+struct wpc_header {
+    char magic[8];
+    int width, height;
+    int keylen;
+};
+
+struct wpc_file {
+    char name[MAX_PATH];
+    unsigned size;
+    FILETIME time;
+};
+
+ST char *wpc_path(char *path, const char *name)
+{
+    char dir[MAX_PATH];
+    set_my_path(NULL, dir, "wpcache");
+    return join_path(path, dir, name);
+}
+
+// Returns false if this picture should not be cached
+ST bool wpc_key(struct rootinfo *r, int width, int height, char *key, char *name)
+{
+    char path[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA fa;
+    unsigned __int64 h;
+    int x;
+    const char *p;
+
+    if (Settings_wallpaperCache <= 0)
+        return false;
+
+    // only what makes a difference to the picture
+    x = sprintf(key, "%d %d %d %06lx %06lx %d %d %d %d %d",
+        width, height, r->solid, r->color1, r->color2,
+        r->gradient, r->type, r->interlaced, r->bevelstyle, r->bevelposition);
+    if (r->mod)
+        x += sprintf(key + x, " mod %d %d %06lx", r->modx, r->mody, r->modfg);
+    if (r->bmp) {
+        if (0 == root_find(r, path)
+         || 0 == GetFileAttributesEx(path, GetFileExInfoStandard, &fa))
+            return false;
+        x += sprintf(key + x, " bmp %d %d %d %d %d %lx %lx %lx <%s>",
+            r->wpstyle, r->scale, r->filter, r->sat, r->hue,
+            fa.nFileSizeLow, fa.ftLastWriteTime.dwLowDateTime,
+            fa.ftLastWriteTime.dwHighDateTime, path);
+    }
+    if (false == r->solid)
+        x += sprintf(key + x, " desk %06lx", GetSysColor(COLOR_DESKTOP));
+
+    // FNV-1a
+    h = 14695981039346656037ULL;
+    for (p = key; *p; ++p)
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    sprintf(name, "%08lx%08lx" WPC_EXT, (unsigned long)(h >> 32), (unsigned long)h);
+    return true;
+}
+
+ST bool wpc_read(const char *name, const char *key, BYTE *pixels, int width, int height)
+{
+    char path[MAX_PATH];
+    char buffer[2*MAX_PATH+200];
+    struct wpc_header hdr;
+    FILETIME now;
+    HANDLE hf;
+    DWORD n;
+    bool ok = false;
+
+    hf = CreateFile(wpc_path(path, name), GENERIC_READ|FILE_WRITE_ATTRIBUTES,
+        FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == hf)
+        return false;
+    if (ReadFile(hf, &hdr, sizeof hdr, &n, NULL) && n == sizeof hdr
+     && 0 == memcmp(hdr.magic, WPC_MAGIC, sizeof hdr.magic)
+     && hdr.width == width && hdr.height == height
+     && hdr.keylen == (int)strlen(key) && hdr.keylen < (int)sizeof buffer
+     && ReadFile(hf, buffer, hdr.keylen, &n, NULL) && n == (DWORD)hdr.keylen
+     && 0 == memcmp(buffer, key, n)
+     && ReadFile(hf, pixels, width * height * 4, &n, NULL)
+     && n == (DWORD)(width * height * 4)) {
+        // used now, for the eviction
+        GetSystemTimeAsFileTime(&now);
+        SetFileTime(hf, NULL, NULL, &now);
+        ok = true;
+    }
+    CloseHandle(hf);
+    return ok;
+}
+
+ST int wpc_cmp(const void *a, const void *b)
+{
+    // newest first
+    return CompareFileTime(&((struct wpc_file*)b)->time, &((struct wpc_file*)a)->time);
+}
+
+// drop what was used longest ago, until the rest fits
+ST void wpc_evict(void)
+{
+    char path[MAX_PATH];
+    WIN32_FIND_DATA fd;
+    struct wpc_file *files = NULL;
+    int n = 0, a = 0, i;
+    unsigned __int64 total, limit;
+    HANDLE h;
+
+    h = FindFirstFile(wpc_path(path, "*" WPC_EXT), &fd);
+    if (INVALID_HANDLE_VALUE == h)
+        return;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        if (n == a)
+            files = (struct wpc_file*)m_realloc(files, (a = a ? 2*a : 16) * sizeof *files);
+        strcpy(files[n].name, fd.cFileName);
+        files[n].size = fd.nFileSizeLow;
+        files[n].time = fd.ftLastWriteTime;
+        ++n;
+    } while (FindNextFile(h, &fd));
+    FindClose(h);
+
+    qsort(files, n, sizeof *files, wpc_cmp);
+    limit = (unsigned __int64)Settings_wallpaperCache << 20;
+    for (total = 0, i = 0; i < n; ++i) {
+        total += files[i].size;
+        // the newest stays anyway, it is the one just made
+        if (i && total > limit)
+            DeleteFile(wpc_path(path, files[i].name));
+    }
+    m_free(files);
+}
+
+ST void wpc_write(const char *name, const char *key, const BYTE *pixels, int width, int height)
+{
+    char path[MAX_PATH];
+    char temp[MAX_PATH];
+    struct wpc_header hdr;
+    HANDLE hf;
+    DWORD n;
+    bool ok;
+
+    CreateDirectory(wpc_path(path, ""), NULL);
+    wpc_path(temp, "$wpcache$.tmp");
+    hf = CreateFile(temp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == hf)
+        return;
+    memcpy(hdr.magic, WPC_MAGIC, sizeof hdr.magic);
+    hdr.width = width;
+    hdr.height = height;
+    hdr.keylen = strlen(key);
+    ok = WriteFile(hf, &hdr, sizeof hdr, &n, NULL)
+        && WriteFile(hf, key, hdr.keylen, &n, NULL)
+        && WriteFile(hf, pixels, width * height * 4, &n, NULL)
+        && n == (DWORD)(width * height * 4);
+    CloseHandle(hf);
+    if (ok && MoveFileEx(temp, wpc_path(path, name), MOVEFILE_REPLACE_EXISTING))
+        wpc_evict();
+    else
+        DeleteFile(temp);
+}
+
+//===========================================================================
+// convert in any case (20ms), bc if it's compatible, it's faster to paint.
+// Stretched to the virtual screen, bmp is deleted.
+ST HBITMAP make_compatible(HBITMAP bmp)
 {
     HWND hwnd_desk = GetDesktopWindow();
     HDC hdc_desk = GetDC(hwnd_desk);
     BITMAP bm;
+
+    if (bmp && GetObject(bmp, sizeof bm, &bm))
+    {
+        HDC hdc_old = CreateCompatibleDC(hdc_desk);
+        HGDIOBJ old_bmp = SelectObject(hdc_old, bmp);
+        HDC hdc_new = CreateCompatibleDC(hdc_desk);
+        HBITMAP bmp_new = CreateCompatibleBitmap(hdc_desk, getWorkspaces().GetVScreenWidth(), getWorkspaces().GetVScreenHeight());
+        SelectObject(hdc_new, bmp_new);
+        StretchBlt(hdc_new, 0, 0, getWorkspaces().GetVScreenWidth(), getWorkspaces().GetVScreenHeight(), hdc_old, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY);
+        DeleteDC(hdc_new);
+        DeleteObject(SelectObject(hdc_old, old_bmp));
+        DeleteDC(hdc_old);
+        bmp = bmp_new;
+    }
+
+    ReleaseDC(hwnd_desk, hdc_desk);
+    return bmp;
+}
+
+//===========================================================================
+// run the bsetroot pipeline here, into a dib that is then made into the
+// compatible bitmap the desktop paints from.
+// Returns false when bsetroot.exe should have a go instead.
+ST bool render_root_bmp(const char *command, HBITMAP *pbmp)
+{
+    struct rootinfo RI;
+    struct rootinfo *r = &RI;
+    char path[MAX_PATH];
+    char line[MAX_PATH];
+    char key[2*MAX_PATH+200];
+    char name[40];
+    BITMAPINFOHEADER bih;
+    HIMG Img = NULL;
+    HBITMAP bmp = NULL;
+    BYTE *pixels;
+    int width, height, n;
+    FILE *fp;
+    bool ok = false, cache;
+
+    *pbmp = NULL;
+    init_root(r);
+
+    // the switches from bsetroot.rc first, as bsetroot.exe does
+    fp = fopen(make_full_path(path, "bsetroot.rc", NULL), "rb");
+    if (fp) {
+        while (read_line(fp, line))
+            if ('-' == line[0] && !parse_root(r, line))
+                break;
+        fclose(fp);
+    }
+    if (0 == parse_root(r, command) || r->help || r->convert)
+        goto done;
+    ok = true;
+
+    root_screensize(r, &width, &height);
+    memset(&bih, 0, sizeof bih);
+    bih.biSize = sizeof bih;
+    bih.biWidth = width;
+    bih.biHeight = height;
+    bih.biPlanes = 1;
+    bih.biBitCount = 32;
+    bih.biCompression = BI_RGB;
+    bmp = CreateDIBSection(NULL, (BITMAPINFO*)&bih, DIB_RGB_COLORS, (void**)&pixels, NULL, 0);
+    if (NULL == bmp) {
+        ok = false;
+        goto done;
+    }
+
+    cache = wpc_key(r, width, height, key, name);
+    if (false == cache || false == wpc_read(name, key, pixels, width, height)) {
+        n = 0;
+        if (r->bmp) {
+            n = root_load(r, &Img);
+            if (n && 0 == r->quiet)
+                BBMessageBox(MB_OK, "#bsetroot#Error: Could not %s image:\n%s",
+                    1 == n ? "find" : "load", r->wpfile);
+        }
+        // not cached with the image missing
+        cache = cache && 0 == n;
+
+        // bsetroot.exe paints its gradients like that
+        bimage_init(true, true);
+        n = root_render(r, &Img, pixels, width, height);
+        bimage_init(Settings_imageDither, mStyle.is_070);
+        if (0 == n) {
+            DeleteObject(bmp);
+            goto done;
+        }
+        if (cache)
+            wpc_write(name, key, pixels, width, height);
+    }
+
+    bih.biWidth = getWorkspaces().GetVScreenWidth();
+    bih.biHeight = getWorkspaces().GetVScreenHeight();
+    if (width == bih.biWidth && height == bih.biHeight) {
+        // that is the final picture already
+        *pbmp = make_compatible(bmp);
+    } else {
+        // the primary screen only, stretched as the saved bmp was,
+        // with the -filter rather than StretchBlt
+        BYTE *pixels_new;
+        HBITMAP bmp_new = CreateDIBSection(NULL, (BITMAPINFO*)&bih,
+            DIB_RGB_COLORS, (void**)&pixels_new, NULL, 0);
+        if (bmp_new)
+            root_scale(NULL, pixels, width, height,
+                pixels_new, bih.biWidth, bih.biHeight,
+                RF_CXIMAGE == r->filter ? RF_AUTO : r->filter);
+        DeleteObject(bmp);
+        *pbmp = make_compatible(bmp_new);
+    }
+    // no memory for it: bsetroot.exe may still manage
+    ok = NULL != *pbmp;
+
+done:
+    image_destroy(Img);
+    delete_root(r);
+    return ok;
+}
+
+ HBITMAP read_bitmap(const char* path, bool delete_after)
+{
+    HWND hwnd_desk = GetDesktopWindow();
+    HDC hdc_desk = GetDC(hwnd_desk);
 #if 0
     HBITMAP bmp = (HBITMAP)LoadImage(NULL, path, IMAGE_BITMAP, 0,0, LR_LOADFROMFILE);
 #else
@@ -117,22 +419,8 @@ HBITMAP make_root_bmp(const char *command)
         fclose(fp);
     }
 #endif
-    if (bmp && GetObject(bmp, sizeof bm, &bm))
-    {
-        // convert in any case (20ms), bc if it's compatible, it's faster to paint.
-        HDC hdc_old = CreateCompatibleDC(hdc_desk);
-        HGDIOBJ old_bmp = SelectObject(hdc_old, bmp);
-        HDC hdc_new = CreateCompatibleDC(hdc_desk);
-        HBITMAP bmp_new = CreateCompatibleBitmap(hdc_desk, getWorkspaces().GetVScreenWidth(), getWorkspaces().GetVScreenHeight());
-        SelectObject(hdc_new, bmp_new);
-        StretchBlt(hdc_new, 0, 0, getWorkspaces().GetVScreenWidth(), getWorkspaces().GetVScreenHeight(), hdc_old, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY);
-        DeleteDC(hdc_new);
-        DeleteObject(SelectObject(hdc_old, old_bmp));
-        DeleteDC(hdc_old);
-        bmp = bmp_new;
-    }
-
     ReleaseDC(hwnd_desk, hdc_desk);
+    bmp = make_compatible(bmp);
     if (delete_after)
         DeleteFile(path);
     return bmp;
@@ -172,6 +460,8 @@ bbexec:
         HBITMAP bmp = make_root_bmp(cptr);
         if (bmp)
             return bmp;
+        if (render_root_bmp(cptr, &bmp))
+            return bmp;
     }
 #endif
 
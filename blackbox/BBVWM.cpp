@@ -22,10 +22,18 @@
 #include "BB.h"
 #include "BBVWM.h"
 #include "Workspaces.h"
+#include "worker.h"
+#include <logging.h>
+#include <algorithm>
 
 #define ST static
 #define SCREEN_DIST 10
 
+// how long (ms) the result of a frozen-window probe is reused
+#define FROZEN_TTL 500
+// max. number of threads that probe windows at the same time
+#define FROZEN_MAX_THREADS 8
+
 struct winlist
 {
     struct winlist *next;
@@ -43,8 +51,11 @@ struct winlist
     bool onbg;
     bool istool;
     bool check;
+    bool frozen;
+    bool probed;
 
     DWORD threadid;
+    DWORD probe_tick;
     HWND root;
 };
 winlist g_Winlist;
@@ -54,6 +65,13 @@ ST bool vwm_styleXPFix;
 ST bool vwm_enabled;
 ST struct winlist *vwm_WL;
 
+ST struct vwm_probe_stats {
+    unsigned rounds;    // calls that needed at least one probe
+    unsigned probes;    // SendMessageTimeout's, one per gui thread
+    unsigned cached;    // windows answered from a recent probe
+    unsigned hung;      // probes that timed out
+} vwm_probe_stats;
+
 ST bool belongs_to_app(winlist *wl, winlist *wl2);
 ST HWND get_root(HWND hwnd);
 ST bool is_shadow(HWND hwnd, LONG ex_style, DWORD threadid);
@@ -98,9 +116,10 @@ winlist * vwm_add_window (HWND hwnd)
             && NULL == GetWindow(hwnd, GW_OWNER))
             wl->istool = true;
 
-        // check whether its listed in 'StickyWindows.ini'
-        wl->sticky_app = getWorkspaces().CheckStickyName(hwnd);
-        wl->onbg = getWorkspaces().CheckOnBgName(hwnd);
+        // check whether its listed in 'StickyWindows.ini'/'BGWindows.ini'
+        unsigned const rules = getWorkspaces().CheckWindowRules(hwnd);
+        wl->sticky_app = 0 != (rules & WR_STICKY);
+        wl->onbg = 0 != (rules & WR_ONBG);
     }
 
     wl->hidden = hidden;
@@ -296,6 +315,153 @@ ST void check_appwindows(winlist *wl_app)
         wl->check = belongs_to_app(wl, wl_app);
 }
 
+//=========================================================
+// Frozen windows would freeze blackbox when we move them. Probing
+// one after the other can cost the full timeout per hung app, so the
+// probes run on worker threads, one per gui thread that owns windows,
+// and the result is kept in the winlist for FROZEN_TTL ms.
+//
+// The workers live as long as the vwm. While they probe, we keep
+// answering sent messages only: a probed window may be sending to us,
+// and posted input must not run into the middle of a desk switch.
+
+struct FrozenProber : Runnable
+{
+    HANDLE m_start; // semaphore, one count per worker per round
+    HANDLE m_done;  // event, the last worker of a round is through
+    HWND const * m_hwnds;
+    char * m_frozen;
+    unsigned m_count;
+    std::atomic<unsigned> m_next;
+    std::atomic<unsigned> m_active;
+    bool m_exit;
+    ThreadPool m_pool;
+
+    FrozenProber ()
+        : m_start(NULL), m_done(NULL), m_hwnds(NULL), m_frozen(NULL)
+        , m_count(0), m_next(0), m_active(0), m_exit(false)
+    { }
+
+    virtual void Run ()
+    {
+        unsigned i;
+        for (;;) {
+            WaitForSingleObject(m_start, INFINITE);
+            if (m_exit)
+                break;
+            while ((i = m_next.fetch_add(1)) < m_count)
+                m_frozen[i] = 0 != is_frozen(m_hwnds[i]);
+            if (1 == m_active.fetch_sub(1))
+                SetEvent(m_done);
+        }
+    }
+
+    void Probe (HWND const * hwnds, char * frozen, unsigned count)
+    {
+        unsigned n;
+        MSG msg;
+
+        if (0 == m_pool.size()) {
+            m_start = CreateSemaphore(NULL, 0, FROZEN_MAX_THREADS, NULL);
+            m_done = CreateEvent(NULL, FALSE, FALSE, NULL);
+            for (n = 0; n < FROZEN_MAX_THREADS; ++n)
+                m_pool.Create(*this);
+        }
+
+        // no worker is in a round when the last one has set m_done
+        n = count < FROZEN_MAX_THREADS ? count : FROZEN_MAX_THREADS;
+        m_hwnds = hwnds;
+        m_frozen = frozen;
+        m_count = count;
+        m_active = n;
+        m_next = 0;
+        ReleaseSemaphore(m_start, n, NULL);
+
+        while (WAIT_OBJECT_0 != MsgWaitForMultipleObjects(
+                1, &m_done, FALSE, INFINITE, QS_SENDMESSAGE))
+            PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+    }
+
+    void Exit ()
+    {
+        if (0 == m_pool.size())
+            return;
+        m_exit = true;
+        ReleaseSemaphore(m_start, (LONG)m_pool.size(), NULL);
+        m_pool.WaitForTerminate();
+        CloseHandle(m_start);
+        CloseHandle(m_done);
+        m_exit = false;
+    }
+};
+
+ST FrozenProber vwm_prober;
+
+ST void probe_frozen(bool only_checked)
+{
+    std::vector<DWORD> threads;
+    std::vector<HWND> hwnds;
+    std::vector<char> frozen;
+    winlist *wl;
+    DWORD now, t0;
+    unsigned i, n, hung;
+
+    now = GetTickCount();
+    dolist (wl, vwm_WL) {
+        if (only_checked && false == wl->check)
+            continue;
+        if (wl->probed && now - wl->probe_tick < FROZEN_TTL) {
+            ++vwm_probe_stats.cached;
+            continue;
+        }
+        if (wl->threadid == BBThreadId) {
+            // our own windows answer when we do
+            wl->frozen = false;
+            wl->probed = true;
+            wl->probe_tick = now;
+            continue;
+        }
+        if (threads.end() == std::find(threads.begin(), threads.end(), wl->threadid)) {
+            threads.push_back(wl->threadid);
+            hwnds.push_back(wl->hwnd);
+        }
+    }
+
+    n = (unsigned)hwnds.size();
+    if (0 == n)
+        return;
+
+    t0 = GetTickCount();
+    frozen.resize(n);
+    if (1 == n) {
+        frozen[0] = 0 != is_frozen(hwnds[0]);
+    } else {
+        vwm_prober.Probe(&hwnds[0], &frozen[0], n);
+    }
+
+    hung = 0;
+    for (i = 0; i < n; ++i) {
+        dolist (wl, vwm_WL)
+            if (wl->threadid == threads[i]) {
+                wl->frozen = 0 != frozen[i];
+                wl->probed = true;
+                wl->probe_tick = now;
+            }
+        hung += frozen[i];
+    }
+
+    ++vwm_probe_stats.rounds;
+    vwm_probe_stats.probes += n;
+    vwm_probe_stats.hung += hung;
+    if (hung)
+        TRACE_MSG(trace::e_Info, trace::CTX_BBCore,
+            "VWM: %u of %u window threads not responding, probed in %u ms"
+            " (total: %u rounds, %u probes, %u cached, %u hung)",
+            hung, n, GetTickCount() - t0,
+            vwm_probe_stats.rounds, vwm_probe_stats.probes,
+            vwm_probe_stats.cached, vwm_probe_stats.hung);
+}
+
 //=========================================================
 ST void defer_windows(int newdesk)
 {
@@ -318,6 +484,7 @@ ST void defer_windows(int newdesk)
     winmoved = false;
 
     if (vwm_WL) {
+        probe_frozen(false);
         dwp = BeginDeferWindowPos(listlen(vwm_WL));
         dolist (wl, vwm_WL)
         {
@@ -326,7 +493,7 @@ ST void defer_windows(int newdesk)
 
             // frozen windows would freeze blackbox in
             // "EndDeferWindowPos" below
-            if (is_frozen(wl->hwnd))
+            if (wl->frozen)
                 goto next;
 
             if (gather || wl->sticky) {
@@ -418,7 +585,7 @@ ST void defer_windows(int newdesk)
 
 ST void explicit_move(winlist *wl)
 {
-    if (!wl->iconic && !is_frozen(wl->hwnd))
+    if (!wl->iconic && !wl->frozen)
         SetWindowPos(wl->hwnd, NULL,
             wl->rect.left,
             wl->rect.top,
@@ -450,6 +617,8 @@ ST bool set_location_helper(HWND hwnd, taskinfo const * t, unsigned flags)
     move_before = switch_desk == window_desk;
 
     check_appwindows(wl);
+    if (vwm_alt_method && (flags & BBTI_SETPOS))
+        probe_frozen(true);
     defer = switch_desk != getWorkspaces().GetScreenCurrent();
 
     dolist (wl, vwm_WL)
@@ -570,10 +739,10 @@ bool vwm_set_onbg(HWND hwnd, bool set)
     return true;
 }
 
-static void bottomize(HWND hwnd)
+static void bottomize(winlist *wl)
 {
-    if (!is_frozen(hwnd))
-        SetWindowPos(hwnd, HWND_BOTTOM, 0, 0, 0, 0,
+    if (!wl->frozen)
+        SetWindowPos(wl->hwnd, HWND_BOTTOM, 0, 0, 0, 0,
             SWP_NOACTIVATE|SWP_NOSIZE|SWP_NOMOVE|SWP_NOSENDCHANGING);
 }
 
@@ -585,9 +754,10 @@ bool vwm_lower_window(HWND hwnd)
     if (NULL == wl)
         return false;
     check_appwindows(wl);
+    probe_frozen(true);
     dolist (wl, vwm_WL)
         if (wl->check)
-            bottomize(wl->hwnd);
+            bottomize(wl);
     return true;
 }
 
@@ -660,6 +830,7 @@ void vwm_init(void)
 
 void vwm_exit(void)
 {
+    vwm_prober.Exit();
     freeall(&vwm_WL);
 }
 
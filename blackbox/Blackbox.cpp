@@ -65,6 +65,7 @@ static RECT g_OldDT = RECT();
 static bool g_shutting_down = false;
 static bool g_in_restart = false;
 static unsigned g_stack_top = 0; //@FIXME: 64bit!
+static unsigned g_timer_wakeups = 0; /* for BB_TIMERWAKEUPS */
 
 //====================
 
@@ -541,6 +542,8 @@ int WINAPI WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLin
 			if (GetMessage(&msg, NULL, 0, 0) <= 0)
 				break;
 			//dbg_printf("hwnd %x, msg %d wp %x lp %x", msg.hwnd, msg.message, msg.wParam, msg.lParam);
+			if (WM_TIMER == msg.message)
+				++g_timer_wakeups;
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
@@ -824,6 +827,9 @@ bb_quit:
 			post_command((const char*)lParam);
 			break;
 
+		case BB_TIMERWAKEUPS:
+			return g_timer_wakeups;
+
 		//====================
 		case BB_BROADCAST:
 			if (false == exec_broam((const char*)lParam))
@@ -972,7 +978,7 @@ bb_quit:
 		// to get the correct window states with active or iconized.
 		case BB_DESKTOPINFO:
 		case BB_TASKSUPDATE:
-			SetTimer(hwnd, BB_TASKUPDATE_TIMER, 200, NULL);
+			timer_set(hwnd, BB_TASKUPDATE_TIMER, 200, 100);
 			goto dispatch_bb_message;
 
 		//====================
@@ -96,6 +96,8 @@ static const struct cfgmenu cfg_sub_plugins[] = {
 #endif
 	{ NLS0("Edit plugins.rc"),		"@BBCore.editPlugins", NULL },
 	{ NLS0("About Plugins"),		"@BBCore.aboutPlugins", NULL },
+	{ NLS0("Startup Times"),		"plugin.times", NULL },
+	{ NLS0("Save Startup Times"),	"plugin.times file", NULL },
 	{ NULL,NULL,NULL },
 };
 /*
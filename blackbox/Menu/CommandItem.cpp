@@ -334,6 +334,7 @@ StringItem::StringItem(const char* pszCommand, const char *init_string)
         replace_str(&m_pszTitle, init_string);
     hText = NULL;
     m_ItemID = MENUITEM_ID_STR;
+    m_bOwnPaint = true; // places the edit control
 }
 
 StringItem::~StringItem()
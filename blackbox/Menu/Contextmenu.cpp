@@ -221,6 +221,7 @@ ContextItem::ContextItem(Menu *m, char* pszTitle, int id, DWORD data, UINT type)
     m_data = data;
     m_type = type;
     m_bmp = NULL;
+    m_bOwnPaint = true; // owner drawn by the shell
     if (NULL == m)
     {
         m_nSortPriority = M_SORT_NORMAL;
@@ -92,6 +92,7 @@ Menu::~Menu()
 	//dbg_printf("%s this=%x %d %s", __FUNCTION__, this, m_refc, m_pMenuItems->m_pszTitle);
     DeleteMenuItems();
     delete m_pMenuItems; // TitleItem
+    free_rasters();
     free_str(&m_IDString);
     delete_pidl_list(&m_pidl_list);
 
@@ -218,6 +219,7 @@ void Menu::destroy_menu_window(bool force)
     DestroyWindow(hwnd);
     if (m_hBitMap)
         DeleteObject(m_hBitMap), m_hBitMap = NULL;
+    free_rasters();
     decref();
 }
 
@@ -580,30 +582,67 @@ void Menu::scroll_menu(int n)
 // assign y coordinates to items according to _new topindex
 void Menu::scroll_assign_items(int new_top)
 {
-    int c0, c1, c, y;
+    int c0, c1, c, y, o;
     MenuItem *pItem;
+    RECT r, fresh;
+    ScrollPlan plan;
 
     new_top = imax(0, imin(new_top, m_itemcount - m_pagesize));
     if (m_hBitMap)
     {
         if (m_topindex == new_top)
             return;
-        InvalidateRect(m_hwnd, NULL, FALSE);
+        // the screen must be up to date before it is shifted
+        if (m_bFlatRows)
+            UpdateWindow(m_hwnd);
     }
 
-    c0  = m_topindex = new_top;
+    c0  = new_top;
     c1  = c0 + m_pagesize;
     c   = 0;
     y   = m_firstitem_top;
+    plan.Start();
     pItem = m_pMenuItems;
     while (NULL != (pItem=pItem->next)) // skip TitleItem
     {
+        o = pItem->m_nTop;
         if (c<c0 || c>=c1)
             pItem->m_nTop = -1000;
         else
             pItem->m_nTop = y, y += pItem->m_nHeight;
+
+        // what moves by how much, and what comes into view
+        plan.Item(c, m_topindex, c0, o, pItem->m_nTop, pItem->m_nHeight);
         c++;
     }
+    m_topindex = new_top;
+
+    if (NULL == m_hBitMap)
+        return;
+
+    // Where the background allows, shift what is on the screen already
+    // and paint only the items that came into view (plus the scroller,
+    // which was shifted with them). Items with an edit or combo control
+    // move it in Paint only, so with one of these all is repainted.
+    r.left = 0, r.right = m_width;
+    r.top = m_firstitem_top, r.bottom = imax(plan.old_end, plan.new_end);
+    if (false == m_bFlatRows
+     || m_hwndChild
+     || false == plan.Shift(r.top, m_height - MenuInfo.nFrameMargin,
+            mStyle.MenuFrame.interlaced)) {
+        InvalidateRect(m_hwnd, NULL, FALSE);
+        return;
+    }
+    ScrollWindowEx(m_hwnd, 0, -plan.dy, &r, &r, NULL, NULL, SW_INVALIDATE);
+    fresh = r, fresh.top = plan.fresh_top, fresh.bottom = plan.fresh_bottom;
+    InvalidateRect(m_hwnd, &fresh, FALSE);
+    if (plan.new_end < r.bottom) {
+        fresh = r, fresh.top = plan.new_end;
+        InvalidateRect(m_hwnd, &fresh, FALSE);
+    }
+    get_vscroller_rect(&fresh);
+    fresh.top = r.top, fresh.bottom = m_height;
+    InvalidateRect(m_hwnd, &fresh, FALSE);
 }
 
 //===========================================================================
@@ -680,7 +719,7 @@ void Menu::bring_ontop(bool force_active)
 void Menu::Paint()
 {
     PAINTSTRUCT ps;
-    HDC hdc, hdc_screen, back;
+    HDC hdc, hdc_screen, back, items;
     RECT r;
     HGDIOBJ S0, F0, B0;
     int y1,y2,c1,c2,c;
@@ -755,6 +794,7 @@ void Menu::Paint()
     F0 = SelectObject(hdc, MenuInfo.hFrameFont);
 
     c = -1, c1 = m_topindex, c2 = c1 + m_pagesize;
+    items = raster_dc(hdc_screen);
 
     // skip items scrolled out on top
     while (c < c1 && pItem)
@@ -766,10 +806,12 @@ void Menu::Paint()
         if (y >= y2)
             break;
         if (y + pItem->m_nHeight > y1)
-            pItem->Paint(hdc);
+            paint_item(hdc, items, pItem);
         pItem = pItem->next, ++c;
     }
     SelectObject(hdc, F0);
+    if (items)
+        DeleteDC(items);
 
 	/* BlackboxZero 1.7.2012 - Check for disabled
 	** Only draw if not disabled.. */
@@ -795,14 +837,20 @@ void Menu::Paint()
 		//int hue = eightScale_up(Settings_menu.scrollHue);
 		int hue = Settings_menu.scrollHue; // no eightscale up
 		if (hue) {
-			int x,y;
-			for (x = r.left; x < r.right; ++x)
-				for (y = r.top; y < r.bottom; ++y)
-					SetPixel(hdc, x, y, mixcolors(
-						GetPixel(hdc, x, y),
-						GetPixel(buf, x - r.left, y - r.top),
-						hue
-					));
+			// mix the button into the menu, in dibs of both
+			RECT rs;
+			DWORD *d, *p;
+			HDC dst, src;
+			int w = r.right - r.left, y;
+			rs.left = rs.top = 0;
+			rs.right = w, rs.bottom = r.bottom - r.top;
+			dst = dib_copy(hdc, &r, &d);
+			src = dib_copy(buf, &rs, &p);
+			if (dst && src)
+				for (y = 0; y < rs.bottom; ++y)
+					mix_span(d + y * w, p + y * w, w, hue);
+			dib_release(src, NULL, &rs);
+			dib_release(dst, src ? hdc : NULL, &r);
 		} else
 			BitBlt(hdc, r.left, r.top, r.right-r.left, r.bottom-r.top, buf, 0, 0, SRCCOPY);
 
@@ -833,6 +881,91 @@ void Menu::Paint()
     EndPaint(m_hwnd, &ps);
 }
 
+//==============================================
+// Item rasters. Where the rows of the background behind the items are
+// all alike, an item looks the same wherever it is scrolled to. Then it
+// is painted once per state into a slot of m_hBmpItems and later just
+// copied from there. The cache goes with the background in Validate().
+
+HDC Menu::raster_dc(HDC hdc)
+{
+    HDC buf;
+    if (false == m_bFlatRows || 0 == m_slot_h)
+        return NULL;
+    if (NULL == m_hBmpItems)
+    {
+        // enough for two pages, so that one page never evicts itself
+        if (false == m_rasters.Init(2 * m_pagesize + 2))
+            return NULL;
+        m_hBmpItems = CreateCompatibleBitmap(hdc, m_width, m_rasters.count * m_slot_h);
+        if (NULL == m_hBmpItems) {
+            m_rasters.Free();
+            return NULL;
+        }
+    }
+    buf = CreateCompatibleDC(hdc);
+    SelectObject(buf, m_hBmpItems);
+    SelectObject(buf, MenuInfo.hFrameFont);
+    SetBkMode(buf, TRANSPARENT);
+    return buf;
+}
+
+void Menu::paint_item(HDC hdc, HDC buf, MenuItem *pItem)
+{
+    HDC back;
+    HGDIOBJ S0;
+    int s, y, h, key;
+
+    h = pItem->m_nHeight;
+    if (NULL == buf || pItem->m_bOwnPaint || h > m_slot_h) {
+        pItem->Paint(hdc);
+        return;
+    }
+
+    key = (pItem->m_bActive && false == pItem->m_bNOP)
+        | pItem->m_bDisabled << 1
+        | pItem->m_bChecked << 2
+        | (mStyle.MenuFrame.interlaced ? (pItem->m_nTop & 1) << 3 : 0);
+
+    s = pItem->m_slot;
+    if (false == m_rasters.Has(s, pItem, key))
+    {
+        s = m_rasters.Take(pItem, key);
+        y = s * m_slot_h;
+
+        // the background, then the item on it, as if at its place
+        back = CreateCompatibleDC(buf);
+        S0 = SelectObject(back, m_hBitMap);
+        BitBlt(buf, 0, y, m_width, h, back, 0, pItem->m_nTop, SRCCOPY);
+        SelectObject(back, S0);
+        DeleteDC(back);
+
+        SetViewportOrgEx(buf, 0, y - pItem->m_nTop, NULL);
+        IntersectClipRect(buf, 0, pItem->m_nTop, m_width, pItem->m_nTop + h);
+        pItem->Paint(buf);
+        SelectClipRgn(buf, NULL);
+        SetViewportOrgEx(buf, 0, 0, NULL);
+
+        // not with an icon that is still to come
+        if (pItem->icon_pending())
+            m_rasters.Drop(s, pItem);
+        pItem->m_slot = s;
+    }
+    BitBlt(hdc, 0, pItem->m_nTop, m_width, h, buf, 0, s * m_slot_h, SRCCOPY);
+}
+
+void Menu::drop_raster(MenuItem *pItem)
+{
+    m_rasters.Drop(pItem->m_slot, pItem);
+}
+
+void Menu::free_rasters(void)
+{
+    if (m_hBmpItems)
+        DeleteObject(m_hBmpItems), m_hBmpItems = NULL;
+    m_rasters.Free();
+}
+
 //==============================================
 // Calculate sizes of the menu-window
 
@@ -842,14 +975,16 @@ void Menu::Validate()
     int border  = mStyle.MenuFrame.borderWidth;
     int tborder = mStyle.MenuTitle.borderWidth;
     int tm      = MenuInfo.nTitleMargin;
-    int w1, w2, c0, c1, h, hmax, x; SIZE size;
+    int w1, w2, c0, c1, h, hmax, x, t; SIZE size;
 
     MenuItem *pItem;
+    StyleItem *pSI;
     HDC hDC;
     HGDIOBJ other_font;
     char opt_cmd[1000];
 
     w1 = w2 = c0 = c1 = h = 0;
+    m_slot_h = 0;
     opt_cmd[0] = 0;
 
     m_bNoTitle = (m_flags & BBMENU_NOTITLE) || mStyle.menuNoTitle;
@@ -875,6 +1010,8 @@ void Menu::Validate()
         pItem->m_nHeight = size.cy;
         if (size.cx > w2)
             w2 = size.cx;
+        if (size.cy > m_slot_h)
+            m_slot_h = size.cy;
         if (pItem->m_ItemID & MENUITEM_UPDCHECK) {
             // update checkmark (for stylemenu folder etc.)
             pItem->m_bChecked = get_opt_command(opt_cmd, pItem->m_pszCommand);
@@ -945,12 +1082,27 @@ void Menu::Validate()
         }
     }
 
+    // Can items be scrolled by blitting and be cached as rasters? Only
+    // if each row of the background looks the same below the title and
+    // above the bottom margin (see Paint)
+    pSI = &mStyle.MenuFrame;
+    t = m_bNoTitle
+        || mStyle.MenuTitle.parentRelative
+        || mStyle.menuTitleLabel ? border : MenuInfo.nTitleHeight;
+    if (BEVEL_FLAT != pSI->bevelstyle)
+        t += pSI->bevelposition, border += pSI->bevelposition;
+    m_bFlatRows = false == pSI->parentRelative
+        && (B_SOLID == pSI->type || B_HORIZONTAL == pSI->type % 100)
+        && m_firstitem_top >= t
+        && margin >= border;
+
     // need a _new background
     if (m_hBitMap)
     {
         DeleteObject(m_hBitMap), m_hBitMap = NULL;
         InvalidateRect(m_hwnd, NULL, FALSE);
     }
+    free_rasters();
 
     // assign y-coords
     scroll_menu(0);
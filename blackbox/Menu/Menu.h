@@ -29,6 +29,7 @@
 #include "../BBApi.h"
 #include "MenuMaker.h"
 #include "../DataTypes.h"
+#include "MenuRaster.h"
 
 struct MenuList { struct MenuList *next; class Menu *m; };
 
@@ -97,6 +98,10 @@ protected:
 
     HBITMAP     m_hBitMap;      // background bitmap, only while onscreen
     HBITMAP     m_hBmpScroll;   // bitmap to paint scroller
+    HBITMAP     m_hBmpItems;    // item rasters, see paint_item()
+    RasterSlots m_rasters;      // the slots of m_hBmpItems
+    int         m_slot_h;       // height of a slot (the highest item)
+    bool        m_bFlatRows;    // background rows behind items all alike
     HWND        m_hwnd;         // window handle, only while onscreen
     HWND        m_hwndChild;    // edit control of StringItems
     HWND        m_hwndRef;      // hwnd to send notifications to */
@@ -175,6 +180,12 @@ protected:
     void scroll_assign_items(int n);
     void scroll_menu(int n);
 
+    // item rasters
+    HDC raster_dc(HDC hdc);
+    void paint_item(HDC hdc, HDC buf, MenuItem *pItem);
+    void free_rasters(void);
+    void drop_raster(MenuItem *pItem);
+
     // keyboard
     MenuItem * kbd_get_next_shortcut(const char *d);
     void kbd_hilite(MenuItem *pItem);
@@ -347,6 +358,9 @@ public:
     // mouse over check
     inline bool isover(int y) { return y >= m_nTop && y < m_nTop + m_nHeight; }
 
+    // the icon is still being loaded by the thread
+    inline bool icon_pending() { return NULL == m_hIcon && NULL != m_iconLoaderWorkItem; }
+
     // ----------------------
     char *m_pszTitle;
     char *m_pszCommand;
@@ -370,6 +384,9 @@ public:
     bool m_bNOP;            // just text
     bool m_bDisabled;       // draw with disabledColor
     bool m_bChecked;        // draw check mark
+    bool m_bOwnPaint;       // Paint() does more than draw, never cached
+
+    int m_slot;             // raster slot in m_pMenu, see Menu::paint_item()
 
 //#ifdef BBOPT_MENUICONS
     HICON m_hIcon;
@@ -57,6 +57,9 @@ MenuItem::~MenuItem()
         delete m_iconLoaderWorkItem;
     }
 
+    if (m_pMenu)
+        m_pMenu->drop_raster(this);
+
     UnlinkSubmenu();
     if (m_pRightmenu)
         m_pRightmenu->decref();
@@ -450,58 +453,69 @@ void SeparatorItem::Paint(HDC hDC)
 	int dist = (m_nWidth+1) / 2 - ((Settings_menu.separatorFullWidth)?1:mStyle.MenuSepMargin);
 	COLORREF c = mStyle.MenuSepColor;
 	COLORREF cs = mStyle.MenuSepShadowColor;//pSI->ShadowColor; /*12.08.2011*/
-
-	if (pSI->ShadowXY) {
-		int yS = y + pSI->ShadowY;
-		int leftS  = left + pSI->ShadowX;
-		int rightS = right + pSI->ShadowX;
-		if (0 == _stricmp(Settings_menu.separatorStyle,"gradient")) {
-			// Gradient shadow
-			for (x = 0; x <= dist; ++x) {
-				int pos, hue = x * 255 / dist;
-				pos = leftS + x;
-				SetPixel(hDC, pos, yS, mixcolors(cs, GetPixel(hDC, pos, y), hue));
-				pos = rightS - x;
-				SetPixel(hDC, pos, yS, mixcolors(cs, GetPixel(hDC, pos, y), hue));
-			}
-		} else if (0 == _stricmp(Settings_menu.separatorStyle,"flat")) {
+	bool gradient = 0 == _stricmp(Settings_menu.separatorStyle,"gradient");
+	bool flat = 0 == _stricmp(Settings_menu.separatorStyle,"flat");
+	bool bevel = 0 == _stricmp(Settings_menu.separatorStyle,"bevel");
+	// Bevel shadow is simply none...
+	bool shadow = pSI->ShadowXY && (gradient || flat);
+	int yS = y + pSI->ShadowY;
+	int leftS  = left + pSI->ShadowX;
+	int rightS = right + pSI->ShadowX;
+	BYTE *f, *g;
+	DWORD *bits;
+	HDC dib;
+	RECT r;
+	int w;
+
+	if (dist <= 0 || false == (gradient || flat || bevel))
+		return;
+
+	// the rows it touches in a dib, rather than pixel by pixel with GDI
+	r.left = imin(left, leftS), r.right = imax(right, rightS) + 1;
+	r.top = y, r.bottom = y + (bevel ? 2 : 1);
+	if (shadow)
+		r.top = imin(r.top, yS), r.bottom = imax(r.bottom, yS + 1);
+	dib = dib_copy(hDC, &r, &bits);
+	if (NULL == dib)
+		return;
+	w = r.right - r.left;
+#define PIX(px, py) (bits + ((py) - r.top) * w + (px) - r.left)
+
+	// f from the left, g from the right
+	f = (BYTE*)m_alloc(2 * (dist + 1));
+	g = f + dist + 1;
+	for (x = 0; x <= dist; ++x)
+		f[x] = g[dist - x] = (BYTE)(gradient ? x * 255 / dist : 160);
+
+	if (shadow) {
+		if (gradient) {
+			// Gradient shadow, over what is above it
+			mix_color_span(PIX(leftS, yS), PIX(leftS, y), dist + 1, switch_rgb(cs), f);
+			mix_color_span(PIX(rightS - dist, yS), PIX(rightS - dist, y), dist + 1, switch_rgb(cs), g);
+		} else {
 			// Flat shadow
-			for (x = 0; x <= dist; ++x) {
-				int pos;
-				pos = leftS + x;
-				SetPixel(hDC, pos, yS, cs);
-				pos = rightS - x;
-				SetPixel(hDC, pos, yS, cs);
-			}
-		} /*else if (0 == stricmp(Settings_menu.separatorStyle,"bevel")) {
-				// Bevel shadow is simply none...
-		}*/
+			for (x = 0; x <= dist; ++x)
+				*PIX(leftS + x, yS) = *PIX(rightS - x, yS) = switch_rgb(cs);
+		}
 	}
 
 	//Draw Separator
-    if (0 == _stricmp(Settings_menu.separatorStyle,"gradient")) {
-		for (x = 0; x <= dist; ++x) {
-			int pos, hue = x * 255 / dist;
-			pos = left + x;
-			SetPixel(hDC, pos, y, mixcolors(c, GetPixel(hDC, pos, y), hue));
-			pos = right - x;
-			SetPixel(hDC, pos, y, mixcolors(c, GetPixel(hDC, pos, y), hue));
-		}
-	} else if (0 == _stricmp(Settings_menu.separatorStyle,"flat")) {
-		for (x = 0; x <= dist; ++x) {
-			int pos; //, hue = x * 255 / dist;
-			pos = left + x; SetPixel(hDC, pos, y, c);
-			pos = right - x; SetPixel(hDC, pos, y, c);
-		}
-	} else if (0 == _stricmp(Settings_menu.separatorStyle,"bevel")) {
-		for (x = 0; x <= dist; ++x) {
-			int pos;
-			pos = left + x; SetPixel(hDC, pos, y, mixcolors(0x00000000, GetPixel(hDC, pos, y), 160));
-			pos = right - x; SetPixel(hDC, pos, y, mixcolors(0x00000000, GetPixel(hDC, pos, y), 160));
-			pos = left + x; SetPixel(hDC, pos, y+1, mixcolors(0x00FFFFFF, GetPixel(hDC, pos, y+1), 160));
-			pos = right - x; SetPixel(hDC, pos, y+1, mixcolors(0x00FFFFFF, GetPixel(hDC, pos, y+1), 160));
-		}
+	if (gradient) {
+		mix_color_span(PIX(left, y), PIX(left, y), dist + 1, switch_rgb(c), f);
+		mix_color_span(PIX(right - dist, y), PIX(right - dist, y), dist + 1, switch_rgb(c), g);
+	} else if (flat) {
+		for (x = 0; x <= dist; ++x)
+			*PIX(left + x, y) = *PIX(right - x, y) = switch_rgb(c);
+	} else {
+		mix_color_span(PIX(left, y), PIX(left, y), dist + 1, 0x00000000, f);
+		mix_color_span(PIX(right - dist, y), PIX(right - dist, y), dist + 1, 0x00000000, g);
+		mix_color_span(PIX(left, y+1), PIX(left, y+1), dist + 1, 0x00FFFFFF, f);
+		mix_color_span(PIX(right - dist, y+1), PIX(right - dist, y+1), dist + 1, 0x00FFFFFF, g);
 	}
+#undef PIX
+
+	m_free(f);
+	dib_release(dib, hDC, &r);
 }
 
 #include <shellapi.h>
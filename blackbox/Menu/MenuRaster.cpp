@@ -0,0 +1,102 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// MenuRaster.cpp - scroll steps and item raster slots, see MenuRaster.h
+
+#include "../BBApi.h"
+#include "bblib.h"
+#include "MenuRaster.h"
+
+//===========================================================================
+// ScrollPlan
+
+void ScrollPlan::Start(void)
+{
+    dy = old_end = new_end = 0;
+    fresh_top = fresh_bottom = 0;
+}
+
+void ScrollPlan::Item(int c, int c0, int c1, int y0, int y1, int h)
+{
+    if (c >= c1 && c < c0)
+        dy -= h;
+    else if (c >= c0 && c < c1)
+        dy += h;
+    if (y0 != -1000)
+        old_end = y0 + h;
+    if (y1 != -1000) {
+        new_end = y1 + h;
+        if (y0 == -1000) {
+            // the new ones are next to each other
+            if (fresh_top == fresh_bottom)
+                fresh_top = y1;
+            fresh_bottom = y1 + h;
+        }
+    }
+}
+
+bool ScrollPlan::Shift(int top, int limit, bool interlaced)
+{
+    int bottom = imax(old_end, new_end);
+    return false == (interlaced && (dy & 1))
+        && iabs(dy) < bottom - top
+        && bottom <= limit;
+}
+
+//===========================================================================
+// RasterSlots
+
+bool RasterSlots::Init(int n)
+{
+    item = (const void**)c_alloc(n * sizeof *item);
+    key = (int*)c_alloc(n * sizeof *key);
+    count = n, next = 0;
+    if (item && key)
+        return true;
+    Free();
+    return false;
+}
+
+void RasterSlots::Free(void)
+{
+    m_free(item), item = NULL;
+    m_free(key), key = NULL;
+    count = 0;
+}
+
+bool RasterSlots::Has(int slot, const void *p, int k)
+{
+    return slot >= 0 && slot < count && item[slot] == p && key[slot] == k;
+}
+
+int RasterSlots::Take(const void *p, int k)
+{
+    int s = next;
+    next = (s + 1) % count;
+    item[s] = p, key[s] = k;
+    return s;
+}
+
+void RasterSlots::Drop(int slot, const void *p)
+{
+    if (slot >= 0 && slot < count && item[slot] == p)
+        item[slot] = NULL;
+}
@@ -0,0 +1,68 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// MenuRaster.h - what scrolling by blitting and the item rasters decide
+//
+// The parts of Menu::scroll_assign_items() and Menu::paint_item() that
+// need no GDI, so that they can be tested on their own.
+
+#ifndef _MENURASTER_H_
+#define _MENURASTER_H_
+
+// A scroll step, fed with the items in order: by how much what stays in
+// view moves, and what comes into view
+struct ScrollPlan
+{
+    int dy;             // moves up by this, down if < 0
+    int old_end;        // bottom of the items in view before
+    int new_end;        // and after
+    int fresh_top;      // rows of the items that came into view
+    int fresh_bottom;
+
+    void Start(void);
+    // item 'c' of the page from index c0 before and c1 now, from y0 to
+    // y1 (-1000 is out of view)
+    void Item(int c, int c0, int c1, int y0, int y1, int h);
+    // whether the band from 'top' can be shifted. It must end above
+    // 'limit', keep some of it in view and, with an interlaced
+    // background, keep the rows' parity.
+    bool Shift(int top, int limit, bool interlaced);
+};
+
+// slots of item rasters in a bitmap, reused round robin
+struct RasterSlots
+{
+    const void **item;  // the item in each slot
+    int *key;           // and its state when painted
+    int count;          // number of slots
+    int next;           // slot to use next
+
+    bool Init(int n);
+    void Free(void);
+    // whether 'slot' has the item as in that state
+    bool Has(int slot, const void *p, int k);
+    // the next slot, now for the item in that state
+    int Take(const void *p, int k);
+    // not the item's any more
+    void Drop(int slot, const void *p);
+};
+
+#endif
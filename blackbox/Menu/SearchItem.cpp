@@ -516,7 +516,9 @@ void ResultItemContext::Invoke (int button)
 
 ArgItem::ArgItem (const char* pszCommand, const char* pszTitle)
 	: CommandItem(pszCommand, pszTitle, false)
-{ }
+{
+	m_bOwnPaint = true; // places the combo box
+}
 ArgItem::~ArgItem ()
 {
 	if (m_combo)
@@ -0,0 +1,147 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// Pixmap.cpp - the glyphs of bbDrawPix encoded and drawn into masks
+//
+// Without GDI calls, so that it can be tested on its own. Utils.cpp
+// makes the bitmap from the masks and blits it.
+
+#include "BBApi.h"
+#include "bblib.h"
+#include "Pixmap.h"
+
+const unsigned char defpix[] = {
+    0x8E,0x00,
+    11,11,12,0,
+    0,0,5,0,12,0,22,0,29,0,39,0,
+    48,0,55,0,64,0,78,0,87,0,101,0,
+    0x04,0x24,0xC4,0xA4,0x00,
+    0x03,0x14,0xA4,0xB4,0xA4,0x94,0x00,
+    0x03,0x53,0x93,0x17,0x93,0x17,0x93,0x17,0xD3,0x00,
+    0x03,0x15,0xB4,0xD3,0xB4,0x95,0x00,
+    0x03,0x34,0x93,0x17,0x93,0x17,0x93,0x17,0xB4,0x00,
+    0x02,0x18,0xA7,0xA6,0xA2,0x25,0xB3,0x94,0x00,
+    0x03,0x23,0xC3,0xE3,0xC3,0xA3,0x00,
+    0x02,0x14,0xA4,0xB4,0xC4,0xB4,0xA4,0x94,0x00,
+    0x02,0x72,0x92,0x18,0x92,0x18,0x92,0x18,0x92,0x18,0x92,0x18,0xF2,0x00,
+    0x02,0x15,0xB4,0xD3,0xF2,0xD3,0xB4,0x95,0x00,
+    0x02,0x34,0x93,0x17,0x92,0x18,0x92,0x18,0x92,0x18,0x93,0x17,0xB4,0x00,
+    0x02,0x18,0xA7,0x92,0x36,0xA2,0x35,0xD2,0xB3,0x94,0x00
+};
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The glyphs of a bullet bitmap (top-down 32 bit pixels, black on any
+// other color) in the run-length format of defpix. Glyphs are w x w in cells
+// of w+1 pixels, 6 in a row, unix style in the first row and the
+// others in the second.
+
+pixinfo *pix_encode(const DWORD *pixels, int width, int height)
+{
+    int y, x, px, py, x0, y0;
+    unsigned char *v;
+    pixinfo *pmi, *pmi2;
+
+    int w, h;
+    int bx, by;
+
+    bx = 6;
+    w = (width-1)/bx-1;
+    // the encoding below can handle 15x15 max.
+    w = h = iminmax(w, 9, 15);
+    // and 'vector' has room for two rows
+    by = iminmax((height-1)/(h+1), 0, 2);
+
+    // dbg_printf("bx:%d - by:%d - %d/%d", bx, by, w, h);
+
+    pmi = (pixinfo *)c_alloc(sizeof(pixinfo) + bx*by * h * (w*3+1));
+    pmi->w = (char)w;
+    pmi->h = (char)h;
+    pmi->n = (char)(bx*by);
+    v = pmi->bits;
+
+    for (py = 0; py < by; ++py) {
+    for (px = 0; px < bx; ++px) {
+        pmi->vector[px+py*bx] = (unsigned short)(v - pmi->bits);
+        for (y0 = y = 0; y < h; ++y) {
+        for (x0 = x = 0; x <= w; ++x) {
+            int dx = x - x0;
+            if (dx == 7) {
+                --x;
+            } else if (x < w) {
+                int sx = px*(w+1)+1+x, sy = py*(h+1)+1+y;
+                if (sx < width && sy < height
+                 && 0 == (pixels[sy*width+sx] & 0xFFFFFF))
+                    continue;
+            }
+            if (dx) {
+                int dy = y - y0;
+                if (dy) {
+                    if (dy == 1)
+                        dx |= 8;
+                    else
+                        *v++ = (unsigned char)dy;
+                    y0 = y;
+                }
+                *v++ = (unsigned char)((dx<<4)|x0);
+            }
+            x0 = x+1;
+        }}
+        *v++ = 0;
+    }}
+
+    pmi->size = (short)(sizeof(pixinfo) + (v - pmi->bits - 2));
+
+    pmi2 = (pixinfo *)m_alloc(pmi->size);
+    memcpy(pmi2, pmi, pmi->size);
+    m_free(pmi);
+    return pmi2;
+}
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Clear the bits of glyph 'pic' in a 1 bpp mask (rows of 'stride'
+// bytes, high bit first) at column x, flipped if 'mirror'
+
+void pix_mask(const pixinfo *pmi, int pic, bool mirror,
+    unsigned char *mask, int stride, int x)
+{
+    const unsigned char *pv;
+    unsigned char c;
+    int y, z, x1, px;
+
+    pv = pmi->bits + pmi->vector[pic];
+    for (y = 0; 0 != (c = *pv); ++pv) {
+        z = c >> 4;
+        if (z == 0) {
+            y += c;
+            continue;
+        }
+        if (z & 8) {
+            z &= 7;
+            ++y;
+        }
+        if (y >= pmi->h)
+            break;
+        for (x1 = c & 15; z && x1 < pmi->w; --z, ++x1) {
+            px = x + (mirror ? pmi->w - 1 - x1 : x1);
+            mask[y*stride + px/8] &= ~(0x80 >> (px&7));
+        }
+    }
+}
@@ -0,0 +1,46 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// Pixmap.h - the glyphs of bbDrawPix: menu bullets, arrows, check marks
+
+#ifndef _BBPIXMAP_H_
+#define _BBPIXMAP_H_
+
+/* A glyph is w x h pixels in rows of runs. Each byte is a run:
+     0x0N       the next row is N rows down
+     0xLX       L (1..7) pixels from column X on
+     0xLX|0x80  the same, on the next row
+   and a 0 ends it. 'vector' has where each glyph starts in 'bits'. */
+typedef struct pixinfo {
+    short size;
+    char w, h, n, u;
+    unsigned short vector[12];
+    unsigned char bits[2];
+} pixinfo;
+
+// the built-in ones, 11x11
+extern const unsigned char defpix[];
+
+pixinfo * pix_encode(const DWORD *pixels, int width, int height);
+void pix_mask(const pixinfo *pmi, int pic, bool mirror,
+    unsigned char *mask, int stride, int x);
+
+#endif
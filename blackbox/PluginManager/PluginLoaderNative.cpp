@@ -55,20 +55,25 @@ int LoadPlugin(struct PluginList* q, HWND hSlit, char** errorMsg) {
     int error = 0;
     bool useslit;
     int r;
+    unsigned t;
     char plugin_path[MAX_PATH];
 
     for (;;)
     {
         //---------------------------------------
         // load the dll
+        t = PluginManager_Clock();
         if (0 == FindRCFile(plugin_path, q->path, NULL)) {
             error = error_plugin_dll_not_found;
             break;
         }
+        q->times.locate += PluginManager_Clock() - t;
 
+        t = PluginManager_Clock();
         r = SetErrorMode(0); // enable 'missing xxx.dll' system message
         pInfo->module = LoadLibrary(plugin_path);
         SetErrorMode(r);
+        q->times.load += PluginManager_Clock() - t;
 
         if (NULL == pInfo->module)
         {
@@ -108,6 +113,7 @@ int LoadPlugin(struct PluginList* q, HWND hSlit, char** errorMsg) {
 
         //---------------------------------------
         // inititalize plugin
+        t = PluginManager_Clock();
         TRY
         {
             if (useslit) {
@@ -134,6 +140,7 @@ int LoadPlugin(struct PluginList* q, HWND hSlit, char** errorMsg) {
         {
             error = error_plugin_crash_on_load;
         }
+        q->times.init += PluginManager_Clock() - t;
         break;
     }
 
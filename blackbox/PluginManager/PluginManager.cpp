@@ -20,13 +20,17 @@ for more details.
 ========================================================================== */
 
 #include <regex>
+#include <vector>
+#include <algorithm>
 #include <string.h>
 
 #include "../BB.h"
+#include "../Settings.h"
 #include "bbrc.h"
 #include "PluginManager.h"
 #include "PluginLoaderNative.h"
 #include "Types.h"
+#include "../worker.h"
 
 // Private variables
 static struct PluginLoaderList *pluginLoaders = &nativeLoader;
@@ -36,6 +40,19 @@ static struct PluginList *slitPlugin;
 static HWND hSlit;  // BBSlit window
 static FILETIME rc_filetime; // plugins.rc filetime
 
+// dlls mapped by worker threads before the plugins are started
+struct preload {
+    struct PluginList *q;
+    char path[MAX_PATH];
+    HMODULE module;
+};
+static std::vector<struct preload> preloads;
+
+#define PRELOAD_MAX_THREADS 4
+
+static unsigned startup_time; // microseconds, PluginManager_Init
+static unsigned preload_time;
+
 // Forward decls
 static void applyPluginStates();
 static int loadPlugin(struct PluginList *q, HWND hSlit, char **errorMsg);
@@ -44,6 +61,8 @@ static void free_plugin(struct PluginList **q);
 static struct PluginList *parseConfigLine(const char *rcline);
 static bool write_plugins(void);
 static void showPluginErrorMessage(struct PluginList *q, int error, const char *msg);
+static void preloadPlugins(void);
+static void showTimes(bool to_file);
 
 static bool isPluginLoader(char *path);
 static int loadPluginLoader(struct PluginList *q, char **errorMsg);
@@ -57,7 +76,9 @@ void PluginManager_Init(void)
     const char *path;
     FILE *fp;
     char szBuffer[MAX_PATH];
+    unsigned t, i;
 
+    t = PluginManager_Clock();
     initPluginLoader(&nativeLoader, NULL);
     bbplugins = c_new(struct PluginList);
     
@@ -80,7 +101,16 @@ void PluginManager_Init(void)
         fclose(fp);
     }
 
+    preloadPlugins();
     applyPluginStates();
+
+    // the plugins that did load hold their own reference
+    for (i = 0; i < preloads.size(); ++i)
+        if (preloads[i].module)
+            FreeLibrary(preloads[i].module);
+    preloads.clear();
+
+    startup_time = PluginManager_Clock() - t;
 }
 
 void PluginManager_Exit(void)
@@ -100,6 +130,101 @@ int PluginManager_RCChanged(void)
     return 0 != diff_filetime(plugrcPath(NULL), &rc_filetime);
 }
 
+// microseconds since the first call (only differences are used).
+// Seconds and the rest apart, so that nothing overflows with uptime
+unsigned PluginManager_Clock(void)
+{
+    static LARGE_INTEGER freq, start;
+    LARGE_INTEGER now;
+    LONGLONG d;
+
+    QueryPerformanceCounter(&now);
+    if (0 == freq.QuadPart) {
+        QueryPerformanceFrequency(&freq);
+        start = now;
+    }
+    d = now.QuadPart - start.QuadPart;
+    return (unsigned)(d / freq.QuadPart * 1000000
+        + d % freq.QuadPart * 1000000 / freq.QuadPart);
+}
+
+//===========================================================================
+// map the dlls of the enabled plugins in parallel. Locating them stays
+// here because FindRCFile may ask the shell. The plugins are still
+// started one after the other in plugins.rc order, by applyPluginStates
+
+struct PluginPreload : Runnable
+{
+    struct preload *m_pre;
+    unsigned m_count;
+    std::atomic<unsigned> m_next;
+
+    PluginPreload (struct preload *pre, unsigned count)
+        : m_pre(pre), m_count(count), m_next(0)
+    { }
+
+    virtual void Run ()
+    {
+        struct PluginList *q;
+        unsigned i, t;
+        while ((i = m_next.fetch_add(1)) < m_count) {
+            q = m_pre[i].q;
+            t = PluginManager_Clock();
+            m_pre[i].module = LoadLibrary(m_pre[i].path);
+            q->times.load = PluginManager_Clock() - t;
+        }
+    }
+};
+
+static void preloadPlugins(void)
+{
+    struct PluginList *q;
+    struct preload p;
+    unsigned t, i, n;
+    UINT mode;
+
+    preload_time = 0;
+    if (false == Settings_preloadPlugins)
+        return;
+
+    t = PluginManager_Clock();
+    dolist (q, bbplugins) {
+        if (NULL == q->name || false == q->isEnabled || q->loaderInfo)
+            continue;
+        if (q == nativeLoader.parent || isPluginLoader(q->path))
+            continue;
+        p.q = q;
+        p.module = NULL;
+        q->times.locate = PluginManager_Clock();
+        if (FindRCFile(p.path, q->path, NULL))
+            preloads.push_back(p);
+        q->times.locate = PluginManager_Clock() - q->times.locate;
+    }
+
+    n = preloads.size();
+    if (n) {
+        PluginPreload preload(&preloads[0], n);
+        ThreadPool pool;
+        // no 'missing xxx.dll' boxes from the workers, the real
+        // load reports it then
+        mode = SetErrorMode(SEM_FAILCRITICALERRORS);
+        for (i = 0; i < n && i < PRELOAD_MAX_THREADS; ++i)
+            pool.Create(preload);
+        pool.WaitForTerminate();
+        SetErrorMode(mode);
+    }
+    preload_time = PluginManager_Clock() - t;
+}
+
+static struct preload *findPreload(struct PluginList *q)
+{
+    unsigned i;
+    for (i = 0; i < preloads.size(); ++i)
+        if (preloads[i].q == q)
+            return &preloads[i];
+    return NULL;
+}
+
 //===========================================================================
 // (API:) EnumPlugins
 
@@ -164,9 +289,32 @@ static struct PluginList *parseConfigLine(const char *rcline) {
 //===========================================================================
 // run through plugin list and load/unload changed plugins
 
+static BOOL CALLBACK collect_window(HWND hwnd, LPARAM lParam)
+{
+    ((std::vector<HWND>*)lParam)->push_back(hwnd);
+    return TRUE;
+}
+
+// paint what the plugin has shown now, to time its first paint
+static unsigned paintPlugin(struct PluginList *q, std::vector<HWND> &before)
+{
+    std::vector<HWND> after;
+    unsigned t, i;
+
+    t = PluginManager_Clock();
+    EnumThreadWindows(GetCurrentThreadId(), collect_window, (LPARAM)&after);
+    for (i = 0; i < after.size(); ++i)
+        if (before.end() == std::find(before.begin(), before.end(), after[i]))
+            RedrawWindow(after[i], NULL, NULL, RDW_UPDATENOW|RDW_ALLCHILDREN);
+    if (q->inSlit && hSlit)
+        RedrawWindow(hSlit, NULL, NULL, RDW_UPDATENOW|RDW_ALLCHILDREN);
+    return PluginManager_Clock() - t;
+}
+
 static void applyPluginState(struct PluginList *q)
 {
     char * errorMsg = "(Unknown error)";
+    std::vector<HWND> before;
 
     int error = 0;
     if (q->loaderInfo) {
@@ -176,8 +324,22 @@ static void applyPluginState(struct PluginList *q)
     }
 
     if (q->isEnabled) {
-        if (0 == error)
+        if (0 == error) {
+            struct preload *p = findPreload(q);
+            unsigned locate = p ? q->times.locate : 0;
+            unsigned load = p ? q->times.load : 0;
+            memset(&q->times, 0, sizeof q->times);
+            EnumThreadWindows(GetCurrentThreadId(), collect_window, (LPARAM)&before);
             error = loadPlugin(q, hSlit, &errorMsg);
+            // the loader has added what it took this time. Its locate
+            // repeats the preload's, so that one only is counted
+            if (p) {
+                q->times.locate = locate;
+                q->times.load += load;
+            }
+            if (q->loaderInfo)
+                q->times.paint = paintPlugin(q, before);
+        }
         if (!q->loaderInfo)
             q->isEnabled = false;
         if (error)
@@ -282,7 +444,11 @@ static int loadPlugin(struct PluginList *plugin, HWND hSlit, char** errorMsg) {
     int lastError = 0;
 
     dolist(pll, pluginLoaders) {
+        unsigned t = PluginManager_Clock();
         lastError = pll->LoadPlugin(plugin, hSlit, errorMsg);
+        // loaders other than the native one do not split their times
+        if (0 == plugin->times.init)
+            plugin->times.init = PluginManager_Clock() - t;
 
         if(lastError == 0) {
             struct PluginPtr *pp = c_new(struct PluginPtr);
@@ -604,6 +770,60 @@ void PluginManager_aboutPlugins(void)
     m_free(msg);
 }
 
+//===========================================================================
+// how long the plugins took to come up, in a box or to plugintimes.txt
+
+static void showTimes(bool to_file)
+{
+    int l, x = 0;
+    char *msg = (char*)c_alloc(l = 4096);
+    char path[MAX_PATH];
+    struct PluginList *q;
+    FILE *fp;
+
+    dolist(q, bbplugins) {
+        if (NULL == q->name || NULL == q->loaderInfo || q == nativeLoader.parent)
+            continue;
+        if (l - x < MAX_PATH + 100)
+            msg = (char*)m_realloc(msg, l*=2);
+        x += sprintf(msg + x,
+            "%s\t%u.%u / %u.%u / %u.%u / %u.%u\n",
+            q->name,
+            q->times.locate/1000, q->times.locate/100%10,
+            q->times.load/1000, q->times.load/100%10,
+            q->times.init/1000, q->times.init/100%10,
+            q->times.paint/1000, q->times.paint/100%10
+            );
+    }
+    if (l - x < 200)
+        msg = (char*)m_realloc(msg, l += 200);
+    x += sprintf(msg + x,
+        "%s\t%u.%u ms (%s %u.%u ms)",
+        NLS2("$Plugin_Times_Total$", "Startup"),
+        startup_time/1000, startup_time/100%10,
+        NLS2("$Plugin_Times_Preload$", "preloaded in"),
+        preload_time/1000, preload_time/100%10
+        );
+
+    if (to_file) {
+        fp = fopen(set_my_path(NULL, path, "plugintimes.txt"), "wt");
+        if (fp) {
+            fprintf(fp, "plugin\tlocate / load / init / paint (ms)\n%s\n", msg);
+            fclose(fp);
+        }
+    } else {
+        BBMessageBox(MB_OK,
+            "#" BBAPPNAME " - %s#%s\t%s\n%s",
+            NLS2("$Plugin_Times_Title$", "Plugin startup times"),
+            NLS2("$Plugin_Times_Columns$", "Plugin"),
+            "locate / load / init / paint (ms)",
+            msg
+            );
+    }
+
+    m_free(msg);
+}
+
 //===========================================================================
 // OpenFileName Dialog to add plugins
 
@@ -808,10 +1028,10 @@ bool parse_pluginDocs(const char *rcline, const char *name)
 int PluginManager_handleBroam(const char *args)
 {
     static const char * const actions[] = {
-        "add", "remove", "load", "inslit", "edit", "docs", NULL
+        "add", "remove", "load", "inslit", "edit", "docs", "times", NULL
     };
     enum {
-        e_add, e_remove, e_load, e_inslit, e_edit, e_docs
+        e_add, e_remove, e_load, e_inslit, e_edit, e_docs, e_times
     };
 
     char buffer[MAX_PATH];
@@ -824,7 +1044,12 @@ int PluginManager_handleBroam(const char *args)
         return 0;
 
     NextToken(buffer, &args, NULL);
-    if (action > 3)
+    if (e_times == action) {
+        showTimes(0 == _stricmp(buffer, "file"));
+        return 1;
+    }
+
+    if (e_edit == action || e_docs == action)
     {
         //check for multiple loadings
         if (IsInString(buffer, "/"))
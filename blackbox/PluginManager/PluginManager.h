@@ -28,6 +28,7 @@ void PluginManager_aboutPlugins(void);
 int PluginManager_handleBroam(const char *submessage);
 Menu* PluginManager_GetMenu(const char *text, char *menu_id, bool pop, int mode);
 int PluginManager_RCChanged(void);
+unsigned PluginManager_Clock(void);
 
 #define SUB_PLUGIN_LOAD 1
 #define SUB_PLUGIN_SLIT 2
@@ -28,6 +28,10 @@ struct PluginList
     int n_instance; // if the same plugin name is used more than once
 
     void* loaderInfo; // place for the loader to put loader-specific data
+
+    struct PluginTimes {
+        unsigned locate, load, init, paint; // microseconds, last load
+    } times;
 };
 
 struct PluginPtr {
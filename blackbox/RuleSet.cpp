@@ -0,0 +1,185 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// RuleSet.cpp - matching window rules, see RuleSet.h
+//
+// Without windows.h, so that it can be tested on its own.
+
+#include <string.h>
+#include "RuleSet.h"
+
+#define CLASS_PREFIX "class:"
+#define CLASS_PREFIX_LEN (sizeof CLASS_PREFIX - 1)
+
+//===========================================================================
+// WildRule
+
+// compare 'n' chars where '?' in the pattern matches anything
+static bool part_equal (const char * s, const char * p, size_t n)
+{
+    for (; n; --n, ++s, ++p)
+        if (*p != *s && *p != '?')
+            return false;
+    return true;
+}
+
+// leftmost occurence of a part in s[0..len)
+static const char * part_find (const char * s, size_t len, std::string const & part)
+{
+    size_t const n = part.size();
+    const char * p = part.c_str();
+    if (n > len)
+        return NULL;
+    // first char is usually literal: skip ahead with memchr
+    if (*p != '?') {
+        const char * e = s + len - n;
+        for (;;) {
+            s = (const char *)memchr(s, *p, e - s + 1);
+            if (NULL == s)
+                return NULL;
+            if (part_equal(s + 1, p + 1, n - 1))
+                return s;
+            if (++s > e)
+                return NULL;
+        }
+    }
+    for (const char * e = s + len - n; s <= e; ++s)
+        if (part_equal(s, p, n))
+            return s;
+    return NULL;
+}
+
+void WildRule::Compile (const char * pattern)
+{
+    const char * p = pattern;
+    m_parts.clear();
+    m_minLen = 0;
+    m_anchorStart = *p != '*';
+    for (;;) {
+        const char * e = p;
+        while (*e && *e != '*')
+            ++e;
+        if (e > p) {
+            m_parts.push_back(std::string(p, e - p));
+            m_minLen += e - p;
+        }
+        if (0 == *e)
+            break;
+        p = e + 1;
+    }
+    m_anchorEnd = 0 != *p;
+}
+
+// With only '*' between the parts, taking the leftmost match of each
+// part is always right, so this needs no backtracking.
+bool WildRule::Match (const char * s, size_t len) const
+{
+    size_t i = 0, n = m_parts.size();
+    const char * e = s + len;
+
+    if (len < m_minLen)
+        return false;
+
+    if (0 == n)
+        return true; // "*"
+
+    if (m_anchorStart) {
+        std::string const & f = m_parts[0];
+        if (false == part_equal(s, f.c_str(), f.size()))
+            return false;
+        if (1 == n && m_anchorEnd)
+            return f.size() == len;
+        s += f.size();
+        ++i;
+    }
+
+    if (m_anchorEnd) {
+        std::string const & l = m_parts[n-1];
+        if (i == n || (size_t)(e - s) < l.size())
+            return false;
+        e -= l.size();
+        if (false == part_equal(e, l.c_str(), l.size()))
+            return false;
+        --n;
+    }
+
+    for (; i < n; ++i) {
+        std::string const & m = m_parts[i];
+        s = part_find(s, e - s, m);
+        if (NULL == s)
+            return false;
+        s += m.size();
+    }
+    return true;
+}
+
+//===========================================================================
+// RuleSet
+
+void RuleSet::Clear ()
+{
+    m_apps.clear();
+    m_classes.clear();
+    m_wildApps.clear();
+    m_wildClasses.clear();
+}
+
+bool RuleSet::Empty () const
+{
+    return m_apps.empty() && m_classes.empty()
+        && m_wildApps.empty() && m_wildClasses.empty();
+}
+
+void RuleSet::Add (const char * rule)
+{
+    bool const is_class = 0 == memcmp(rule, CLASS_PREFIX, CLASS_PREFIX_LEN);
+    if (is_class)
+        rule += CLASS_PREFIX_LEN;
+    if (0 == *rule)
+        return;
+
+    if (strpbrk(rule, "*?")) {
+        WildRule w;
+        w.Compile(rule);
+        (is_class ? m_wildClasses : m_wildApps).push_back(w);
+    } else {
+        (is_class ? m_classes : m_apps).insert(rule);
+    }
+}
+
+bool RuleSet::Match (std::string const & app, std::string const & cls) const
+{
+    if (app.size()) {
+        if (m_apps.count(app))
+            return true;
+        for (WildRule const & w : m_wildApps)
+            if (w.Match(app.c_str(), app.size()))
+                return true;
+    }
+    if (cls.size()) {
+        if (m_classes.count(cls))
+            return true;
+        for (WildRule const & w : m_wildClasses)
+            if (w.Match(cls.c_str(), cls.size()))
+                return true;
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// RuleSet.h - the rules of StickyWindows.ini and BGWindows.ini
+
+#ifndef _BBRULESET_H_
+#define _BBRULESET_H_
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+/* Each line of the ini files is one rule:
+     app.exe        the module name of the window's process
+     class:name     the window's class name
+   Both may contain the wildcards '*' and '?'. Matching is not
+   case-sensitive: rules and names are given in lower case. */
+
+// a pattern with wildcards, stored as the literal pieces between '*'
+struct WildRule
+{
+    std::vector<std::string> m_parts;
+    bool m_anchorStart;     // pattern does not start with '*'
+    bool m_anchorEnd;       // pattern does not end with '*'
+    size_t m_minLen;        // sum of the parts
+
+    void Compile (const char * pattern);
+    bool Match (const char * s, size_t len) const;
+};
+
+// the rules of one ini file. Exact names go into hash sets, patterns
+// with wildcards into a short list of WildRules.
+struct RuleSet
+{
+    std::unordered_set<std::string> m_apps;
+    std::unordered_set<std::string> m_classes;
+    std::vector<WildRule> m_wildApps;
+    std::vector<WildRule> m_wildClasses;
+
+    void Clear ();
+    void Add (const char * rule);
+    bool Empty () const;
+    bool Match (std::string const & app, std::string const & cls) const;
+};
+
+#endif
@@ -1014,6 +1014,7 @@ static const struct rccfg extrc_cfg[] = {
 
     { "blackbox.background.enabled",           C_BOL, (void*)true,          &Settings_enableBackground  },
     { "blackbox.background.smartWallpaper",    C_BOL, (void*)true,          &Settings_smartWallpaper },
+    { "blackbox.background.cacheSize",         C_INT, (void*)256,           &Settings_wallpaperCache },
 
     { "blackbox.workspaces.followActive",      C_BOL, (void*)true,          &Settings_followActive },
     { "blackbox.workspaces.altMethod",         C_BOL, (void*)true,          &Settings_altMethod },
@@ -1032,6 +1033,7 @@ static const struct rccfg extrc_cfg[] = {
     { "blackbox.options.shellContextMenu",     C_BOL, (void*)false,         &Settings_shellContextMenu },
     { "blackbox.options.UTF8Encoding",         C_BOL, (void*)false,         &Settings_UTF8Encoding },
     { "blackbox.options.OldTray",              C_BOL, (void*)false,         &Settings_OldTray },
+    { "blackbox.options.preloadPlugins",       C_BOL, (void*)true,          &Settings_preloadPlugins },
 
     /* BlackboxZero 1.7.2012 */
     { "blackbox.menu.keepHilite:",              C_BOL, (void*)false,        &Settings_menuKeepHilite },
@@ -119,6 +119,7 @@ BBSETTING bool Settings_fullMaximization;
 // Background
 BBSETTING bool Settings_enableBackground;
 BBSETTING bool Settings_smartWallpaper;
+BBSETTING int Settings_wallpaperCache; // MB, 0: no cache
 
 // Options
 BBSETTING bool Settings_desktopHook;
@@ -142,6 +143,7 @@ BBSETTING int Settings_imageDither;
 BBSETTING bool Settings_shellContextMenu;
 BBSETTING bool Settings_UTF8Encoding;
 BBSETTING bool Settings_OldTray;
+BBSETTING bool Settings_preloadPlugins;
 BBSETTING int Settings_contextMenuAdjust[2];
 BBSETTING int Settings_LogFlag;
 
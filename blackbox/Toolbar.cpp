@@ -361,7 +361,11 @@ ST void Toolbar_setclock(void)
 #else
         seconds = strstr(format, "%S") || strstr(format, "%#S");
 #endif
-        SetTimer(Toolbar_hwnd, TOOLBAR_CLOCK_TIMER, seconds ? 1100 - lt.wMilliseconds : 61000 - lt.wSecond * 1000, NULL);
+        // due a bit past the tick, so there is room for slack
+        if (seconds)
+            timer_set(Toolbar_hwnd, TOOLBAR_CLOCK_TIMER, 1100 - lt.wMilliseconds, 50);
+        else
+            timer_set(Toolbar_hwnd, TOOLBAR_CLOCK_TIMER, 61000 - lt.wSecond * 1000, 500);
 
     }
 }
@@ -384,38 +388,92 @@ ST int get_text_extend(HDC hdc, const char *cp, StyleItem * pSI)
 }
 
 //===========================================================================
-ST void PaintToolbar(HDC hdc, RECT *rcPaint)
-{
-    RECT r;
-    StyleItem *pSI = 0;
-    struct button *btn = 0;
+// The toolbar is painted in cells. Each paint re-renders only the cells
+// whose content changed since they were last drawn, on top of a cached
+// layer that has all the gradients but no text. The back buffer stays
+// around between paints and is blitted for the invalid area only.
 
-    HDC buf;
-    HGDIOBJ bufother, other_font;
-    int size;
+enum { TBC_WSLABEL, TBC_WINLABEL, TBC_BUTTONS, TBC_CLOCK, TBC_COUNT };
 
-    int margin, border, border_margin, button_padding, middle_padding, two_buttons;
-    int tbW, tbH, tbLabelW, tbLabelX, tbClockX, tbWinLabelX, tbWinLabelW;
-    int i, justify;
+#define TBD_LAYOUT (1 << TBC_COUNT) // positions and static layer
+#define TBD_ALL (TBD_LAYOUT | ((1 << TBC_COUNT) - 1))
 
-    tbW = TBInfo.width;
-    tbH = TBInfo.height;
-    buf = CreateCompatibleDC(NULL);
-    bufother = SelectObject(buf, CreateCompatibleBitmap(hdc, tbW, tbH));
+ST struct toolbar_cache
+{
+    HDC buf;                // back buffer, the same as on screen
+    HGDIOBJ buf_other;
+    HDC bg;                 // static layer: the gradients of toolbar and labels
+    HGDIOBJ bg_other;
+    HDC btn[2];             // normal and pressed button gradient
+    HGDIOBJ btn_other[2];
+    int width, height;      // size of 'buf' and 'bg'
+    unsigned dirty;         // TBD_xxx
+    RECT cell[TBC_COUNT];
+    char text[TBC_COUNT][100]; // texts as drawn
+    bool pressed[4];        // buttons as drawn
+} tbc;
+
+ST HDC create_buffer(HDC hdc, int w, int h, HGDIOBJ *other)
+{
+    HDC buf = CreateCompatibleDC(NULL);
+    *other = SelectObject(buf, CreateCompatibleBitmap(hdc, w, h));
+    return buf;
+}
 
-    if (NULL==Toolbar_hFont)
-        Toolbar_hFont = CreateStyleFont(&mStyle.Toolbar);
-    other_font = SelectObject(buf, Toolbar_hFont);
+ST void delete_buffer(HDC *buf, HGDIOBJ other)
+{
+    if (*buf) {
+        DeleteObject(SelectObject(*buf, other));
+        DeleteDC(*buf);
+        *buf = NULL;
+    }
+}
+
+ST void Toolbar_FreeCache(void)
+{
+    if (tbc.buf)
+        SelectObject(tbc.buf, GetStockObject(SYSTEM_FONT));
+    delete_buffer(&tbc.buf, tbc.buf_other);
+    delete_buffer(&tbc.bg, tbc.bg_other);
+    delete_buffer(&tbc.btn[0], tbc.btn_other[0]);
+    delete_buffer(&tbc.btn[1], tbc.btn_other[1]);
+    tbc.width = tbc.height = 0;
+    tbc.dirty = TBD_ALL;
+}
+
+// Invalidate one cell on screen. The paint will find out by itself what
+// has changed, this is only to keep the blit small.
+ST void Toolbar_InvalidateCell(int cell)
+{
+    if (NULL == Toolbar_hwnd)
+        return;
+    if (tbc.dirty & TBD_LAYOUT)
+        InvalidateRect(Toolbar_hwnd, NULL, FALSE);
+    else
+        InvalidateRect(Toolbar_hwnd, &tbc.cell[cell], FALSE);
+}
 
-	size = 6 + get_text_extend(buf, Toolbar_CurrentTime, &mStyle.ToolbarClock);
-    if (tbClockW < size)
-        tbClockW = size + 2*tbLabelIndent;
+// After the labels were set: the window label can be redrawn alone
+// unless the workspace name has changed, which may change the layout
+ST void Toolbar_InvalidateLabels(void)
+{
+    if (strcmp(tbc.text[TBC_WSLABEL], Toolbar_WorkspaceName))
+        InvalidateRect(Toolbar_hwnd, NULL, FALSE);
+    else
+        Toolbar_InvalidateCell(TBC_WINLABEL);
+}
 
-	size = get_text_extend(buf, Toolbar_WorkspaceName, &mStyle.Toolbar);
-    tbLabelW = size + 2*tbLabelIndent;
+ST void Toolbar_Layout(HDC hdc, int tbLabelW)
+{
+    RECT r;
+    StyleItem *pSI;
+    struct button *btn;
+    int margin, border, border_margin, button_padding, middle_padding, two_buttons;
+    int tbW, tbH, tbLabelX, tbClockX, tbWinLabelX, tbWinLabelW;
+    int i, f;
 
-    // The widest sets the width!
-    tbLabelW = tbClockW = imax(tbH * 2, imax(tbLabelW, tbClockW));
+    tbW = TBInfo.width;
+    tbH = TBInfo.height;
 
     margin = tbMargin;
     border = mStyle.Toolbar.borderWidth;
@@ -445,94 +503,172 @@ ST void PaintToolbar(HDC hdc, RECT *rcPaint)
     }
     btn[4].r.right = tbClockX + tbClockW;
 
+    r.top = (tbH - tbLabelH)/2;
+    r.bottom = r.top + tbLabelH;
+    r.right = (r.left = tbLabelX) + tbLabelW;
+    tbc.cell[TBC_WSLABEL] = r;
+    r.right = (r.left = tbWinLabelX) + tbWinLabelW;
+    tbc.cell[TBC_WINLABEL] = r;
+    r.right = (r.left = tbClockX) + tbClockW;
+    tbc.cell[TBC_CLOCK] = r;
+    UnionRect(&tbc.cell[TBC_BUTTONS], &btn[0].r, &btn[3].r);
+
+    //====================
+    // (Re)create the buffers
+
+    if (tbc.width != tbW || tbc.height != tbH || NULL == tbc.buf) {
+        Toolbar_FreeCache();
+        tbc.buf = create_buffer(hdc, tbW, tbH, &tbc.buf_other);
+        tbc.bg = create_buffer(hdc, tbW, tbH, &tbc.bg_other);
+        tbc.width = tbW;
+        tbc.height = tbH;
+    }
+    delete_buffer(&tbc.btn[0], tbc.btn_other[0]);
+    delete_buffer(&tbc.btn[1], tbc.btn_other[1]);
+
     //====================
+    // Paint the static layer: toolbar and label gradients
 
-    // Paint toolbar Style
     r.left = r.top = 0;
     r.right = tbW;
     r.bottom = tbH;
     pSI = &mStyle.Toolbar;
-    MakeStyleGradient(buf, &r, pSI, pSI->bordered);
+    MakeStyleGradient(tbc.bg, &r, pSI, pSI->bordered);
 
-    //====================
-    // Paint unpressed workspace/task buttons...
+    pSI = &mStyle.ToolbarLabel;
+    MakeStyleGradient(tbc.bg, &tbc.cell[TBC_WSLABEL], pSI, pSI->bordered);
+    pSI = &mStyle.ToolbarWindowLabel;
+    MakeStyleGradient(tbc.bg, &tbc.cell[TBC_WINLABEL], pSI, pSI->bordered);
+    pSI = &mStyle.ToolbarClock;
+    MakeStyleGradient(tbc.bg, &tbc.cell[TBC_CLOCK], pSI, pSI->bordered);
 
-    r.left = r.top = 0;
+    // and the button gradients
     r.right = r.bottom = tbButtonWH;
-    {
-        HDC src;
-        HGDIOBJ srcother;
-        int x, y, f2, f1 = -1;
-        src = CreateCompatibleDC(NULL);
-        srcother = SelectObject(src, CreateCompatibleBitmap(hdc, tbButtonWH, tbButtonWH));
-        for (i = 0; i < 4; i++)
-        {
-            btn = Toolbar_Button + i;
-            f2 = btn->pressed || (Toolbar_force_button_pressed && (i&1));
-            x = btn->r.left, y = btn->r.top;
-            pSI = f2 ? &mStyle.ToolbarButtonPressed : &mStyle.ToolbarButton;
-            if (pSI->parentRelative) {
-                RECT b;
-                b.left = x, b.top = y, b.right = x+r.right, b.bottom = y+r.bottom;
-                CreateBorder(buf, &b, pSI->borderColor, pSI->borderWidth);
-            } else {
-                if (f1 != f2) {
-                    MakeStyleGradient(src, &r, pSI, pSI->bordered);
-                    f1 = f2;
-                }
-                BitBlt(buf, x, y, tbButtonWH, tbButtonWH, src, 0, 0, SRCCOPY);
-            }
-            bbDrawPix(buf, &btn->r, pSI->picColor, (i&1) ? BS_TRIANGLE : -BS_TRIANGLE);
+    for (f = 0; f < 2; ++f) {
+        pSI = f ? &mStyle.ToolbarButtonPressed : &mStyle.ToolbarButton;
+        if (false == pSI->parentRelative) {
+            tbc.btn[f] = create_buffer(hdc, tbButtonWH, tbButtonWH, &tbc.btn_other[f]);
+            MakeStyleGradient(tbc.btn[f], &r, pSI, pSI->bordered);
         }
-
-        DeleteObject(SelectObject(src, srcother));
-        DeleteDC(src);
     }
 
-    //====================
+    BitBlt(tbc.buf, 0, 0, tbW, tbH, tbc.bg, 0, 0, SRCCOPY);
+    tbc.dirty = TBD_ALL & ~TBD_LAYOUT;
+}
 
-    r.top = (tbH - tbLabelH)/2;
-    r.bottom = r.top + tbLabelH;
-    SetBkMode(buf, TRANSPARENT);
-    justify = mStyle.Toolbar.Justify | (DT_VCENTER|DT_SINGLELINE|DT_WORD_ELLIPSIS|DT_NOPREFIX);
+ST void Toolbar_PaintButtons(void)
+{
+    StyleItem *pSI;
+    struct button *btn;
+    int i, f, x, y;
 
-    // Paint workspaces background...
-    r.right = (r.left = tbLabelX) + tbLabelW;
-    pSI = &mStyle.ToolbarLabel;
-    MakeStyleGradient(buf, &r, pSI, pSI->bordered);
-    r.left  += tbLabelIndent;
-    r.right -= tbLabelIndent;
-    //bbDrawText(buf, Toolbar_WorkspaceName, &r, justify, pSI->TextColor);
-	/* BlackboxZero 1.5.2012 */
-	BBDrawTextAlt(buf, Toolbar_WorkspaceName, -1, &r, justify, pSI);
+    for (i = 0; i < 4; i++)
+    {
+        btn = Toolbar_Button + i;
+        f = btn->pressed || (Toolbar_force_button_pressed && (i&1));
+        x = btn->r.left, y = btn->r.top;
+        pSI = f ? &mStyle.ToolbarButtonPressed : &mStyle.ToolbarButton;
+        BitBlt(tbc.buf, x, y, tbButtonWH, tbButtonWH, tbc.bg, x, y, SRCCOPY);
+        if (pSI->parentRelative)
+            CreateBorder(tbc.buf, &btn->r, pSI->borderColor, pSI->borderWidth);
+        else
+            BitBlt(tbc.buf, x, y, tbButtonWH, tbButtonWH, tbc.btn[f], 0, 0, SRCCOPY);
+        bbDrawPix(tbc.buf, &btn->r, pSI->picColor, (i&1) ? BS_TRIANGLE : -BS_TRIANGLE);
+        tbc.pressed[i] = 0 != f;
+    }
+}
 
-    // Paint window label background...
-    r.right = (r.left = tbWinLabelX) + tbWinLabelW;
-    pSI = &mStyle.ToolbarWindowLabel;
-    MakeStyleGradient(buf, &r, pSI, pSI->bordered);
-    r.left  += tbLabelIndent;
-    r.right -= tbLabelIndent;
-    //bbDrawText(buf, Toolbar_CurrentWindow, &r, justify, pSI->TextColor);
-	/* BlackboxZero 1.5.2012 */
-	BBDrawTextAlt(buf, Toolbar_CurrentWindow, -1, &r, justify, pSI);
+ST void Toolbar_PaintLabel(int cell, const char *text, StyleItem *pSI)
+{
+    RECT r = tbc.cell[cell];
+    int justify = mStyle.Toolbar.Justify | (DT_VCENTER|DT_SINGLELINE|DT_WORD_ELLIPSIS|DT_NOPREFIX);
 
-    // Paint clock background...
-    r.right = (r.left = tbClockX) + tbClockW;
-    pSI = &mStyle.ToolbarClock;
-    MakeStyleGradient(buf, &r, pSI, pSI->bordered);
+    BitBlt(tbc.buf, r.left, r.top, r.right - r.left, r.bottom - r.top,
+        tbc.bg, r.left, r.top, SRCCOPY);
     r.left  += tbLabelIndent;
     r.right -= tbLabelIndent;
-    //bbDrawText(buf, Toolbar_CurrentTime, &r, justify, pSI->TextColor);
 	/* BlackboxZero 1.5.2012 */
-	BBDrawTextAlt(buf, Toolbar_CurrentTime, -1, &r, justify, pSI);
+	BBDrawTextAlt(tbc.buf, text, -1, &r, justify, pSI);
+    strcpy_max(tbc.text[cell], text, sizeof tbc.text[cell]);
+}
+
+//===========================================================================
+ST void PaintToolbar(HDC hdc, RECT *rcPaint)
+{
+    int size, tbLabelW, i;
+    bool new_clock, new_label;
+
+    if (NULL == Toolbar_hFont) {
+        Toolbar_hFont = CreateStyleFont(&mStyle.Toolbar);
+        tbc.dirty |= TBD_LAYOUT;
+    }
+    if (NULL == tbc.buf)
+        tbc.dirty |= TBD_LAYOUT;
+    else
+        SelectObject(tbc.buf, Toolbar_hFont);
+
+    new_clock = 0 != strcmp(tbc.text[TBC_CLOCK], Toolbar_CurrentTime);
+    new_label = 0 != strcmp(tbc.text[TBC_WSLABEL], Toolbar_WorkspaceName);
+
+    // strings are measured only when they changed
+    if (new_clock || new_label || (tbc.dirty & TBD_LAYOUT)) {
+        HDC tmp = tbc.buf ? tbc.buf : CreateCompatibleDC(NULL);
+        HGDIOBJ other_font = SelectObject(tmp, Toolbar_hFont);
+
+        size = 6 + get_text_extend(tmp, Toolbar_CurrentTime, &mStyle.ToolbarClock);
+        if (tbClockW < size)
+            tbClockW = size + 2*tbLabelIndent;
+
+        size = get_text_extend(tmp, Toolbar_WorkspaceName, &mStyle.Toolbar);
+        tbLabelW = size + 2*tbLabelIndent;
+
+        if (tmp != tbc.buf) {
+            SelectObject(tmp, other_font);
+            DeleteDC(tmp);
+        }
+
+        // The widest sets the width!
+        tbLabelW = tbClockW = imax(TBInfo.height * 2, imax(tbLabelW, tbClockW));
+        if (tbLabelW != tbc.cell[TBC_WSLABEL].right - tbc.cell[TBC_WSLABEL].left)
+            tbc.dirty |= TBD_LAYOUT;
+
+        if (tbc.dirty & TBD_LAYOUT) {
+            Toolbar_Layout(hdc, tbLabelW);
+            SelectObject(tbc.buf, Toolbar_hFont);
+            SetBkMode(tbc.buf, TRANSPARENT);
+            // the paint region may be smaller than what has changed
+            if (rcPaint->left > 0 || rcPaint->top > 0
+             || rcPaint->right < tbc.width || rcPaint->bottom < tbc.height)
+                InvalidateRect(Toolbar_hwnd, NULL, FALSE);
+        }
+    }
+
+    if (new_label)
+        tbc.dirty |= 1 << TBC_WSLABEL;
+    if (new_clock)
+        tbc.dirty |= 1 << TBC_CLOCK;
+    if (strcmp(tbc.text[TBC_WINLABEL], Toolbar_CurrentWindow))
+        tbc.dirty |= 1 << TBC_WINLABEL;
+    for (i = 0; i < 4; i++)
+        if (tbc.pressed[i] != (Toolbar_Button[i].pressed
+                || (Toolbar_force_button_pressed && (i&1))))
+            tbc.dirty |= 1 << TBC_BUTTONS;
 
     //====================
 
-    BitBltRect(hdc, buf, rcPaint);
+    if (tbc.dirty & (1 << TBC_BUTTONS))
+        Toolbar_PaintButtons();
+    if (tbc.dirty & (1 << TBC_WSLABEL))
+        Toolbar_PaintLabel(TBC_WSLABEL, Toolbar_WorkspaceName, &mStyle.ToolbarLabel);
+    if (tbc.dirty & (1 << TBC_WINLABEL))
+        Toolbar_PaintLabel(TBC_WINLABEL, Toolbar_CurrentWindow, &mStyle.ToolbarWindowLabel);
+    if (tbc.dirty & (1 << TBC_CLOCK))
+        Toolbar_PaintLabel(TBC_CLOCK, Toolbar_CurrentTime, &mStyle.ToolbarClock);
+    tbc.dirty = 0;
+
+    //====================
 
-    SelectObject(buf, other_font);
-    DeleteObject(SelectObject(buf, bufother));
-    DeleteDC(buf);
+    BitBltRect(hdc, tbc.buf, rcPaint);
 }
 
 //===========================================================================
@@ -564,6 +700,7 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
             RemoveSticky(hwnd);
             MessageManager_Register (hwnd, msgs, false);
             SetDesktopMargin(Toolbar_hwnd, 0, 0);
+            Toolbar_FreeCache();
             if (Toolbar_hFont)
                 DeleteObject(Toolbar_hFont), Toolbar_hFont = NULL;
             TBInfo.hwnd = Toolbar_hwnd = NULL;
@@ -591,12 +728,12 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
         case BB_TASKSUPDATE:
         showlabel:
             Toolbar_setlabel();
-            InvalidateRect(hwnd, NULL, FALSE);
+            Toolbar_InvalidateLabels();
             break;
 
         case BB_DESKTOPINFO:
             Toolbar_setlabel();
-            InvalidateRect(hwnd, NULL, FALSE);
+            Toolbar_InvalidateLabels();
             break;
 
         //====================
@@ -618,10 +755,10 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
         //====================
 
         case BB_SETTOOLBARLABEL:
-            SetTimer(hwnd, TOOLBAR_LABEL_TIMER, 2000, (TIMERPROC)NULL);
+            timer_set(hwnd, TOOLBAR_LABEL_TIMER, 2000, 200);
             Toolbar_ShowingExternalLabel = true;
             strcpy_max(Toolbar_CurrentWindow, (const char*)lParam, sizeof Toolbar_CurrentWindow);
-            InvalidateRect(hwnd, NULL, FALSE);
+            Toolbar_InvalidateCell(TBC_WINLABEL);
             break;
 
         //====================
@@ -632,9 +769,13 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
             if (TBInfo.autoHide)
             {
                 if (check_mouse(hwnd) || (TBInfo.bbsb_hwnd && check_mouse(TBInfo.bbsb_hwnd)))
-                    break;
-
-                Toolbar_AutoHide(true);
+                {
+                    // still over it: wait for WM_MOUSELEAVE where that works
+                    if (GetCapture() == hwnd || 0 == track_mouse_leave(hwnd))
+                        break;
+                }
+                else
+                    Toolbar_AutoHide(true);
             }
             KillTimer(hwnd, wParam);
             break;
@@ -643,7 +784,7 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
         if (wParam == TOOLBAR_CLOCK_TIMER)
         {
             Toolbar_setclock();
-            InvalidateRect(hwnd, NULL, FALSE);
+            Toolbar_InvalidateCell(TBC_CLOCK);
             break;
         }
 
@@ -682,12 +823,19 @@ ST LRESULT CALLBACK Toolbar_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPAR
             if (TBInfo.autohidden)
             {
                 // bring back from autohide
-                SetTimer(hwnd, TOOLBAR_AUTOHIDE_TIMER, 250, NULL);
+                if (0 == track_mouse_leave(hwnd))
+                    timer_set(hwnd, TOOLBAR_AUTOHIDE_TIMER, 250, 50);
                 Toolbar_AutoHide(false);
                 break;
             }
             goto left_mouse;
 
+        case WM_MOUSELEAVE:
+            // hide when the mouse is not back after a little while
+            if (TBInfo.autoHide && false == TBInfo.autohidden)
+                timer_set(hwnd, TOOLBAR_AUTOHIDE_TIMER, 250, 50);
+            break;
+
         case WM_LBUTTONUP:
         left_mouse:
         {
@@ -881,6 +1029,7 @@ void Toolbar_UpdatePosition(void)
         tbClockW = 0;
         Toolbar_setlabel();
         Toolbar_setclock();
+        Toolbar_FreeCache();
         if (Toolbar_hFont) DeleteObject(Toolbar_hFont), Toolbar_hFont = NULL;
         Toolbar_set_pos();
     }
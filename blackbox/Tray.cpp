@@ -28,6 +28,7 @@
 #include "bbshell.h"
 #define INCLUDE_NIDS
 #include "Tray.h"
+#include "TrayIcons.h"
 
 #define ST static
 
@@ -78,31 +79,42 @@ typedef struct _SHELLTRAYDATA
 } SHELLTRAYDATA;
 #pragma pack(pop)
 
-typedef struct systemTrayNode
-{
-    struct systemTrayNode *next;
-    bool hidden;
-    bool shared;
-    bool added;
-    int popup;
-    unsigned version;
-    HICON orig_icon;
-    GUID guidItem;
-    HWND hWnd;
-    UINT uID;
-    UINT uCallbackMessage;
-    unsigned uChanged;
-    int index;
-    POINT pt;
-    systemTray t;
-} systemTrayNode;
-
 //===========================================================================
 // the 'Shell_TrayWnd'
 ST HWND hTrayWnd;
 
-// the icon vector
-ST systemTrayNode *trayIconList;
+// the timer of the merged modifies, see TrayIcons.cpp
+#define TRAY_COALESCE_TIMER 1
+
+// the pixels of an icon, mask then color, each as 32 bit with its size
+typedef struct iconPixels
+{
+    ULONGLONG hash;
+    unsigned size;
+    BYTE *bits;
+} iconPixels;
+
+// copied icons, shared by all nodes that show the same pixels. Icons
+// which could not be read are never matched, they have no bits.
+typedef struct trayIconStore
+{
+    struct trayIconStore *hnext; // chain in trayIconStoreHash
+    struct trayIconStore *inext; // chain in trayIconStoreByIcon
+    HICON hIcon;
+    int refc;
+    iconPixels px;
+} trayIconStore;
+
+// lookup of the store by pixel hash and by the copy's handle
+#define ICON_HASH_SIZE 64
+ST trayIconStore *trayIconStoreHash[ICON_HASH_SIZE];
+ST trayIconStore *trayIconStoreByIcon[ICON_HASH_SIZE];
+
+ST struct tray_stats {
+    unsigned icons_copied;      // CopyIcon calls
+    unsigned icons_reused;      // new icons found in the store
+    unsigned icons_unchanged;   // NIF_ICON dropped, same pixels as before
+} tray_stats;
 
 // under explorer, setting hTrayWnd to topmost lets it receive the
 // messages before explorer does.
@@ -129,26 +141,13 @@ ST UINT trayredirect_message;
 
 int GetTraySize(void)
 {
-    systemTrayNode *p;
-    int n = 0;
-    dolist (p, trayIconList)
-        p->index = p->hidden ? -1 : n++;
-    return n;
+    return tray_index_size();
 }
 
 //===========================================================================
 // API: GetTrayIcon
 //===========================================================================
 
-static systemTrayNode *nth_icon(int i)
-{
-    systemTrayNode *p;
-    dolist (p, trayIconList)
-        if (i == p->index)
-            break;
-    return p;
-}
-
 systemTray* GetTrayIcon(int icon_index)
 {
     systemTrayNode *p = nth_icon(icon_index);
@@ -306,6 +305,160 @@ int ForwardTrayMessage(int icon_index, UINT message, systemTrayIconPos *pos)
     return forward_tray_message(nth_icon(icon_index), message, pos);
 }
 
+//===========================================================================
+// Function: icon_pixels - read and hash the pixels of an icon
+//===========================================================================
+
+ST ULONGLONG fnv_hash(ULONGLONG h, const void *data, unsigned size)
+{
+    const unsigned char *b = (const unsigned char *)data;
+    while (size--)
+        h = (h ^ *b++) * 0x100000001B3ULL;
+    return h;
+}
+
+// appends the size and the 32 bit pixels of hbm to px
+ST bool read_bitmap_bits(HDC hdc, HBITMAP hbm, iconPixels *px)
+{
+    BITMAP bm;
+    BITMAPINFO bmi;
+    unsigned size;
+    BYTE *bits;
+
+    if (NULL == hbm || 0 == GetObject(hbm, sizeof bm, &bm))
+        return false;
+
+    memset(&bmi, 0, sizeof bmi);
+    bmi.bmiHeader.biSize = sizeof bmi.bmiHeader;
+    bmi.bmiHeader.biWidth = bm.bmWidth;
+    bmi.bmiHeader.biHeight = -bm.bmHeight;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    size = 2 * sizeof(LONG) + bm.bmWidth * bm.bmHeight * 4;
+    px->bits = (BYTE*)m_realloc(px->bits, px->size + size);
+    bits = px->bits + px->size;
+    px->size += size;
+    memcpy(bits, &bm.bmWidth, sizeof(LONG));
+    memcpy(bits + sizeof(LONG), &bm.bmHeight, sizeof(LONG));
+    return bm.bmHeight == GetDIBits(hdc, hbm, 0, bm.bmHeight,
+        bits + 2 * sizeof(LONG), &bmi, DIB_RGB_COLORS);
+}
+
+// reads and hashes the pixels, px->bits is to be freed in any case
+ST bool icon_pixels(HICON hIcon, iconPixels *px)
+{
+    ICONINFO ii;
+    HDC hdc;
+    bool ok;
+
+    memset(px, 0, sizeof *px);
+    if (FALSE == GetIconInfo(hIcon, &ii))
+        return false;
+    hdc = CreateCompatibleDC(NULL);
+    ok = read_bitmap_bits(hdc, ii.hbmMask, px);
+    if (ok && ii.hbmColor)
+        ok = read_bitmap_bits(hdc, ii.hbmColor, px);
+    DeleteDC(hdc);
+    if (ii.hbmColor)
+        DeleteObject(ii.hbmColor);
+    if (ii.hbmMask)
+        DeleteObject(ii.hbmMask);
+    if (ok)
+        px->hash = fnv_hash(0xCBF29CE484222325ULL, px->bits, px->size);
+    return ok;
+}
+
+// the hash only finds the candidates, the pixels decide
+ST bool same_pixels(const iconPixels *a, const iconPixels *b)
+{
+    return a->bits && b->bits
+        && a->hash == b->hash
+        && a->size == b->size
+        && 0 == memcmp(a->bits, b->bits, a->size);
+}
+
+//===========================================================================
+// Function: icon_acquire/icon_release - the refcounted icon store
+//===========================================================================
+
+ST unsigned icon_handle_hash(HICON hIcon)
+{
+    unsigned h = (unsigned)((DWORD_PTR)hIcon >> 2);
+    return (h ^ (h >> 7)) % ICON_HASH_SIZE;
+}
+
+ST trayIconStore *icon_stored(HICON hIcon)
+{
+    trayIconStore *e = trayIconStoreByIcon[icon_handle_hash(hIcon)];
+    for (; e; e = e->inext)
+        if (e->hIcon == hIcon)
+            break;
+    return e;
+}
+
+// a copy of hIcon, or the one with the same pixels. The store takes
+// px->bits when it keeps them
+ST HICON icon_acquire(HICON hIcon, iconPixels *px)
+{
+    trayIconStore *e, **pp;
+
+    if (px->bits) {
+        e = trayIconStoreHash[px->hash % ICON_HASH_SIZE];
+        for (; e; e = e->hnext)
+            if (same_pixels(&e->px, px)) {
+                ++e->refc;
+                ++tray_stats.icons_reused;
+                return e->hIcon;
+            }
+    }
+    hIcon = CopyIcon(hIcon);
+    if (NULL == hIcon)
+        return NULL;
+    ++tray_stats.icons_copied;
+    e = c_new(trayIconStore);
+    e->hIcon = hIcon;
+    e->refc = 1;
+    e->px = *px;
+    px->bits = NULL;
+
+    pp = &trayIconStoreHash[e->px.hash % ICON_HASH_SIZE];
+    e->hnext = *pp, *pp = e;
+    pp = &trayIconStoreByIcon[icon_handle_hash(hIcon)];
+    e->inext = *pp, *pp = e;
+    return hIcon;
+}
+
+ST void icon_release(HICON hIcon)
+{
+    trayIconStore *e = icon_stored(hIcon), **pp;
+
+    if (NULL == e || 0 != --e->refc)
+        return;
+    for (pp = &trayIconStoreHash[e->px.hash % ICON_HASH_SIZE]; *pp != e; pp = &(*pp)->hnext);
+    *pp = e->hnext;
+    for (pp = &trayIconStoreByIcon[icon_handle_hash(hIcon)]; *pp != e; pp = &(*pp)->inext);
+    *pp = e->inext;
+    m_free(e->px.bits);
+    m_free(e);
+    DestroyIcon(hIcon);
+}
+
+ST void log_tray_stats(void)
+{
+    log_printf((LOG_TRAY,
+        "Tray: icon store: %u copies, %u reused, %u unchanged"
+        " (%u GDI objects saved, %u redraws suppressed)",
+        tray_stats.icons_copied,
+        tray_stats.icons_reused,
+        tray_stats.icons_unchanged,
+        // a copied icon owns a mask and a color bitmap
+        2 * (tray_stats.icons_reused + tray_stats.icons_unchanged),
+        tray_stats.icons_unchanged
+        ));
+}
+
 //===========================================================================
 // Function: reset_icon - clear the HICON and related entries
 //===========================================================================
@@ -318,22 +471,27 @@ ST void reset_icon(systemTrayNode *p)
             if (s->shared && s->orig_icon == p->orig_icon)
                 reset_icon(s);
         if (p->t.hIcon)
-            DestroyIcon(p->t.hIcon);
+            icon_release(p->t.hIcon);
     }
     p->t.hIcon = NULL;
     p->orig_icon = NULL;
 }
 
 //===========================================================================
-// Function: send_tray_message
+// Function: tray_broadcast / tray_timer - for TrayIcons.cpp
 //===========================================================================
 
-ST LRESULT send_tray_message(systemTrayNode *p, unsigned uChanged, unsigned msg)
+LRESULT tray_broadcast(systemTrayNode *p, unsigned msg)
 {
-    if (p->hidden || 0 == uChanged)
-        return 0;
-    p->uChanged = uChanged;
-    return MessageManager_Send(BB_TRAYUPDATE, MAKEWPARAM(p->index, uChanged), msg);
+    return MessageManager_Send(BB_TRAYUPDATE, MAKEWPARAM(p->index, p->uChanged), msg);
+}
+
+void tray_timer(bool set)
+{
+    if (set)
+        timer_set(hTrayWnd, TRAY_COALESCE_TIMER, TRAY_COALESCE_DELAY, TRAY_COALESCE_DELAY / 2);
+    else
+        KillTimer(hTrayWnd, TRAY_COALESCE_TIMER);
 }
 
 //===========================================================================
@@ -342,8 +500,10 @@ ST LRESULT send_tray_message(systemTrayNode *p, unsigned uChanged, unsigned msg)
 
 ST void RemoveTrayIcon(systemTrayNode *p, bool post)
 {
+    if (post)
+        flush_tray_updates();
     reset_icon(p);
-    remove_node(&trayIconList, p);
+    tray_remove_node(p);
     if (post)
         send_tray_message(p, NIF_ICON, TRAYICON_REMOVED);
     m_free(p);
@@ -507,6 +667,7 @@ ST LRESULT TrayEvent(void *data, unsigned size)
     NIDBB nid;
     systemTrayNode *p;
     UINT bbTrayMessage, uChanged, ret;
+    bool was_hidden;
 
     memset(&nid, 0, sizeof nid);
 
@@ -573,10 +734,7 @@ ST LRESULT TrayEvent(void *data, unsigned size)
     if (Settings_LogFlag & LOG_TRAY)
         log_tray(trayCommand, &nid);
 
-    // search the list
-    dolist (p, trayIconList)
-        if (p->hWnd == nid.hWnd && p->uID == nid.uID)
-            break;
+    p = find_icon(nid.hWnd, nid.uID);
 
     switch (trayCommand) {
 
@@ -629,6 +787,7 @@ ST LRESULT TrayEvent(void *data, unsigned size)
             if (p->shared != nid.shared)
                 reset_icon(p);
             bbTrayMessage = TRAYICON_MODIFIED;
+            was_hidden = p->hidden;
 
         } else {
             if (NIM_MODIFY == trayCommand) {
@@ -639,9 +798,9 @@ ST LRESULT TrayEvent(void *data, unsigned size)
                     return FALSE;
             }
             p = c_new(systemTrayNode);
-            append_node(&trayIconList, p);
             p->hWnd = nid.hWnd;
             p->uID  = nid.uID;
+            tray_add_node(p);
             p->added = NIM_ADD == trayCommand;
             if (trayredirect_message) {
                 p->t.hWnd = hTrayWnd;
@@ -651,10 +810,13 @@ ST LRESULT TrayEvent(void *data, unsigned size)
                 p->t.uID  = p->uID;
             }
             bbTrayMessage = TRAYICON_ADDED;
+            was_hidden = nid.hidden;
         }
 
         p->hidden = nid.hidden;
         p->shared = nid.shared;
+        if (was_hidden != p->hidden)
+            tray_index_changed();
         uChanged = 0;
         ret = p->added;
 
@@ -709,12 +871,33 @@ ST LRESULT TrayEvent(void *data, unsigned size)
                 }
 
             } else {
-                reset_icon(p);
-                if (nid.hIcon) {
-                    p->t.hIcon = CopyIcon(nid.hIcon);
+                iconPixels px;
+                trayIconStore *e;
+
+                memset(&px, 0, sizeof px);
+                if (nid.hIcon && false == icon_pixels(nid.hIcon, &px))
+                    m_free(px.bits), px.bits = NULL;
+
+                if (p->t.hIcon
+                    && NULL != (e = icon_stored(p->t.hIcon))
+                    && same_pixels(&e->px, &px)) {
+                    // same pixels again: keep our copy, just follow
+                    // the handle for icons that share it
+                    systemTrayNode *s;
+                    dolist (s, trayIconList)
+                        if (s->shared && s->orig_icon == p->orig_icon)
+                            s->orig_icon = nid.hIcon;
                     p->orig_icon = nid.hIcon;
+                    ++tray_stats.icons_unchanged;
+                } else {
+                    reset_icon(p);
+                    if (nid.hIcon) {
+                        p->t.hIcon = icon_acquire(nid.hIcon, &px);
+                        p->orig_icon = nid.hIcon;
+                    }
+                    uChanged |= NIF_ICON;
                 }
-                uChanged |= NIF_ICON;
+                m_free(px.bits);
             }
         }
 
@@ -737,7 +920,8 @@ ST LRESULT TrayEvent(void *data, unsigned size)
         }
 
         /* notify plugins about change */
-        send_tray_message(p, uChanged, bbTrayMessage);
+        tray_update(p, uChanged, bbTrayMessage, was_hidden,
+            0 != (nid.uFlags & NIF_INFO));
         return ret;
 
     default:
@@ -835,6 +1019,11 @@ ST LRESULT CALLBACK TrayWndProc(
         return TrayTestEvent(data, size);
     }
 
+    if (message == WM_TIMER && wParam == TRAY_COALESCE_TIMER) {
+        flush_tray_updates();
+        return 0;
+    }
+
     if (message == WM_WINDOWPOSCHANGED && tray_on_top) {
         SetWindowPos(hwnd, HWND_TOPMOST, 0,0,0,0,
             SWP_NOSIZE|SWP_NOMOVE|SWP_NOACTIVATE|SWP_NOSENDCHANGING);
@@ -1152,6 +1341,8 @@ void Tray_Exit(void)
     }
     while (trayIconList)
         RemoveTrayIcon(trayIconList, false);
+    log_tray_stats();
+    tray_free_index();
 }
 
 //===========================================================================
@@ -0,0 +1,238 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// TrayIcons.cpp - the icons of the tray: lookup, display index, merged updates
+//
+// Without windows calls, so that it can be tested on its own. Tray.cpp
+// reads the shell's NOTIFYICONDATA into the nodes and sends what this
+// decides.
+
+#include "BBApi.h"
+#include "bblib.h"
+#include "TrayIcons.h"
+
+#define ST static
+
+systemTrayNode *trayIconList;
+
+// lookup of icons by (hWnd, uID)
+#define TRAY_HASH_SIZE 64
+ST systemTrayNode *trayIconHash[TRAY_HASH_SIZE];
+
+// visible icons by display index, rebuilt when the list changes
+ST systemTrayNode **trayIconIndex;
+ST int trayIndexSize;
+ST int trayIndexAlloc;
+ST bool trayIndexValid;
+
+// icons with a uPending mask
+ST int tray_pending;
+
+//===========================================================================
+// Function: tray_hash - (hWnd, uID) lookup table
+//===========================================================================
+
+ST unsigned tray_hash(HWND hWnd, UINT uID)
+{
+    unsigned h = (unsigned)((DWORD_PTR)hWnd >> 2);
+    return (h ^ (h >> 7) ^ uID * 0x9E3779B1) % TRAY_HASH_SIZE;
+}
+
+ST void tray_hash_add(systemTrayNode *p)
+{
+    systemTrayNode **pp = &trayIconHash[tray_hash(p->hWnd, p->uID)];
+    p->hnext = *pp;
+    *pp = p;
+}
+
+ST void tray_hash_remove(systemTrayNode *p)
+{
+    systemTrayNode **pp = &trayIconHash[tray_hash(p->hWnd, p->uID)];
+    for (; *pp; pp = &(*pp)->hnext)
+        if (*pp == p) {
+            *pp = p->hnext;
+            break;
+        }
+}
+
+systemTrayNode *find_icon(HWND hWnd, UINT uID)
+{
+    systemTrayNode *p = trayIconHash[tray_hash(hWnd, uID)];
+    for (; p; p = p->hnext)
+        if (p->hWnd == hWnd && p->uID == uID)
+            break;
+    return p;
+}
+
+//===========================================================================
+// Function: tray_build_index - map display index -> icon
+//===========================================================================
+
+ST void tray_build_index(void)
+{
+    systemTrayNode *p;
+    int n = 0;
+
+    if (trayIndexValid)
+        return;
+    dolist (p, trayIconList) {
+        if (p->hidden) {
+            p->index = -1;
+            continue;
+        }
+        if (n == trayIndexAlloc) {
+            trayIndexAlloc = imax(16, 2 * trayIndexAlloc);
+            trayIconIndex = (systemTrayNode**)m_realloc(trayIconIndex,
+                trayIndexAlloc * sizeof *trayIconIndex);
+        }
+        trayIconIndex[n] = p;
+        p->index = n++;
+    }
+    trayIndexSize = n;
+    trayIndexValid = true;
+}
+
+void tray_index_changed(void)
+{
+    trayIndexValid = false;
+}
+
+int tray_index_size(void)
+{
+    tray_build_index();
+    return trayIndexSize;
+}
+
+systemTrayNode *nth_icon(int i)
+{
+    tray_build_index();
+    if (i < 0 || i >= trayIndexSize)
+        return NULL;
+    return trayIconIndex[i];
+}
+
+void tray_free_index(void)
+{
+    tray_pending = 0;
+    m_free(trayIconIndex);
+    trayIconIndex = NULL;
+    trayIndexSize = trayIndexAlloc = 0;
+    trayIndexValid = false;
+}
+
+//===========================================================================
+// Function: tray_add_node / tray_remove_node
+//===========================================================================
+
+void tray_add_node(systemTrayNode *p)
+{
+    append_node(&trayIconList, p);
+    tray_hash_add(p);
+    trayIndexValid = false;
+}
+
+// p->index stays what it was, for the TRAYICON_REMOVED. When it was the
+// last icon with changes to send, the timer has nothing more to do.
+void tray_remove_node(systemTrayNode *p)
+{
+    if (p->uPending) {
+        p->uPending = 0;
+        if (0 == --tray_pending)
+            tray_timer(false);
+    }
+    tray_build_index();
+    remove_node(&trayIconList, p);
+    tray_hash_remove(p);
+    trayIndexValid = false;
+}
+
+//===========================================================================
+// Function: send_tray_message
+//===========================================================================
+
+LRESULT send_tray_message(systemTrayNode *p, unsigned uChanged, unsigned msg)
+{
+    if (p->hidden || 0 == uChanged)
+        return 0;
+    p->uChanged = uChanged;
+    return tray_broadcast(p, msg);
+}
+
+//===========================================================================
+// Function: flush_tray_updates - send the coalesced modifies
+//===========================================================================
+
+void flush_tray_updates(void)
+{
+    systemTrayNode *p;
+    unsigned uChanged;
+
+    if (0 == tray_pending)
+        return;
+    tray_timer(false);
+    tray_build_index();
+    // plugins may call back into the tray while we notify them,
+    // so look up the next pending icon from the start each time
+    for (;;) {
+        dolist (p, trayIconList)
+            if (p->uPending)
+                break;
+        if (NULL == p)
+            break;
+        uChanged = p->uPending;
+        p->uPending = 0;
+        --tray_pending;
+        send_tray_message(p, uChanged, TRAYICON_MODIFIED);
+    }
+    tray_pending = 0;
+}
+
+//===========================================================================
+// Function: queue_tray_update - merge a modify into the pending mask
+//===========================================================================
+
+ST void queue_tray_update(systemTrayNode *p, unsigned uChanged)
+{
+    if (p->hidden || 0 == uChanged)
+        return;
+    // the timer starts with the first one, more modifies do not delay it
+    if (0 == p->uPending && 1 == ++tray_pending)
+        tray_timer(true);
+    p->uPending |= uChanged;
+}
+
+//===========================================================================
+// Function: tray_update - notify plugins about a change from the shell
+//===========================================================================
+
+// Plain modifies of a known icon are merged with following ones,
+// everything else goes out in order
+void tray_update(systemTrayNode *p, unsigned uChanged, unsigned msg,
+    bool was_hidden, bool balloon)
+{
+    if (TRAYICON_MODIFIED == msg && was_hidden == p->hidden && false == balloon) {
+        queue_tray_update(p, uChanged);
+    } else {
+        flush_tray_updates();
+        tray_build_index();
+        send_tray_message(p, uChanged, msg);
+    }
+}
@@ -0,0 +1,74 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// TrayIcons.h - the icons of the tray: lookup, display index, merged updates
+
+#ifndef _BBTRAYICONS_H_
+#define _BBTRAYICONS_H_
+
+typedef struct systemTrayNode
+{
+    struct systemTrayNode *next;
+    struct systemTrayNode *hnext; // chain in trayIconHash
+    bool hidden;
+    bool shared;
+    bool added;
+    int popup;
+    unsigned version;
+    HICON orig_icon;
+    GUID guidItem;
+    HWND hWnd;
+    UINT uID;
+    UINT uCallbackMessage;
+    unsigned uChanged;
+    unsigned uPending; // coalesced NIM_MODIFY changes not yet sent
+    int index;
+    POINT pt;
+    systemTray t;
+} systemTrayNode;
+
+// the icon vector
+extern systemTrayNode *trayIconList;
+
+// repeated modifies of the same icon are merged for this many ms
+// into one BB_TRAYUPDATE
+#define TRAY_COALESCE_DELAY 20
+
+void tray_add_node(systemTrayNode *p);
+void tray_remove_node(systemTrayNode *p);
+systemTrayNode *find_icon(HWND hWnd, UINT uID);
+
+// visible icons by display index
+void tray_index_changed(void);
+int tray_index_size(void);
+systemTrayNode *nth_icon(int i);
+void tray_free_index(void);
+
+LRESULT send_tray_message(systemTrayNode *p, unsigned uChanged, unsigned msg);
+void tray_update(systemTrayNode *p, unsigned uChanged, unsigned msg,
+    bool was_hidden, bool balloon);
+void flush_tray_updates(void);
+
+// in Tray.cpp: the BB_TRAYUPDATE for p, and the timer of the merge
+LRESULT tray_broadcast(systemTrayNode *p, unsigned msg);
+void tray_timer(bool set);
+
+#endif
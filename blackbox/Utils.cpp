@@ -22,6 +22,7 @@
 #include "BB.h"
 #include "Settings.h"
 #include "bbrc.h"
+#include "Pixmap.h"
 #include <time.h>
 #include <shlobj.h>
 #include <shellapi.h>
@@ -341,36 +342,16 @@ int bbWC2MB(const WCHAR *src, char *str, int len)
 
 //===========================================================================
 
-typedef struct pixinfo {
-    short size;
-    char w, h, n, u;
-    char vector[12];
-    unsigned char bits[2];
-} pixinfo;
-
 static pixinfo *pixmap;
 void reset_pix(void);
 void read_pix(void);
 pixinfo * load_pix(const char *path);
 
-static const unsigned char defpix[] = {
-    0x82,0x00,
-    11,11,12,0,
-    0,5,12,22,29,39,
-    48,55,64,78,87,101,
-    0x04,0x24,0xC4,0xA4,0x00,
-    0x03,0x14,0xA4,0xB4,0xA4,0x94,0x00,
-    0x03,0x53,0x93,0x17,0x93,0x17,0x93,0x17,0xD3,0x00,
-    0x03,0x15,0xB4,0xD3,0xB4,0x95,0x00,
-    0x03,0x34,0x93,0x17,0x93,0x17,0x93,0x17,0xB4,0x00,
-    0x02,0x18,0xA7,0xA6,0xA2,0x25,0xB3,0x94,0x00,
-    0x03,0x23,0xC3,0xE3,0xC3,0xA3,0x00,
-    0x02,0x14,0xA4,0xB4,0xC4,0xB4,0xA4,0x94,0x00,
-    0x02,0x72,0x92,0x18,0x92,0x18,0x92,0x18,0x92,0x18,0x92,0x18,0xF2,0x00,
-    0x02,0x15,0xB4,0xD3,0xF2,0xD3,0xB4,0x95,0x00,
-    0x02,0x34,0x93,0x17,0x92,0x18,0x92,0x18,0x92,0x18,0x93,0x17,0xB4,0x00,
-    0x02,0x18,0xA7,0x92,0x36,0xA2,0x35,0xD2,0xB3,0x94,0x00
-};
+// all glyphs, and then all of them mirrored, side by side in a 1 bpp
+// bitmap (set bits are background), made from 'pixmap' when needed
+static HBITMAP pix_bmp;
+static HDC pix_dc;
+static HGDIOBJ pix_other;
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #if 0
@@ -393,7 +374,7 @@ void write_pix(pixinfo *pmi)
     fprintf(fp, ",\n\t%d,%d,%d,0", pmi->w, pmi->h, pmi->n);
     for (n = 0; n < pmi->n; ++n) {
         c = pmi->vector[n];
-        fprintf(fp, ",%s%d", n%6?"":"\n\t", c&255);
+        fprintf(fp, ",%s%d,%d", n%6?"":"\n\t", c&255, c>>8);
     }
     for (n = 0; n < pmi->n; ++n) {
         v = pmi->bits + pmi->vector[n];
@@ -411,6 +392,11 @@ void write_pix(pixinfo *pmi)
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 void reset_pix(void)
 {
+    if (pix_dc) {
+        DeleteObject(SelectObject(pix_dc, pix_other));
+        DeleteDC(pix_dc);
+        pix_dc = NULL, pix_bmp = NULL;
+    }
     if (pixmap)
         m_free(pixmap), pixmap = NULL;
 }
@@ -443,13 +429,9 @@ void read_pix(void)
 
 pixinfo *load_pix(const char *path)
 {
-    BITMAP bm; HDC hdc; HGDIOBJ other; HBITMAP hbmp;
-    int y, x, px, py, x0, y0;
-    unsigned char *v;
-    pixinfo *pmi, *pmi2;
-
-    int w, h;
-    int bx, by;
+    BITMAP bm; BITMAPINFOHEADER bi; HDC hdc; HBITMAP hbmp;
+    DWORD *pixels;
+    pixinfo *pmi = NULL;
 
     hbmp = (HBITMAP)LoadImage(
         NULL,
@@ -463,74 +445,57 @@ pixinfo *load_pix(const char *path)
     if (NULL == hbmp)
         return NULL;
 
-    bx = 6, by = 1, w = h = 9;
-
-    if (GetObject(hbmp, sizeof bm, &bm))
+    if (GetObject(hbmp, sizeof bm, &bm) && bm.bmWidth > 0 && bm.bmHeight > 0)
     {
-        w = (bm.bmWidth-1)/bx-1;
-        // the encoding below can handle 15x15 max.
-        w = h = iminmax(w, 9, 15);
-        by = (bm.bmHeight-1)/(h+1);
+        // read it as 32 bit top-down rows, all at once
+        memset(&bi, 0, sizeof bi);
+        bi.biSize = sizeof bi;
+        bi.biWidth = bm.bmWidth;
+        bi.biHeight = -bm.bmHeight;
+        bi.biPlanes = 1;
+        bi.biBitCount = 32;
+        bi.biCompression = BI_RGB;
+
+        pixels = (DWORD*)m_alloc(bm.bmWidth * bm.bmHeight * sizeof(DWORD));
+        hdc = CreateCompatibleDC(NULL);
+        if (GetDIBits(hdc, hbmp, 0, bm.bmHeight, pixels, (BITMAPINFO*)&bi, DIB_RGB_COLORS))
+            pmi = pix_encode(pixels, bm.bmWidth, bm.bmHeight);
+        DeleteDC(hdc);
+        m_free(pixels);
     }
 
-    // dbg_printf("bx:%d - by:%d - %d/%d", bx, by, w, h);
-
-    hdc = CreateCompatibleDC(NULL);
-    other = SelectObject(hdc, hbmp);
-
-    pmi = (pixinfo *)c_alloc(sizeof(pixinfo) + bx*by * h * (w*3+1));
-    pmi->w = (char)w;
-    pmi->h = (char)h;
-    pmi->n = (char)(bx*by);
-    v = pmi->bits;
-
-    for (py = 0; py < by; ++py) {
-    for (px = 0; px < bx; ++px) {
-        pmi->vector[px+py*bx] = (char)(v - pmi->bits);
-        for (y0 = y = 0; y < h; ++y) {
-        for (x0 = x = 0; x <= w; ++x) {
-            int dx = x - x0;
-            if (dx == 7) {
-                --x;
-            } else if (x < w) {
-                if (0 == GetPixel(hdc, px*(w+1)+1+x, py*(h+1)+1+y))
-                    continue;
-            }
-            if (dx) {
-                int dy = y - y0;
-                if (dy) {
-                    if (dy == 1)
-                        dx |= 8;
-                    else
-                        *v++ = (unsigned char)dy;
-                    y0 = y;
-                }
-                *v++ = (unsigned char)((dx<<4)|x0);
-            }
-            x0 = x+1;
-        }}
-        *v++ = 0;
-    }}
-
-    pmi->size = (short)(sizeof(pixinfo) + (v - pmi->bits - 2));
-
-    pmi2 = (pixinfo *)m_alloc(pmi->size);
-    memcpy(pmi2, pmi, pmi->size);
-    m_free(pmi);
-
-    DeleteObject(SelectObject(hdc, other));
-    DeleteDC(hdc);
+    DeleteObject(hbmp);
+    return pmi;
+}
 
-    return pmi2;
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static void make_pix_bmp(void)
+{
+    pixinfo *pmi = pixmap;
+    int n, w, stride, i;
+    unsigned char *mask;
+
+    n = pmi->n, w = pmi->w;
+    stride = (2*n*w + 15) / 16 * 2; // CreateBitmap wants WORD rows
+    mask = (unsigned char*)m_alloc(stride * pmi->h);
+    memset(mask, 255, stride * pmi->h);
+    for (i = 0; i < 2*n; ++i)
+        pix_mask(pmi, i % n, i >= n, mask, stride, i*w);
+
+    pix_bmp = CreateBitmap(2*n*w, pmi->h, 1, 1, mask);
+    m_free(mask);
+    pix_dc = CreateCompatibleDC(NULL);
+    pix_other = SelectObject(pix_dc, pix_bmp);
 }
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 void bbDrawPix(HDC hDC, RECT *rc, COLORREF color, int pic)
 {
-    int x0, y0, y, z, f, x1, x2;
+    int x0, y0;
+    bool mirror;
     pixinfo *pmi;
-    unsigned char c, *pv;
-    HGDIOBJ oldPen = NULL;
+    HGDIOBJ oldBrush;
+    COLORREF oldText, oldBk;
 
     if (NULL == pixmap)
         read_pix();
@@ -538,14 +503,9 @@ void bbDrawPix(HDC hDC, RECT *rc, COLORREF color, int pic)
     pmi = pixmap;
     x0 = (rc->left + rc->right - pmi->h)/2;
     y0 = (rc->top + rc->bottom - pmi->w)/2;
-    f = 1;
-
-    if (pic < 0) {
-        // draw mirrored
+    mirror = pic < 0;
+    if (mirror)
         pic = -pic;
-        x0 += pmi->w - 1;
-        f = -1;
-    }
 
     if (pic == 1 && Settings_arrowUnix)
         pic = 0;
@@ -555,37 +515,20 @@ void bbDrawPix(HDC hDC, RECT *rc, COLORREF color, int pic)
     if (pic >= pmi->n)
         return;
 
-    pv = pmi->bits + pmi->vector[pic];
-
-    if (!g_usingXP || g_usingVista)
-        oldPen = SelectObject(hDC, CreatePen(PS_SOLID, 1, color));
-
-    for (y = y0; 0 != (c = *pv); ++pv) {
-        z = c >> 4;
-        if (z == 0) {
-            y += c;
-            continue;
-        }
-        if (z & 8) {
-            z &= 7;
-            ++y;
-        }
-
-        x1 = x0 + f * (c & 15);
-        x2 = x1 + f * z;
-
-        if (oldPen) {
-            // buggy on XP with dropshadows for menus enabled
-            MoveToEx(hDC, x1, y, NULL);
-            LineTo  (hDC, x2, y);
-        } else {
-            // buggy on Vista with dropshadows for menus not enabled
-            while (x1 != x2)
-                SetPixel(hDC, x1, y, color), x1 += f;
-       }
-    }
-    if (oldPen)
-        DeleteObject(SelectObject(hDC, oldPen));
+    if (NULL == pix_dc)
+        make_pix_bmp();
+
+    // one blit with the mask: where it is 0 (as the text color) the
+    // brush, where 1 (as the background color) what is there
+    oldBrush = SelectObject(hDC, CreateSolidBrush(color));
+    oldText = SetTextColor(hDC, 0x000000);
+    oldBk = SetBkColor(hDC, 0xFFFFFF);
+    BitBlt(hDC, x0, y0, pmi->w, pmi->h,
+        pix_dc, (mirror ? pmi->n + pic : pic) * pmi->w, 0,
+        0x00B8074A); // PSDPxax
+    SetBkColor(hDC, oldBk);
+    SetTextColor(hDC, oldText);
+    DeleteObject(SelectObject(hDC, oldBrush));
 }
 
 //===========================================================================
@@ -0,0 +1,168 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright (C) 2001-2003 The Blackbox for Windows Development Team
+  Copyright (C) 2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// Matches windows against the rules in StickyWindows.ini/BGWindows.ini,
+// compiled into RuleSets. The result per process and window class is
+// cached until one of the files changes.
+
+#include "BB.h"
+#include "WindowRules.h"
+
+// how often (ms) the files are checked for changes
+#define RULES_CHECK_INTERVAL 2000
+
+// the cache is cleared when it gets larger, pids are not forever
+#define RULES_CACHE_MAX 1024
+
+//===========================================================================
+// WindowRules
+
+WindowRules::WindowRules ()
+    : m_lastCheck(0)
+{
+    memset(m_files, 0, sizeof m_files);
+}
+
+static bool get_mtime (const char * path, FILETIME * ft)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (0 == path[0] || FALSE == GetFileAttributesEx(path, GetFileExInfoStandard, &fad)) {
+        memset(ft, 0, sizeof *ft);
+        return false;
+    }
+    *ft = fad.ftLastWriteTime;
+    return true;
+}
+
+void WindowRules::load_file (RuleFile & rf, const char * name, RuleSet & rs)
+{
+    char buffer[MAX_PATH];
+    FILE * fp;
+
+    rs.Clear();
+    FindRCFile(rf.path, name, NULL);
+    get_mtime(rf.path, &rf.mtime);
+    fp = FileOpen(rf.path);
+    if (fp) {
+        while (ReadNextCommand(fp, buffer, sizeof (buffer)))
+            rs.Add(_strlwr(buffer));
+        FileClose(fp);
+    }
+}
+
+void WindowRules::Load ()
+{
+    load_file(m_files[0], "StickyWindows.ini", m_sticky);
+    load_file(m_files[1], "BGWindows.ini", m_onbg);
+    m_cache.clear();
+    m_lastCheck = GetTickCount();
+}
+
+void WindowRules::Clear ()
+{
+    m_sticky.Clear();
+    m_onbg.Clear();
+    m_cache.clear();
+}
+
+bool WindowRules::files_changed ()
+{
+    DWORD const now = GetTickCount();
+    if (now - m_lastCheck < RULES_CHECK_INTERVAL)
+        return false;
+    m_lastCheck = now;
+    for (RuleFile & rf : m_files) {
+        FILETIME ft;
+        get_mtime(rf.path, &ft);
+        if (CompareFileTime(&ft, &rf.mtime))
+            return true;
+    }
+    return false;
+}
+
+unsigned WindowRules::classify (HWND hwnd, DWORD pid, std::string & key,
+    std::unordered_map<DWORD, std::string> * apps)
+{
+    char cls[256];
+    char appName[MAX_PATH];
+    unsigned flags = 0;
+
+    if (0 == GetClassName(hwnd, cls, sizeof cls))
+        cls[0] = 0;
+    _strlwr(cls);
+
+    sprintf(appName, "%08lx:", (unsigned long)pid);
+    key.assign(appName).append(cls);
+    auto const it = m_cache.find(key);
+    if (it != m_cache.end())
+        return it->second;
+
+    std::string app;
+    if (apps && apps->count(pid)) {
+        app = (*apps)[pid];
+    } else {
+        if (GetAppByWindow(hwnd, appName))
+            app = _strlwr(appName);
+        if (apps)
+            (*apps)[pid] = app;
+    }
+
+    std::string const klass(cls);
+    if (m_sticky.Match(app, klass))
+        flags |= WR_STICKY;
+    if (m_onbg.Match(app, klass))
+        flags |= WR_ONBG;
+
+    if (m_cache.size() >= RULES_CACHE_MAX)
+        m_cache.clear();
+    m_cache[key] = flags;
+    return flags;
+}
+
+unsigned WindowRules::Classify (HWND hwnd)
+{
+    HWND h = hwnd;
+    unsigned flags = 0;
+    Classify(&h, 1, &flags);
+    return flags;
+}
+
+void WindowRules::Classify (HWND const * hwnds, unsigned count, unsigned * flags)
+{
+    std::unordered_map<DWORD, std::string> apps;
+    std::string key;
+    unsigned i;
+
+    if (files_changed())
+        Load();
+
+    if (m_sticky.Empty() && m_onbg.Empty()) {
+        for (i = 0; i < count; ++i)
+            flags[i] = 0;
+        return;
+    }
+
+    for (i = 0; i < count; ++i) {
+        DWORD pid = 0;
+        GetWindowThreadProcessId(hwnds[i], &pid);
+        flags[i] = classify(hwnds[i], pid, key, count > 1 ? &apps : NULL);
+    }
+}
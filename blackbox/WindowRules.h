@@ -0,0 +1,50 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright (C) 2001-2003 The Blackbox for Windows Development Team
+  Copyright (C) 2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+  ========================================================================== */
+#pragma once
+#include "BB.h"
+#include "RuleSet.h"
+#include <string>
+#include <unordered_map>
+
+// StickyWindows.ini and BGWindows.ini, compiled. The rules are in
+// RuleSet.h.
+
+#define WR_STICKY   1
+#define WR_ONBG     2
+
+// the rule files, and the results per (process id, class name)
+class WindowRules
+{
+    struct RuleFile
+    {
+        char path[MAX_PATH];
+        FILETIME mtime;
+    };
+
+    RuleSet m_sticky;
+    RuleSet m_onbg;
+    RuleFile m_files[2];
+    DWORD m_lastCheck;
+    std::unordered_map<std::string, unsigned> m_cache;
+
+    void load_file (RuleFile & rf, const char * name, RuleSet & rs);
+    bool files_changed ();
+    unsigned classify (HWND hwnd, DWORD pid, std::string & key,
+        std::unordered_map<DWORD, std::string> * apps);
+
+public:
+    WindowRules ();
+    void Load ();
+    void Clear ();
+    // WR_STICKY | WR_ONBG for a window
+    unsigned Classify (HWND hwnd);
+    // the same for many windows at once, looks up each process only once
+    void Classify (HWND const * hwnds, unsigned count, unsigned * flags);
+};
@@ -36,8 +36,6 @@ Workspaces::Workspaces ()
     , lastScreen(0)
     , VScreenX(0), VScreenY(0), VScreenWidth(0), VScreenHeight(0)
     , deskNames(0)
-    , stickyNamesList(0)
-    , onBGNamesList(0)
     , taskList(0)
     , pTopTask(0)
     , activeTaskWindow(0)
@@ -66,12 +64,9 @@ void Workspaces::Init (int nostartup)
     currentScreen   = 0;
     lastScreen      = 0;
     deskNames       = NULL;
-    stickyNamesList = NULL;
-    onBGNamesList   = NULL;
 
     SetNames();
-    WS_LoadStickyNamesList();
-    WS_LoadOnBGNamesList();
+    WS_LoadWindowRules();
     GetScreenMetrics();
     vwm_init();
     if (!nostartup)
@@ -83,9 +78,8 @@ void Workspaces::Exit ()
     exit_tasks();
     vwm_exit();
     freeall(&deskNames);
-    freeall(&onBGNamesList);
     freeall(&onbg_list);
-    freeall(&stickyNamesList);
+    windowRules.Clear();
     // not neccesary if all plugins properly call 'RemoveSticky':
     freeall(&sticky_list);
 }
@@ -94,8 +88,7 @@ void Workspaces::Reconfigure ()
 {
     bool changed = false;
     SetNames();
-    WS_LoadStickyNamesList();
-    WS_LoadOnBGNamesList();
+    WS_LoadWindowRules();
     // force reorder on resolution changes
     changed = GetScreenMetrics();
     vwm_reconfig(changed);
@@ -762,15 +755,7 @@ void Workspaces::RemoveSticky (HWND hwnd)
 // export to BBVWM.cpp
 bool Workspaces::CheckStickyName (HWND hwnd)
 {
-    struct string_node * sl = 0;
-    char appName[MAX_PATH];
-    if (NULL == stickyNamesList || 0 == GetAppByWindow(hwnd, appName))
-        return false;
-    _strlwr(appName);
-    dolist (sl, stickyNamesList)
-        if (0==strcmp(appName, sl->str))
-            return true;
-    return false;
+    return 0 != (windowRules.Classify(hwnd) & WR_STICKY);
 }
 
 // export to BBVWM.cpp
@@ -790,20 +775,22 @@ bool Workspaces::CheckSticky (HWND hwnd)
 }
 
 //===========================================================================
-void Workspaces::WS_LoadStickyNamesList ()
+// StickyWindows.ini & BGWindows.ini, see WindowRules.cpp
+
+void Workspaces::WS_LoadWindowRules ()
 {
-    char path[MAX_PATH];
-    char buffer[MAX_PATH];
-    FILE * fp = 0;
-
-    freeall(&stickyNamesList);
-    FindRCFile(path, "StickyWindows.ini", NULL);
-    fp = FileOpen(path);
-    if (fp) {
-        while (ReadNextCommand(fp, buffer, sizeof (buffer)))
-            append_string_node(&stickyNamesList, _strlwr(buffer));
-        FileClose(fp);
-    }
+    windowRules.Load();
+}
+
+// WR_STICKY | WR_ONBG as listed in the ini files
+unsigned Workspaces::CheckWindowRules (HWND hwnd)
+{
+    return windowRules.Classify(hwnd);
+}
+
+void Workspaces::CheckWindowRules (HWND const * hwnds, unsigned count, unsigned * flags)
+{
+    windowRules.Classify(hwnds, count, flags);
 }
 
 //===========================================================================
@@ -871,32 +858,9 @@ bool Workspaces::CheckOnBG (HWND hwnd)
     return check_onbg_plugin(hwnd) || vwm_get_status(hwnd, VWM_ONBG);
 }
 
-void Workspaces::WS_LoadOnBGNamesList ()
-{
-    char path[MAX_PATH];
-    char buffer[MAX_PATH];
-
-    freeall(&onBGNamesList);
-    FindRCFile(path, "BGWindows.ini", NULL);
-    FILE * fp = FileOpen(path);
-    if (fp) {
-        while (ReadNextCommand(fp, buffer, sizeof (buffer)))
-            append_string_node(&onBGNamesList, _strlwr(buffer));
-        FileClose(fp);
-    }
-}
-
 bool Workspaces::CheckOnBgName (HWND hwnd)
 {
-    struct string_node * sl = 0;
-    char appName[MAX_PATH];
-    if (NULL == onBGNamesList || 0 == GetAppByWindow(hwnd, appName))
-        return false;
-    _strlwr(appName);
-    dolist (sl, onBGNamesList)
-        if (0==strcmp(appName, sl->str))
-            return true;
-    return false;
+    return 0 != (windowRules.Classify(hwnd) & WR_ONBG);
 }
 
 //===========================================================================
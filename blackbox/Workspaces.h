@@ -9,6 +9,7 @@
   ========================================================================== */
 #pragma once
 #include "BB.h"
+#include "WindowRules.h"
 
 struct toptask {
     toptask  * next;
@@ -31,8 +32,7 @@ class Workspaces
     int VScreenX, VScreenY, VScreenWidth, VScreenHeight;
 
     string_node * deskNames;          // workspace names
-    string_node * stickyNamesList;    // application listed in StickyWindows.ini
-    string_node * onBGNamesList;      // application listed in BGWindows.ini
+    WindowRules   windowRules;        // StickyWindows.ini & BGWindows.ini
     tasklist *    taskList;           // the list of tasks, in order as they were added
     toptask *     pTopTask;           // the list of tasks, in order as they were recently active
     HWND          activeTaskWindow;   // the current active taskwindow or NULL
@@ -76,6 +76,8 @@ public:
     bool CheckStickyPlugin (HWND hwnd);
     bool CheckStickyName (HWND hwnd);
     bool CheckOnBgName (HWND hwnd);
+    unsigned CheckWindowRules (HWND hwnd);
+    void CheckWindowRules (HWND const * hwnds, unsigned count, unsigned * flags);
     void SwitchToBBWnd () const;
 
     //@FIXME these may be private
@@ -116,8 +118,7 @@ private:
     void WS_CloseWindow (HWND hwnd);
     void WS_RestoreWindow (HWND hwnd);
     void WS_BringToFront (HWND hwnd, bool to_current);
-    void WS_LoadStickyNamesList ();
-    void WS_LoadOnBGNamesList ();
+    void WS_LoadWindowRules ();
     bool check_onbg_plugin (HWND hwnd);
 
     void min_rest_helper (int cmd);
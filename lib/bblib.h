@@ -106,6 +106,8 @@ BBLIB_EXPORT int is_alnum(int c);
 BBLIB_EXPORT COLORREF rgb (unsigned r, unsigned g, unsigned b);
 BBLIB_EXPORT COLORREF switch_rgb (COLORREF c);
 BBLIB_EXPORT COLORREF mixcolors(COLORREF c1, COLORREF c2, int f);
+BBLIB_EXPORT void mix_span(DWORD *d, const DWORD *s, int n, int f);
+BBLIB_EXPORT void mix_color_span(DWORD *d, const DWORD *s, int n, DWORD c, const BYTE *f);
 BBLIB_EXPORT COLORREF shadecolor(COLORREF c, int f);
 BBLIB_EXPORT unsigned greyvalue(COLORREF c);
 BBLIB_EXPORT COLORREF ParseLiteralColor(LPCSTR color);
@@ -161,6 +163,8 @@ BBLIB_EXPORT void bbshell_set_defaultrc_path(const char *s);
 /* winutils.c */
 
 BBLIB_EXPORT void BitBltRect(HDC hdc_to, HDC hdc_from, RECT *r);
+BBLIB_EXPORT HDC dib_copy(HDC hdc_from, const RECT *r, DWORD **pbits);
+BBLIB_EXPORT void dib_release(HDC hdc_dib, HDC hdc_to, const RECT *r);
 BBLIB_EXPORT HWND GetRootWindow(HWND hwnd);
 BBLIB_EXPORT int is_bbwindow(HWND hwnd);
 BBLIB_EXPORT int get_fontheight(HFONT hFont);
@@ -179,6 +183,8 @@ BBLIB_EXPORT HWND window_under_mouse(void);
 BBLIB_EXPORT int load_imp(void *pp, const char *dll, const char *proc);
 BBLIB_EXPORT int _load_imp(void *pp, const char *dll, const char *proc);
 #define have_imp(pp) ((DWORD_PTR)pp > 1)
+BBLIB_EXPORT UINT_PTR timer_set(HWND hwnd, UINT_PTR id, UINT ms, UINT slack);
+BBLIB_EXPORT int track_mouse_leave(HWND hwnd);
 
 BBLIB_EXPORT char* get_exe_path(HINSTANCE h, char* pszPath, int nMaxLen);
 BBLIB_EXPORT char *set_my_path(HINSTANCE h, char *dest, const char *fname);
@@ -269,6 +269,17 @@ cont_1:
             if (E_eos==next_token(r)) return false;
             append_string_node(&r->paths, unquote(r->token));
             continue;
+
+        case E_filter:
+        {
+            static const char * const filters[] = {
+                "auto", "box", "bicubic", "lanczos", "cximage", NULL
+            };
+            next_token(r);
+            r->filter = get_string_index(r->token, filters);
+            if (-1 == r->filter) return false;
+            continue;
+        }
         }
     }
 }
@@ -29,6 +29,13 @@
 #define WP_CENTER 2
 #define WP_FULL 3
 
+// -filter, for resampling the image
+#define RF_AUTO 0       // box to shrink, lanczos to enlarge
+#define RF_BOX 1
+#define RF_BICUBIC 2
+#define RF_LANCZOS 3
+#define RF_CXIMAGE 4    // the image library's own
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -53,6 +60,7 @@ enum
 
     E_scale, E_save, E_convert, E_vdesk, E_help, E_quiet,
     E_prefix, E_path,
+    E_filter,
     E_last
 };
 
@@ -74,6 +82,7 @@ static const char *switches[] =
 
     "-scale", "-save", "-convert", "-vdesk", "-help", "-quiet",
     "-prefix", "-path",
+    "-filter",
     NULL
 };
 #endif
@@ -106,6 +115,7 @@ struct rootinfo
     char save;  // -save
     char vdesk; // -vdesk
     int scale;  // -scale
+    int filter; // -filter
     char convert; // -convert
     char help;  // -help
     char quiet; // -quiet
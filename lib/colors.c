@@ -41,6 +41,36 @@ COLORREF mixcolors(COLORREF c1, COLORREF c2, int f)
         );
 }
 
+/* mixcolors() for spans of 32 bit dib pixels. The channels are mixed
+   alike, so the order (0x00RRGGBB in a dib) does not matter. x/255 is
+   taken as ((x + 1) * 257) >> 16, which is exact for x up to 255*255,
+   so the results are the same as from mixcolors() */
+
+#define MIX_CH(a, b, f, n, sh) \
+    ((((((a)>>(sh))&255)*(f) + (((b)>>(sh))&255)*(n)) * 257 + 257) >> 16) << (sh)
+
+/* d = mixcolors(d, s, f) */
+void mix_span(DWORD *d, const DWORD *s, int n, int f)
+{
+    int x, g = 255 - f;
+    DWORD a, b;
+    for (x = 0; x < n; ++x) {
+        a = d[x], b = s[x];
+        d[x] = MIX_CH(a, b, f, g, 0) | MIX_CH(a, b, f, g, 8) | MIX_CH(a, b, f, g, 16);
+    }
+}
+
+/* d = mixcolors(c, s, f), with f per pixel and c as in the dib */
+void mix_color_span(DWORD *d, const DWORD *s, int n, DWORD c, const BYTE *f)
+{
+    int x, g;
+    DWORD b;
+    for (x = 0; x < n; ++x) {
+        b = s[x], g = 255 - f[x];
+        d[x] = MIX_CH(c, b, f[x], g, 0) | MIX_CH(c, b, f[x], g, 8) | MIX_CH(c, b, f[x], g, 16);
+    }
+}
+
 COLORREF shadecolor(COLORREF c, int f)
 {
     int r,g,b;
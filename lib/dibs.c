@@ -0,0 +1,64 @@
+/* ------------------------------------------------------------------------- */
+/*
+  This file is part of the bbLean source code
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+*/
+/* ------------------------------------------------------------------------- */
+/* 32 bit dibs of a dc, for the pixels to be worked on directly */
+
+#include "bblib.h"
+
+/* A memory dc with a 32 bit top-down dib of the rect r of hdc_from, for
+   the pixels to be worked on in *pbits (row y at y * width). */
+HDC dib_copy(HDC hdc_from, const RECT *r, DWORD **pbits)
+{
+    BITMAPINFOHEADER bih;
+    HBITMAP bmp;
+    HDC hdc;
+    int w = r->right - r->left, h = r->bottom - r->top;
+
+    if (w <= 0 || h <= 0)
+        return NULL;
+    memset(&bih, 0, sizeof bih);
+    bih.biSize = sizeof bih;
+    bih.biWidth = w;
+    bih.biHeight = -h;
+    bih.biPlanes = 1;
+    bih.biBitCount = 32;
+    bih.biCompression = BI_RGB;
+    bmp = CreateDIBSection(NULL, (BITMAPINFO*)&bih, DIB_RGB_COLORS, (void**)pbits, NULL, 0);
+    if (NULL == bmp)
+        return NULL;
+    hdc = CreateCompatibleDC(hdc_from);
+    SelectObject(hdc, bmp);
+    BitBlt(hdc, 0, 0, w, h, hdc_from, r->left, r->top, SRCCOPY);
+    GdiFlush();
+    return hdc;
+}
+
+/* put the pixels back at r of hdc_to, if not NULL, and free the dib */
+void dib_release(HDC hdc_dib, HDC hdc_to, const RECT *r)
+{
+    HBITMAP bmp;
+    if (NULL == hdc_dib)
+        return;
+    if (hdc_to)
+        BitBlt(hdc_to, r->left, r->top, r->right - r->left, r->bottom - r->top,
+            hdc_dib, 0, 0, SRCCOPY);
+    bmp = (HBITMAP)GetCurrentObject(hdc_dib, OBJ_BITMAP);
+    DeleteDC(hdc_dib);
+    DeleteObject(bmp);
+}
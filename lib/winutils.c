@@ -66,6 +66,32 @@ int load_imp(void *pp, const char *dll, const char *proc)
     return have_imp(*(void**)pp);
 }
 
+/* SetTimer that lets the system move the deadline by up to 'slack' ms,
+   so that it can fire together with other timers (windows 8 and later,
+   elsewhere a plain SetTimer) */
+UINT_PTR timer_set(HWND hwnd, UINT_PTR id, UINT ms, UINT slack)
+{
+    static UINT_PTR (WINAPI *pSetCoalescableTimer)(HWND, UINT_PTR, UINT, TIMERPROC, ULONG);
+    if (slack && load_imp(&pSetCoalescableTimer, "USER32.DLL", "SetCoalescableTimer"))
+        return pSetCoalescableTimer(hwnd, id, ms, NULL, slack);
+    return SetTimer(hwnd, id, ms, NULL);
+}
+
+/* have the system send WM_MOUSELEAVE once the mouse is off hwnd (which
+   is also when it is over a child of it). 0 if that is not available */
+int track_mouse_leave(HWND hwnd)
+{
+    static BOOL (WINAPI *pTrackMouseEvent)(LPTRACKMOUSEEVENT);
+    TRACKMOUSEEVENT tme;
+    if (!load_imp(&pTrackMouseEvent, "USER32.DLL", "TrackMouseEvent"))
+        return 0;
+    tme.cbSize = sizeof tme;
+    tme.dwFlags = TME_LEAVE;
+    tme.hwndTrack = hwnd;
+    tme.dwHoverTime = HOVER_DEFAULT;
+    return 0 != pTrackMouseEvent(&tme);
+}
+
 void BitBltRect(HDC hdc_to, HDC hdc_from, RECT *r)
 {
     BitBlt(
@@ -0,0 +1,231 @@
+#include "CallChannel.hpp"
+#include "../Debug.h"
+
+CallChannel::CallChannel(Transport* transport) : transport(transport), inPos(0), inEnd(0), nextId(1), inId(0), queued(0), owed(0), ringOut(nullptr), ringIn(nullptr) {}
+
+bool CallChannel::Queue(MessageHeader* msg, unsigned int id) {
+    unsigned int len = sizeof(MessageHeader) + msg->len;
+    msg->id = id;
+
+    // version 1 has no ring and wants each answer at once
+    if(this->transport->Version() < 2) {
+        auto headerSize = this->transport->HeaderSize();
+        this->out.insert(this->out.end(), (char*)msg, (char*)msg + headerSize);
+        this->out.insert(this->out.end(), (char*)(msg + 1), (char*)(msg + 1) + msg->len);
+        return this->Flush();
+    }
+
+    if(this->ringOut != nullptr && len >= RingMin && this->ringOut->Write(msg, len)) {
+        RingDataMessage ringData = { 1 };
+        return this->Send(ringData, id);
+    }
+
+    this->out.insert(this->out.end(), (char*)msg, (char*)msg + len);
+    return true;
+}
+
+bool CallChannel::Flush() {
+    if(this->out.empty())
+        return true;
+
+    auto ret = this->transport->Write(this->out.data(), this->out.size());
+    this->out.clear();
+
+    return ret;
+}
+
+// have at least len bytes at inPos
+bool CallChannel::Fill(unsigned int len) {
+    if(this->inEnd - this->inPos >= len)
+        return true;
+
+    if(this->inPos > 0) {
+        memmove(this->in.data(), this->in.data() + this->inPos, this->inEnd - this->inPos);
+        this->inEnd -= this->inPos;
+        this->inPos = 0;
+    }
+
+    if(this->in.size() < len || this->in.size() < ReadMin)
+        this->in.resize(len < ReadMin ? ReadMin : len);
+
+    while(this->inEnd < len) {
+        auto n = this->transport->Read(this->in.data() + this->inEnd, this->in.size() - this->inEnd);
+        if(n == 0)
+            return false;
+
+        this->inEnd += n;
+    }
+
+    return true;
+}
+
+bool CallChannel::Receive(MessageHeader* header, char** content) {
+    auto headerSize = this->transport->HeaderSize();
+
+    if(!this->Fill(headerSize))
+        return false;
+
+    memcpy(header, this->in.data() + this->inPos, headerSize);
+
+    // version 1 answers come in the order of their requests, they get
+    // the ids that Call gave those
+    if(headerSize < sizeof(MessageHeader)) {
+        header->id = ++this->inId;
+        if(header->id == 0)
+            header->id = ++this->inId;
+    }
+
+    if(!this->Fill(headerSize + header->len))
+        return false;
+
+    *content = this->in.data() + this->inPos + headerSize;
+    this->inPos += headerSize + header->len;
+
+    if(header->tag == RingDataMessage::tag && this->ringIn != nullptr)
+        return this->FromRing(header, content);
+
+    return true;
+}
+
+// the message a RingDataMessage stands for, copied out so that the ring
+// can take the next one at once
+bool CallChannel::FromRing(MessageHeader* header, char** content) {
+    uint32_t len;
+    auto rec = (char const*)this->ringIn->Peek(&len);
+
+    if(rec == nullptr || len < sizeof(MessageHeader)) {
+        dbg_printf("Ring record for message %u missing\n", header->id);
+        return false;
+    }
+
+    this->ringMsg.assign(rec, rec + len);
+    this->ringIn->Release();
+
+    memcpy(header, this->ringMsg.data(), sizeof(MessageHeader));
+    if(header->len != len - sizeof(MessageHeader))
+        return false;
+
+    *content = this->ringMsg.data() + sizeof(MessageHeader);
+    return true;
+}
+
+// the answer to another call, for its Result
+void CallChannel::Keep(MessageHeader* header, char* content) {
+    Stashed& s = this->stash[header->id];
+    s.header = *header;
+    s.content.assign(content, content + header->len);
+}
+
+// reads the answers still owed
+bool CallChannel::Collect() {
+    while(this->owed > 0) {
+        MessageHeader header;
+        char* content;
+
+        if(!this->Receive(&header, &content))
+            return false;
+
+        this->Keep(&header, content);
+        this->owed--;
+    }
+
+    return true;
+}
+
+bool CallChannel::EndBatch() {
+    FlushMessage flush;
+
+    if(!this->Collect())
+        return false;
+
+    // version 1 answers each request as it comes
+    if(this->transport->Version() >= 2 && !this->Send(flush, 0))
+        return false;
+
+    if(!this->Flush())
+        return false;
+
+    this->owed += this->queued;
+    this->queued = 0;
+
+    return true;
+}
+
+unsigned int CallChannel::Call(CallRequestMessage request) {
+    // version 1 has one call on the way at a time
+    if(this->transport->Version() < 2 && !this->Collect())
+        return 0;
+
+    // a big batch goes out in parts, the answers come after the last
+    if(this->out.size() >= BatchMax && (!this->Collect() || !this->Flush()))
+        return 0;
+
+    unsigned int id = this->nextId++;
+    if(id == 0)
+        id = this->nextId++;
+
+    if(!this->Send(request, id))
+        return 0;
+
+    if(this->transport->Version() < 2)
+        this->owed++;
+    else
+        this->queued++;
+
+    return id;
+}
+
+bool CallChannel::Answer(MessageHeader* header, char* content, CallResponseMessage* response, ErrMessage* err) {
+    if(header->tag == CallResponseMessage::tag) {
+        if(MessageSerializer::Deserialize(header, content, response))
+            return true;
+
+        err->error = _strdup("Could not deserialize message.");
+    } else if(header->tag == ErrMessage::tag) {
+        if(!MessageSerializer::Deserialize(header, content, err))
+            err->error = _strdup("Could not deserialize error message.");
+    } else {
+        err->error = _strdup("Unexpected message received.");
+    }
+
+    return false;
+}
+
+bool CallChannel::Result(unsigned int id, CallResponseMessage* response, ErrMessage* err) {
+    err->error = nullptr;
+
+    auto it = this->stash.find(id);
+    if(it == this->stash.end()) {
+        if(this->queued > 0 && !this->EndBatch()) {
+            err->error = _strdup("Could not send request.");
+            return false;
+        }
+
+        for(;;) {
+            if(this->owed == 0) {
+                err->error = _strdup("No such request.");
+                return false;
+            }
+
+            MessageHeader header;
+            char* content;
+
+            if(!this->Receive(&header, &content)) {
+                err->error = _strdup("No message received.");
+                return false;
+            }
+
+            this->owed--;
+
+            if(header.id == id)
+                return this->Answer(&header, content, response, err);
+
+            this->Keep(&header, content);
+        }
+    }
+
+    auto ret = this->Answer(&it->second.header, it->second.content.data(), response, err);
+    this->stash.erase(it);
+
+    return ret;
+}
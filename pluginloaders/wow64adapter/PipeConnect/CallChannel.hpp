@@ -0,0 +1,92 @@
+#ifndef __CALL_CHANNEL_H__
+#define __CALL_CHANNEL_H__
+#include <map>
+#include <vector>
+#include "PipeConnect.h"
+
+// Calls over a Transport. Every CallRequest gets an id and any number of
+// them can be outstanding; the answer carries the id of its request, so
+// answers may come in any order.
+//
+// The caller gathers requests and writes them together; a FlushMessage
+// ends the batch. The other side gathers its answers and writes them
+// when it sees the FlushMessage. Before the caller writes again it reads
+// all answers it is owed, so the two sides never both wait on a write
+// and a full pipe cannot lock them up.
+//
+// Input is read in large pieces into one buffer which is used again, the
+// content of a received message points into it until the next Receive.
+//
+// On a version 1 transport there are no ids and no FlushMessage on the
+// wire: every message is written at once, a caller has one call on the
+// way at a time and the answers are numbered in the order they come.
+//
+// With a SharedRing to write to, messages of RingMin bytes and more go
+// through it when there is room, and a RingDataMessage takes their place
+// on the pipe. Receive gives the message from the ring in its place, so
+// the rest of the channel does not see the difference.
+class CallChannel {
+private:
+    enum { BatchMax = 64 * 1024, ReadMin = 64 * 1024, RingMin = 1024 };
+
+    struct Stashed {
+        MessageHeader header;
+        std::vector<char> content;
+    };
+
+    Transport* transport;
+
+    std::vector<char> out;
+    std::vector<char> in;
+    unsigned int inPos, inEnd;
+
+    unsigned int nextId;
+    unsigned int inId;      // the last id given to a version 1 message
+    unsigned int queued;    // requests not yet sent with a FlushMessage
+    unsigned int owed;      // answers to batches sent, not yet read
+    std::map<unsigned int, Stashed> stash;
+
+    SharedRing* ringOut;
+    SharedRing* ringIn;
+    std::vector<char> ringMsg;  // the last message from ringIn
+
+    bool Queue(MessageHeader* msg, unsigned int id);
+    bool Fill(unsigned int len);
+    bool FromRing(MessageHeader* header, char** content);
+    void Keep(MessageHeader* header, char* content);
+    bool Collect();
+    bool EndBatch();
+    bool Answer(MessageHeader* header, char* content, CallResponseMessage* response, ErrMessage* err);
+
+public:
+    CallChannel(Transport* transport);
+
+    // the rings to this side's peer and from it, either may be nullptr
+    void Rings(SharedRing* out, SharedRing* in) {
+        this->ringOut = out;
+        this->ringIn = in;
+    }
+
+    // the next message, content is valid until the next Receive
+    bool Receive(MessageHeader* header, char** content);
+
+    // the answering side: gathers a message, Flush writes what was gathered
+    template<typename MsgT>
+    bool Send(MsgT msg, unsigned int id) {
+        auto serialized = MessageSerializer::Serialize(msg);
+        auto ret = this->Queue(serialized, id);
+        delete[] (char*)serialized;
+
+        return ret;
+    }
+
+    bool Flush();
+
+    // the calling side: gathers a request and returns its id, 0 on failure
+    unsigned int Call(CallRequestMessage request);
+
+    // waits for the answer to the request id
+    bool Result(unsigned int id, CallResponseMessage* response, ErrMessage* err);
+};
+
+#endif
@@ -20,21 +20,33 @@ enum class MessageTag : char {
     CallResponse,
 
     Finalize,
+
+    Flush,
+
+    OpenRing,
+    RingData,
 };
 
+// id: the request a message answers, 0 when it is not part of a call
 typedef struct MessageHeader {
     MessageTag tag;
     unsigned int len;
+    unsigned int id;
 
     MessageHeader() {}
-    MessageHeader(MessageTag tag) : tag(tag) {}
-    MessageHeader(MessageTag tag, unsigned int len) : tag(tag), len(len) {}
+    MessageHeader(MessageTag tag) : tag(tag), id(0) {}
+    MessageHeader(MessageTag tag, unsigned int len) : tag(tag), len(len), id(0) {}
 } MessageHeader;
 
 struct OkMessage {
     static const MessageTag tag = MessageTag::Ok;
 };
 
+// ends a batch of calls, the answers to it are sent now
+struct FlushMessage {
+    static const MessageTag tag = MessageTag::Flush;
+};
+
 struct ErrMessage {
     static const MessageTag tag = MessageTag::Err;
     
@@ -53,6 +65,22 @@ struct GetApiPipeResult {
     char* pipeName;
 };
 
+// the name and size of the SharedRing for bulk data
+struct OpenRingMessage {
+    static const MessageTag tag = MessageTag::OpenRing;
+
+    char* name;
+    unsigned int size;
+};
+
+// stands for the message with its id, which is the next record in the
+// ring (header and content as on the pipe)
+struct RingDataMessage {
+    static const MessageTag tag = MessageTag::RingData;
+
+    unsigned int records;
+};
+
 struct PingMessage {
     static const MessageTag tag = MessageTag::Ping;
 
@@ -2,6 +2,11 @@
 #include "../Debug.h"
 
 PipeClient::PipeClient(const char* pipename) : abort(false) {
+    memset(&this->readOl, 0, sizeof(OVERLAPPED));
+    memset(&this->writeOl, 0, sizeof(OVERLAPPED));
+    this->readOl.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    this->writeOl.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
     dbg_printf("Connecting to control pipe: %s\n", pipename);
 
     this->pipe = CreateFile(pipename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
@@ -20,6 +25,8 @@ PipeClient::~PipeClient() {
     this->abort = true;
     Sleep(600);
     CloseHandle(this->pipe);
+    CloseHandle(this->readOl.hEvent);
+    CloseHandle(this->writeOl.hEvent);
 }
 
 bool PipeClient::IsConnected() {
@@ -30,93 +37,56 @@ void PipeClient::IsConnected(bool value) {
     this->isConnected = value;
 }
 
-void* PipeClient::ReceiveRaw(int numBytesExpected) {
-    char* buf = (char*)malloc(numBytesExpected);
-    if(numBytesExpected == 0)
-        return buf;
-    
-    OVERLAPPED ol = {0};
-    ol.hEvent = CreateEvent(nullptr, true, false, nullptr);
-    
-    DWORD bytesRead;
-
-    if(ReadFile(this->pipe, buf, numBytesExpected, nullptr, &ol)) {
-        CloseHandle(ol.hEvent);
-        return buf;
-    }
-
+// waits for the read or write on ol, cancels it on abort
+bool PipeClient::Complete(OVERLAPPED* ol, DWORD* n) {
     auto err = GetLastError();
 
     if(err != ERROR_IO_PENDING) {
-        dbg_printf("Error reading from pipe: %d\n", err);
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
+        dbg_printf("Error on pipe: 0x%04X\n", err);
+        return false;
     }
 
     while(!this->abort) {
-        if(WaitForSingleObject(ol.hEvent, 500) == WAIT_OBJECT_0)
+        if(WaitForSingleObject(ol->hEvent, 500) == WAIT_OBJECT_0)
             break;
     }
 
     if(this->abort) {
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
+        CancelIo(this->pipe);
+        GetOverlappedResult(this->pipe, ol, n, TRUE);
+        return false;
     }
 
-    if(!GetOverlappedResult(this->pipe, &ol, &bytesRead, TRUE)) {
-        dbg_printf("Error reading from pipe: %d\n", GetLastError());
-
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
+    if(!GetOverlappedResult(this->pipe, ol, n, TRUE)) {
+        dbg_printf("Error on pipe: 0x%04X\n", GetLastError());
+        return false;
     }
 
-    if(bytesRead != numBytesExpected) {
-        dbg_printf("Error reading from. Got %d bytes, expected %d\n", bytesRead, numBytesExpected);
-                
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
-    }
+    return true;
+}
+
+unsigned int PipeClient::Read(void* buf, unsigned int len) {
+    DWORD bytesRead = 0;
+
+    if(ReadFile(this->pipe, buf, len, nullptr, &this->readOl))
+        GetOverlappedResult(this->pipe, &this->readOl, &bytesRead, TRUE);
+    else if(!this->Complete(&this->readOl, &bytesRead))
+        return 0;
 
-    CloseHandle(ol.hEvent);
-    return buf;
+    return bytesRead;
 }
 
-bool PipeClient::Send(void* msg, int len) {
-    OVERLAPPED ol = {0};
-    ol.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-    if(!WriteFile(this->pipe, msg, len, nullptr, &ol)) {
-        auto err = GetLastError();
-        
-        if(err != ERROR_IO_PENDING) {
-            dbg_printf("Error sending message: 0x%04X\n", err);
-            
-            CloseHandle(ol.hEvent);
-            return false;
-        }
-
-        while(!this->abort) {
-            if(WaitForSingleObject(ol.hEvent, 500) == WAIT_OBJECT_0)
-                break;
-        }
-
-        if(this->abort) {
-            CloseHandle(ol.hEvent);
-            return false;
-        }
-
-        DWORD ignored;
-
-        if(!GetOverlappedResult(this->pipe, &ol, &ignored, TRUE)) {
-            CloseHandle(ol.hEvent);
-            return false;
-        }
-    }
+bool PipeClient::Write(void const* buf, unsigned int len) {
+    DWORD written = 0;
 
-    CloseHandle(ol.hEvent);
-    return true;
-}
\ No newline at end of file
+    if(WriteFile(this->pipe, buf, len, nullptr, &this->writeOl))
+        GetOverlappedResult(this->pipe, &this->writeOl, &written, TRUE);
+    else if(!this->Complete(&this->writeOl, &written))
+        return false;
+
+    return written == len;
+}
+
+bool PipeClient::Send(void* msg, int len) {
+    return this->Write(msg, len);
+}
@@ -3,9 +3,10 @@
 #include <functional>
 #include "PipeConnect.h"
 
-class PipeClient {
+class PipeClient : public Transport {
 private:
     HANDLE pipe;
+    OVERLAPPED readOl, writeOl;
     bool isConnected;
     bool abort;
 
@@ -15,27 +16,25 @@ public:
 
     bool IsConnected();
 
-    template<typename Ret=char>
-    Ret* Receive(int expectedNumBytes = sizeof(Ret)) {
-        return reinterpret_cast<Ret*>(this->ReceiveRaw(expectedNumBytes));
-    }
-
     template<typename MsgT>
     bool Send(MsgT msg) {
         bool ret;
         
         auto serialized = MessageSerializer::Serialize(msg);
-        ret = this->Send(serialized, sizeof(MessageHeader) + serialized->len);
-        delete serialized;
+        ret = this->WriteMessage(serialized);
+        delete[] (char*)serialized;
         
         return ret;
     }
 
     bool Send(void* msg, int len);
+
+    unsigned int Read(void* buf, unsigned int len);
+    bool Write(void const* buf, unsigned int len);
 private:
     void IsConnected(bool value);
 
-    void* ReceiveRaw(int expectedNumBytes);
+    bool Complete(OVERLAPPED* ol, DWORD* n);
 };
 
-#endif
\ No newline at end of file
+#endif
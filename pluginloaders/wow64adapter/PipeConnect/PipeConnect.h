@@ -5,7 +5,10 @@
 
 #include "Messages.hpp"
 #include "Serializer.hpp"
+#include "Transport.hpp"
+#include "SharedRing.hpp"
 #include "PipeClient.hpp"
 #include "PipeServer.hpp"
+#include "CallChannel.hpp"
 
 #endif
\ No newline at end of file
@@ -1,7 +1,12 @@
 #include "PipeServer.hpp"
 #include "../Debug.h"
 
-PipeServer::PipeServer(const char* name, int timeout) : pipe(INVALID_HANDLE_VALUE), initOl(nullptr), name(name), timeout(timeout) {}
+PipeServer::PipeServer(const char* name, int timeout) : pipe(INVALID_HANDLE_VALUE), initOl(nullptr), name(name), timeout(timeout) {
+    memset(&this->readOl, 0, sizeof(OVERLAPPED));
+    memset(&this->writeOl, 0, sizeof(OVERLAPPED));
+    this->readOl.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    this->writeOl.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+}
 
 PipeServer::~PipeServer() {
     if(this->pipe != INVALID_HANDLE_VALUE) {
@@ -16,6 +21,9 @@ PipeServer::~PipeServer() {
 
         delete this->initOl;
     }
+
+    CloseHandle(this->readOl.hEvent);
+    CloseHandle(this->writeOl.hEvent);
 }
 
 bool PipeServer::BeginConnect() {
@@ -83,78 +91,48 @@ bool PipeServer::EndConnect() {
 }
 
 bool PipeServer::Send(void* msg, int len) {
-    OVERLAPPED ol = {0};
-    ol.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
-
-    if(!WriteFile(this->pipe, msg, len, nullptr, &ol)) {
-        if(GetLastError() != ERROR_IO_PENDING) {
-            CloseHandle(ol.hEvent);
-            return false;
-        }
+    return this->Write(msg, len);
+}
 
-        if(WaitForSingleObject(ol.hEvent, timeout) != WAIT_OBJECT_0) {
-            CloseHandle(ol.hEvent);
-            return false;
-        }
+// waits for the read or write on ol, cancels it on timeout
+bool PipeServer::Complete(OVERLAPPED* ol, DWORD* n) {
+    if(GetLastError() != ERROR_IO_PENDING) {
+        dbg_printf("Error on pipe: %d\n", GetLastError());
+        return false;
+    }
 
-        DWORD ignored;
+    if(WaitForSingleObject(ol->hEvent, this->timeout) != WAIT_OBJECT_0) {
+        CancelIo(this->pipe);
+        GetOverlappedResult(this->pipe, ol, n, TRUE);
+        return false;
+    }
 
-        if(!GetOverlappedResult(this->pipe, &ol, &ignored, TRUE)) {
-            CloseHandle(ol.hEvent);
-            return false;
-        }
+    if(!GetOverlappedResult(this->pipe, ol, n, TRUE)) {
+        dbg_printf("Error on pipe: %d\n", GetLastError());
+        return false;
     }
 
-    CloseHandle(ol.hEvent);
     return true;
 }
 
-void* PipeServer::ReceiveRaw(int numBytesExpected) {
-    void* buf = calloc(1, numBytesExpected);
-    if(numBytesExpected == 0)
-        return buf;
-
-    OVERLAPPED ol = {0};
-    ol.hEvent = CreateEvent(nullptr, true, false, nullptr);
-    
-    DWORD bytesRead;
-
-    if(ReadFile(this->pipe, buf, numBytesExpected, nullptr, &ol)) {
-        CloseHandle(ol.hEvent);
-        return buf;
-    }
-
-    auto err = GetLastError();
+unsigned int PipeServer::Read(void* buf, unsigned int len) {
+    DWORD bytesRead = 0;
 
-    if(err != ERROR_IO_PENDING) {
-        dbg_printf("Error reading from pipe: %d\n", err);
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
-    }
+    if(ReadFile(this->pipe, buf, len, nullptr, &this->readOl))
+        GetOverlappedResult(this->pipe, &this->readOl, &bytesRead, TRUE);
+    else if(!this->Complete(&this->readOl, &bytesRead))
+        return 0;
 
-    if(WaitForSingleObject(ol.hEvent, this->timeout) != WAIT_OBJECT_0) {
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
-    }
-
-    if(!GetOverlappedResult(this->pipe, &ol, &bytesRead, TRUE)) {
-        dbg_printf("Error reading from pipe: %d\n", GetLastError());
-
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
-    }
+    return bytesRead;
+}
 
-    if(bytesRead != numBytesExpected) {
-        dbg_printf("Error reading from. Got %d bytes, expected %d\n", bytesRead, numBytesExpected);
+bool PipeServer::Write(void const* buf, unsigned int len) {
+    DWORD written = 0;
 
-        CloseHandle(ol.hEvent);
-        free(buf);
-        return nullptr;
-    }
+    if(WriteFile(this->pipe, buf, len, nullptr, &this->writeOl))
+        GetOverlappedResult(this->pipe, &this->writeOl, &written, TRUE);
+    else if(!this->Complete(&this->writeOl, &written))
+        return false;
 
-    CloseHandle(ol.hEvent);
-    return buf;
-}
\ No newline at end of file
+    return written == len;
+}
@@ -1,15 +1,19 @@
 #ifndef __PIPE_SERVER_H__
 #define __PIPE_SERVER_H__
+#include <vector>
 #include "PipeConnect.h"
 
-class PipeServer {
+class PipeServer : public Transport {
 private:
     HANDLE pipe;
     OVERLAPPED *initOl;
+    OVERLAPPED readOl, writeOl;
 
     const char* name;
     int timeout;
     bool connected;
+
+    std::vector<char> content;
 public:
     PipeServer(const char* name, int timeout);
     ~PipeServer();
@@ -17,38 +21,36 @@ public:
     bool BeginConnect();
     bool EndConnect();
 
+    // for reads and writes from now on
+    void Timeout(int timeout) {
+        this->timeout = timeout;
+    }
+
     template<typename MsgT>
     bool Expect(MsgT* msg, ErrMessage* err) {
         err->error = nullptr;
-        auto header = this->Receive<MessageHeader>();
-        
-        if(header == nullptr) {
+
+        MessageHeader header;
+        if(!this->ReadHeader(&header)) {
             err->error = _strdup("No messageheader received.");
             return false;
         }
 
-        auto content = this->Receive(header->len);
-        if(content == nullptr) {
+        this->content.resize(header.len);
+        if(!this->ReadAll(this->content.data(), header.len)) {
             err->error = _strdup("No content received.");
-            delete header;
             return false;
         }
 
-        if(header->tag == MsgT::tag) {
-            auto deserializeOk = MessageSerializer::Deserialize(header, content, msg);
-
-            delete header;
-            delete content;
+        if(header.tag == MsgT::tag) {
+            auto deserializeOk = MessageSerializer::Deserialize(&header, this->content.data(), msg);
 
             if(!deserializeOk)
                 err->error = _strdup("Could not deserialize message.");
 
             return deserializeOk;
-        } else if(header->tag == ErrMessage::tag) {
-            auto deserializeOk = MessageSerializer::Deserialize(header, content, err);
-
-            delete header;
-            delete content;
+        } else if(header.tag == ErrMessage::tag) {
+            auto deserializeOk = MessageSerializer::Deserialize(&header, this->content.data(), err);
 
             if(!deserializeOk)
                 err->error = _strdup("Could not deserialize error message.");
@@ -58,28 +60,24 @@ public:
 
         err->error = _strdup("Unexpected message received.");
 
-        delete header;
-        delete content;
-
         return false;
     }
 
-    template<typename Ret=char>
-    Ret* Receive(int expectedNumBytes = sizeof(Ret)) {
-        return reinterpret_cast<Ret*>(this->ReceiveRaw(expectedNumBytes));
-    }
-    
     template<typename MsgT>
-    void Send(MsgT msg) {
+    bool Send(MsgT msg) {
         auto serialized = MessageSerializer::Serialize(msg);
+        auto ret = this->WriteMessage(serialized);
+        delete[] (char*)serialized;
 
-        this->Send(serialized, sizeof(MessageHeader) + serialized->len);
-        delete serialized;
+        return ret;
     }
 
     bool Send(void* msg, int len);
 
+    unsigned int Read(void* buf, unsigned int len);
+    bool Write(void const* buf, unsigned int len);
+
 private:
-    void* ReceiveRaw(int expectedNumBytes);
+    bool Complete(OVERLAPPED* ol, DWORD* n);
 };
-#endif
\ No newline at end of file
+#endif
@@ -1,141 +1,244 @@
 #ifndef __SERIALIZER__H__
 #define __SERIALIZER__H__
 #include <vector>
+#include <utility>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
 #include "Messages.hpp"
 #include "Debug.h"
 
 template<typename T>
-struct TypeSerializer {
-    static void Serialize(unsigned int* len, char** values, T value) {
-        auto valueLen = sizeof(T);
-
-        if(valueLen == 0)
-            return;
+struct TypeSerializer;
+
+// A Serializer keeps the bytes of a message as a gather list of chunks.
+// Small values are copied into blocks it owns; each new block is twice
+// the size of the last and blocks never move, so appending is amortized
+// O(1). Blobs of RefMin bytes or more are only referenced and must stay
+// alive until the message is flattened with Value(). Merging a moved
+// Serializer takes over its blocks and chunks instead of copying them.
+struct SerializerChunk {
+    char const* data;
+    unsigned int len;
+};
 
-        auto newValues = (char*) malloc(*len + valueLen);
+class Serializer {
+private:
+    enum { MinBlock = 1024, RefMin = 256 };
 
-        if(*values != nullptr) {
-            memcpy(newValues, *values, *len);
-            free(*values);
-        }
+    std::vector<SerializerChunk> chunks;
+    std::vector<char*> blocks;
+    char* tail;
+    unsigned int tailLen;
+    unsigned int blockLen;
+    unsigned int length;
+    unsigned int offset;
 
-        memcpy(newValues+(*len), &value, valueLen);
+    void Grow(unsigned int len) {
+        this->blockLen = this->blockLen ? this->blockLen * 2 : (unsigned int)MinBlock;
+        if(this->blockLen < len)
+            this->blockLen = len;
 
-        *len += valueLen;
-        *values = newValues;
+        this->tail = (char*)malloc(this->blockLen);
+        this->tailLen = this->blockLen;
+        this->blocks.push_back(this->tail);
     }
 
-    static void Deserialize(char* values, unsigned int* off, T* value) {
-        auto valueLen = sizeof(T);
+    void Release() {
+        for(auto b : this->blocks)
+            free(b);
+        this->blocks.clear();
+        this->chunks.clear();
+        this->tail = nullptr;
+        this->tailLen = this->blockLen = this->length = this->offset = 0;
+    }
 
-        if(valueLen == 0)
-            return;
+    void Take(Serializer& other) {
+        this->chunks.swap(other.chunks);
+        this->blocks.swap(other.blocks);
+        this->tail = other.tail;
+        this->tailLen = other.tailLen;
+        this->blockLen = other.blockLen;
+        this->length = other.length;
+        this->offset = other.offset;
 
-        memcpy(value, values + (*off), valueLen);
-        
-        *off += valueLen;
+        other.tail = nullptr;
+        other.tailLen = other.blockLen = other.length = other.offset = 0;
     }
-};
 
-class Serializer {
-private:
-    unsigned int length;
-    char* value;
-    unsigned int offset;
 public:
-    Serializer() : length(0), value(nullptr), offset(0) {}
-    Serializer(const Serializer &other) {
-        if(other.length) {
-            this->value = (char*)malloc(other.length);
-            memcpy(this->value, other.value, other.length);
-        } else {
-            this->value = nullptr;
-        }
-
-        this->length = other.length;
+    Serializer() : tail(nullptr), tailLen(0), blockLen(0), length(0), offset(0) {}
+    Serializer(const Serializer &other) : tail(nullptr), tailLen(0), blockLen(0), length(0), offset(0) {
+        if(other.length)
+            this->Grow(other.length);
+        *this << other;
         this->offset = other.offset;
     }
-    Serializer(unsigned int len, char const* content) : length(len), offset(0) {
-        this->value = (char*)malloc(len);
-        memcpy(this->value, content, len);
+    Serializer(Serializer&& other) : tail(nullptr), tailLen(0), blockLen(0), length(0), offset(0) {
+        this->Take(other);
+    }
+    Serializer(unsigned int len, char const* content) : tail(nullptr), tailLen(0), blockLen(0), length(0), offset(0) {
+        this->Append(content, len);
     }
 
     ~Serializer() {
-        free(this->value);
+        this->Release();
+    }
+
+    Serializer& operator=(Serializer&& other) {
+        if(this != &other) {
+            this->Release();
+            this->Take(other);
+        }
+        return *this;
     }
 
-    unsigned int Length() {
+    Serializer& operator=(const Serializer& other) {
+        if(this != &other)
+            *this = Serializer(other);
+        return *this;
+    }
+
+    unsigned int Length() const {
         return this->length;
     }
 
-    char* Value() {
+    std::vector<SerializerChunk> const& Chunks() const {
+        return this->chunks;
+    }
+
+    // copy len bytes
+    void Append(void const* data, unsigned int len) {
+        if(len == 0)
+            return;
+
+        if(this->tailLen < len)
+            this->Grow(len);
+
+        memcpy(this->tail, data, len);
+
+        if(!this->chunks.empty() && this->chunks.back().data + this->chunks.back().len == this->tail) {
+            this->chunks.back().len += len;
+        } else {
+            SerializerChunk c = { this->tail, len };
+            this->chunks.push_back(c);
+        }
+
+        this->tail += len;
+        this->tailLen -= len;
+        this->length += len;
+    }
+
+    // reference len bytes, or copy them when that is cheaper
+    void Reference(void const* data, unsigned int len) {
+        if(len < RefMin) {
+            this->Append(data, len);
+            return;
+        }
+
+        SerializerChunk c = { (char const*)data, len };
+        this->chunks.push_back(c);
+        this->length += len;
+    }
+
+    void CopyTo(char* out) const {
+        for(auto& c : this->chunks) {
+            memcpy(out, c.data, c.len);
+            out += c.len;
+        }
+    }
+
+    char* Value() const {
         char* r = new char[this->length];
-        memcpy(r, this->value, this->length);
+        this->CopyTo(r);
         return r;
     }
 
+    // the bytes in one piece, joined once if needed
     char const* ValueRaw() {
-        return this->value;
+        if(this->chunks.size() > 1) {
+            char* joined = (char*)malloc(this->length);
+            this->CopyTo(joined);
+
+            auto len = this->length;
+            auto off = this->offset;
+            this->Release();
+
+            this->blocks.push_back(joined);
+            SerializerChunk c = { joined, len };
+            this->chunks.push_back(c);
+            this->blockLen = this->length = len;
+            this->offset = off;
+        }
+
+        return this->chunks.empty() ? nullptr : this->chunks[0].data;
+    }
+
+    Serializer& operator<<(Serializer&& other) {
+        this->chunks.insert(this->chunks.end(), other.chunks.begin(), other.chunks.end());
+        this->blocks.insert(this->blocks.end(), other.blocks.begin(), other.blocks.end());
+        this->length += other.length;
+
+        other.chunks.clear();
+        other.blocks.clear();
+        other.tail = nullptr;
+        other.tailLen = other.blockLen = other.length = other.offset = 0;
+        return *this;
+    }
+
+    Serializer& operator<<(const Serializer& other) {
+        for(auto& c : other.chunks)
+            this->Append(c.data, c.len);
+        return *this;
+    }
+
+    Serializer& operator<<(Serializer& other) {
+        return *this << (const Serializer&)other;
     }
 
     template<typename T>
     Serializer& operator<<(T value) {
-        TypeSerializer<T>::Serialize(&this->length, &this->value, value);
+        TypeSerializer<T>::Serialize(*this, value);
         return *this;
     }
 
     template<typename T>
     Serializer& operator>>(T* value) {
-        TypeSerializer<T>::Deserialize(this->value, &this->offset, value);
+        TypeSerializer<T>::Deserialize((char*)this->ValueRaw(), &this->offset, value);
         return *this;
     }
 };
 
-template<>
-struct TypeSerializer<Serializer> {
-    static void Serialize(unsigned int* fstLen, char** fst, Serializer value) {
-        auto sndLen = value.Length();
-
-        if(sndLen == 0)
-            return;
+template<typename T>
+struct TypeSerializer {
+    static void Serialize(Serializer& ser, T value) {
+        ser.Append(&value, sizeof(T));
+    }
 
-        auto snd = value.ValueRaw();
+    static void Deserialize(char* values, unsigned int* off, T* value) {
+        auto valueLen = sizeof(T);
 
-        auto merged = (char*)malloc(*fstLen + sndLen);
+        if(valueLen == 0)
+            return;
 
-        if(*fst != nullptr) {
-            memcpy(merged, *fst, *fstLen);
-            free(*fst);
-        }
+        memcpy(value, values + (*off), valueLen);
         
-        memcpy(merged+(*fstLen), snd, sndLen);
-
-        *fst = merged;
-        *fstLen += sndLen;
+        *off += valueLen;
     }
 };
 
 template<>
 struct TypeSerializer<char*> {
-    static void Serialize(unsigned int* headLen, char** head, char* value) {
+    static void Serialize(Serializer& ser, char* value) {
         unsigned int valueLen = strlen(value) + 1;
-        auto tailLen = sizeof(unsigned int) + valueLen;
-
-        auto merged = (char*)malloc(*headLen + tailLen);
-        if(*head != nullptr) {
-            memcpy(merged, *head, *headLen);
-            free(*head);
-        }
 
-        *(unsigned int*)(merged + *headLen) = valueLen;
-        memcpy(merged+(*headLen)+sizeof(unsigned int), value, valueLen);
-        
-        *head = merged;
-        *headLen += tailLen;
+        ser.Append(&valueLen, sizeof(unsigned int));
+        ser.Reference(value, valueLen);
     }
 
     static void Deserialize(char* values, unsigned int* off, char** value) {
-        auto valueLen = *(unsigned int*)(values + *off);
+        unsigned int valueLen;
+        memcpy(&valueLen, values + (*off), sizeof(unsigned int));
         *off += sizeof(unsigned int);
 
         *value = (char*)malloc(valueLen);
@@ -151,43 +254,38 @@ struct Pack {
 
 template<>
 struct TypeSerializer<Pack> {
-    static void Serialize(unsigned int* headLen, char** head, Pack value) {
-        unsigned int valueLen = value.len;
-        auto tailLen = sizeof(unsigned int) + valueLen;
-
-        auto merged = (char*)malloc(*headLen + tailLen);
-        if(*head != nullptr) {
-            memcpy(merged, *head, *headLen);
-            free(*head);
-        }
-
-        *(unsigned int*)(merged + *headLen) = valueLen;
-        memcpy(merged+(*headLen)+sizeof(unsigned int), value.content, valueLen);
-
-        *head = merged;
-        *headLen += tailLen;
+    static void Serialize(Serializer& ser, Pack value) {
+        ser.Append(&value.len, sizeof(unsigned int));
+        ser.Reference(value.content, value.len);
     }
 
     static void Deserialize(char* values, unsigned int* off, Pack* value) {
-        auto valueLen = *(unsigned int*)values;
+        unsigned int valueLen;
+        memcpy(&valueLen, values + (*off), sizeof(unsigned int));
         *off += sizeof(unsigned int);
 
+        value->len = valueLen;
         value->content = (char*)malloc(valueLen);
         memcpy(value->content, values + (*off), valueLen);
         *off += valueLen;
     }
 };
 
+// the header and the content in one buffer, for Send and delete
+inline MessageHeader* MessageOf(MessageTag tag, Serializer const& content) {
+    char* r = new char[sizeof(MessageHeader) + content.Length()];
+    new (r) MessageHeader(tag, content.Length());
+    content.CopyTo(r + sizeof(MessageHeader));
+    return reinterpret_cast<MessageHeader*>(r);
+}
+
 template<typename MsgT>
 struct _MessageSerializer {
     static MessageHeader* Serialize(MsgT message) {
         Serializer content;
         content << message;
         
-        Serializer msg; 
-        msg << MessageHeader(MsgT::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(MsgT::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, MsgT* msgOut) {
@@ -205,10 +303,7 @@ struct _MessageSerializer<ErrMessage> {
         Serializer content;
         content << message.error;
 
-        Serializer msg;
-        msg << MessageHeader(ErrMessage::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(ErrMessage::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, ErrMessage* msgOut) {
@@ -226,10 +321,7 @@ struct _MessageSerializer<GetApiPipeResult> {
         Serializer content;
         content << message.pipeName;
 
-        Serializer msg;
-        msg << MessageHeader(GetApiPipeResult::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(GetApiPipeResult::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, GetApiPipeResult* msgOut) {
@@ -241,6 +333,24 @@ struct _MessageSerializer<GetApiPipeResult> {
     }
 };
 
+template<>
+struct _MessageSerializer<OpenRingMessage> {
+    static MessageHeader* Serialize(OpenRingMessage message) {
+        Serializer content;
+        content << message.name << message.size;
+
+        return MessageOf(OpenRingMessage::tag, content);
+    }
+
+    static bool Deserialize(MessageHeader* header, char* content, OpenRingMessage* msgOut) {
+        if(header->tag != OpenRingMessage::tag)
+            return false;
+
+        Serializer(header->len, content) >> &msgOut->name >> &msgOut->size;
+        return true;
+    }
+};
+
 template<>
 struct _MessageSerializer<CallRequestMessage> {
     static MessageHeader* Serialize(CallRequestMessage message) {
@@ -253,17 +363,14 @@ struct _MessageSerializer<CallRequestMessage> {
             content << p;
         }
 
-        Serializer msg;
-        msg << MessageHeader(CallRequestMessage::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(CallRequestMessage::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, CallRequestMessage* msgOut) {
         if(header->tag != CallRequestMessage::tag)
             return false;
 
-        Serializer& ser = Serializer(header->len, content);
+        Serializer ser(header->len, content);
 
         ser >> &msgOut->function;
         ser >> &msgOut->argc;
@@ -295,17 +402,14 @@ struct _MessageSerializer<CallResponseMessage> {
         
         content << message.lastError;
 
-        Serializer msg;
-        msg << MessageHeader(CallResponseMessage::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(CallResponseMessage::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, CallResponseMessage* msgOut) {
         if(header->tag != CallResponseMessage::tag)
             return false;
 
-        Serializer& ser = Serializer(header->len, content);
+        Serializer ser(header->len, content);
 
         ser >> &msgOut->resultSize;
 
@@ -329,17 +433,14 @@ struct _MessageSerializer<ApplyPluginStateMessage> {
         content << message.n_instance;
         content << message.loaderInfo;
 
-        Serializer msg;
-        msg << MessageHeader(ApplyPluginStateMessage::tag, content.Length()) << content;
-
-        return reinterpret_cast<MessageHeader*>(msg.Value());
+        return MessageOf(ApplyPluginStateMessage::tag, content);
     }
 
     static bool Deserialize(MessageHeader* header, char* content, ApplyPluginStateMessage* msgOut) {
         if(header->tag != ApplyPluginStateMessage::tag)
             return false;
 
-        Serializer& ser = Serializer(header->len, content);
+        Serializer ser(header->len, content);
         ser >> &msgOut->name >> &msgOut->path;
         ser >> (DWORD*)&msgOut->hSlit;
         ser >> &msgOut->isEnabled >> &msgOut->canUseSlit >> &msgOut->useSlit >> &msgOut->inSlit;
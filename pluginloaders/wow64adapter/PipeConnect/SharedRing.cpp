@@ -0,0 +1,60 @@
+#include "PipeConnect.h"
+#include "../Debug.h"
+
+SharedRing::~SharedRing() {
+    if(this->header != nullptr)
+        UnmapViewOfFile(this->header);
+
+    if(this->map != nullptr)
+        CloseHandle(this->map);
+}
+
+bool SharedRing::Create(const char* name, uint32_t size) {
+    if(!ValidSize(size))
+        return false;
+
+    this->map = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, MappingSize(size), name);
+    if(this->map == nullptr) {
+        dbg_printf("Creating ring %s failed: %d\n", name, GetLastError());
+        return false;
+    }
+
+    // someone else's, maybe smaller and in use: not to be initialized
+    if(GetLastError() == ERROR_ALREADY_EXISTS) {
+        dbg_printf("Ring %s exists already\n", name);
+        CloseHandle(this->map);
+        this->map = nullptr;
+        return false;
+    }
+
+    auto mem = MapViewOfFile(this->map, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if(mem == nullptr)
+        return false;
+
+    if(this->Init(mem, size))
+        return true;
+
+    UnmapViewOfFile(mem);
+    return false;
+}
+
+bool SharedRing::Open(const char* name) {
+    this->map = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, name);
+    if(this->map == nullptr) {
+        dbg_printf("Opening ring %s failed: %d\n", name, GetLastError());
+        return false;
+    }
+
+    auto mem = MapViewOfFile(this->map, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if(mem == nullptr)
+        return false;
+
+    // the view is as big as the mapping, whatever the header says
+    MEMORY_BASIC_INFORMATION mbi;
+    if(VirtualQuery(mem, &mbi, sizeof mbi) == sizeof mbi && this->Attach(mem, mbi.RegionSize))
+        return true;
+
+    dbg_printf("Ring %s is not a ring\n", name);
+    UnmapViewOfFile(mem);
+    return false;
+}
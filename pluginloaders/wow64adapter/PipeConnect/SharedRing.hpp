@@ -0,0 +1,202 @@
+#ifndef __SHARED_RING_H__
+#define __SHARED_RING_H__
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+// A ring of records in shared memory, one process writes and one reads.
+// Bulk data goes through it; the pipe only says that there is some.
+//
+// The layout has only fixed size fields so the 32 and 64 bit sides
+// agree on it. head and tail count the bytes written and released and
+// wrap at 2^32. A record is an 8 byte header and the data padded to 8.
+// A record that does not fit before the end of the ring goes to the
+// start, behind a skip marker, so every record is in one piece and the
+// reader uses it where it is until it releases it.
+//
+// The other process may be broken or hostile: the size is taken once
+// when attaching and checked against the mapping, and a record is only
+// used when it lies between tail and head.
+struct RingHeader {
+    uint32_t magic;
+    uint32_t size;                  // of the data, a power of 2
+    uint32_t reserved0[14];
+
+    std::atomic<uint32_t> head;     // written by the producer only
+    uint32_t reserved1[15];
+
+    std::atomic<uint32_t> tail;     // written by the consumer only
+    uint32_t reserved2[15];
+};
+
+static_assert(sizeof(RingHeader) == 192, "RingHeader must be the same for 32 and 64 bit");
+
+class SharedRing {
+private:
+    enum : uint32_t { Magic = 0x52696e67, Skip = 0xffffffff };
+
+    RingHeader* header;
+    char* data;
+    uint32_t size;
+    uint32_t mask;
+
+    uint32_t reserved;      // bytes taken by the record being written
+    uint32_t peeked;        // bytes taken by the record being read
+
+    void* map;
+
+    static uint32_t RecordSize(uint32_t len) {
+        return 8 + ((len + 7) & ~7u);
+    }
+
+public:
+    SharedRing() : header(nullptr), data(nullptr), size(0), mask(0), reserved(0), peeked(0), map(nullptr) {}
+    ~SharedRing();
+
+    static uint32_t MappingSize(uint32_t size) {
+        return sizeof(RingHeader) + size;
+    }
+
+    // a new named mapping, size a power of 2. Fails if the name is taken
+    bool Create(const char* name, uint32_t size);
+    bool Open(const char* name);
+
+    static bool ValidSize(uint32_t size) {
+        return size >= 64 && size <= 0x40000000u && (size & (size - 1)) == 0;
+    }
+
+    // a new ring in mem of MappingSize(size) bytes, on the side that made it
+    bool Init(void* mem, uint32_t size) {
+        if(!ValidSize(size))
+            return false;
+
+        this->header = (RingHeader*)mem;
+        this->data = (char*)mem + sizeof(RingHeader);
+        this->header->magic = Magic;
+        this->header->size = size;
+        this->header->head.store(0);
+        this->header->tail.store(0);
+
+        this->size = size;
+        this->mask = size - 1;
+        return true;
+    }
+
+    // the ring the other side made, in the bytes mapped at mem
+    bool Attach(void* mem, size_t bytes) {
+        if(bytes < sizeof(RingHeader))
+            return false;
+
+        auto header = (RingHeader*)mem;
+        uint32_t size = header->size;
+
+        if(header->magic != Magic || !ValidSize(size) || MappingSize(size) > bytes)
+            return false;
+
+        this->header = header;
+        this->data = (char*)mem + sizeof(RingHeader);
+        this->size = size;
+        this->mask = size - 1;
+        return true;
+    }
+
+    uint32_t Size() const {
+        return this->size;
+    }
+
+    // whether a record of len bytes can be written at all: with at most
+    // half the ring it fits in an empty ring wherever the skip would be
+    bool Fits(uint32_t len) const {
+        return len <= this->size / 2 - 8;
+    }
+
+    // room for len bytes at the producer's end, nullptr when full
+    void* Reserve(uint32_t len) {
+        if(!this->Fits(len))
+            return nullptr;
+
+        auto size = this->size;
+        auto head = this->header->head.load(std::memory_order_relaxed);
+        auto tail = this->header->tail.load(std::memory_order_acquire);
+
+        if(head - tail > size)
+            return nullptr;
+
+        auto pos = head & this->mask;
+        auto rec = RecordSize(len);
+        auto need = rec;
+
+        if(rec > size - pos)
+            need += size - pos;
+
+        if(need > size - (head - tail))
+            return nullptr;
+
+        if(need > rec) {
+            *(uint32_t*)(this->data + pos) = Skip;
+            pos = 0;
+        }
+
+        *(uint32_t*)(this->data + pos) = len;
+        this->reserved = need;
+
+        return this->data + pos + 8;
+    }
+
+    // the reserved record can be read now
+    void Commit() {
+        auto head = this->header->head.load(std::memory_order_relaxed);
+        this->header->head.store(head + this->reserved, std::memory_order_release);
+        this->reserved = 0;
+    }
+
+    // the oldest record, nullptr when there is none or it is bad
+    void const* Peek(uint32_t* len) {
+        auto tail = this->header->tail.load(std::memory_order_relaxed);
+        auto head = this->header->head.load(std::memory_order_acquire);
+        auto avail = head - tail;
+
+        if(avail == 0 || avail > this->size || avail % 8 != 0)
+            return nullptr;
+
+        auto pos = tail & this->mask;
+        auto skip = 0u;
+
+        if(*(uint32_t*)(this->data + pos) == Skip) {
+            skip = this->size - pos;
+            pos = 0;
+        }
+
+        auto n = *(uint32_t*)(this->data + pos);
+
+        // a record the producer could not have written
+        if(!this->Fits(n) || skip + RecordSize(n) > avail)
+            return nullptr;
+
+        *len = n;
+        this->peeked = skip + RecordSize(n);
+
+        return this->data + pos + 8;
+    }
+
+    // done with the record from Peek, the producer may write over it
+    void Release() {
+        auto tail = this->header->tail.load(std::memory_order_relaxed);
+        this->header->tail.store(tail + this->peeked, std::memory_order_release);
+        this->peeked = 0;
+    }
+
+    // copies len bytes in as one record, false when full
+    bool Write(void const* buf, uint32_t len) {
+        auto p = this->Reserve(len);
+        if(p == nullptr)
+            return false;
+
+        memcpy(p, buf, len);
+        this->Commit();
+
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+#include <stddef.h>
+#include <stdint.h>
+#include "Messages.hpp"
+
+// Version 2 is the call protocol of CallChannel: MessageHeader has a
+// request id, answers come after FlushMessage and big messages may go
+// through a SharedRing. Version 1 is the protocol from before: headers
+// without the id and every answer written right after its request.
+enum : uint32_t { ProtocolMagic = 0x57366262, ProtocolVersion = 2, ProtocolMinVersion = 1 };
+
+// The plugin host, which connects, writes its ProtocolHello first with
+// the highest version it speaks; the adapter answers with the version
+// they use. A version 1 host sends none and waits for requests.
+struct ProtocolHello {
+    uint32_t magic;
+    uint32_t version;
+};
+
+// The byte stream under a CallChannel: a named pipe here, anything that
+// keeps the bytes in order will do. It knows the protocol version, for
+// how message headers look on it.
+class Transport {
+private:
+    uint32_t version;
+
+public:
+    Transport() : version(ProtocolVersion) {}
+    virtual ~Transport() {}
+
+    // reads at least one and at most len bytes, returns 0 on failure
+    virtual unsigned int Read(void* buf, unsigned int len) = 0;
+    virtual bool Write(void const* buf, unsigned int len) = 0;
+
+    bool ReadAll(void* buf, unsigned int len) {
+        char* p = (char*)buf;
+
+        while(len > 0) {
+            auto n = this->Read(p, len);
+            if(n == 0)
+                return false;
+
+            p += n;
+            len -= n;
+        }
+
+        return true;
+    }
+
+    uint32_t Version() const {
+        return this->version;
+    }
+
+    // for a connection whose version was agreed on another one
+    void Version(uint32_t version) {
+        this->version = version;
+    }
+
+    // the bytes of a MessageHeader on the wire, version 1 has no id
+    unsigned int HeaderSize() const {
+        return this->version < 2 ? offsetof(MessageHeader, id) : sizeof(MessageHeader);
+    }
+
+    // msg as made by MessageSerializer, header and content
+    bool WriteMessage(MessageHeader const* msg) {
+        if(this->version < 2)
+            return this->Write(msg, this->HeaderSize()) && this->Write(msg + 1, msg->len);
+
+        return this->Write(msg, sizeof(MessageHeader) + msg->len);
+    }
+
+    bool ReadHeader(MessageHeader* header) {
+        header->id = 0;
+        return this->ReadAll(header, this->HeaderSize());
+    }
+
+    // the host's side: offers ProtocolVersion, false unless the adapter
+    // answers with a version we speak
+    bool Offer() {
+        ProtocolHello ours = { ProtocolMagic, ProtocolVersion }, theirs;
+
+        if(!this->Write(&ours, sizeof ours) || !this->ReadAll(&theirs, sizeof theirs))
+            return false;
+
+        if(theirs.magic != ProtocolMagic || theirs.version < ProtocolMinVersion || theirs.version > ProtocolVersion)
+            return false;
+
+        this->version = theirs.version;
+        return true;
+    }
+
+    // the adapter's side, with a read timeout: takes the host's hello, or
+    // none as version 1, and answers with the version to use. *peer is
+    // the version the host offered, 0 for something else than a hello
+    bool Accept(uint32_t* peer) {
+        ProtocolHello ours = { ProtocolMagic, ProtocolVersion }, theirs;
+
+        *peer = 0;
+        auto n = this->Read(&theirs, sizeof theirs);
+        if(n == 0) {
+            *peer = this->version = 1;
+            return true;
+        }
+
+        if(!this->ReadAll((char*)&theirs + n, sizeof theirs - n) || theirs.magic != ProtocolMagic)
+            return false;
+
+        *peer = theirs.version;
+        if(theirs.version < ProtocolMinVersion)
+            return false;
+
+        if(theirs.version < ours.version)
+            ours.version = theirs.version;
+
+        this->version = ours.version;
+        return this->Write(&ours, sizeof ours);
+    }
+};
+
+#endif
@@ -22,9 +22,21 @@ char plugInfoBuffer[plugInfoBuffersize];
 char errorBuffer[errorBuffersize];
 
 static const int timeout = INFINITE;
+// a host from before the ProtocolHello never sends one, it is
+// talked to with version 1 when none came by then
+static const int helloTimeout = 5000;
+static uint32_t protocolVersion;
 
 static PipeServer *controlPipe;
 static const char* controlPipeName = "\\\\.\\pipe\\bbWow64AdapterControlPipe";
+
+// big answers to the host, the pipe only signals them. The name has
+// our process id, so that two blackboxes do not share one
+static SharedRing *bulkRing;
+static char bulkRingName[64];
+static const unsigned int bulkRingSize = 1 << 20;
+static HANDLE apiThread;
+
 bool abortApiPump;
 
 static const char* hostName = "PluginHostPrototype.exe";
@@ -77,32 +89,75 @@ bool Init(char* workingDir) {
         return false;
     }
 
-    GetApiPipeMessage getApi = { timeout };
+    // the version both speak, for this pipe and the api pipe. Anything
+    // else would misread the messages or wait for answers that do not come
+    uint32_t hostVersion;
 
-    auto getApiMsg = MessageSerializer::Serialize(getApi);
-    if(!controlPipe->Send(getApiMsg, sizeof(MessageHeader) + getApiMsg->len)) {
-        delete getApiMsg;
+    controlPipe->Timeout(helloTimeout);
+    auto helloOk = controlPipe->Accept(&hostVersion);
+    controlPipe->Timeout(timeout);
+
+    if(!helloOk) {
+        if(hostVersion == 0)
+            BBMessageBox(MB_OK, "%s:\nThe plugin host %s does not speak the plugin protocol.", name, hostName);
+        else
+            BBMessageBox(MB_OK, "%s:\nThe plugin host %s speaks protocol version %u, need %u to %u.", name, hostName, hostVersion, ProtocolMinVersion, ProtocolVersion);
 
         TerminateProcess(pluginHostProcess, -1);
         delete controlPipe;
         return false;
     }
 
-    GetApiPipeResult apiResult;
+    protocolVersion = controlPipe->Version();
+
     OkMessage ok;
     ErrMessage errMsg;
 
+    // before the api thread starts, which writes to it. Without the
+    // ring everything goes through the pipes, as with version 1
+    bulkRing = new SharedRing;
+    sprintf(bulkRingName, "Local\\bbWow64AdapterBulkRing.%lu", GetCurrentProcessId());
+
+    if(protocolVersion >= 2 && bulkRing->Create(bulkRingName, bulkRingSize)) {
+        OpenRingMessage openRing = { bulkRingName, bulkRingSize };
+        controlPipe->Send(openRing);
+
+        if(!controlPipe->Expect(&ok, &errMsg)) {
+            delete errMsg.error;
+
+            delete bulkRing;
+            bulkRing = nullptr;
+        }
+    } else {
+        delete bulkRing;
+        bulkRing = nullptr;
+    }
+
+    GetApiPipeMessage getApi = { timeout };
+
+    if(!controlPipe->Send(getApi)) {
+        TerminateProcess(pluginHostProcess, -1);
+        delete controlPipe;
+        delete bulkRing;
+        bulkRing = nullptr;
+        return false;
+    }
+
+    GetApiPipeResult apiResult;
+
     if(!controlPipe->Expect(&apiResult, &errMsg)) {
         delete errMsg.error;
 
         TerminateProcess(pluginHostProcess, -1);
         delete controlPipe;
+        delete bulkRing;
+        bulkRing = nullptr;
         return false;
     }
 
     // TODO: start thread which connects to api pipe...
 
-    auto apiThread = CreateThread(nullptr, 0, &ApiThread, apiResult.pipeName, 0, nullptr);
+    apiThread = CreateThread(nullptr, 0, &ApiThread, apiResult.pipeName, 0, nullptr);
     apiResult.pipeName = nullptr;
     
     if(!controlPipe->Expect(&ok, &errMsg)) {
@@ -123,6 +178,21 @@ void Finalize() {
         TerminateProcess(pluginHostProcess, 0);
 
     delete controlPipe;
+
+    // the api thread ends with the pipe to the host. Should it not, the
+    // ring stays, it might still write to it
+    if(apiThread != nullptr) {
+        if(WaitForSingleObject(apiThread, 1000) == WAIT_OBJECT_0) {
+            delete bulkRing;
+            bulkRing = nullptr;
+        }
+
+        CloseHandle(apiThread);
+        apiThread = nullptr;
+    } else {
+        delete bulkRing;
+        bulkRing = nullptr;
+    }
 }
 
 const char *GetName() {
@@ -248,16 +318,18 @@ DWORD WINAPI ApiThread(LPVOID par) {
         return -1;
     }
 
+    // requests are answered in order, the answers to a batch of them
+    // go out together at its FlushMessage
+    apiPipe->Version(protocolVersion);
+    CallChannel channel(apiPipe);
+    channel.Rings(bulkRing, nullptr);
+
     while(!abortApiPump) {
-        auto header = apiPipe->Receive<MessageHeader>();
-        if(header == nullptr)
-            break;
-        
-        auto content = apiPipe->Receive(header->len);
-        if(content == nullptr) {
-            delete header;
+        MessageHeader header;
+        char* content;
+
+        if(!channel.Receive(&header, &content))
             break;
-        }
 
         CallRequestMessage callRequest;
         CallResponseMessage callResponse;
@@ -265,38 +337,41 @@ DWORD WINAPI ApiThread(LPVOID par) {
         PongMessage pong;
         ErrMessage err;
 
-        switch(header->tag) {
+        switch(header.tag) {
             case CallRequestMessage::tag:
-                abortApiPump |= !MessageSerializer::Deserialize(header, content, &callRequest);
+                abortApiPump |= !MessageSerializer::Deserialize(&header, content, &callRequest);
                 if(abortApiPump)
                     break;
 
                 if(HandleApiRequest(&callRequest, &callResponse)) {
-                    abortApiPump |= !apiPipe->Send(callResponse);
+                    abortApiPump |= !channel.Send(callResponse, header.id);
 
                     free(callResponse.result);
                 } else {
                     err.error = "Function not implemented";
-                    abortApiPump |= !apiPipe->Send(err);
+                    abortApiPump |= !channel.Send(err, header.id);
                 }
                 break;
             case PingMessage::tag:
-                abortApiPump |= !MessageSerializer::Deserialize(header, content, &ping);
+                abortApiPump |= !MessageSerializer::Deserialize(&header, content, &ping);
                 if(abortApiPump)
                     break;
 
                 pong.challenge = ping.challenge;
-                abortApiPump |= !apiPipe->Send(pong);
+                abortApiPump |= !channel.Send(pong, header.id);
+                break;
+            case FlushMessage::tag:
+                abortApiPump |= !channel.Flush();
                 break;
             default:
                 err.error = "Message not understood";
-                abortApiPump |= !apiPipe->Send(err);
+                abortApiPump |= !channel.Send(err, header.id);
                 break;
         }
-
-        delete header;
-        delete content;
     }
 
+    channel.Flush();
     delete apiPipe;
+
+    return 0;
 }
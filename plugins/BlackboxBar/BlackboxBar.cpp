@@ -647,10 +647,11 @@ void barinfo::set_clock_string(void)
 
 	SYSTEMTIME lt;
 	GetLocalTime(&lt);
-	SetTimer(this->hwnd, CLOCK_TIMER, seconds
-		? 1100 - lt.wMilliseconds
-		: 61000 - lt.wSecond * 1000,
-		NULL);
+	// due a bit past the tick, so there is room for slack
+	if (seconds)
+		timer_set(this->hwnd, CLOCK_TIMER, 1100 - lt.wMilliseconds, 50);
+	else
+		timer_set(this->hwnd, CLOCK_TIMER, 61000 - lt.wSecond * 1000, 500);
 }
 
 //===========================================================================
@@ -1045,7 +1046,7 @@ LRESULT barinfo::wnd_proc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam,
 			if (NULL == strchr(item_string, M_WINL))
 				break;
 
-			SetTimer(hwnd, LABEL_TIMER, 2000, NULL);
+			timer_set(hwnd, LABEL_TIMER, 2000, 200);
 			ShowingExternalLabel = true;
 			wcsncpy_s(windowlabel, (LPWSTR)lParam, _TRUNCATE);
 			this->update(M_WINL);
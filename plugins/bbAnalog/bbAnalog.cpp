@@ -46,6 +46,7 @@
 #include "bblib.h"
 #include "bbPlugin.h"
 #include "bbversion.h"
+#include "aadraw.h"
 #include <time.h>
 #include <math.h>
 
@@ -111,6 +112,12 @@ struct bbanalog_plugin : plugin_info
     SYSTEMTIME clocktime;
     int centerX;
     int centerY;
+    int radius;
+
+    // background and tics, with the hands drawn on a copy every second
+    HDC face;
+    DWORD *face_bits;
+    int face_w, face_h;
 
     int showDate;
     bool antiAliasing;
@@ -118,8 +125,12 @@ struct bbanalog_plugin : plugin_info
 
     void ReadRCSettings();
     void getCurrentTime();
-    void DrawRadian (HDC hdc, int rfrom, int rto, int seconds, COLORREF Colour, int thickness);
-    void draw_clock(HDC);
+    void DrawRadian (HDC hdc, struct aa_bitmap *bm, int rfrom, int rto, int seconds, COLORREF Colour, int thickness);
+    void draw_background(HDC);
+    void draw_date(HDC);
+    void make_face(HDC);
+    void free_face();
+    void draw_hands(HDC, struct aa_bitmap *bm);
 
     void about_box()
     {
@@ -211,76 +222,12 @@ void endPlugin(HINSTANCE hPluginInstance)
 
 //===========================================================================
 
-//===========================================================================
-// draw antialiased line
-
-void BlendPixel(HDC hdc, int x, int y, COLORREF Paint, BYTE Alpha)
-{
-    COLORREF Paper = GetPixel(hdc, x, y);
-
-    BYTE PixelAlpha = Alpha;// * 5 / 10;
-    BYTE PaperAlpha = ~PixelAlpha;
-    SetPixel(hdc, x, y,
-        (((((Paint&0x0000FF)*PixelAlpha)+((Paper&0x0000FF)*PaperAlpha))&0x0000FF00)
-       | ((((Paint&0x00FF00)*PixelAlpha)+((Paper&0x00FF00)*PaperAlpha))&0x00FF0000)
-       | ((((Paint&0xFF0000)*PixelAlpha)+((Paper&0xFF0000)*PaperAlpha))&0xFF000000)
-         ) >> 8);
-}
-
-void DrawAALine(HDC hdc, int x0, int y0, int x1, int y1, DWORD Colour, int thickness)
-{
-    int dx, dy, xDir, t;
-    if(y0>y1)
-    {
-      t = y0, y0 = y1, y1=t; //Swap(y0,y1);
-      t = x0, x0 = x1, x1=t; //Swap(x0,x1);
-    }
-
-    //First and last Pixels always get set
-    SetPixel(hdc, x0, y0, Colour);
-    SetPixel(hdc, x1, y1, Colour);
-
-    dx=x1-x0;
-    dy=y1-y0;
-
-    if(dx>=0)   xDir=1;
-    else        xDir=-1, dx=-dx;
-
-    DWORD ErrorAcc = 0;
-    BYTE Alpha;
-
-    if(dy>dx) {
-        // y-major line
-        DWORD ErrorAdj = ((DWORD)dx<<16) / (DWORD)dy;
-        while(--dy) {
-            ErrorAcc+=ErrorAdj;
-            ++y0;
-            x1=x0+xDir*(WORD)(ErrorAcc>>16);
-            Alpha=(BYTE)(ErrorAcc>>8);
-            BlendPixel(hdc, x1,      y0, Colour, ~Alpha);
-            BlendPixel(hdc, x1+xDir, y0, Colour,  Alpha);
-        }
-
-    } else {
-        // x-major line
-        DWORD ErrorAdj=((DWORD)dy<<16) / (DWORD)dx;
-        while(--dx) {
-            ErrorAcc+=ErrorAdj;
-            x0+=xDir;
-            y1=y0+(WORD)(ErrorAcc>>16);
-            Alpha=(BYTE)(ErrorAcc>>8);
-            BlendPixel(hdc, x0, y1  , Colour, ~Alpha);
-            BlendPixel(hdc, x0, y1+1, Colour,  Alpha);
-        }
-    }
-}
-
 //===========================================================================
 // draw not-antialiased line
 
 void DrawLine(HDC hdc, int x0, int y0, int x1, int y1, DWORD Colour, int thickness)
 {
-    HGDIOBJ hpen = SelectObject(hdc, CreatePen(PS_SOLID, 1, Colour));
+    HGDIOBJ hpen = SelectObject(hdc, CreatePen(PS_SOLID, imax(1, (thickness + 5) / 10), Colour));
     MoveToEx(hdc, x0, y0, NULL);
     LineTo(hdc, x1, y1);
     DeleteObject(SelectObject(hdc, hpen));
@@ -288,14 +235,25 @@ void DrawLine(HDC hdc, int x0, int y0, int x1, int y1, DWORD Colour, int thickne
 }
 
 //===========================================================================
-// Draw the clock hands
+// Draw the clock hands. The thickness is in 1/10 pixel. With bm, anti-
+// aliased into its pixels (through pixel centers as the lines by GDI)
 
-void bbanalog_plugin::DrawRadian (HDC hdc, int rfrom, int rto, int seconds, COLORREF Colour, int thickness)
+void bbanalog_plugin::DrawRadian (HDC hdc, struct aa_bitmap *bm, int rfrom, int rto, int seconds, COLORREF Colour, int thickness)
 {
     double theta = seconds * (2*M_PI) / 3600;
 
     double fy = cos(theta);
     double fx = sin(theta);
+
+    if (bm) {
+        float cx = centerX + 0.5f, cy = centerY + 0.5f;
+        aa_line(bm,
+            (float)(cx + rfrom * fx), (float)(cy - rfrom * fy),
+            (float)(cx + rto * fx), (float)(cy - rto * fy),
+            thickness / 10.0f, Colour);
+        return;
+    }
+
     int px = (int)(centerX + (rfrom * fx) + 0.5);
     int py = (int)(centerY - (rfrom * fy) + 0.5);
 
@@ -305,19 +263,15 @@ void bbanalog_plugin::DrawRadian (HDC hdc, int rfrom, int rto, int seconds, COLO
     } else {
         int qx = (int)(centerX + (rto * fx) + 0.5);
         int qy = (int)(centerY - (rto * fy) + 0.5);
-        if (antiAliasing)
-            DrawAALine(hdc, px, py, qx, qy, Colour, thickness);
-        else
-            DrawLine(hdc, px, py, qx, qy, Colour, thickness);
+        DrawLine(hdc, px, py, qx, qy, Colour, thickness);
     }
 }
 
 //===========================================================================
 // draw the clock
 
-void bbanalog_plugin::draw_clock (HDC hdc)
+void bbanalog_plugin::draw_background (HDC hdc)
 {
-    COLORREF fontColor = myStyleItem.TextColor;
     RECT r = { 0, 0, this->width, this->height};
 
     //Make background gradient
@@ -333,76 +287,115 @@ void bbanalog_plugin::draw_clock (HDC hdc)
 
         MakeStyleGradient(hdc, &r, &myStyleItem2, false);
     }
+}
 
+void bbanalog_plugin::draw_date (HDC hdc)
+{
+    COLORREF fontColor = myStyleItem.TextColor;
+    int indent = false == myStyleItem2.parentRelative ? bevelWidth + borderWidth : 0;
+    RECT r = { indent, indent, this->width - indent, this->height - indent};
 
-    if(showDate)
-    {
-        HGDIOBJ otherfont = SelectObject(hdc, CreateStyleFont(&myStyleItem));
+    draw_background(hdc);
 
-        time_t systemTime; time(&systemTime);
-        struct tm *ltm = localtime(&systemTime);
+    HGDIOBJ otherfont = SelectObject(hdc, CreateStyleFont(&myStyleItem));
 
-        char currentDate[80], *p;
-        strftime(currentDate, sizeof currentDate, date_format, ltm);
+    time_t systemTime; time(&systemTime);
+    struct tm *ltm = localtime(&systemTime);
 
-        for (p = currentDate; *p; ++p)
-            if (*p == '|')
-                *p = '\n';
+    char currentDate[80], *p;
+    strftime(currentDate, sizeof currentDate, date_format, ltm);
 
-        RECT s = {0,0,0,0};
-        DrawText(hdc, currentDate, -1, &s, DT_LEFT|DT_CALCRECT);
-        r.top += (r.bottom - r.top - s.bottom) / 2;
+    for (p = currentDate; *p; ++p)
+        if (*p == '|')
+            *p = '\n';
 
-        SetBkMode(hdc, TRANSPARENT);
-        SetTextColor(hdc, fontColor);
-        DrawText(hdc, currentDate, -1, &r, DT_TOP | DT_CENTER );
-        DeleteObject(SelectObject(hdc, otherfont));
-    }
-    else
-    {
-        int i, radius;
-
-        radius = (this->width / 2) - (bevelWidth + borderWidth) - 1;
-        centerX = this->width  / 2;
-        centerY = this->height / 2;
-
-        // Draw tics(1-12) on the clock face.
-        // 12, 3, 6, 9 are 3 pixels long, the rest are 1 pixel.
-        for(i = 0; i<12; i++)
-            DrawRadian (hdc,
-                radius-1-2*(0==i%3),
-                radius-1,
-                i * (3600 / 12),
-                fontColor,
-                10);
-
-        //Draw the seconds hand
-        DrawRadian (hdc,
-            -radius/5,
-            radius-3,
-            clocktime.wSecond * (3600 / 60),
-            0x0066bb, // dark red
-            10);
+    RECT s = {0,0,0,0};
+    DrawText(hdc, currentDate, -1, &s, DT_LEFT|DT_CALCRECT);
+    r.top += (r.bottom - r.top - s.bottom) / 2;
+
+    SetBkMode(hdc, TRANSPARENT);
+    SetTextColor(hdc, fontColor);
+    DrawText(hdc, currentDate, -1, &r, DT_TOP | DT_CENTER );
+    DeleteObject(SelectObject(hdc, otherfont));
+}
 
-        //Draw the minute hand
-        DrawRadian (hdc,
-            2,
-            radius-4,
-            clocktime.wMinute * (3600 / 60),
+// the background and the tics, kept in a dib until the style or the
+// size changes
+void bbanalog_plugin::make_face (HDC hdc_scrn)
+{
+    COLORREF fontColor = myStyleItem.TextColor;
+    RECT r = { 0, 0, this->width, this->height};
+    struct aa_bitmap bm;
+    int i;
+
+    free_face();
+    face = dib_copy(hdc_scrn, &r, &face_bits);
+    if (NULL == face)
+        return;
+    face_w = this->width;
+    face_h = this->height;
+
+    draw_background(face);
+    GdiFlush();
+
+    radius = (this->width / 2) - (bevelWidth + borderWidth) - 1;
+    centerX = this->width  / 2;
+    centerY = this->height / 2;
+
+    bm.pixels = face_bits;
+    bm.width = face_w;
+    bm.height = face_h;
+
+    // Draw tics(1-12) on the clock face.
+    // 12, 3, 6, 9 are 3 pixels long, the rest are 1 pixel.
+    for(i = 0; i<12; i++)
+        DrawRadian (face, antiAliasing ? &bm : NULL,
+            radius-1-2*(0==i%3),
+            radius-1,
+            i * (3600 / 12),
             fontColor,
             10);
+}
 
-        //Draw the hour hand
-        DrawRadian (hdc,
-            2,
-            (radius - 3)*2/3,
-            clocktime.wHour * (3600 / 12) + clocktime.wMinute * (3600 / 60 / 12),
-            fontColor,
-            15);
+void bbanalog_plugin::free_face ()
+{
+    dib_release(face, NULL, NULL);
+    face = NULL;
+}
 
-        // Set a center pixel
+void bbanalog_plugin::draw_hands (HDC hdc, struct aa_bitmap *bm)
+{
+    COLORREF fontColor = myStyleItem.TextColor;
+
+    //Draw the seconds hand
+    DrawRadian (hdc, bm,
+        -radius/5,
+        radius-3,
+        clocktime.wSecond * (3600 / 60),
+        0x0066bb, // dark red
+        10);
+
+    //Draw the minute hand
+    DrawRadian (hdc, bm,
+        2,
+        radius-4,
+        clocktime.wMinute * (3600 / 60),
+        fontColor,
+        10);
+
+    //Draw the hour hand
+    DrawRadian (hdc, bm,
+        2,
+        (radius - 3)*2/3,
+        clocktime.wHour * (3600 / 12) + clocktime.wMinute * (3600 / 60 / 12),
+        fontColor,
+        15);
+
+    // Set a center pixel
+    if (bm)
+        aa_circle(bm, centerX + 0.5f, centerY + 0.5f, 0.75f, 0, fontColor);
+    else
         SetPixel(hdc, centerX, centerY, fontColor);
-    }
 }
 
 //===========================================================================
@@ -420,6 +413,7 @@ void bbanalog_plugin::process_broam(const char *temp, int f)
 
     if (BBP_broam_bool(this, temp, "antiAliasing", &antiAliasing))
     {
+        free_face();
         InvalidateRect(this->hwnd, NULL, FALSE);
         show_menu(false);
         return;
@@ -427,6 +421,7 @@ void bbanalog_plugin::process_broam(const char *temp, int f)
 
     if (BBP_broam_bool(this, temp, "drawBorder", &drawBorder))
     {
+        free_face();
         InvalidateRect(this->hwnd, NULL, FALSE);
         show_menu(false);
         return;
@@ -465,28 +460,53 @@ LRESULT bbanalog_plugin::wnd_proc(HWND hwnd, UINT message, WPARAM wParam, LPARAM
             break;
 
         case WM_DESTROY:
+            this->free_face();
             break;
 
         case WM_PAINT:
         {
-            // Create buffer hdc's, bitmaps etc.
             PAINTSTRUCT ps;
             HDC hdc_scrn = BeginPaint(hwnd, &ps);
-            HDC buf = CreateCompatibleDC(NULL);
-            HBITMAP bufbmp = CreateCompatibleBitmap(hdc_scrn, this->width, this->height);
-            HGDIOBJ otherbmp = SelectObject(buf, bufbmp);
+            RECT r = { 0, 0, this->width, this->height};
+            struct aa_bitmap bm;
+            HDC buf;
+
+            if (this->showDate)
+            {
+                buf = CreateCompatibleDC(NULL);
+                HBITMAP bufbmp = CreateCompatibleBitmap(hdc_scrn, this->width, this->height);
+                HGDIOBJ otherbmp = SelectObject(buf, bufbmp);
 
-            this->draw_clock(buf);
+                this->draw_date(buf);
 
-            BitBltRect(hdc_scrn, buf, &ps.rcPaint);
-            DeleteObject(SelectObject(buf, otherbmp));
-            DeleteDC(buf);
+                BitBltRect(hdc_scrn, buf, &ps.rcPaint);
+                DeleteObject(SelectObject(buf, otherbmp));
+                DeleteDC(buf);
+            }
+            else
+            {
+                // only the hands, on a copy of the face
+                if (NULL == this->face
+                 || this->face_w != this->width
+                 || this->face_h != this->height)
+                    this->make_face(hdc_scrn);
+
+                buf = this->face ? dib_copy(this->face, &r, &bm.pixels) : NULL;
+                if (buf)
+                {
+                    bm.width = this->width;
+                    bm.height = this->height;
+                    this->draw_hands(buf, this->antiAliasing ? &bm : NULL);
+                    dib_release(buf, hdc_scrn, &r);
+                }
+            }
 
             EndPaint(hwnd, &ps);
             break;
         }
 
         case BB_RECONFIGURE:
+            this->free_face();
             GetStyleSettings();
             this->ReadRCSettings();
             this->getCurrentTime();
@@ -0,0 +1,283 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// aadraw.cpp - anti-aliased lines, circles and polygons for plugins.
+//
+// Like the 'accumulation' rasterizers of font renderers: each edge adds
+// to the cells it passes the signed area it covers to its right, so that
+// a running sum along a row is the coverage of each pixel. This is exact
+// for any shape with straight edges, and needs one pass over the edges
+// and one over the bounding box.
+
+#include "BBApi.h"
+#include "bblib.h"
+#include "aadraw.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.1415926536
+#endif
+
+struct aa_cells
+{
+    float *a;
+    int x0, y0, w, h, stride;
+};
+
+static int aa_clip(float v, int lo, int hi)
+{
+    if (!(v > lo)) // also NaN
+        return lo;
+    if (v > hi)
+        return hi;
+    return (int)v;
+}
+
+static bool cells_init(struct aa_cells *p, struct aa_bitmap *bm, const float *xy, int n)
+{
+    float l, t, r, b;
+    int i;
+
+    if (n < 3)
+        return false;
+    l = r = xy[0], t = b = xy[1];
+    for (i = 1; i < n; ++i) {
+        if (xy[2*i] < l) l = xy[2*i];
+        if (xy[2*i] > r) r = xy[2*i];
+        if (xy[2*i+1] < t) t = xy[2*i+1];
+        if (xy[2*i+1] > b) b = xy[2*i+1];
+    }
+    p->x0 = aa_clip(floorf(l), 0, bm->width);
+    p->y0 = aa_clip(floorf(t), 0, bm->height);
+    p->w = aa_clip(ceilf(r), 0, bm->width) - p->x0;
+    p->h = aa_clip(ceilf(b), 0, bm->height) - p->y0;
+    if (p->w <= 0 || p->h <= 0)
+        return false;
+    // two more, for the cells right of an edge at the right border
+    p->stride = p->w + 2;
+    p->a = (float*)c_alloc(p->stride * p->h * sizeof(float));
+    return NULL != p->a;
+}
+
+static void cells_edge(struct aa_cells *p, float xa, float ya, float xb, float yb)
+{
+    float dir, dxdy, x, xn, dy, d, l, r, s, f0, f1, a0, a1, a2, am, t;
+    float *row;
+    int y, ye, i0, i1, i;
+
+    xa -= p->x0, xb -= p->x0;
+    ya -= p->y0, yb -= p->y0;
+    if (ya == yb)
+        return;
+    dir = 1;
+    if (ya > yb) {
+        t = xa, xa = xb, xb = t;
+        t = ya, ya = yb, yb = t;
+        dir = -1;
+    }
+    if (yb <= 0 || ya >= p->h)
+        return;
+
+    dxdy = (xb - xa) / (yb - ya);
+    x = xa;
+    if (ya < 0)
+        x -= ya * dxdy, ya = 0;
+    ye = aa_clip(ceilf(yb), 0, p->h);
+
+    for (y = (int)ya; y < ye; ++y)
+    {
+        row = p->a + y * p->stride;
+        dy = (y + 1 < yb ? y + 1 : yb) - (y > ya ? y : ya);
+        xn = x + dxdy * dy;
+        d = dy * dir;
+
+        // left of the box all is covered, right of it nothing is seen
+        l = x < xn ? x : xn;
+        r = x < xn ? xn : x;
+        x = xn;
+        if (!(l < p->w)) // also NaN
+            continue;
+        if (r <= 0) {
+            row[0] += d;
+            continue;
+        }
+        if (l < 0 || r > p->w) {
+            // over a side, the part of the height there by its width
+            s = d / (r - l);
+            if (l < 0)
+                row[0] -= s * l, l = 0;
+            if (r > p->w)
+                r = (float)p->w;
+            d = s * (r - l);
+        }
+        i0 = (int)l;
+        i1 = (int)ceilf(r);
+
+        if (i1 <= i0 + 1) {
+            // within one cell: split by the middle of the edge
+            t = 0.5f * (l + r) - i0;
+            row[i0] += d - d * t;
+            row[i0 + 1] += d * t;
+        } else {
+            // across cells: triangles at the ends, even steps between
+            s = 1 / (r - l);
+            f0 = l - i0;
+            a0 = 0.5f * s * (1 - f0) * (1 - f0);
+            f1 = r - i1 + 1;
+            am = 0.5f * s * f1 * f1;
+            row[i0] += d * a0;
+            if (i1 == i0 + 2) {
+                row[i0 + 1] += d * (1 - a0 - am);
+            } else {
+                a1 = s * (1.5f - f0);
+                row[i0 + 1] += d * (a1 - a0);
+                for (i = i0 + 2; i < i1 - 1; ++i)
+                    row[i] += d * s;
+                a2 = a1 + (i1 - i0 - 3) * s;
+                row[i1 - 1] += d * (1 - a2 - am);
+            }
+            row[i1] += d * am;
+        }
+    }
+}
+
+// sum up the cells and mix the color into the bitmap by the coverage
+static void cells_fill(struct aa_cells *p, struct aa_bitmap *bm, COLORREF c)
+{
+    BYTE *f;
+    DWORD *d;
+    float *row, acc, v;
+    int x, y, x1, x2;
+
+    f = (BYTE*)m_alloc(p->w);
+    c = switch_rgb(c);
+    for (y = 0; y < p->h; ++y)
+    {
+        row = p->a + y * p->stride;
+        acc = 0, x1 = p->w, x2 = 0;
+        for (x = 0; x < p->w; ++x) {
+            acc += row[x];
+            v = fabsf(acc);
+            f[x] = v >= 1 ? 255 : (BYTE)(v * 255 + 0.5f);
+            if (f[x]) {
+                if (x < x1)
+                    x1 = x;
+                x2 = x + 1;
+            }
+        }
+        if (x1 < x2) {
+            d = bm->pixels + (p->y0 + y) * bm->width + p->x0;
+            mix_color_span(d + x1, d + x1, x2 - x1, c, f + x1);
+        }
+    }
+    m_free(f);
+}
+
+//===========================================================================
+
+void aa_polygons(struct aa_bitmap *bm, const float *xy, const int *counts, int k, COLORREF c)
+{
+    struct aa_cells cells;
+    const float *p;
+    int i, j, n;
+
+    for (i = n = 0; i < k; ++i)
+        n += counts[i];
+    if (false == cells_init(&cells, bm, xy, n))
+        return;
+    for (i = 0, p = xy; i < k; p += 2 * counts[i++])
+        for (j = 0, n = counts[i]; j < n; ++j)
+            cells_edge(&cells, p[2*j], p[2*j+1],
+                p[2*((j+1)%n)], p[2*((j+1)%n)+1]);
+    cells_fill(&cells, bm, c);
+    m_free(cells.a);
+}
+
+void aa_polygon(struct aa_bitmap *bm, const float *xy, int n, COLORREF c)
+{
+    aa_polygons(bm, xy, &n, 1, c);
+}
+
+// points on an arc, enough that the chords are not seen
+static int aa_segments(float r, float angle)
+{
+    return 2 + (int)(angle * (1 + fabsf(r)) / 2);
+}
+
+static float *aa_arc(float *p, float cx, float cy, float r, float a, float b, int n)
+{
+    int i;
+    float t = (b - a) / n, q;
+    // the points between a bit outside, so that the chords cut off as
+    // much as they add
+    q = r * sqrtf(t / sinf(t));
+    for (i = 0; i <= n; ++i) {
+        t = a + (b - a) * i / n;
+        *p++ = cx + (i % n ? q : r) * cosf(t);
+        *p++ = cy + (i % n ? q : r) * sinf(t);
+    }
+    return p;
+}
+
+void aa_line(struct aa_bitmap *bm, float x0, float y0, float x1, float y1, float width, COLORREF c)
+{
+    float r, a, *xy, *p;
+    int n;
+
+    r = width / 2;
+    if (!(r > 0))
+        return;
+    if (x0 == x1 && y0 == y1) {
+        aa_circle(bm, x0, y0, r, 0, c);
+        return;
+    }
+    // half circles around both ends make one contour
+    a = atan2f(y1 - y0, x1 - x0);
+    n = aa_segments(r, (float)M_PI);
+    xy = (float*)m_alloc(4 * (n + 1) * sizeof(float));
+    p = aa_arc(xy, x1, y1, r, a - (float)M_PI/2, a + (float)M_PI/2, n);
+    aa_arc(p, x0, y0, r, a + (float)M_PI/2, a + (float)M_PI*3/2, n);
+    aa_polygon(bm, xy, 2 * (n + 1), c);
+    m_free(xy);
+}
+
+void aa_circle(struct aa_bitmap *bm, float cx, float cy, float r, float width, COLORREF c)
+{
+    float ro, ri, *xy;
+    int n, counts[2];
+
+    ro = r + width / 2;
+    ri = r - width / 2;
+    if (!(ro > 0))
+        return;
+    n = aa_segments(ro, (float)(2*M_PI));
+    xy = (float*)m_alloc(4 * n * sizeof(float));
+    // the hole goes the other way round
+    aa_arc(xy, cx, cy, ro, 0, (float)(2*M_PI), n - 1);
+    counts[0] = n;
+    counts[1] = 0;
+    if (width > 0 && ri > 0) {
+        aa_arc(xy + 2 * n, cx, cy, ri, 0, (float)(-2*M_PI), n - 1);
+        counts[1] = n;
+    }
+    aa_polygons(bm, xy, counts, 1 + (counts[1] > 0), c);
+    m_free(xy);
+}
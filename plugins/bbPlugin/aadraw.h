@@ -0,0 +1,53 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// aadraw.h - anti-aliased lines, circles and polygons for plugins.
+//
+// Shapes are filled by the exact area they cover of each pixel, in one
+// pass over their bounding box, into 32 bit pixels with top-down rows
+// as in a dib section (0x00RRGGBB, see dib_copy() in bblib). Pixel x/y
+// covers x..x+1, y..y+1, so the center of a pixel is at x+0.5, y+0.5.
+// No GDI calls, only the pixels.
+
+#ifndef _AADRAW_H_
+#define _AADRAW_H_
+
+struct aa_bitmap
+{
+    DWORD *pixels;
+    int width;
+    int height;
+};
+
+// fill the polygon with the n points in xy (x0,y0,x1,y1...). Holes by
+// contours in the other direction, with aa_polygons()
+void aa_polygon(struct aa_bitmap *bm, const float *xy, int n, COLORREF c);
+
+// several contours at once, counts[i] points each, nonzero winding
+void aa_polygons(struct aa_bitmap *bm, const float *xy, const int *counts, int k, COLORREF c);
+
+// a line of any width, with round ends
+void aa_line(struct aa_bitmap *bm, float x0, float y0, float x1, float y1, float width, COLORREF c);
+
+// a ring of that width around the radius, or with width 0 a disc
+void aa_circle(struct aa_bitmap *bm, float cx, float cy, float r, float width, COLORREF c);
+
+#endif
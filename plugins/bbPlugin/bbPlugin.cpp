@@ -1375,7 +1375,7 @@ bool check_mouse(HWND hwnd)
 void set_autohide_timer(plugin_info* PI, bool set)
 {
 	if (set)
-		SetTimer(PI->hwnd, AUTOHIDE_TIMER, 100, NULL);
+		timer_set(PI->hwnd, AUTOHIDE_TIMER, 100, 50);
 	else
 		KillTimer(PI->hwnd, AUTOHIDE_TIMER);
 }
@@ -1572,8 +1572,10 @@ LRESULT CALLBACK BBP_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPar
 		case WM_MOUSEMOVE:
 			if (false == PI->mouse_over)
 			{
+				// the system tells when the mouse is gone, else poll
 				PI->mouse_over = true;
-				set_autohide_timer(PI, true);
+				if (false == track_mouse_leave(hwnd))
+					set_autohide_timer(PI, true);
 			}
 
 			if (PI->auto_hidden)
@@ -1590,7 +1592,15 @@ LRESULT CALLBACK BBP_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPar
 				goto pass_nothing;
 
 			if (check_mouse(hwnd))
+			{
+				// back in: from now on wait for WM_MOUSELEAVE again
+				if (GetCapture() != hwnd && track_mouse_leave(hwnd))
+				{
+					PI->mouse_over = true;
+					set_autohide_timer(PI, false);
+				}
 				goto pass_result;
+			}
 #if 0
 			{
 				POINT pt;
@@ -1608,10 +1618,9 @@ LRESULT CALLBACK BBP_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPar
 				PI->mouse_over = false;
 			}
 
-			if (PI->auto_shown)
+			// while suspended, BB_AUTOHIDE checks again when that ends
+			if (PI->auto_shown && false == (PI->suspend_autohide && BBVERSION_LEAN))
 			{
-				if (PI->suspend_autohide && BBVERSION_LEAN)
-					goto pass_result;
 				PI->auto_shown = false;
 				BBP_set_window_modes(PI);
 			}
@@ -1619,6 +1628,33 @@ LRESULT CALLBACK BBP_WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lPar
 			set_autohide_timer(PI, false);
 			goto pass_result;
 
+		case WM_MOUSELEAVE:
+			if (false == PI->mouse_over)
+				goto pass_nothing;
+
+			// still within the window rect (over a child, or captured):
+			// the plugin sees the leave when the timer finds it gone
+			if (check_mouse(hwnd))
+			{
+				set_autohide_timer(PI, true);
+				goto pass_result;
+			}
+
+			PI->mouse_over = false;
+			if (PI->auto_shown && false == (PI->suspend_autohide && BBVERSION_LEAN))
+			{
+				PI->auto_shown = false;
+				BBP_set_window_modes(PI);
+			}
+			{
+				// with the point, as the timer's one has it
+				POINT pt;
+				GetCursorPos(&pt);
+				ScreenToClient(hwnd, &pt);
+				lParam = MAKELPARAM(pt.x, pt.y);
+			}
+			goto pass_nothing;
+
 
 		case BB_AUTOHIDE:
 			if (PI->inSlit)
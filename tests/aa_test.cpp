@@ -0,0 +1,438 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// aa_test.cpp - aadraw's coverage against the exact area, and golden images
+//
+// The cells of an edge add up to the signed area right of it, so each
+// pixel must be |sum of the areas of the contours clipped to it|, as a
+// model computes it here in doubles. Lines and circles are polygons of
+// chords, which must come close to the true shapes. Two pictures of all
+// of it are checked in as golden/aa_*.ppm:
+//
+//   aa_test --write <dir> : write the pictures there instead
+
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BBApi.h"
+#include "bblib.h"
+#include "aadraw.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static double rnd(double lo, double hi)
+{
+    seed = seed * 1103515245 + 12345;
+    return lo + (hi - lo) * ((seed >> 8) & 0xFFFF) / 65535.0;
+}
+
+struct Pixels
+{
+    std::vector<DWORD> px;
+    struct aa_bitmap bm;
+
+    Pixels(int w, int h, DWORD bg = 0) : px(w * h, bg) {
+        bm.pixels = &px[0], bm.width = w, bm.height = h;
+    }
+    // blue in a COLORREF is the low byte of the pixel
+    int at(int x, int y) {
+        return px[y * bm.width + x] & 255;
+    }
+    double sum() {
+        double s = 0;
+        for (size_t i = 0; i < px.size(); ++i)
+            s += (px[i] & 255) / 255.0;
+        return s;
+    }
+};
+
+// -----------------------------------------------------------------
+// the model: a contour cut to the pixel's square, its signed area
+
+typedef std::vector<double> Contour; // x0,y0,x1,y1...
+
+static Contour clip_side(const Contour &in, int axis, double v, int keep_above)
+{
+    Contour out;
+    int i, n = in.size() / 2;
+
+    for (i = 0; i < n; ++i) {
+        const double *a = &in[2*i], *b = &in[2*((i+1)%n)];
+        bool ia = (a[axis] >= v) == !!keep_above;
+        bool ib = (b[axis] >= v) == !!keep_above;
+        if (ia)
+            out.push_back(a[0]), out.push_back(a[1]);
+        if (ia != ib) {
+            double t = (v - a[axis]) / (b[axis] - a[axis]);
+            out.push_back(a[0] + t * (b[0] - a[0]));
+            out.push_back(a[1] + t * (b[1] - a[1]));
+        }
+    }
+    return out;
+}
+
+static double area(const Contour &c)
+{
+    double s = 0;
+    int i, n = c.size() / 2;
+
+    for (i = 0; i < n; ++i)
+        s += c[2*i] * c[2*((i+1)%n)+1] - c[2*((i+1)%n)] * c[2*i+1];
+    return s / 2;
+}
+
+static int model(const std::vector<Contour> &shape, int x, int y)
+{
+    double v = 0;
+
+    for (size_t k = 0; k < shape.size(); ++k) {
+        Contour c = shape[k];
+        c = clip_side(c, 0, x, 1);
+        c = clip_side(c, 0, x + 1, 0);
+        c = clip_side(c, 1, y, 1);
+        c = clip_side(c, 1, y + 1, 0);
+        v += area(c);
+    }
+    v = fabs(v);
+    return v >= 1 ? 255 : (int)(v * 255 + 0.5);
+}
+
+// the shape drawn and the model, pixel by pixel; the floats of aadraw
+// may be one off
+static int compare(const std::vector<Contour> &shape, int w, int h)
+{
+    std::vector<float> xy;
+    std::vector<int> counts;
+    Pixels p(w, h);
+    int x, y, bad = 0;
+
+    for (size_t k = 0; k < shape.size(); ++k) {
+        for (size_t i = 0; i < shape[k].size(); ++i)
+            xy.push_back((float)shape[k][i]);
+        counts.push_back(shape[k].size() / 2);
+    }
+    aa_polygons(&p.bm, &xy[0], &counts[0], counts.size(), 0xFF0000);
+
+    // the model with the floats that were drawn
+    std::vector<Contour> drawn(shape.size());
+    for (size_t k = 0, i = 0; k < shape.size(); ++k)
+        for (size_t j = 0; j < shape[k].size(); ++j)
+            drawn[k].push_back(xy[i++]);
+
+    for (y = 0; y < h; ++y)
+        for (x = 0; x < w; ++x) {
+            int d = p.at(x, y) - model(drawn, x, y);
+            if (d < -1 || d > 1) {
+                if (++bad < 5)
+                    fprintf(stderr, "at %d,%d: %d, model %d\n",
+                        x, y, p.at(x, y), model(drawn, x, y));
+            }
+        }
+    return bad;
+}
+
+static Contour rect(double l, double t, double r, double b)
+{
+    double c[] = { l, t, r, t, r, b, l, b };
+    return Contour(c, c + 8);
+}
+
+// points around a center at rising angles, which make a simple polygon
+static Contour star(double cx, double cy, double r0, double r1, int n, int dir)
+{
+    Contour c;
+    for (int i = 0; i < n; ++i) {
+        double a = dir * (i + rnd(0, 0.9)) * 2 * M_PI / n, r = rnd(r0, r1);
+        c.push_back(cx + r * cos(a));
+        c.push_back(cy + r * sin(a));
+    }
+    return c;
+}
+
+static void test_rect(void)
+{
+    Pixels p(10, 10);
+    float q[] = { 2.25f, 3.5f, 7.75f, 3.5f, 7.75f, 6.0f, 2.25f, 6.0f };
+
+    aa_polygon(&p.bm, q, 4, 0xFF0000);
+    CHECK(96 == p.at(2, 3)); // 0.75 * 0.5
+    CHECK(128 == p.at(4, 3));
+    CHECK(191 == p.at(2, 4));
+    CHECK(255 == p.at(4, 4));
+    CHECK(0 == p.at(1, 4) && 0 == p.at(8, 4) && 0 == p.at(4, 6));
+    CHECK(fabs(p.sum() - 5.5 * 2.5) < 0.02);
+
+    // the other way round is the same
+    Pixels r(10, 10);
+    float b[] = { 2.25f, 6.0f, 7.75f, 6.0f, 7.75f, 3.5f, 2.25f, 3.5f };
+    aa_polygon(&r.bm, b, 4, 0xFF0000);
+    CHECK(p.px == r.px);
+}
+
+static void test_model(void)
+{
+    std::vector<Contour> shape;
+    int i, bad = 0;
+
+    // thin and at the cell borders
+    shape.assign(1, rect(3, 2, 3.1, 9));
+    bad += compare(shape, 12, 12);
+    shape.assign(1, rect(1, 1, 11, 1.01));
+    bad += compare(shape, 12, 12);
+    shape.assign(1, rect(2, 2, 7, 7));
+    bad += compare(shape, 12, 12);
+
+    for (i = 0; i < 300; ++i) {
+        // steep and flat edges, within the bitmap and over its sides
+        shape.assign(1, star(rnd(-5, 37), rnd(-5, 29), rnd(0, 3), rnd(3, 25), 3 + i % 20, 1));
+        bad += compare(shape, 32, 24);
+        // a hole the other way round, partly out of the outside
+        shape.push_back(star(rnd(10, 22), rnd(8, 16), 0.5, 8, 3 + i % 7, -1));
+        bad += compare(shape, 32, 24);
+    }
+    CHECK(0 == bad);
+}
+
+static void test_overlap(void)
+{
+    // the same way round twice is covered once, a pentagram's middle too
+    float a[] = { 2, 2, 12, 2, 12, 12, 2, 12, 4, 4, 14, 4, 14, 14, 4, 14 };
+    int counts[] = { 4, 4 };
+    Pixels p(16, 16);
+
+    aa_polygons(&p.bm, a, counts, 2, 0xFF0000);
+    CHECK(255 == p.at(8, 8) && 255 == p.at(2, 2) && 255 == p.at(13, 13));
+    CHECK(fabs(p.sum() - (200 - 64)) < 0.02);
+
+    float s[10];
+    for (int i = 0; i < 5; ++i) {
+        s[2*i] = 16 + 14 * sinf(i * 4 * M_PI / 5);
+        s[2*i+1] = 16 - 14 * cosf(i * 4 * M_PI / 5);
+    }
+    Pixels q(32, 32);
+    aa_polygon(&q.bm, s, 5, 0xFF0000);
+    CHECK(255 == q.at(16, 16) && 255 == q.at(16, 8) && 0 == q.at(3, 28));
+}
+
+// lines and circles against the shapes they stand for, by area and by
+// a fine grid of samples
+static int sampled(Pixels &p, double cx, double cy, double r0, double r1)
+{
+    int x, y, i, j, in, bad = 0;
+
+    for (y = 0; y < p.bm.height; ++y)
+        for (x = 0; x < p.bm.width; ++x) {
+            for (in = i = 0; i < 32; ++i)
+                for (j = 0; j < 32; ++j) {
+                    double dx = x + (i + 0.5) / 32 - cx, dy = y + (j + 0.5) / 32 - cy;
+                    double d = sqrt(dx * dx + dy * dy);
+                    in += d <= r1 && d >= r0;
+                }
+            bad += abs(p.at(x, y) - in * 255 / 1024) > 8;
+        }
+    return bad;
+}
+
+static void test_circles(void)
+{
+    Pixels disc(64, 64), ring(64, 64), tiny(8, 8);
+
+    aa_circle(&disc.bm, 32, 32, 20, 0, 0xFF0000);
+    CHECK(fabs(disc.sum() - M_PI * 400) < 0.5);
+    CHECK(0 == sampled(disc, 32, 32, 0, 20));
+
+    aa_circle(&ring.bm, 31.3f, 32.6f, 20, 4, 0xFF0000);
+    CHECK(fabs(ring.sum() - M_PI * (22*22 - 18*18)) < 0.5);
+    CHECK(0 == sampled(ring, 31.3, 32.6, 18, 22));
+    CHECK(0 == ring.at(31, 32));
+
+    aa_circle(&tiny.bm, 4.5f, 4.5f, 0.5f, 0, 0xFF0000);
+    // a pentagon by then, still near the area
+    CHECK(fabs(tiny.sum() - M_PI / 4) < 0.06);
+    CHECK(tiny.at(4, 4) > 180 && tiny.at(4, 4) < 210);
+}
+
+static void test_lines(void)
+{
+    Pixels p(64, 64), v(16, 16), dot(16, 16);
+    int x, y, bad = 0;
+
+    aa_line(&p.bm, 10, 10, 50, 40, 3, 0xFF0000);
+    CHECK(fabs(p.sum() - (50 * 3 + M_PI * 2.25)) < 0.3);
+    // the same from the other end, and symmetric about the middle
+    Pixels q(64, 64);
+    aa_line(&q.bm, 50, 40, 10, 10, 3, 0xFF0000);
+    for (y = 0; y < 50; ++y)
+        for (x = 0; x < 60; ++x)
+            bad += abs(p.at(x, y) - p.at(59 - x, 49 - y)) > 1
+                || abs(p.at(x, y) - q.at(x, y)) > 1;
+    CHECK(0 == bad);
+
+    // one pixel wide on the pixel centers is the column alone
+    aa_line(&v.bm, 5.5f, 4, 5.5f, 12, 1, 0xFF0000);
+    CHECK(255 == v.at(5, 8) && 0 == v.at(4, 8) && 0 == v.at(6, 8));
+
+    // with no length it is a disc
+    aa_line(&dot.bm, 8, 8, 8, 8, 4, 0xFF0000);
+    CHECK(fabs(dot.sum() - M_PI * 4) < 0.1);
+
+    // nothing for no width
+    Pixels none(16, 16);
+    aa_line(&none.bm, 1, 1, 14, 14, 0, 0xFF0000);
+    aa_circle(&none.bm, 8, 8, -1, 1, 0xFF0000);
+    CHECK(0 == none.sum());
+}
+
+// out of the bitmap, partly and wholly, and what is not a number
+static void test_clip(void)
+{
+    Pixels p(16, 16), empty(16, 16);
+    float nan = sqrtf(-1.0f), bad[] = { 1, 1, nan, 5, 1, 9 };
+
+    aa_line(&p.bm, -20, -5, 40, 30, 6, 0xFF0000);
+    aa_circle(&p.bm, 8, 8, 50, 2, 0xFF0000);
+    CHECK(p.sum() > 0);
+
+    aa_circle(&empty.bm, 100, 100, 5, 0, 0xFF0000);
+    aa_circle(&empty.bm, -10, 8, 5, 0, 0xFF0000);
+    aa_line(&empty.bm, 0, -10, 16, -2, 3, 0xFF0000);
+    aa_polygon(&empty.bm, bad, 3, 0xFF0000);
+    CHECK(0 == empty.sum());
+
+    // all covered
+    Pixels all(16, 16);
+    aa_circle(&all.bm, 8, 8, 30, 0, 0xFF0000);
+    CHECK(256 == all.sum());
+}
+
+// -----------------------------------------------------------------
+// the pictures
+
+static void draw_clock(Pixels &p)
+{
+    float c = 48, R = 44, a, l;
+    int i;
+
+    for (i = 0; i < 12; ++i) {
+        a = i * M_PI / 6, l = i % 3 ? 3 : 7;
+        aa_line(&p.bm, c + (R - l) * sinf(a), c - (R - l) * cosf(a),
+            c + R * sinf(a), c - R * cosf(a), i % 3 ? 1 : 2, 0x000000);
+    }
+    aa_circle(&p.bm, c, c, R + 2, 1.5f, 0x404040);
+    a = 1.1f;
+    aa_line(&p.bm, c, c, c + R * 0.6f * sinf(a), c - R * 0.6f * cosf(a), 3.5f, 0x000000);
+    a = 4.0f;
+    aa_line(&p.bm, c, c, c + R * 0.9f * sinf(a), c - R * 0.9f * cosf(a), 2, 0x000000);
+    a = 2.3f;
+    aa_line(&p.bm, c - 8 * sinf(a), c + 8 * cosf(a),
+        c + R * 0.92f * sinf(a), c - R * 0.92f * cosf(a), 1, 0x0000CC);
+    aa_circle(&p.bm, c, c, 2.5f, 0, 0x0000CC);
+}
+
+static void draw_shapes(Pixels &p)
+{
+    float star[10], frame[] = { 70, 6, 122, 6, 122, 58, 70, 58, 80, 16, 80, 48, 112, 48, 112, 16 };
+    int i, counts[] = { 4, 4 };
+
+    for (i = 0; i < 5; ++i) {
+        star[2*i] = 30 + 26 * sinf(i * 4 * M_PI / 5);
+        star[2*i+1] = 34 - 26 * cosf(i * 4 * M_PI / 5);
+    }
+    aa_polygon(&p.bm, star, 5, 0x2060E0);
+    aa_polygons(&p.bm, frame, counts, 2, 0x20A040);
+    for (i = 0; i < 8; ++i)
+        aa_line(&p.bm, 74 + i * 6, 20, 84 + i * 4, 44, 0.25f + i * 0.5f, RGB(200, 30 * i, 0));
+    aa_circle(&p.bm, 96, 32, 9, 3, 0xFFFFFF);
+    aa_circle(&p.bm, 128, 64, 20, 6, 0x800080);
+    aa_line(&p.bm, -4, 60, 40, 70, 5, 0x000000);
+}
+
+static bool write_ppm(const char *path, Pixels &p)
+{
+    FILE *fp = fopen(path, "wb");
+    if (NULL == fp)
+        return false;
+    fprintf(fp, "P6\n%d %d\n255\n", p.bm.width, p.bm.height);
+    for (size_t i = 0; i < p.px.size(); ++i) {
+        unsigned char rgb[3] = {
+            (unsigned char)(p.px[i] >> 16), (unsigned char)(p.px[i] >> 8), (unsigned char)p.px[i] };
+        fwrite(rgb, 3, 1, fp);
+    }
+    return 0 == fclose(fp);
+}
+
+// each channel within one of the golden picture's
+static int compare_ppm(const char *path, Pixels &p)
+{
+    FILE *fp = fopen(path, "rb");
+    int w, h, m, bad = 0;
+
+    if (NULL == fp) {
+        fprintf(stderr, "%s: not found\n", path);
+        return -1;
+    }
+    if (3 != fscanf(fp, "P6 %d %d %d", &w, &h, &m) || 255 != m
+        || w != p.bm.width || h != p.bm.height || '\n' != fgetc(fp)) {
+        fclose(fp);
+        fprintf(stderr, "%s: not a %dx%d ppm\n", path, p.bm.width, p.bm.height);
+        return -1;
+    }
+    std::vector<unsigned char> rgb(w * h * 3);
+    if (rgb.size() != fread(&rgb[0], 1, rgb.size(), fp))
+        bad = -1;
+    fclose(fp);
+
+    for (int i = 0; bad >= 0 && i < w * h; ++i)
+        for (int k = 0; k < 3; ++k)
+            if (abs((int)((p.px[i] >> (16 - 8 * k)) & 255) - rgb[3 * i + k]) > 1) {
+                if (++bad < 5)
+                    fprintf(stderr, "%s: at %d,%d differs\n", path, i % w, i / w);
+                break;
+            }
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    Pixels clock(96, 96, 0xD0D0D0), shapes(128, 64, 0x303030);
+    std::string dir = BBLEAN_DIR "/tests/golden";
+
+    draw_clock(clock);
+    draw_shapes(shapes);
+    if (argc > 2 && 0 == strcmp(argv[1], "--write")) {
+        dir = argv[2];
+        CHECK(write_ppm((dir + "/aa_clock.ppm").c_str(), clock));
+        CHECK(write_ppm((dir + "/aa_shapes.ppm").c_str(), shapes));
+        return test_result("aa");
+    }
+    CHECK(0 == compare_ppm((dir + "/aa_clock.ppm").c_str(), clock));
+    CHECK(0 == compare_ppm((dir + "/aa_shapes.ppm").c_str(), shapes));
+
+    test_rect();
+    test_model();
+    test_overlap();
+    test_circles();
+    test_lines();
+    test_clip();
+    return test_result("aa");
+}
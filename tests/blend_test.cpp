@@ -0,0 +1,222 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// blend_test.cpp - mix_span and mix_color_span against mixcolors(), and
+// the scroll button of Menu::Paint mixed in dibs against the pixel way
+//
+// The spans take x/255 as ((x + 1) * 257) >> 16, which must be exact for
+// every x up to 255*255: all channel values are tried with every f. The
+// dcs are the memory ones of stub/gdi_mem.cpp.
+
+#include <vector>
+#include "BBApi.h"
+#include "bblib.h"
+#include "gdi_mem.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static unsigned int rnd32(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) | (seed & 0xFFFF0000);
+}
+
+// The pixels get whatever in the top byte, which mixcolors() ignores
+// as it does no more than a channel at a time either
+static void test_mix_span(void)
+{
+    DWORD d[256], s[256], a[256];
+    int f, v, x, bad = 0;
+
+    // every a, b and f in each channel
+    for (f = 0; f < 256; ++f)
+        for (v = 0; v < 256; ++v) {
+            for (x = 0; x < 256; ++x) {
+                a[x] = d[x] = (rnd32() & 0xFF000000) | v << 16 | (255 - v) << 8 | (x ^ v);
+                s[x] = (rnd32() & 0xFF000000) | x << 16 | v << 8 | (255 - x);
+            }
+            mix_span(d, s, 256, f);
+            for (x = 0; x < 256; ++x)
+                bad += d[x] != mixcolors(a[x], s[x], f);
+        }
+    CHECK(0 == bad);
+
+    // and the length is kept to
+    for (x = 0; x < 256; ++x)
+        d[x] = a[x] = rnd32(), s[x] = rnd32();
+    mix_span(d, s, 100, 77);
+    for (x = 100; x < 256; ++x)
+        bad += d[x] != a[x];
+    mix_span(d, s, 0, 77);
+    CHECK(0 == bad);
+}
+
+static void test_mix_color_span(void)
+{
+    DWORD d[256], s[256];
+    BYTE f[256];
+    int c, v, x, bad = 0;
+
+    for (c = 0; c < 256; ++c) {
+        DWORD color = c << 16 | (255 - c) << 8 | (c * 7 & 255);
+        for (v = 0; v < 256; ++v) {
+            for (x = 0; x < 256; ++x) {
+                s[x] = (rnd32() & 0xFF000000) | x << 16 | v << 8 | (x ^ v);
+                f[x] = (BYTE)(x + v);
+            }
+            mix_color_span(d, s, 256, color, f);
+            for (x = 0; x < 256; ++x)
+                bad += d[x] != mixcolors(color, s[x], f[x]);
+
+            // in place, as the separators do it
+            memcpy(d, s, sizeof d);
+            mix_color_span(d, d, 256, color, f);
+            for (x = 0; x < 256; ++x)
+                bad += d[x] != mixcolors(color, s[x], f[x]);
+        }
+    }
+    CHECK(0 == bad);
+}
+
+//===========================================================================
+// a dc with random pixels
+
+static HDC random_dc(int w, int h)
+{
+    HDC dc = CreateCompatibleDC(NULL);
+    SelectObject(dc, CreateCompatibleBitmap(dc, w, h));
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            SetPixel(dc, x, y, rnd32() & 0xFFFFFF);
+    return dc;
+}
+
+static void free_dc(HDC dc)
+{
+    DeleteObject(GetCurrentObject(dc, OBJ_BITMAP));
+    DeleteDC(dc);
+}
+
+static bool same_dc(HDC a, HDC b, int w, int h)
+{
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            if (GetPixel(a, x, y) != GetPixel(b, x, y))
+                return false;
+    return true;
+}
+
+// dib_copy gives the pixels of the rect top-down, dib_release puts
+// them back
+static void test_dib_copy(void)
+{
+    HDC dc = random_dc(50, 40), dib;
+    RECT r = { 7, 5, 30, 22 };
+    DWORD *bits;
+    int x, y, bad = 0, objects = gdi_objects;
+
+    dib = dib_copy(dc, &r, &bits);
+    CHECK(NULL != dib);
+    for (y = r.top; y < r.bottom; ++y)
+        for (x = r.left; x < r.right; ++x) {
+            COLORREF c = GetPixel(dc, x, y);
+            bad += bits[(y - r.top) * 23 + x - r.left] != switch_rgb(c);
+            bits[(y - r.top) * 23 + x - r.left] = 0x00123456;
+        }
+    CHECK(0 == bad);
+    dib_release(dib, dc, &r);
+    CHECK(objects == gdi_objects);
+    for (y = 0; y < 40; ++y)
+        for (x = 0; x < 50; ++x) {
+            bool in = x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+            bad += in != (GetPixel(dc, x, y) == switch_rgb(0x00123456));
+        }
+    CHECK(0 == bad);
+
+    // nothing to copy, and nothing to put back
+    RECT empty = { 10, 10, 10, 20 };
+    CHECK(NULL == dib_copy(dc, &empty, &bits));
+    dib = dib_copy(dc, &r, &bits);
+    dib_release(dib, NULL, &r);
+    dib_release(NULL, dc, &r);
+    CHECK(objects == gdi_objects);
+    free_dc(dc);
+}
+
+// the scroll button, as Menu::Paint mixed it before with GetPixel and
+// SetPixel, and now in dibs
+static void scroller_pixels(HDC hdc, HDC buf, const RECT &r, int hue)
+{
+    for (int x = r.left; x < r.right; ++x)
+        for (int y = r.top; y < r.bottom; ++y)
+            SetPixel(hdc, x, y, mixcolors(GetPixel(hdc, x, y),
+                GetPixel(buf, x - r.left, y - r.top), hue));
+}
+
+static void scroller_dibs(HDC hdc, HDC buf, const RECT &r, int hue)
+{
+    RECT rs;
+    DWORD *d, *p;
+    HDC dst, src;
+    int w = r.right - r.left, y;
+    rs.left = rs.top = 0;
+    rs.right = w, rs.bottom = r.bottom - r.top;
+    dst = dib_copy(hdc, &r, &d);
+    src = dib_copy(buf, &rs, &p);
+    if (dst && src)
+        for (y = 0; y < rs.bottom; ++y)
+            mix_span(d + y * w, p + y * w, w, hue);
+    dib_release(src, NULL, &rs);
+    dib_release(dst, src ? hdc : NULL, &r);
+}
+
+static void test_scroller(void)
+{
+    int i, bad = 0, objects = gdi_objects;
+
+    for (i = 0; i < 200; ++i) {
+        int w = 1 + rnd32() % 40, h = 1 + rnd32() % 20, hue = rnd32() % 256;
+        RECT r;
+        r.left = rnd32() % 60, r.top = rnd32() % 200;
+        r.right = r.left + w, r.bottom = r.top + h;
+        HDC menu = random_dc(100, 220), buf = random_dc(w, h);
+        HDC copy = CreateCompatibleDC(NULL);
+        SelectObject(copy, CreateCompatibleBitmap(copy, 100, 220));
+        BitBlt(copy, 0, 0, 100, 220, menu, 0, 0, SRCCOPY);
+
+        scroller_pixels(menu, buf, r, hue);
+        scroller_dibs(copy, buf, r, hue);
+        bad += !same_dc(menu, copy, 100, 220);
+        free_dc(menu), free_dc(buf), free_dc(copy);
+    }
+    CHECK(0 == bad);
+    CHECK(objects == gdi_objects);
+}
+
+int main()
+{
+    test_mix_span();
+    test_mix_color_span();
+    test_dib_copy();
+    test_scroller();
+    return test_result("blend");
+}
@@ -0,0 +1,30 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// image_raw.h - what stub/image_raw.cpp adds to rootimg.h
+
+#ifndef _BBTEST_IMAGE_RAW_H_
+#define _BBTEST_IMAGE_RAW_H_
+
+// what root_cpu_level returns: 0 plain C, 1 SSE2, 2 AVX2
+extern int root_test_level;
+
+#endif
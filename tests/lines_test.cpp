@@ -0,0 +1,209 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// lines_test.cpp - bbnote's piece table and line index
+//
+// Random inserts, deletes and overwrites on the text, with now and then
+// the index dropped, against a std::string with the same edits: the
+// text, the number of lines, and where each line starts must agree.
+// Then the same on a file big enough to be mapped.
+
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "edstruct.h"
+#include "test.h"
+
+// what edpiece.cpp needs from the rest of bbnote
+struct edvars *edp;
+int load_stop(void) { return 0; }
+void u_reset(void) { }
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return n > 0 ? (int)((seed >> 4) % n) : 0;
+}
+
+static std::string random_text(int n)
+{
+    std::string s;
+    while (n--)
+        s += rnd(8) ? 'a' + rnd(26) : '\n';
+    return s;
+}
+
+// where each line starts, line 0 at 0
+static std::vector<int> line_starts(const std::string &m)
+{
+    std::vector<int> v(1, 0);
+    for (int o = 0; o < (int)m.size(); ++o)
+        if (m[o] == 10)
+            v.push_back(o + 1);
+    return v;
+}
+
+static int bad;
+
+static void expect(bool ok, const char *what, int a, int b)
+{
+    if (!ok && ++bad < 10)
+        fprintf(stderr, "%s %d %d\n", what, a, b);
+}
+
+static void compare(const std::string &m, int probes)
+{
+    std::vector<int> starts = line_starts(m);
+    int i, n = m.size(), lines = starts.size() - 1;
+
+    expect(flen == n, "flen", flen, n);
+    expect(lix_count() == lines, "lix_count", lix_count(), lines);
+    for (i = 0; i < probes; ++i) {
+        int o = rnd(n + 1), l = rnd(lines + 3) - 1, k, w, r, f, want;
+        int line = std::upper_bound(starts.begin(), starts.end(), o) - starts.begin() - 1;
+        expect(lix_line(o) == line, "lix_line", o, lix_line(o));
+        want = l < 0 ? 0 : l > lines ? n : starts[l];
+        expect(lix_offset(l) == want, "lix_offset", l, lix_offset(l));
+
+        // the w'th linefeed from o, forward and back, within 300
+        k = w = 1 + rnd(5);
+        r = lix_fwd(o, std::min(n, o + 300), &k);
+        f = o, want = w;
+        for (int p = o; p < std::min(n, o + 300) && want; ++p)
+            if (m[p] == 10)
+                f = p + 1, --want;
+        expect(r == f && k == want, "lix_fwd", o, r);
+
+        k = w;
+        r = lix_back(o, std::max(0, o - 300), &k);
+        f = o, want = w;
+        for (int p = o - 1; p >= std::max(0, o - 300) && want; --p)
+            if (m[p] == 10)
+                f = p, --want;
+        expect(r == f && k == want, "lix_back", o, r);
+    }
+}
+
+static void check_text(const std::string &m)
+{
+    std::string t(flen, 0);
+    copyfrom(&t[0], 0, flen);
+    expect(t == m, "text", flen, (int)m.size());
+}
+
+static void edit(std::string &m, int ops, int maxlen)
+{
+    int i;
+
+    for (i = 0; i < ops; ++i) {
+        int n = m.size(), o = rnd(n + 1), l = 1 + rnd(maxlen);
+        std::string s;
+        switch (rnd(6)) {
+        case 0: case 1:
+            s = random_text(l);
+            insdelmem(o, l);
+            copyto(o, s.data(), l);
+            m.insert(o, s);
+            break;
+        case 2:
+            l = std::min(l, n - o);
+            insdelmem(o, -l);
+            m.erase(o, l);
+            break;
+        case 3:
+            l = std::min(l, n - o);
+            s = random_text(l);
+            copyto(o, s.data(), l);
+            m.replace(o, l, s);
+            break;
+        case 4:
+            l = std::min(l, n - o);
+            clearchr(o, rnd(2) ? ' ' : 10, l);
+            m.replace(o, l, std::string(l, (char)getchr(o)));
+            break;
+        case 5:
+            if (0 == rnd(10))
+                lix_free(); // rebuilt from the text when asked next
+            s = random_text(l);
+            append_text(s.data(), l, 0);
+            m += s;
+            break;
+        }
+        if (0 == i % 16)
+            compare(m, 8);
+    }
+    check_text(m);
+}
+
+static void test_edits(void)
+{
+    std::string m;
+
+    edp = new_buffer();
+    // small edits on a small text, then big ones so that chunks are
+    // split and merged
+    edit(m, 3000, 40);
+    compare(m, 200);
+    edit(m, 1000, 20000);
+    compare(m, 200);
+    edit(m, 3000, 40);
+    compare(m, 200);
+    clear_buffer();
+    CHECK(0 == bad);
+    free(edp);
+}
+
+static void test_mapped(void)
+{
+    char name[] = "/tmp/lines_testXXXXXX";
+    int fd = mkstemp(name), size;
+    std::string m = random_text(3 << 20);
+    const char *p;
+
+    CHECK(fd >= 0 && (ssize_t)m.size() == write(fd, m.data(), m.size()));
+    close(fd);
+
+    edp = new_buffer();
+    p = map_file(name, &size);
+    CHECK(p && size == (int)m.size());
+    append_text(p, size, 1);
+    compare(m, 50);
+    // writes copy what they touch out of the file
+    edit(m, 500, 2000);
+    compare(m, 50);
+    detach_file();
+    edit(m, 500, 2000);
+    compare(m, 50);
+    clear_buffer();
+    unlink(name);
+    CHECK(0 == bad);
+    free(edp);
+}
+
+int main()
+{
+    test_edits();
+    test_mapped();
+    return test_result("lines");
+}
@@ -0,0 +1,193 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// match3_test.cpp - bbnote's lazy DFA against rmatch(), its backtracker
+//
+// Random expressions on random text, from every position: rdfa_match()
+// and rdfa_mem() must give the length rmatch() gives, unless they ran
+// out of states.
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "test.h"
+
+int rcomp (unsigned char *in, unsigned char *out, int omax, int cf);
+struct rmres { int p; int w; };
+int rmatch(int s, int a, int e, unsigned char *m, struct rmres *m_ptr, int (*getchr)(int));
+struct rdfa *rdfa_new(unsigned char *code, int len);
+void rdfa_free(struct rdfa *d);
+void rdfa_first(struct rdfa *d, unsigned char *set);
+int rdfa_match(struct rdfa *d, int s, int a, int e, int (*getchr)(int));
+int rdfa_mem(struct rdfa *d, const unsigned char *p, int s, int a, int e);
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// the editor passes tabs as spaces
+static const unsigned char *text;
+
+static int getchr(int o)
+{
+    return text[o] == 9 ? ' ' : text[o];
+}
+
+static std::string atom(int depth)
+{
+    static const char *const simple[] = {
+        "a", "b", "c", "A", " ", ".", "!", "[ab]", "[^a]", "[a-c]", "[A ]", "/t", "/n"
+    };
+    switch (depth < 2 ? rnd(8) : 0) {
+    case 0: case 1: case 2: case 3:
+        return simple[rnd(sizeof simple / sizeof *simple)];
+    case 4:
+        return "(" + atom(depth + 1) + atom(depth + 1) + "|" + atom(depth + 1) + ")";
+    case 5:
+        return "{" + atom(depth + 1) + atom(depth + 1) + "}";
+    default:
+        return atom(depth + 1) + atom(depth + 1);
+    }
+}
+
+static std::string expression(void)
+{
+    std::string r;
+    int i, n = 1 + rnd(5);
+
+    if (0 == rnd(5))
+        r += "^";
+    for (i = 0; i < n; ++i) {
+        r += atom(0);
+        switch (rnd(6)) {
+        case 0: r += "*"; break;
+        case 1: r += "+"; break;
+        case 2: r += "?"; break;
+        }
+    }
+    if (0 == rnd(5))
+        r += "$";
+    if (0 == rnd(8))
+        r += "|" + atom(0);
+    return r;
+}
+
+// one expression on one text, from each position
+static int compare(const char *expr, int cf, const char *str, int *fell_back)
+{
+    unsigned char code[1000];
+    struct rmres res[16];
+    struct rdfa *d;
+    int s, len, r, n, m, o, bad = 0;
+
+    if (0 == (o = rcomp((unsigned char*)expr, code, sizeof code, cf)))
+        return 0;
+
+    text = (const unsigned char*)str;
+    len = strlen(str);
+    d = rdfa_new(code, o);
+    for (s = 0; s <= len; ++s) {
+        r = rmatch(s, 0, len, code, res, getchr);
+        n = rdfa_match(d, s, 0, len, getchr);
+        m = rdfa_mem(d, text, s, 0, len);
+        if (n < 0 || m < 0) {
+            ++*fell_back;
+            // it starts over after that, as the editor does
+            rdfa_free(d);
+            d = rdfa_new(code, o);
+            continue;
+        }
+        if (r != n || r != m) {
+            if (++bad < 10)
+                fprintf(stderr, "\"%s\" cf %d at %d in \"%s\": rmatch %d, dfa %d, mem %d\n",
+                    expr, cf, s, str, r, n, m);
+        }
+    }
+    rdfa_free(d);
+    return bad;
+}
+
+static void test_random(void)
+{
+    static const char chars[] = "aabbcA \t\n";
+    int i, k, bad = 0, fell_back = 0;
+    char str[32];
+
+    for (i = 0; i < 20000; ++i) {
+        std::string e = expression();
+        int len = rnd(24);
+        for (k = 0; k < len; ++k)
+            str[k] = chars[rnd(sizeof chars - 1)];
+        str[len] = 0;
+        bad += compare(e.c_str(), rnd(2), str, &fell_back);
+    }
+    CHECK(0 == bad);
+    CHECK(0 == fell_back);
+}
+
+// one that needs more states than the DFA makes
+static void test_many_states(void)
+{
+    char str[4000];
+    int i, fell_back = 0;
+
+    for (i = 0; i < (int)sizeof str - 1; ++i)
+        str[i] = "ab"[rnd(2)];
+    str[i] = 0;
+    CHECK(0 == compare("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)", 0, str + 3900, &fell_back));
+
+    // the whole text, where rmatch() would run out of stack
+    unsigned char code[1000];
+    struct rdfa *d;
+    int o;
+    text = (const unsigned char*)str;
+    o = rcomp((unsigned char*)"(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)", code, sizeof code, 0);
+    d = rdfa_new(code, o);
+    CHECK(-1 == rdfa_match(d, 0, 0, sizeof str - 1, getchr));
+    rdfa_free(d);
+}
+
+static void test_first(void)
+{
+    unsigned char code[1000], set[256];
+    struct rdfa *d;
+    int c, o, ok = 1;
+
+    o = rcomp((unsigned char*)"[b-d]x|^y", code, sizeof code, 1);
+    d = rdfa_new(code, o);
+    rdfa_first(d, set);
+    for (c = 0; c < 256; ++c)
+        ok &= set[c] == (strchr("bcdBCDyY", c) && c);
+    CHECK(ok);
+    rdfa_free(d);
+}
+
+int main()
+{
+    test_random();
+    test_many_states();
+    test_first();
+    return test_result("match3");
+}
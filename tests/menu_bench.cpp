@@ -0,0 +1,65 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// menu_bench.cpp - frames per second of wheel scrolling a 2000 item menu
+//
+// menu_bench [rounds] : down to the end by 3 items a notch and back up,
+// in the window of menu_screen.h, painted after each notch: with all of
+// it invalid and painted on each step as before, and with the blitting
+// and the rasters. The MenuItem::Paint calls and the pixels painted per
+// frame are what carries over to GDI; the rate is of this model.
+
+#include <chrono>
+#include "menu_screen.h"
+
+static void run(bool legacy, int rounds)
+{
+    std::vector<int> h(2000);
+    int i, r, frames = 0;
+
+    for (i = 0; i < 2000; ++i)
+        h[i] = 0 == i % 11 ? 7 : 18;
+    MenuScreen m(h, 40, false, legacy);
+    m.paint();
+    long paints = m.paints, pixels = m.pixels;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (r = 0; r < rounds; ++r) {
+        while (m.topindex < m.count() - m.pagesize)
+            m.scroll(m.topindex + 3), m.paint(), ++frames;
+        while (m.topindex > 0)
+            m.scroll(m.topindex - 3), m.paint(), ++frames;
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("%-6s %6d frames %9.0f frames/s %6.2f item paints/frame %8.0f pixels/frame\n",
+        legacy ? "full" : "blit", frames, frames / s,
+        (double)(m.paints - paints) / frames, (double)(m.pixels - pixels) / frames);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 5;
+
+    run(true, rounds);
+    run(false, rounds);
+    return 0;
+}
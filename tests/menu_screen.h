@@ -0,0 +1,289 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// menu_screen.h - a menu window of pixels, scrolled and painted as Menu does
+//
+// scroll_assign_items(), Paint() and paint_item() of Menu.cpp, with their
+// ScrollPlan and RasterSlots, over a screen of DWORDs instead of GDI. The
+// invalid region is a mask of pixels, and Paint() changes only what is in
+// it, as BeginPaint's clip does. The background rows behind the items are
+// alike, or alternate when interlaced, as with m_bFlatRows. 'legacy' is
+// the way before the blitting: all invalid on each step, no rasters.
+
+#ifndef _BBTEST_MENU_SCREEN_H_
+#define _BBTEST_MENU_SCREEN_H_
+
+#include <string.h>
+#include <vector>
+#include "BBApi.h"
+#include "bblib.h"
+#include "Menu/MenuRaster.h"
+
+struct MenuScreen
+{
+    int width, height, top, margin, pagesize, topindex, active;
+    bool interlaced, legacy, shown;
+    std::vector<int> item_h, item_top, item_slot;
+    std::vector<char> disabled, checked;
+    std::vector<DWORD> screen, rasters;
+    std::vector<char> invalid;
+    RasterSlots slots;
+    int slot_h;
+    // what it took: MenuItem::Paint calls, raster copies, pixels painted
+    long paints, blits, pixels, shifts;
+
+    MenuScreen(const std::vector<int> &heights, int page, bool interlaced, bool legacy)
+        : width(160), top(20), margin(4), pagesize(page), topindex(0), active(-1),
+          interlaced(interlaced), legacy(legacy), shown(false),
+          item_h(heights), item_top(heights.size(), -1000), item_slot(heights.size(), 0),
+          disabled(heights.size()), checked(heights.size()),
+          paints(0), blits(0), pixels(0), shifts(0)
+    {
+        int i, c, h, hmax = 0;
+
+        // high enough for the highest page, as Validate() makes it
+        for (i = 0; i + page <= (int)heights.size(); ++i) {
+            for (h = c = 0; c < page; ++c)
+                h += heights[i + c];
+            hmax = imax(hmax, h);
+        }
+        height = top + hmax + margin;
+        screen.assign(width * height, 0);
+        invalid.assign(width * height, 0);
+        slot_h = 0;
+        for (i = 0; i < (int)heights.size(); ++i) {
+            slot_h = imax(slot_h, heights[i]);
+            disabled[i] = 0 == i % 7;
+            checked[i] = 0 == i % 5;
+        }
+        memset(&slots, 0, sizeof slots);
+        if (false == legacy) {
+            slots.Init(2 * page + 2);
+            rasters.resize(slots.count * slot_h * width);
+        }
+        scroll(0);
+        shown = true;
+        invalidate(0, 0, width, height);
+    }
+
+    ~MenuScreen() {
+        slots.Free();
+    }
+
+    int count() {
+        return item_h.size();
+    }
+
+    // ------------------------------------------------------
+    // the looks
+
+    DWORD background(int y) {
+        if (y < top || y >= height - margin)
+            return 0x101040;
+        return interlaced && (y & 1) ? 0x303030 : 0x383838;
+    }
+
+    // item i's row r, as MenuItem::Paint draws it over the background
+    // of row y: text, a hilite, a check mark
+    DWORD item_pixel(int i, int r, int x, DWORD back) {
+        unsigned int n = (i * 2654435761u) ^ (r * 40503u) ^ (x * 69069u);
+        if (x < margin || x >= width - margin)
+            return back;
+        if (checked[i] && x < margin + 6 && r > 2 && r < item_h[i] - 2)
+            return 0x00C000;
+        if (r > 3 && r < item_h[i] - 3 && 0 == (n >> 13 & 3))
+            return i == active ? 0xFFFFFF : disabled[i] ? 0x808080 : 0xE0E0E0;
+        if (i == active)
+            return 0x4060A0 + r;
+        return back;
+    }
+
+    void scroller_rect(int *l, int *t, int *r, int *b) {
+        int k = height - margin - top - 12, d = count() - pagesize;
+        *l = width - margin - 8, *r = width - margin - 2;
+        *t = top + (d ? topindex * k / d : 0), *b = *t + 12;
+    }
+
+    // ------------------------------------------------------
+    // the window
+
+    void invalidate(int l, int t, int r, int b) {
+        for (int y = imax(t, 0); y < imin(b, height); ++y)
+            for (int x = imax(l, 0); x < imin(r, width); ++x)
+                invalid[y * width + x] = 1;
+    }
+
+    void invalidate_item(int i) {
+        if (i >= 0 && item_top[i] != -1000)
+            invalidate(0, item_top[i], width, item_top[i] + item_h[i]);
+    }
+
+    bool any_invalid(void) {
+        for (size_t i = 0; i < invalid.size(); ++i)
+            if (invalid[i])
+                return true;
+        return false;
+    }
+
+    // ScrollWindowEx(0, -dy) of the band, with SW_INVALIDATE
+    void scroll_window(int t, int b, int dy) {
+        std::vector<DWORD> old(screen);
+        for (int y = t; y < b; ++y) {
+            int s = y + dy;
+            if (s >= t && s < b)
+                memcpy(&screen[y * width], &old[s * width], width * sizeof(DWORD));
+            else
+                invalidate(0, y, width, y + 1);
+        }
+        ++shifts;
+    }
+
+    // ------------------------------------------------------
+    // Menu::scroll_assign_items()
+
+    void scroll(int new_top) {
+        ScrollPlan plan;
+        int c, y, o, l, t, r, b;
+
+        new_top = imax(0, imin(new_top, count() - pagesize));
+        if (shown) {
+            if (topindex == new_top)
+                return;
+            if (false == legacy)
+                paint(); // UpdateWindow
+        }
+        plan.Start();
+        for (c = 0, y = top; c < count(); ++c) {
+            o = item_top[c];
+            if (c < new_top || c >= new_top + pagesize)
+                item_top[c] = -1000;
+            else
+                item_top[c] = y, y += item_h[c];
+            plan.Item(c, topindex, new_top, o, item_top[c], item_h[c]);
+        }
+        topindex = new_top;
+        if (false == shown)
+            return;
+
+        b = imax(plan.old_end, plan.new_end);
+        if (legacy || false == plan.Shift(top, height - margin, interlaced)) {
+            invalidate(0, 0, width, height);
+            return;
+        }
+        scroll_window(top, b, plan.dy);
+        invalidate(0, plan.fresh_top, width, plan.fresh_bottom);
+        if (plan.new_end < b)
+            invalidate(0, plan.new_end, width, b);
+        scroller_rect(&l, &t, &r, &b);
+        invalidate(l, top, r, height);
+    }
+
+    // MenuItem::Active()
+    void hilite(int i) {
+        invalidate_item(active);
+        active = i;
+        invalidate_item(active);
+    }
+
+    // ------------------------------------------------------
+    // Menu::Paint() and paint_item()
+
+    void put(int x, int y, DWORD c) {
+        if (invalid[y * width + x])
+            screen[y * width + x] = c, ++pixels;
+    }
+
+    void paint_item(int i) {
+        int r, x, s, y0 = item_top[i], key;
+
+        if (legacy) {
+            for (r = 0; r < item_h[i]; ++r)
+                for (x = 0; x < width; ++x)
+                    put(x, y0 + r, item_pixel(i, r, x, background(y0 + r)));
+            ++paints;
+            return;
+        }
+        key = (i == active) | disabled[i] << 1 | checked[i] << 2
+            | (interlaced ? (y0 & 1) << 3 : 0);
+        s = item_slot[i];
+        if (false == slots.Has(s, &item_h[i], key)) {
+            s = slots.Take(&item_h[i], key);
+            DWORD *p = &rasters[s * slot_h * width];
+            for (r = 0; r < item_h[i]; ++r)
+                for (x = 0; x < width; ++x)
+                    p[r * width + x] = item_pixel(i, r, x, background(y0 + r));
+            item_slot[i] = s;
+            ++paints;
+        }
+        DWORD *p = &rasters[s * slot_h * width];
+        for (r = 0; r < item_h[i]; ++r)
+            for (x = 0; x < width; ++x)
+                put(x, y0 + r, p[r * width + x]);
+        ++blits;
+    }
+
+    void paint(void) {
+        int x, y, y1 = height, y2 = 0, c, l, t, r, b;
+
+        for (y = 0; y < height; ++y)
+            for (x = 0; x < width; ++x)
+                if (invalid[y * width + x])
+                    y1 = imin(y1, y), y2 = imax(y2, y + 1);
+        if (y1 >= y2)
+            return;
+
+        for (y = y1; y < y2; ++y)
+            for (x = 0; x < width; ++x)
+                put(x, y, background(y));
+        for (c = topindex; c < topindex + pagesize; ++c) {
+            if (item_top[c] >= y2)
+                break;
+            if (item_top[c] + item_h[c] > y1)
+                paint_item(c);
+        }
+        scroller_rect(&l, &t, &r, &b);
+        for (y = t; pagesize < count() && y < b; ++y)
+            for (x = l; x < r; ++x)
+                put(x, y, 0xC0C000);
+        memset(&invalid[0], 0, invalid.size());
+    }
+
+    // all of it at once, as it should look
+    std::vector<DWORD> render(void) {
+        std::vector<DWORD> s(width * height);
+        int c, r, x, y, l, t, b;
+
+        for (y = 0; y < height; ++y)
+            for (x = 0; x < width; ++x)
+                s[y * width + x] = background(y);
+        for (c = topindex; c < topindex + pagesize; ++c)
+            for (r = 0; r < item_h[c]; ++r)
+                for (x = 0, y = item_top[c] + r; x < width; ++x)
+                    s[y * width + x] = item_pixel(c, r, x, background(y));
+        scroller_rect(&l, &t, &r, &b);
+        for (y = t; pagesize < count() && y < b; ++y)
+            for (x = l; x < r; ++x)
+                s[y * width + x] = 0xC0C000;
+        return s;
+    }
+};
+
+#endif
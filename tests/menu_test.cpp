@@ -0,0 +1,177 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// menu_test.cpp - menus scrolled by blitting look as if painted anew
+//
+// In the window of menu_screen.h: after each scroll step, page step,
+// jump and hilite, and each Paint(), the screen must be what a paint of
+// all of it gives, with a plain background and an interlaced one, where
+// items of odd heights can not be shifted. Per step by one item only the
+// item that came into view is painted, and a page that was seen before
+// comes from the rasters.
+
+#include "menu_screen.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// mostly items, some separators and some higher ones
+static std::vector<int> heights(int n, bool odd)
+{
+    std::vector<int> h(n);
+    for (int i = 0; i < n; ++i)
+        h[i] = 0 == i % 11 ? 7 : 0 == i % 13 ? 22 : odd && 0 == i % 3 ? 17 : 18;
+    return h;
+}
+
+static void test_plan(void)
+{
+    ScrollPlan p;
+    int c, h[] = { 10, 20, 30, 40 }, y0[] = { -1000, 20, 40, -1000 }, y1[] = { -1000, -1000, 20, 50 };
+
+    // from items 1-2 at 20 to items 2-3
+    p.Start();
+    for (c = 0; c < 4; ++c)
+        p.Item(c, 1, 2, y0[c], y1[c], h[c]);
+    CHECK(20 == p.dy && 70 == p.old_end && 90 == p.new_end);
+    CHECK(50 == p.fresh_top && 90 == p.fresh_bottom);
+    CHECK(p.Shift(20, 90, false) && false == p.Shift(20, 89, false));
+    CHECK(p.Shift(20, 90, true));
+    // nothing stays: no shift
+    CHECK(false == p.Shift(70, 90, false));
+
+    // and back
+    p.Start();
+    for (c = 0; c < 4; ++c)
+        p.Item(c, 2, 1, y1[c], y0[c], h[c]);
+    CHECK(-20 == p.dy && 20 == p.fresh_top && 40 == p.fresh_bottom);
+    p.dy = -21;
+    CHECK(false == p.Shift(20, 90, true) && p.Shift(20, 90, false));
+}
+
+static void test_slots(void)
+{
+    RasterSlots s;
+    int a, b, i;
+
+    memset(&s, 0, sizeof s);
+    CHECK(false == s.Has(0, &a, 0));
+    CHECK(s.Init(3));
+    i = s.Take(&a, 1);
+    CHECK(s.Has(i, &a, 1) && false == s.Has(i, &a, 2) && false == s.Has(i, &b, 1));
+    CHECK(false == s.Has(-1, &a, 1) && false == s.Has(3, &a, 1));
+    s.Take(&b, 0);
+    s.Take(&b, 1);
+    CHECK(s.Has(i, &a, 1));
+    // round robin: the fourth goes where the first was
+    CHECK(i == s.Take(&b, 2) && false == s.Has(i, &a, 1));
+    s.Drop(i, &a);
+    CHECK(s.Has(i, &b, 2));
+    s.Drop(i, &b);
+    CHECK(false == s.Has(i, &b, 2));
+    s.Free();
+    CHECK(0 == s.count && NULL == s.item);
+}
+
+// random steps, each compared with a paint of all
+static int walk(bool interlaced, bool odd, bool legacy, int steps)
+{
+    MenuScreen m(heights(500, odd), 20, interlaced, legacy);
+    int i, bad = 0;
+
+    m.paint();
+    for (i = 0; i < steps; ++i) {
+        switch (rnd(6)) {
+        case 0: m.scroll(m.topindex + 1 + rnd(3)); break;
+        case 1: m.scroll(m.topindex - 1 - rnd(3)); break;
+        case 2: m.scroll(m.topindex + (rnd(2) ? m.pagesize : -m.pagesize)); break;
+        case 3: m.scroll(rnd(m.count())); break;
+        case 4: m.hilite(m.topindex + rnd(m.pagesize)); break;
+        default: m.scroll(m.topindex + 19 + rnd(3)); break;
+        }
+        // now and then two steps in one paint
+        if (rnd(4))
+            m.paint();
+        if (m.any_invalid())
+            continue;
+        if (m.screen != m.render() && ++bad < 5)
+            fprintf(stderr, "step %d (%s%s%s): differs\n", i,
+                interlaced ? "interlaced " : "", odd ? "odd " : "", legacy ? "legacy" : "");
+    }
+    m.paint();
+    bad += m.screen != m.render();
+    // and the shortcut was taken where it could be
+    if (false == legacy && false == (interlaced && odd))
+        bad += m.shifts < steps / 4;
+    return bad;
+}
+
+static void test_walk(void)
+{
+    CHECK(0 == walk(false, false, false, 2000));
+    CHECK(0 == walk(false, true, false, 2000));
+    CHECK(0 == walk(true, false, false, 2000));
+    CHECK(0 == walk(true, true, false, 2000));
+    CHECK(0 == walk(true, true, true, 300));
+}
+
+// with the wheel, down a step at a time and back up
+static void test_frames(void)
+{
+    std::vector<int> h = heights(300, false);
+    MenuScreen m(h, 20, false, false), old(h, 20, false, true);
+    long paints, full, blits;
+    int i;
+
+    m.paint(), old.paint();
+    paints = m.paints, full = old.paints;
+    for (i = 0; i < 100; ++i) {
+        m.scroll(m.topindex + 1), m.paint();
+        old.scroll(old.topindex + 1), old.paint();
+    }
+    // one item per step, against all of the page
+    CHECK(100 == m.paints - paints);
+    CHECK(100 * 20 == old.paints - full);
+    CHECK(m.pixels * 5 < old.pixels);
+    CHECK(m.screen == old.screen);
+
+    // and back a page: it is all still in the rasters
+    paints = m.paints, blits = m.blits;
+    for (i = 0; i < 20; ++i)
+        m.scroll(m.topindex - 1), m.paint();
+    CHECK(m.paints == paints && m.blits > blits);
+    CHECK(m.screen == m.render());
+}
+
+int main()
+{
+    test_plan();
+    test_slots();
+    test_walk();
+    test_frames();
+    return test_result("menu");
+}
@@ -0,0 +1,224 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// pix_test.cpp - the bullet glyphs of bbDrawPix, encoded and decoded
+//
+// pix_encode() of a bitmap like menu-bullets.bmp, and pix_mask() of
+// what it made, must give the black pixels of each cell back, also
+// mirrored. The runs are read once more here as Pixmap.h has them, and
+// the built-in glyphs must be what pix_encode() makes of their picture.
+
+#include <string.h>
+#include <vector>
+#include "BBApi.h"
+#include "bblib.h"
+#include "Pixmap.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static unsigned int rnd32(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) | (seed & 0xFFFF0000);
+}
+
+// a bitmap of glyphs, 6 in a row, on a background of noise
+struct Sheet
+{
+    std::vector<DWORD> px;
+    int width, height, w;
+
+    Sheet(int w, int rows) : w(w) {
+        width = 6 * (w + 1) + 1, height = rows * (w + 1) + 1;
+        px.resize(width * height);
+        for (size_t i = 0; i < px.size(); ++i)
+            px[i] = rnd32() | 1; // not black
+    }
+    DWORD &at(int pic, int x, int y) {
+        return px[((pic / 6) * (w + 1) + 1 + y) * width + (pic % 6) * (w + 1) + 1 + x];
+    }
+    bool black(int pic, int x, int y) {
+        int sx = (pic % 6) * (w + 1) + 1 + x, sy = (pic / 6) * (w + 1) + 1 + y;
+        return sx < width && sy < height && 0 == (px[sy * width + sx] & 0xFFFFFF);
+    }
+};
+
+// the runs of a glyph into a w x h grid
+static std::vector<char> runs(const pixinfo *pmi, int pic)
+{
+    std::vector<char> g(pmi->w * pmi->h);
+    const unsigned char *p = pmi->bits + pmi->vector[pic];
+    int y = 0;
+
+    for (; *p; ++p) {
+        if (*p < 0x10) {
+            y += *p;
+            continue;
+        }
+        if (*p & 0x80)
+            ++y;
+        for (int i = 0; i < (*p >> 4 & 7); ++i)
+            g.at(y * pmi->w + (*p & 15) + i) = 1;
+    }
+    return g;
+}
+
+// all glyphs, then all mirrored, as make_pix_bmp() has them
+static std::vector<unsigned char> mask(const pixinfo *pmi, int *stride)
+{
+    int n = pmi->n, w = pmi->w, i;
+
+    *stride = (2 * n * w + 15) / 16 * 2;
+    std::vector<unsigned char> m(*stride * pmi->h, 255);
+    for (i = 0; i < 2 * n; ++i)
+        pix_mask(pmi, i % n, i >= n, &m[0], *stride, i * w);
+    return m;
+}
+
+static bool cleared(const std::vector<unsigned char> &m, int stride, int x, int y)
+{
+    return 0 == (m[y * stride + x / 8] & (0x80 >> (x & 7)));
+}
+
+// the mask against what 'set' says of each pixel of each glyph
+template <class F>
+static int compare(const pixinfo *pmi, F set)
+{
+    int stride, i, x, y, bad = 0, n = pmi->n, w = pmi->w;
+    std::vector<unsigned char> m = mask(pmi, &stride);
+
+    for (i = 0; i < n; ++i)
+        for (y = 0; y < pmi->h; ++y)
+            for (x = 0; x < w; ++x) {
+                bool on = set(i, x, y);
+                bad += on != cleared(m, stride, i * w + x, y);
+                bad += on != cleared(m, stride, (n + i) * w + w - 1 - x, y);
+            }
+    return bad;
+}
+
+static void test_default(void)
+{
+    const pixinfo *d = (const pixinfo*)defpix;
+    int i, x, y;
+
+    CHECK(11 == d->w && 11 == d->h && 12 == d->n);
+    CHECK(0 == compare(d, [&](int pic, int x, int y) {
+        return 1 == runs(d, pic)[y * d->w + x];
+    }));
+
+    // its picture encoded is the same bytes
+    Sheet s(11, 2);
+    for (i = 0; i < 12; ++i) {
+        std::vector<char> g = runs(d, i);
+        for (y = 0; y < 11; ++y)
+            for (x = 0; x < 11; ++x)
+                if (g[y * 11 + x])
+                    s.at(i, x, y) = rnd32() & 0xFF000000;
+    }
+    pixinfo *p = pix_encode(&s.px[0], s.width, s.height);
+    CHECK(p->size == d->size && 0 == memcmp(p, d, d->size));
+    m_free(p);
+}
+
+static void test_random(void)
+{
+    int w, k, i, x, y, bad = 0;
+
+    for (w = 9; w <= 15; ++w)
+        for (k = 0; k < 20; ++k) {
+            Sheet s(w, 1 + k % 2);
+            // from sparse to solid, so that there are gaps of rows,
+            // runs over 7 and more than 255 bytes of them
+            unsigned int density = k * 13;
+            for (i = 0; i < 6 * (1 + k % 2); ++i)
+                for (y = 0; y < w; ++y)
+                    for (x = 0; x < w; ++x)
+                        if ((rnd32() & 255) < density)
+                            s.at(i, x, y) &= 0xFF000000;
+            pixinfo *p = pix_encode(&s.px[0], s.width, s.height);
+            CHECK(p->w == w && p->h == w && p->n == 6 * (1 + k % 2));
+            bad += compare(p, [&](int pic, int x, int y) {
+                return s.black(pic, x, y);
+            });
+            // the runs as the format has them
+            for (i = 0; i < p->n; ++i) {
+                std::vector<char> g = runs(p, i);
+                for (y = 0; y < w; ++y)
+                    for (x = 0; x < w; ++x)
+                        bad += g[y * w + x] != s.black(i, x, y);
+            }
+            // and the size is what it took
+            const unsigned char *e = p->bits + p->vector[p->n - 1];
+            while (*e)
+                ++e;
+            bad += p->size != (int)(sizeof(pixinfo) + e - p->bits - 1);
+            m_free(p);
+        }
+    CHECK(0 == bad);
+}
+
+// all black, in a bitmap without the last column and row: what is not
+// in it is background
+static void test_cut(void)
+{
+    Sheet s(12, 2);
+    int x, y;
+
+    for (size_t i = 0; i < s.px.size(); ++i)
+        s.px[i] = 0;
+    std::vector<DWORD> cut((s.width - 2) * (s.height - 2));
+    for (y = 0; y < s.height - 2; ++y)
+        for (x = 0; x < s.width - 2; ++x)
+            cut[y * (s.width - 2) + x] = 0;
+    pixinfo *p = pix_encode(&cut[0], s.width - 2, s.height - 2);
+    // a cell less wide, so 11 wide
+    CHECK(11 == p->w && 12 == p->n);
+    CHECK(0 == compare(p, [&](int pic, int x, int y) {
+        int sx = (pic % 6) * 12 + 1 + x, sy = (pic / 6) * 12 + 1 + y;
+        return sx < s.width - 2 && sy < s.height - 2;
+    }));
+    m_free(p);
+
+    // too narrow for 9 wide glyphs, which are the least
+    std::vector<DWORD> narrow(45 * 21, 0);
+    p = pix_encode(&narrow[0], 45, 21);
+    CHECK(9 == p->w && 12 == p->n);
+    CHECK(0 == compare(p, [&](int pic, int x, int y) {
+        return (pic % 6) * 10 + 1 + x < 45;
+    }));
+    m_free(p);
+
+    // too low for a row of glyphs
+    DWORD small[40 * 5] = { 0 };
+    p = pix_encode(small, 40, 5);
+    CHECK(0 == p->n && 9 == p->w);
+    m_free(p);
+}
+
+int main()
+{
+    test_default();
+    test_random();
+    test_cut();
+    return test_result("pix");
+}
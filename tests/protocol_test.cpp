@@ -0,0 +1,317 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// protocol_test.cpp - the version handshake and the call protocol
+//
+// Over a socketpair, with the adapter's answering loop on one end and a
+// plugin host of version 2, of version 1 or of some future version on
+// the other.
+
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <thread>
+#include <vector>
+#include "PipeConnect.h"
+#include "test.h"
+#include "socket_transport.h"
+
+struct Pair {
+    int sv[2];
+    SocketTransport *adapter, *host;
+
+    Pair(int buffer = 0) {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, this->sv);
+        // small buffers, so that a write blocks soon
+        for (int i = 0; buffer && i < 2; ++i) {
+            setsockopt(this->sv[i], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof buffer);
+            setsockopt(this->sv[i], SOL_SOCKET, SO_RCVBUF, &buffer, sizeof buffer);
+        }
+        this->adapter = new SocketTransport(this->sv[0]);
+        this->host = new SocketTransport(this->sv[1]);
+    }
+
+    ~Pair() {
+        delete this->adapter;
+        delete this->host;
+        close(this->sv[0]);
+        close(this->sv[1]);
+    }
+
+    // the host is done, the adapter's Receive fails after the rest
+    void HostDone() {
+        shutdown(this->sv[1], SHUT_WR);
+    }
+};
+
+// the adapter's ApiThread: "echo" returns its argument, all else fails
+static void serve(Transport* pipe)
+{
+    CallChannel channel(pipe);
+    MessageHeader header;
+    char* content;
+
+    while (channel.Receive(&header, &content)) {
+        CallRequestMessage rq;
+        ErrMessage err;
+
+        if (header.tag == FlushMessage::tag) {
+            channel.Flush();
+            continue;
+        }
+        if (header.tag != CallRequestMessage::tag
+            || !MessageSerializer::Deserialize(&header, content, &rq)) {
+            err.error = (char*)"Message not understood";
+            channel.Send(err, header.id);
+            continue;
+        }
+        if (0 == strcmp(rq.function, "echo")) {
+            CallResponseMessage rs = {};
+            rs.resultSize = rq.argSize[0];
+            rs.result = (char*)rq.argv[0];
+            rs.lastError = header.id;
+            channel.Send(rs, header.id);
+        } else {
+            err.error = (char*)"Function not implemented";
+            channel.Send(err, header.id);
+        }
+        for (int i = 0; i < rq.argc; ++i)
+            free(rq.argv[i]);
+        free(rq.argv);
+        free(rq.argSize);
+        free(rq.function);
+    }
+    channel.Flush();
+}
+
+static void test_hello_same()
+{
+    Pair p;
+    uint32_t peer;
+    bool offered, accepted;
+
+    std::thread t([&] { offered = p.host->Offer(); });
+    accepted = p.adapter->Accept(&peer);
+    t.join();
+
+    CHECK(offered && accepted && 2 == peer);
+    CHECK(2 == p.adapter->Version() && 2 == p.host->Version());
+    CHECK(12 == p.adapter->HeaderSize());
+}
+
+// a newer host is talked to with ours
+static void test_hello_newer()
+{
+    Pair p;
+    uint32_t peer;
+    ProtocolHello hello = { ProtocolMagic, 3 };
+
+    p.host->Write(&hello, sizeof hello);
+    CHECK(p.adapter->Accept(&peer) && 3 == peer && 2 == p.adapter->Version());
+    CHECK(p.host->ReadAll(&hello, sizeof hello));
+    CHECK(ProtocolMagic == hello.magic && 2 == hello.version);
+}
+
+// a version 1 host says nothing and gets no answer
+static void test_hello_v1()
+{
+    Pair p;
+    uint32_t peer;
+    char c;
+
+    p.adapter->Timeout(100);
+    CHECK(p.adapter->Accept(&peer) && 1 == peer);
+    CHECK(1 == p.adapter->Version() && 8 == p.adapter->HeaderSize());
+
+    fcntl(p.sv[1], F_SETFL, O_NONBLOCK);
+    CHECK(read(p.sv[1], &c, 1) < 0 && EAGAIN == errno);
+}
+
+static void test_hello_bad()
+{
+    uint32_t peer;
+
+    {
+        // not a hello
+        Pair p;
+        MessageHeader header(MessageTag::Ping, 4);
+        p.host->Write(&header, 8);
+        CHECK(!p.adapter->Accept(&peer) && 0 == peer);
+    }
+    {
+        // no version
+        Pair p;
+        ProtocolHello hello = { ProtocolMagic, 0 };
+        p.host->Write(&hello, sizeof hello);
+        CHECK(!p.adapter->Accept(&peer) && 0 == peer);
+    }
+    {
+        // an adapter that answers with a version the host does not know
+        Pair p;
+        ProtocolHello hello = { ProtocolMagic, 3 };
+        p.adapter->Write(&hello, sizeof hello);
+        CHECK(!p.host->Offer());
+    }
+}
+
+// the control pipe's messages have the header of the version
+static void test_messages_v1()
+{
+    Pair p;
+    MessageHeader header;
+    PingMessage ping = { 42 }, got;
+
+    p.adapter->Version(1);
+    p.host->Version(1);
+    auto msg = MessageSerializer::Serialize(ping);
+    msg->id = 7;
+    CHECK(p.adapter->WriteMessage(msg));
+    delete[] (char*)msg;
+
+    p.host->Timeout(1000);
+    char raw[8 + sizeof got];
+    CHECK(p.host->ReadAll(raw, sizeof raw));
+    CHECK(MessageTag::Ping == (MessageTag)raw[0] && sizeof got == *(unsigned int*)(raw + 4));
+
+    CHECK(p.host->Write(raw, sizeof raw));
+    CHECK(p.adapter->ReadHeader(&header));
+    CHECK(MessageTag::Ping == header.tag && 0 == header.id && sizeof got == header.len);
+}
+
+// a version 1 host writes a request and reads its answer at once,
+// without a FlushMessage
+static void test_calls_v1_raw()
+{
+    Pair p;
+    int i;
+
+    p.adapter->Version(1);
+    std::thread t(serve, p.adapter);
+
+    p.host->Version(1);
+    for (i = 0; i < 50; ++i) {
+        unsigned int size = i * 3;
+        std::vector<char> arg(size, (char)i);
+        void* argv[1] = { arg.data() };
+        char fn[] = "echo";
+        CallRequestMessage rq = { fn, 1, &size, argv };
+        auto msg = MessageSerializer::Serialize(rq);
+        CHECK(p.host->WriteMessage(msg));
+        delete[] (char*)msg;
+
+        MessageHeader header;
+        CHECK(p.host->ReadHeader(&header));
+        std::vector<char> content(header.len);
+        CHECK(p.host->ReadAll(content.data(), header.len));
+
+        CallResponseMessage rs;
+        CHECK(MessageSerializer::Deserialize(&header, content.data(), &rs));
+        CHECK(rs.resultSize == size && 0 == memcmp(rs.result, arg.data(), size));
+        free(rs.result);
+    }
+
+    p.HostDone();
+    t.join();
+}
+
+// many calls at once, answered in any order; with small buffers a
+// side that writes without reading would hang here
+static void test_calls(uint32_t version, int calls, int buffer)
+{
+    Pair p(buffer);
+    int i, round, bad = 0;
+
+    p.adapter->Version(version);
+    p.host->Version(version);
+    std::thread t(serve, p.adapter);
+
+    CallChannel channel(p.host);
+    std::vector<unsigned int> ids(calls), sizes(calls);
+
+    for (round = 0; round < 3; ++round) {
+        for (i = 0; i < calls; ++i) {
+            sizes[i] = (i * 7919) % (i % 5 ? 300 : 100000);
+            std::vector<char> v(sizes[i]);
+            for (unsigned int k = 0; k < sizes[i]; ++k)
+                v[k] = (char)(k ^ i);
+            void* argv[1] = { v.data() };
+            char echo[] = "echo", fail[] = "fail";
+            CallRequestMessage rq = { i % 7 ? echo : fail, 1, &sizes[i], argv };
+            ids[i] = channel.Call(rq);
+            CHECK(0 != ids[i]);
+        }
+        // in a shuffled order
+        std::vector<int> order(calls);
+        unsigned int seed = round + 1;
+        for (i = 0; i < calls; ++i)
+            order[i] = i;
+        for (i = calls - 1; i > 0; --i) {
+            seed = seed * 1103515245 + 12345;
+            std::swap(order[i], order[(seed >> 8) % (i + 1)]);
+        }
+        for (int n = 0; n < calls; ++n) {
+            i = order[n];
+            CallResponseMessage rs;
+            ErrMessage err;
+            bool ok = channel.Result(ids[i], &rs, &err);
+            if (0 == i % 7) {
+                bad += ok || NULL == err.error || strcmp(err.error, "Function not implemented");
+                free(err.error);
+            } else if (!ok) {
+                ++bad;
+                free(err.error);
+            } else {
+                if (rs.resultSize != sizes[i] || (version >= 2 && rs.lastError != ids[i]))
+                    ++bad;
+                else
+                    for (unsigned int k = 0; k < sizes[i]; ++k)
+                        if (rs.result[k] != (char)(k ^ i)) {
+                            ++bad;
+                            break;
+                        }
+                free(rs.result);
+            }
+        }
+        // and none twice
+        CallResponseMessage rs;
+        ErrMessage err;
+        CHECK(!channel.Result(ids[0], &rs, &err));
+        free(err.error);
+    }
+    CHECK(0 == bad);
+
+    p.HostDone();
+    t.join();
+}
+
+int main()
+{
+    test_hello_same();
+    test_hello_newer();
+    test_hello_v1();
+    test_hello_bad();
+    test_messages_v1();
+    test_calls_v1_raw();
+    test_calls(2, 1000, 0);
+    test_calls(2, 300, 4096);
+    test_calls(1, 300, 4096);
+    return test_result("protocol");
+}
@@ -0,0 +1,500 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// read_test.cpp - jpeg and png rows from image_read against libjpeg/libpng
+//
+// The jpegs in backgrounds/, and jpegs and pngs written here in the ways
+// that image_read treats differently: with restart markers at whole MCU
+// rows or not, subsampled or not, progressive, grey, at each 1/denom.
+// The rows must be the bits of a plain decode of the whole, also when
+// the jpeg is cut at the restart markers and decoded on some threads.
+// Damaged files must give no row twice and not crash.
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <mutex>
+#include <vector>
+#include "image_read.cpp"
+#include "test.h"
+
+typedef std::vector<RGBQUAD> Rows;
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+static bool same(const RGBQUAD &a, const RGBQUAD &b)
+{
+    return 0 == memcmp(&a, &b, sizeof a);
+}
+
+// what image_read gives, bottom-up as in the ImageReader
+struct Collect : ImageReader
+{
+    int m_want_w, m_want_h;     // for m_min_w/h, 0 for all
+    int m_w, m_h, m_starts, m_twice, m_out;
+    Rows m_px;
+    std::vector<int> m_got;
+    std::mutex m_lock;
+
+    Collect (int w = 0, int h = 0)
+        : m_want_w(w), m_want_h(h), m_w(0), m_h(0), m_starts(0), m_twice(0), m_out(0) { }
+
+    virtual bool Size (int width, int height)
+    {
+        m_min_w = m_want_w, m_min_h = m_want_h;
+        return true;
+    }
+    virtual bool Start (int width, int height)
+    {
+        m_w = width, m_h = height, ++m_starts;
+        m_px.assign(width * height, RGBQUAD());
+        m_got.assign(height, 0);
+        return true;
+    }
+    virtual void Row (int y, RGBQUAD *line)
+    {
+        std::lock_guard<std::mutex> g(m_lock);
+        if (y < 0 || y >= m_h) {
+            ++m_out;
+            return;
+        }
+        m_twice += m_got[y]++ > 0;
+        memcpy(&m_px[y * m_w], line, m_w * sizeof *line);
+    }
+    bool All ()
+    {
+        for (int n : m_got)
+            if (1 != n)
+                return false;
+        return 1 == m_starts && 0 == m_twice && 0 == m_out;
+    }
+};
+
+//===========================================================================
+// the plain decodes
+
+static bool ref_jpg(const char *path, int denom, int *w, int *h, Rows &px)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    JSAMPARRAY buffer;
+    FILE *fp = fopen(path, "rb");
+    int x, n;
+
+    if (NULL == fp)
+        return false;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, fp);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    jpeg_start_decompress(&cinfo);
+    *w = cinfo.output_width, *h = cinfo.output_height, n = cinfo.output_components;
+    px.assign(*w * *h, RGBQUAD());
+    buffer = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE, *w * n, 1);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        RGBQUAD *d = &px[(*h - 1 - cinfo.output_scanline) * *w];
+        jpeg_read_scanlines(&cinfo, buffer, 1);
+        for (x = 0; x < *w; ++x) {
+            BYTE *s = buffer[0] + x * n;
+            if (1 == n)
+                d[x].rgbRed = d[x].rgbGreen = d[x].rgbBlue = s[0];
+            else
+                d[x].rgbRed = s[0], d[x].rgbGreen = s[1], d[x].rgbBlue = s[2];
+        }
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    fclose(fp);
+    return true;
+}
+
+static std::vector<BYTE> file_data(const char *path)
+{
+    std::vector<BYTE> v;
+    FILE *fp = fopen(path, "rb");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        v.resize(ftell(fp));
+        fseek(fp, 0, SEEK_SET);
+        if (v.size() != fread(v.data(), 1, v.size(), fp))
+            v.clear();
+        fclose(fp);
+    }
+    return v;
+}
+
+//===========================================================================
+// jpegs to test with
+
+struct JpgOptions {
+    int w, h;
+    int gray, hs, vs;           // grey, or the luma sampling factors
+    int restart_rows;           // 0 for none
+    int restart_mcus;           // an interval that is not whole rows
+    int progressive;
+};
+
+static const char *tmp_path(const char *ext)
+{
+    static char path[64];
+    snprintf(path, sizeof path, "/tmp/bbtest_read_%d%s", (int)getpid(), ext);
+    return path;
+}
+
+static void write_jpg(const char *path, const JpgOptions &o)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    std::vector<BYTE> row(o.w * 3);
+    JSAMPROW rows[1] = { row.data() };
+    FILE *fp = fopen(path, "wb");
+    int x, y;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, fp);
+    cinfo.image_width = o.w;
+    cinfo.image_height = o.h;
+    cinfo.input_components = o.gray ? 1 : 3;
+    cinfo.in_color_space = o.gray ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 85, TRUE);
+    if (!o.gray) {
+        cinfo.comp_info[0].h_samp_factor = o.hs;
+        cinfo.comp_info[0].v_samp_factor = o.vs;
+    }
+    cinfo.restart_in_rows = o.restart_rows;
+    cinfo.restart_interval = o.restart_mcus;
+    if (o.progressive)
+        jpeg_simple_progression(&cinfo);
+    jpeg_start_compress(&cinfo, TRUE);
+    for (y = 0; y < o.h; ++y) {
+        // edges and gradients, for the chroma at the cuts
+        for (x = 0; x < o.w; ++x) {
+            BYTE *p = &row[x * (o.gray ? 1 : 3)];
+            int v = ((x / 7 + y / 5) & 1) ? 230 : 20;
+            p[0] = (BYTE)(x * 255 / o.w);
+            if (!o.gray)
+                p[1] = (BYTE)v, p[2] = (BYTE)(y * 255 / o.h ^ (x & 16 ? 0x80 : 0));
+        }
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    fclose(fp);
+}
+
+// image_read at 1/denom against the plain decode
+static int check_read(const char *path, int denom)
+{
+    int w, h, bad = 0;
+    Rows want;
+
+    ref_jpg(path, 1, &w, &h, want);
+    Collect c(denom > 1 ? (w + denom - 1) / denom : 0, denom > 1 ? (h + denom - 1) / denom : 0);
+    ref_jpg(path, denom, &w, &h, want);
+    bad += 1 != image_read(path, &c) || !c.All() || c.m_w != w || c.m_h != h;
+    for (size_t i = 0; 0 == bad && i < want.size(); ++i)
+        bad += !same(want[i], c.m_px[i]);
+    if (bad)
+        fprintf(stderr, "%s at 1/%d: not the plain decode\n", path, denom);
+    return bad;
+}
+
+// cut at the restart markers and decoded on n threads
+static int check_parts(const char *path, int denom, int n)
+{
+    std::vector<BYTE> data = file_data(path);
+    struct jpg_layout l;
+    int w, h, bad = 0;
+    Rows want;
+    Collect c;
+
+    ref_jpg(path, 1, &w, &h, want);
+    if (false == jpg_layout(data.data(), data.size(), &l))
+        return 1;
+    ref_jpg(path, denom, &w, &h, want);
+    bad += 1 != jpg_parts(data.data(), &l, l.width, l.height, denom, n, &c)
+        || !c.All() || c.m_w != w || c.m_h != h;
+    free(l.rst);
+    for (size_t i = 0; 0 == bad && i < want.size(); ++i)
+        bad += !same(want[i], c.m_px[i]);
+    if (bad)
+        fprintf(stderr, "%s at 1/%d on %d threads: not the plain decode\n", path, denom, n);
+    return bad;
+}
+
+static bool has_layout(const char *path)
+{
+    std::vector<BYTE> data = file_data(path);
+    struct jpg_layout l;
+    if (false == jpg_layout(data.data(), data.size(), &l))
+        return false;
+    free(l.rst);
+    return true;
+}
+
+static void test_backgrounds(void)
+{
+    static const char *const files[] = {
+        BBLEAN_DIR "/backgrounds/fractal.jpg",
+        BBLEAN_DIR "/backgrounds/fractal2.jpg",
+        BBLEAN_DIR "/backgrounds/fractal_2.jpg",
+    };
+    int i, denom, bad = 0;
+
+    for (i = 0; i < 3; ++i)
+        for (denom = 1; denom <= 8; denom *= 2)
+            bad += check_read(files[i], denom);
+    // the one with restart markers every two MCU rows
+    CHECK(has_layout(files[0]));
+    for (denom = 1; denom <= 8; denom *= 2)
+        bad += check_parts(files[0], denom, 1 + denom);
+    CHECK(0 == bad);
+}
+
+static void test_written(void)
+{
+    static const JpgOptions cases[] = {
+        //  w    h   gray hs vs rows mcus prog
+        { 333, 250, 0, 2, 2, 1, 0, 0 },
+        { 320, 241, 0, 2, 2, 3, 0, 0 },
+        { 257, 199, 0, 1, 1, 1, 0, 0 },
+        { 300, 200, 0, 2, 1, 2, 0, 0 },
+        { 171, 300, 0, 1, 2, 1, 0, 0 },
+        { 250, 123, 1, 1, 1, 1, 0, 0 },
+        { 64, 500, 0, 2, 2, 1, 0, 0 },
+        { 200, 17, 0, 2, 2, 1, 0, 0 },
+    };
+    const char *path = tmp_path(".jpg");
+    int i, n, denom, bad = 0;
+
+    for (i = 0; i < (int)(sizeof cases / sizeof *cases); ++i) {
+        write_jpg(path, cases[i]);
+        for (denom = 1; denom <= 8; denom *= 2) {
+            bad += check_read(path, denom);
+            for (n = 1; n <= 8; n += 3)
+                bad += check_parts(path, denom, n);
+        }
+    }
+
+    // not to be cut: no markers, not at whole rows, progressive, and
+    // a picture of one interval; image_read decodes them whole
+    static const JpgOptions whole[] = {
+        { 300, 200, 0, 2, 2, 0, 0, 0 },
+        { 300, 200, 0, 2, 2, 0, 7, 0 },
+        { 300, 200, 0, 2, 2, 1, 0, 1 },
+        { 300, 16, 0, 2, 2, 1, 0, 0 },
+    };
+    for (i = 0; i < 4; ++i) {
+        write_jpg(path, whole[i]);
+        CHECK(false == has_layout(path));
+        for (denom = 1; denom <= 8; denom *= 2)
+            bad += check_read(path, denom);
+    }
+    CHECK(0 == bad);
+    unlink(path);
+}
+
+// short and damaged files: any rows, none twice, no crash
+static void test_damaged(void)
+{
+    JpgOptions o = { 320, 240, 0, 2, 2, 1, 0, 0 };
+    const char *path = tmp_path(".jpg");
+    std::vector<BYTE> good, data;
+    int i, k, bad = 0;
+
+    write_jpg(path, o);
+    good = file_data(path);
+    // libjpeg's warnings, many
+    fflush(stderr);
+    int err = dup(2), null = open("/dev/null", O_WRONLY);
+    dup2(null, 2);
+    for (i = 0; i < 300; ++i) {
+        data = good;
+        if (i % 3 == 0)
+            data.resize(rnd(data.size()));
+        else
+            for (k = 1 + rnd(4); k; --k)
+                data[rnd(data.size())] = rnd(256);
+        FILE *fp = fopen(path, "wb");
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+
+        Collect c;
+        image_read(path, &c);
+        bad += c.m_twice || c.m_out || c.m_starts > 1;
+
+        // and cut, where the layout still makes sense
+        struct jpg_layout l;
+        if (data.size() > 2 && jpg_layout(data.data(), data.size(), &l)) {
+            Collect p;
+            jpg_parts(data.data(), &l, l.width, l.height, 1, 3, &p);
+            bad += p.m_twice || p.m_out;
+            free(l.rst);
+        }
+    }
+    fflush(stderr);
+    dup2(err, 2);
+    close(err), close(null);
+    CHECK(0 == bad);
+    unlink(path);
+}
+
+//===========================================================================
+// pngs, which come as they are written
+
+static void write_png(const char *path, int w, int h, int color_type, int depth,
+    int interlace, const std::vector<BYTE> &bits)
+{
+    png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    FILE *fp = fopen(path, "wb");
+    size_t stride = bits.size() / h;
+
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, w, h, depth, color_type, interlace,
+        PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    if (PNG_COLOR_TYPE_PALETTE == color_type) {
+        png_color pal[16];
+        for (int i = 0; i < 16; ++i)
+            pal[i].red = i * 16, pal[i].green = 255 - i * 9, pal[i].blue = i * i;
+        png_set_PLTE(png_ptr, info_ptr, pal, 16);
+    }
+    png_write_info(png_ptr, info_ptr);
+    std::vector<png_bytep> rows(h);
+    for (int y = 0; y < h; ++y)
+        rows[y] = (png_bytep)&bits[y * stride];
+    png_write_image(png_ptr, rows.data());
+    png_write_end(png_ptr, info_ptr);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    fclose(fp);
+}
+
+// each kind of png with what the pixel x, y must come out as
+static void test_png(void)
+{
+    const char *path = tmp_path(".png");
+    const int w = 77, h = 45;
+    int kind, x, y, bad = 0;
+
+    for (kind = 0; kind < 7; ++kind) {
+        static const int types[] = {
+            PNG_COLOR_TYPE_RGB, PNG_COLOR_TYPE_RGB_ALPHA, PNG_COLOR_TYPE_GRAY,
+            PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_PALETTE, PNG_COLOR_TYPE_RGB,
+            PNG_COLOR_TYPE_GRAY_ALPHA
+        };
+        static const int depths[] = { 8, 8, 8, 2, 4, 16, 8 };
+        static const int channels[] = { 3, 4, 1, 1, 1, 3, 2 };
+        int depth = depths[kind], nc = channels[kind];
+        size_t stride = (w * nc * depth + 7) / 8;
+        std::vector<BYTE> bits(stride * h);
+        std::vector<RGBQUAD> want(w * h);
+
+        for (y = 0; y < h; ++y)
+            for (x = 0; x < w; ++x) {
+                int v[4], c;
+                for (c = 0; c < nc; ++c)
+                    v[c] = rnd(depth == 16 ? 65536 : 1 << depth);
+                if (depth < 8) {
+                    int shift = 8 - depth - (x * depth) % 8;
+                    bits[y * stride + x * depth / 8] |= v[0] << shift;
+                } else {
+                    for (c = 0; c < nc; ++c)
+                        if (16 == depth)
+                            bits[y * stride + (x * nc + c) * 2] = v[c] >> 8,
+                            bits[y * stride + (x * nc + c) * 2 + 1] = (BYTE)v[c];
+                        else
+                            bits[y * stride + x * nc + c] = v[c];
+                }
+                RGBQUAD &q = want[(h - 1 - y) * w + x];
+                int g;
+                switch (kind) {
+                case 0: case 1:
+                    q.rgbRed = v[0], q.rgbGreen = v[1], q.rgbBlue = v[2];
+                    break;
+                case 2:
+                    q.rgbRed = q.rgbGreen = q.rgbBlue = v[0];
+                    break;
+                case 3:
+                    q.rgbRed = q.rgbGreen = q.rgbBlue = v[0] * 85;
+                    break;
+                case 4:
+                    q.rgbRed = v[0] * 16, q.rgbGreen = 255 - v[0] * 9, q.rgbBlue = v[0] * v[0];
+                    break;
+                case 5:
+                    q.rgbRed = v[0] >> 8, q.rgbGreen = v[1] >> 8, q.rgbBlue = v[2] >> 8;
+                    break;
+                case 6:
+                    // on the background of read_png, whose grey is 0,
+                    // as in CxImage
+                    g = (v[0] * v[1] + 127) / 255;
+                    q.rgbRed = q.rgbGreen = q.rgbBlue = g;
+                    break;
+                }
+            }
+        write_png(path, w, h, types[kind], depth, PNG_INTERLACE_NONE, bits);
+        Collect c;
+        int k = 1 == image_read(path, &c) && c.All() && c.m_w == w && c.m_h == h;
+        for (size_t i = 0; k && i < want.size(); ++i)
+            if (abs(want[i].rgbRed - c.m_px[i].rgbRed) > (6 == kind)
+             || abs(want[i].rgbGreen - c.m_px[i].rgbGreen) > (6 == kind)
+             || abs(want[i].rgbBlue - c.m_px[i].rgbBlue) > (6 == kind)
+             || c.m_px[i].rgbReserved)
+                k = 0;
+        if (!k) {
+            fprintf(stderr, "png kind %d: not as written\n", kind);
+            ++bad;
+        }
+
+        // Adam7 is left to the image library
+        if (0 == kind) {
+            write_png(path, w, h, types[kind], depth, PNG_INTERLACE_ADAM7, bits);
+            Collect a;
+            CHECK(0 == image_read(path, &a) && 0 == a.m_starts);
+        }
+    }
+    CHECK(0 == bad);
+
+    // the ones in the tree
+    Collect logo;
+    CHECK(1 == image_read(BBLEAN_DIR "/docs/bblean_logo.png", &logo) && logo.All()
+        && 88 == logo.m_w && 31 == logo.m_h);
+    unlink(path);
+}
+
+int main()
+{
+    Collect none;
+    CHECK(-1 == image_read("/nonexistent.jpg", &none));
+    test_backgrounds();
+    test_written();
+    test_damaged();
+    test_png();
+    return test_result("read");
+}
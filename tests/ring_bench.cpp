@@ -0,0 +1,113 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// ring_bench.cpp - calls answered over the pipe alone and with the ring
+//
+// ring_bench [calls] : for some answer sizes, the calls per second and
+// the bytes that went over the pipe, without and with the SharedRing.
+
+#include <sys/socket.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "PipeConnect.h"
+#include "socket_transport.h"
+
+static void answer(Transport* pipe, SharedRing* ring, unsigned int size)
+{
+    CallChannel channel(pipe);
+    std::vector<char> result(size, 'r');
+    MessageHeader header;
+    char* c;
+
+    channel.Rings(ring, nullptr);
+    while (channel.Receive(&header, &c)) {
+        if (header.tag == FlushMessage::tag) {
+            channel.Flush();
+            continue;
+        }
+        CallResponseMessage rs = {};
+        rs.resultSize = size;
+        rs.result = result.data();
+        channel.Send(rs, header.id);
+    }
+}
+
+static void run(unsigned int size, bool with_ring, int calls)
+{
+    const int batch = 16;
+    std::vector<char> mem(SharedRing::MappingSize(1 << 22));
+    SharedRing out, in;
+    int sv[2], i, j;
+
+    if (with_ring) {
+        out.Init(mem.data(), 1 << 22);
+        in.Attach(mem.data(), mem.size());
+    }
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    SocketTransport a(sv[0]), b(sv[1]);
+    std::thread t(answer, &b, with_ring ? &out : nullptr, size);
+
+    CallChannel channel(&a);
+    channel.Rings(nullptr, with_ring ? &in : nullptr);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (i = 0; i < calls; i += batch) {
+        unsigned int ids[batch], argSize = 4;
+        int arg = 0;
+        void* argv[1] = { &arg };
+        char fn[] = "f";
+        for (j = 0; j < batch; ++j) {
+            CallRequestMessage rq = { fn, 1, &argSize, argv };
+            ids[j] = channel.Call(rq);
+        }
+        for (j = 0; j < batch; ++j) {
+            CallResponseMessage rs;
+            ErrMessage err;
+            if (channel.Result(ids[j], &rs, &err))
+                free(rs.result);
+            else
+                free(err.error);
+        }
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    shutdown(sv[0], SHUT_WR);
+    t.join();
+    close(sv[0]);
+    close(sv[1]);
+
+    printf("%7u bytes %-4s %9.0f calls/s %7.1f MB/s %11ld pipe bytes\n",
+        size, with_ring ? "ring" : "pipe", calls / s,
+        (double)size * calls / s / 1e6, a.read_bytes);
+}
+
+int main(int argc, char** argv)
+{
+    static const unsigned int sizes[] = { 64, 1024, 16384, 262144 };
+    int calls = argc > 1 ? atoi(argv[1]) : 20000;
+
+    for (unsigned int size : sizes) {
+        run(size, false, calls);
+        run(size, true, calls);
+    }
+    return 0;
+}
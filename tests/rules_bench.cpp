@@ -0,0 +1,112 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// rules_bench.cpp - 200 window rules on 1000 windows
+//
+// rules_bench [rounds] : the time per window of the string list that
+// was scanned before, and of the RuleSet with the same names and with
+// some of them patterns.
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "RuleSet.h"
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+static std::string name(int i)
+{
+    static const char *const words[] = {
+        "note", "pad", "term", "media", "player", "shell", "x", "vim", "mail", "chat"
+    };
+    std::string r = words[i % 10];
+    r += words[i / 10 % 10];
+    r += std::to_string(i / 100);
+    return r + ".exe";
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double ns_per_window(Clock::time_point t0, int rounds, int windows)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / rounds / windows;
+}
+
+int main(int argc, char **argv)
+{
+    const int nrules = 200, nwindows = 1000;
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<std::string> rules, apps, classes;
+    int i, r, hits;
+
+    for (i = 0; i < nrules; ++i)
+        rules.push_back(name(rnd(2000)));
+    // a quarter of the windows are listed
+    for (i = 0; i < nwindows; ++i) {
+        apps.push_back(i % 4 ? name(rnd(2000) + 2000) : rules[rnd(nrules)]);
+        classes.push_back("class" + std::to_string(rnd(100)));
+    }
+
+    // what Workspaces did before: strcmp through a list per window
+    auto t0 = Clock::now();
+    for (hits = r = 0; r < rounds; ++r)
+        for (i = 0; i < nwindows; ++i)
+            for (auto &s : rules)
+                if (0 == strcmp(apps[i].c_str(), s.c_str())) {
+                    ++hits;
+                    break;
+                }
+    printf("list      %8.1f ns/window %6d hits\n", ns_per_window(t0, rounds, nwindows), hits / rounds);
+
+    RuleSet exact;
+    for (auto &s : rules)
+        exact.Add(s.c_str());
+    t0 = Clock::now();
+    for (hits = r = 0; r < rounds; ++r)
+        for (i = 0; i < nwindows; ++i)
+            hits += exact.Match(apps[i], classes[i]);
+    printf("exact     %8.1f ns/window %6d hits\n", ns_per_window(t0, rounds, nwindows), hits / rounds);
+
+    // one in ten a pattern, half of them on the class
+    RuleSet wild;
+    for (i = 0; i < nrules; ++i) {
+        std::string s = rules[i];
+        if (0 == i % 20)
+            s = "*" + s.substr(2, 4) + "*";
+        else if (10 == i % 20)
+            s = "class:class" + std::to_string(i % 100) + "?*";
+        wild.Add(s.c_str());
+    }
+    t0 = Clock::now();
+    for (hits = r = 0; r < rounds; ++r)
+        for (i = 0; i < nwindows; ++i)
+            hits += wild.Match(apps[i], classes[i]);
+    printf("patterns  %8.1f ns/window %6d hits\n", ns_per_window(t0, rounds, nwindows), hits / rounds);
+    return 0;
+}
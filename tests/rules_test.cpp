@@ -0,0 +1,157 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// rules_test.cpp - the window rules of StickyWindows.ini/BGWindows.ini
+//
+// WildRule against a plain backtracking wildcard matcher, on random
+// patterns and names, and what RuleSet makes of the lines of a file.
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "RuleSet.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// '*' is any run of chars, '?' any one
+static bool glob(const char *p, const char *s)
+{
+    for (; *p; ++p, ++s) {
+        if ('*' == *p) {
+            for (;; ++s) {
+                if (glob(p + 1, s))
+                    return true;
+                if (0 == *s)
+                    return false;
+            }
+        }
+        if (0 == *s || ('?' != *p && *p != *s))
+            return false;
+    }
+    return 0 == *s;
+}
+
+static std::string random_string(const char *chars, int maxlen)
+{
+    std::string r;
+    int n = rnd(maxlen + 1);
+    while (n--)
+        r += chars[rnd(strlen(chars))];
+    return r;
+}
+
+static void test_wild_random(void)
+{
+    int i, k, bad = 0, matched = 0;
+
+    for (i = 0; i < 20000; ++i) {
+        std::string p = random_string("ab*?.", 8);
+        WildRule w;
+        // RuleSet takes no empty rules
+        if (p.empty())
+            continue;
+        w.Compile(p.c_str());
+        for (k = 0; k < 20; ++k) {
+            std::string s = random_string("ab.", 10);
+            bool want = glob(p.c_str(), s.c_str());
+            bool got = w.Match(s.c_str(), s.size());
+            matched += want;
+            if (want != got && ++bad < 10)
+                fprintf(stderr, "\"%s\" on \"%s\": %d, want %d\n",
+                    p.c_str(), s.c_str(), got, want);
+        }
+    }
+    CHECK(0 == bad);
+    // and the random cases are not all one way
+    CHECK(matched > 20000 && matched < 380000);
+}
+
+static void test_wild_cases(void)
+{
+    static const struct { const char *p, *s; bool m; } cases[] = {
+        { "*", "", true },
+        { "*", "x.exe", true },
+        { "**", "x", true },
+        { "?", "", false },
+        { "a*", "a", true },
+        { "*a", "ba", true },
+        { "*a", "ab", false },
+        { "a*a", "a", false },
+        { "a*a", "aa", true },
+        { "*.exe", "explorer.exe", true },
+        { "*.exe", "explorer.exe.lnk", false },
+        { "note*.e?e", "notepad.exe", true },
+        { "*pad*", "notepad.exe", true },
+        { "*ab*ab*", "abab", true },
+        { "*ab*ab*", "aab", false },
+        { "*aab", "aaab", true },
+        { "x?y*z", "xqyz", true },
+    };
+    for (auto &c : cases) {
+        WildRule w;
+        w.Compile(c.p);
+        CHECK(c.m == w.Match(c.s, strlen(c.s)));
+    }
+}
+
+static void test_ruleset(void)
+{
+    RuleSet rs;
+
+    CHECK(rs.Empty());
+    rs.Add("notepad.exe");
+    rs.Add("class:tooltips_class32");
+    rs.Add("*term*.exe");
+    rs.Add("class:conky_*");
+    rs.Add("class:");
+    rs.Add("");
+    CHECK(!rs.Empty());
+
+    CHECK(rs.Match("notepad.exe", ""));
+    CHECK(rs.Match("", "tooltips_class32"));
+    CHECK(rs.Match("mintty-term.exe", "mintty"));
+    CHECK(rs.Match("x.exe", "conky_main"));
+    // an app rule is not a class rule and the other way round
+    CHECK(!rs.Match("tooltips_class32", ""));
+    CHECK(!rs.Match("", "notepad.exe"));
+    CHECK(!rs.Match("conky_main", ""));
+    CHECK(!rs.Match("", "xterm.exe"));
+    CHECK(!rs.Match("notepad.ex", "notepad.exe2"));
+    CHECK(!rs.Match("", ""));
+
+    rs.Clear();
+    CHECK(rs.Empty() && !rs.Match("notepad.exe", ""));
+}
+
+int main()
+{
+    test_wild_random();
+    test_wild_cases();
+    test_ruleset();
+    return test_result("rules");
+}
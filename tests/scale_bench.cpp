@@ -0,0 +1,61 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// scale_bench.cpp - the wallpaper resampler, C and SSE2
+//
+// scale_bench [rounds] : a 1920x1200 picture up to 2560x1600 and down
+// to 1280x800 with each filter, in output megapixels per second.
+
+#include <chrono>
+#include <vector>
+#include "BBApi.h"
+#include "rootimg.h"
+#include "image_raw.h"
+
+static void run(const std::vector<BYTE> &s, int dw, int dh, int filter, int level, int rounds)
+{
+    static const char *const names[] = { "auto", "box", "bicubic", "lanczos" };
+    std::vector<BYTE> d(dw * dh * 4);
+
+    root_test_level = level;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+        root_scale(NULL, &s[0], 1920, 1200, &d[0], dw, dh, filter);
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("to %4dx%-4d %-7s %-4s %8.1f ms %7.1f Mpixel/s\n", dw, dh, names[filter],
+        level ? "sse2" : "c", t * 1000 / rounds, (double)dw * dh * rounds / t / 1e6);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    std::vector<BYTE> s(1920 * 1200 * 4);
+    unsigned int seed = 1;
+
+    for (BYTE &b : s)
+        b = (BYTE)((seed = seed * 1103515245 + 12345) >> 16);
+    for (int filter = RF_BOX; filter <= RF_LANCZOS; ++filter)
+        for (int level = 0; level <= 1; ++level) {
+            run(s, 2560, 1600, filter, level, rounds);
+            run(s, 1280, 800, filter, level, rounds);
+        }
+    return 0;
+}
@@ -0,0 +1,298 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// scale_test.cpp - the wallpaper resampler against a model in doubles
+//
+// The model takes the same filters over the same source pixels with
+// exact weights and rounds the rows across to bytes as root_scale does;
+// root_scale's 1.14 fixed point may be off from it by a little. The
+// SSE2 passes must give the bits of the C ones, and root_read, with its
+// rows coming in any order, the bits of root_scale.
+//
+// CxImage's Resample is not a reference here: it samples at the pixel
+// corners, not centers, and the library does not build for 64 bit Linux.
+
+#include <math.h>
+#include <vector>
+#include "BBApi.h"
+#include "rootimg.h"
+#include "image_raw.h"
+#include "test.h"
+
+typedef std::vector<BYTE> Pixels;
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// noise, or something smooth with an edge, which makes lanczos ring
+static Pixels picture(int w, int h, bool noise)
+{
+    Pixels p(w * h * 4);
+    int x, y, c;
+    for (y = 0; y < h; ++y)
+        for (x = 0; x < w; ++x)
+            for (c = 0; c < 4; ++c)
+                p[(y * w + x) * 4 + c] = noise ? rnd(256)
+                    : x < w / 2 ? (x * 255 / w + y * c * 7) & 255 : 250 - c * 60;
+    return p;
+}
+
+static double model_filter(int filter, double x)
+{
+    const double pi = 3.14159265358979323846;
+    switch (filter) {
+    case RF_BOX:
+        return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+    case RF_BICUBIC:
+        x = fabs(x);
+        return x < 1.0 ? (1.5*x - 2.5)*x*x + 1.0
+            : x < 2.0 ? ((-0.5*x + 2.5)*x - 4.0)*x + 2.0 : 0.0;
+    default:
+        if (x <= -3.0 || x >= 3.0)
+            return 0.0;
+        return x == 0.0 ? 1.0 : sin(pi*x) / (pi*x) * sin(pi*x/3) / (pi*x/3);
+    }
+}
+
+// the weights of output i over the source pixels, as make_axis has them
+static void model_weights(int src, int dst, int filter, int i, int *lo, std::vector<double> &w)
+{
+    double radius, scale, fscale, support, center, sum;
+    int j, hi;
+
+    if (RF_AUTO == filter)
+        filter = dst < src ? RF_BOX : RF_LANCZOS;
+    radius = RF_BOX == filter ? 0.5 : RF_BICUBIC == filter ? 2.0 : 3.0;
+    scale = (double)dst / src;
+    fscale = scale < 1.0 ? 1.0 / scale : 1.0;
+    support = radius * fscale;
+    center = (i + 0.5) / scale;
+    *lo = (int)floor(center - support);
+    if (*lo < 0)
+        *lo = 0;
+    hi = (int)ceil(center + support);
+    if (hi > src)
+        hi = src;
+    w.clear();
+    for (sum = 0.0, j = *lo; j < hi; ++j) {
+        w.push_back(model_filter(filter, (j + 0.5 - center) / fscale));
+        sum += w.back();
+    }
+    if (sum == 0.0) {
+        *lo = (int)center < src ? (int)center : src - 1;
+        w.assign(1, 1.0);
+        return;
+    }
+    for (double &v : w)
+        v /= sum;
+}
+
+static BYTE to_byte(double v)
+{
+    v = floor(v + 0.5);
+    return (BYTE)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static Pixels model_scale(const Pixels &s, int sw, int sh, int dw, int dh, int filter)
+{
+    std::vector<double> w;
+    Pixels t(dw * sh * 4), d(dw * dh * 4);
+    int x, y, c, k, lo;
+    double v;
+
+    // across to bytes, then down
+    for (x = 0; x < dw; ++x) {
+        if (sw == dw)
+            lo = x, w.assign(1, 1.0);
+        else
+            model_weights(sw, dw, filter, x, &lo, w);
+        for (y = 0; y < sh; ++y)
+            for (c = 0; c < 4; ++c) {
+                for (v = 0.0, k = 0; k < (int)w.size(); ++k)
+                    v += w[k] * s[(y * sw + lo + k) * 4 + c];
+                t[(y * dw + x) * 4 + c] = to_byte(v);
+            }
+    }
+    for (y = 0; y < dh; ++y) {
+        if (sh == dh)
+            lo = y, w.assign(1, 1.0);
+        else
+            model_weights(sh, dh, filter, y, &lo, w);
+        for (x = 0; x < dw * 4; ++x) {
+            for (v = 0.0, k = 0; k < (int)w.size(); ++k)
+                v += w[k] * t[(lo + k) * dw * 4 + x];
+            d[y * dw * 4 + x] = to_byte(v);
+        }
+    }
+    return d;
+}
+
+static Pixels scale(int level, const Pixels &s, int sw, int sh, int dw, int dh, int filter)
+{
+    Pixels d(dw * dh * 4);
+    root_test_level = level;
+    root_scale(NULL, &s[0], sw, sh, &d[0], dw, dh, filter);
+    return d;
+}
+
+static int max_diff(const Pixels &a, const Pixels &b, double *sum)
+{
+    int m = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int d = abs(a[i] - b[i]);
+        *sum += d;
+        if (d > m)
+            m = d;
+    }
+    return m;
+}
+
+static void test_model(void)
+{
+    static const int filters[] = { RF_AUTO, RF_BOX, RF_BICUBIC, RF_LANCZOS };
+    int i, worst = 0, bad = 0;
+    double sum = 0, count = 0;
+
+    for (i = 0; i < 400; ++i) {
+        int sw = 1 + rnd(60), sh = 1 + rnd(60);
+        int dw = rnd(4) ? 1 + rnd(90) : sw, dh = rnd(4) ? 1 + rnd(90) : sh;
+        int filter = filters[rnd(4)];
+        Pixels s = picture(sw, sh, rnd(2));
+        int m = max_diff(scale(0, s, sw, sh, dw, dh, filter),
+            model_scale(s, sw, sh, dw, dh, filter), &sum);
+        count += dw * dh * 4;
+        if (m > worst)
+            worst = m;
+        if (m > 2 && ++bad < 5)
+            fprintf(stderr, "%dx%d to %dx%d filter %d: off by %d\n", sw, sh, dw, dh, filter, m);
+    }
+    printf("scale: off from the model by %d at most, %.4f on average\n", worst, sum / count);
+    CHECK(worst <= 2);
+    CHECK(sum / count < 0.05);
+}
+
+// weights that add up to one: a flat color stays what it is
+static void test_flat(void)
+{
+    static const int filters[] = { RF_BOX, RF_BICUBIC, RF_LANCZOS };
+    int i, k, bad = 0;
+
+    for (i = 0; i < 100; ++i) {
+        // some shrink a lot, where the rounding of many weights adds up
+        int sw = i % 4 ? 1 + rnd(50) : 300 + rnd(700), sh = 1 + rnd(50);
+        int dw = i % 4 ? 1 + rnd(80) : 1 + rnd(3), dh = 1 + rnd(80);
+        Pixels s(sw * sh * 4);
+        for (k = 0; k < sw * sh * 4; ++k)
+            s[k] = "\x10\x80\xfe\x00"[k & 3];
+        Pixels d = scale(0, s, sw, sh, dw, dh, filters[i % 3]);
+        for (k = 0; k < dw * dh * 4; ++k)
+            bad += d[k] != (BYTE)"\x10\x80\xfe\x00"[k & 3];
+    }
+    CHECK(0 == bad);
+}
+
+// the SSE2 passes give the bits of the C ones
+static void test_levels(void)
+{
+    int i, bad = 0;
+    double sum = 0;
+
+    for (i = 0; i < 300; ++i) {
+        int sw = 1 + rnd(70), sh = 1 + rnd(70), dw = 1 + rnd(100), dh = 1 + rnd(100);
+        int filter = rnd(4);
+        Pixels s = picture(sw, sh, true);
+        bad += scale(0, s, sw, sh, dw, dh, filter) != scale(1, s, sw, sh, dw, dh, filter);
+    }
+    CHECK(0 == bad);
+
+    // big enough for the threads
+    Pixels s = picture(640, 400, false);
+    Pixels d = scale(1, s, 640, 400, 900, 560, RF_LANCZOS);
+    CHECK(d == scale(0, s, 640, 400, 900, 560, RF_LANCZOS));
+    CHECK(max_diff(d, model_scale(s, 640, 400, 900, 560, RF_LANCZOS), &sum) <= 2);
+    d = scale(1, s, 640, 400, 600, 450, RF_BICUBIC);
+    CHECK(d == scale(0, s, 640, 400, 600, 450, RF_BICUBIC));
+}
+
+static bool same(const Pixels &d, int w, int h, HIMG img)
+{
+    int x, y;
+    if (image_getwidth(img) != w || image_getheight(img) != h)
+        return false;
+    for (y = 0; y < h; ++y)
+        for (x = 0; x < w; ++x) {
+            RGBQUAD q = image_getpixel(img, x, y);
+            if (memcmp(&d[(y * w + x) * 4], &q, 4))
+                return false;
+        }
+    return true;
+}
+
+// root_read resamples the rows as they come, root_resample from an image
+static void test_read(void)
+{
+    int level, i, bad = 0;
+    HIMG img, got;
+
+    for (level = 0; level <= 1; ++level)
+        for (i = 0; i < 60; ++i) {
+            int sw = 1 + rnd(80), sh = 1 + rnd(80), dw = 1 + rnd(80), dh = 1 + rnd(80);
+            int filter = rnd(4);
+            Pixels s = picture(sw, sh, true);
+            Pixels d = scale(level, s, sw, sh, dw, dh, filter);
+
+            img = image_create_fromraw(sw, sh, &s[0]);
+            image_save(img, "pic");
+            root_test_level = level;
+            if (1 == root_read("pic", &got, dw, dh, 0, filter)) {
+                bad += !same(d, dw, dh, got);
+                image_destroy(got);
+            } else
+                ++bad;
+            bad += 1 != root_resample(&img, dw, dh, filter) || !same(d, dw, dh, img);
+            image_destroy(img);
+        }
+    CHECK(0 == bad);
+
+    // -scale 50, without a size
+    Pixels s = picture(101, 60, true);
+    img = image_create_fromraw(101, 60, &s[0]);
+    image_save(img, "half");
+    CHECK(1 == root_read("half", &got, 0, 0, 50, RF_BOX)
+        && same(scale(0, s, 101, 60, 50, 30, RF_BOX), 50, 30, got));
+    image_destroy(got);
+    image_destroy(img);
+    CHECK(0 == root_read("nothing", &got, 10, 10, 0, RF_BOX));
+}
+
+int main()
+{
+    test_model();
+    test_flat();
+    test_levels();
+    test_read();
+    return test_result("scale");
+}
@@ -0,0 +1,269 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// serializer_test.cpp - the wow64adapter's Serializer and its messages
+//
+// The bytes of each message as the other side reads them, round trips
+// with small and big fields, and the gather list: big blobs are only
+// referenced, merged Serializers are taken over, copies are deep.
+
+#include <string>
+#include <vector>
+#include "PipeConnect.h"
+#include "test.h"
+
+// the bytes a writer of the old format would give, field by field
+struct Wire {
+    std::vector<char> b;
+
+    template<typename T> Wire& operator<<(T v) {
+        b.insert(b.end(), (char*)&v, (char*)&v + sizeof v);
+        return *this;
+    }
+    Wire& bytes(const void* p, unsigned int len) {
+        *this << len;
+        b.insert(b.end(), (char*)p, (char*)p + len);
+        return *this;
+    }
+    Wire& str(const char* s) {
+        return bytes(s, strlen(s) + 1);
+    }
+};
+
+static bool same_wire(MessageHeader* msg, MessageTag tag, const Wire& w)
+{
+    return msg->tag == tag && msg->len == w.b.size() && 0 == msg->id
+        && 0 == memcmp(msg + 1, w.b.data(), w.b.size());
+}
+
+static std::vector<char> blob(unsigned int len, int seed)
+{
+    std::vector<char> v(len);
+    for (unsigned int i = 0; i < len; ++i)
+        v[i] = (char)(i * 31 + seed);
+    return v;
+}
+
+static void test_call_request()
+{
+    static const unsigned int sizes[] = { 0, 1, 255, 256, 4096, 1 << 20 };
+    const int argc = sizeof sizes / sizeof *sizes;
+    std::vector<std::vector<char> > args;
+    unsigned int argSize[argc];
+    void* argv[argc];
+    char fn[] = "GetSettingPtr";
+    Wire w;
+    int i;
+
+    w.str(fn) << argc;
+    for (i = 0; i < argc; ++i) {
+        args.push_back(blob(sizes[i], i));
+        argSize[i] = sizes[i];
+        argv[i] = args[i].data();
+        w.bytes(argv[i], sizes[i]);
+    }
+
+    CallRequestMessage rq = { fn, argc, argSize, argv }, got;
+    MessageHeader* msg = MessageSerializer::Serialize(rq);
+    CHECK(same_wire(msg, MessageTag::CallRequest, w));
+
+    CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+    CHECK(0 == strcmp(got.function, fn) && argc == got.argc);
+    for (i = 0; i < got.argc; ++i) {
+        CHECK(got.argSize[i] == sizes[i]);
+        CHECK(0 == memcmp(got.argv[i], argv[i], sizes[i]));
+        free(got.argv[i]);
+    }
+    free(got.argv);
+    free(got.argSize);
+    free(got.function);
+    delete[] (char*)msg;
+
+    // and the wrong tag is refused
+    PingMessage ping = { 1 };
+    msg = MessageSerializer::Serialize(ping);
+    CHECK(!MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+    delete[] (char*)msg;
+}
+
+static void test_call_response()
+{
+    static const unsigned int sizes[] = { 0, 7, 300, 100000 };
+    for (unsigned int size : sizes) {
+        std::vector<char> result = blob(size, size);
+        CallResponseMessage rs = {}, got;
+        Wire w;
+
+        rs.resultSize = size;
+        rs.result = result.data();
+        rs.lastError = 1234;
+        w << size;
+        w.bytes(result.data(), size) << (DWORD)1234;
+
+        MessageHeader* msg = MessageSerializer::Serialize(rs);
+        CHECK(same_wire(msg, MessageTag::CallResponse, w));
+        CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+        CHECK(got.resultSize == size && 1234 == got.lastError);
+        CHECK(0 == memcmp(got.result, result.data(), size));
+        free(got.result);
+        delete[] (char*)msg;
+    }
+}
+
+static void test_others()
+{
+    {
+        std::string name(1000, 'p');
+        char path[] = "plugins\\bbAnalog\\bbAnalog.dll";
+        ApplyPluginStateMessage m = {}, got;
+        Wire w;
+
+        m.name = (char*)name.c_str();
+        m.path = path;
+        m.hSlit = (HWND)0x1234;
+        m.isEnabled = true;
+        m.useSlit = true;
+        m.n_instance = 3;
+        m.loaderInfo = 0xABCD;
+        w.str(m.name).str(path) << (DWORD)0x1234;
+        w << true << false << true << false << 3 << 0xABCDu;
+
+        MessageHeader* msg = MessageSerializer::Serialize(m);
+        CHECK(same_wire(msg, MessageTag::ApplyPluginState, w));
+        CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+        CHECK(name == got.name && 0 == strcmp(got.path, path));
+        CHECK((HWND)0x1234 == got.hSlit && 3 == got.n_instance && 0xABCD == got.loaderInfo);
+        CHECK(got.isEnabled && !got.canUseSlit && got.useSlit && !got.inSlit);
+        free(got.name);
+        free(got.path);
+        delete[] (char*)msg;
+    }
+    {
+        char err[] = "Function not implemented";
+        ErrMessage e = { err }, got;
+        Wire w;
+        w.str(err);
+        MessageHeader* msg = MessageSerializer::Serialize(e);
+        CHECK(same_wire(msg, MessageTag::Err, w));
+        CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+        CHECK(0 == strcmp(got.error, err));
+        free(got.error);
+        delete[] (char*)msg;
+    }
+    {
+        char name[] = "bbLeanRing_1234";
+        OpenRingMessage m = { name, 1 << 22 }, got;
+        Wire w;
+        w.str(name) << (unsigned int)(1 << 22);
+        MessageHeader* msg = MessageSerializer::Serialize(m);
+        CHECK(same_wire(msg, MessageTag::OpenRing, w));
+        CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got));
+        CHECK(0 == strcmp(got.name, name) && (1u << 22) == got.size);
+        free(got.name);
+        delete[] (char*)msg;
+    }
+    {
+        PingMessage ping = { 42 }, got;
+        Wire w;
+        w << 42;
+        MessageHeader* msg = MessageSerializer::Serialize(ping);
+        CHECK(same_wire(msg, MessageTag::Ping, w));
+        CHECK(MessageSerializer::Deserialize(msg, (char*)(msg + 1), &got) && 42 == got.challenge);
+        delete[] (char*)msg;
+    }
+}
+
+static std::vector<char> flat(const Serializer& s)
+{
+    std::vector<char> v(s.Length());
+    s.CopyTo(v.data());
+    return v;
+}
+
+static void test_gather()
+{
+    std::vector<char> big = blob(1000, 1);
+    Serializer s;
+    int i;
+
+    // small values are joined into one chunk per block
+    for (i = 0; i < 100; ++i)
+        s << i;
+    CHECK(400 == s.Length() && 1 == s.Chunks().size());
+
+    // a big blob is referenced, not copied; its length joins the rest
+    Pack p = { (unsigned int)big.size(), big.data() };
+    s << p;
+    CHECK(s.Chunks().size() == 2 && s.Chunks()[1].data == big.data());
+    s << 7;
+    CHECK(s.Length() == 400 + 4 + 1000 + 4);
+
+    // a merged one is taken over with its chunks
+    Serializer t;
+    t << 5 << p;
+    auto chunks = t.Chunks().size();
+    auto n = s.Chunks().size();
+    s << std::move(t);
+    CHECK(0 == t.Length() && t.Chunks().empty());
+    CHECK(s.Chunks().size() == n + chunks && s.Chunks().back().data == big.data());
+
+    // copies are deep and equal
+    Serializer c(s);
+    std::vector<char> v = flat(s);
+    CHECK(flat(c) == v);
+    for (auto& k : c.Chunks())
+        CHECK(k.data != big.data());
+
+    // growing blocks never move what is in them
+    Serializer g;
+    const char* first;
+    g << 1;
+    first = g.Chunks()[0].data;
+    for (i = 0; i < 100000; ++i)
+        g << (char)i;
+    CHECK(g.Chunks()[0].data == first && g.Length() == 100004);
+    CHECK(g.Chunks().size() < 20);
+
+    // read back from the joined bytes
+    int x, y;
+    Pack q;
+    c >> &x;
+    for (i = 1; i < 100; ++i)
+        c >> &y;
+    c >> &q;
+    CHECK(0 == x && 99 == y && q.len == 1000 && 0 == memcmp(q.content, big.data(), 1000));
+    CHECK(1 == c.Chunks().size());
+    free(q.content);
+
+    // move assignment leaves the source empty
+    Serializer m;
+    m = std::move(c);
+    CHECK(0 == c.Length() && flat(m) == v);
+}
+
+int main()
+{
+    test_call_request();
+    test_call_response();
+    test_others();
+    test_gather();
+    return test_result("serializer");
+}
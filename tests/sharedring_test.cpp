@@ -0,0 +1,297 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// sharedring_test.cpp - the SharedRing, alone and under a CallChannel
+//
+// The second half forks a plugin host: it is sent the OpenRingMessage
+// as the adapter sends it, opens the ring from its name and calls the
+// adapter, which answers the big calls through the ring.
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "PipeConnect.h"
+#include "test.h"
+#include "socket_transport.h"
+
+// records of all sizes, through all the places the ring wraps
+static void test_records()
+{
+    const uint32_t size = 256;
+    std::vector<char> mem(SharedRing::MappingSize(size));
+    SharedRing w, r;
+    uint32_t len;
+    int i, n, seq = 0, got = 0;
+
+    CHECK(w.Init(mem.data(), size));
+    CHECK(r.Attach(mem.data(), mem.size()));
+    CHECK(r.Size() == size);
+    CHECK(w.Fits(size / 2 - 8) && !w.Fits(size / 2 - 7));
+    std::vector<char> big(size / 2 - 7);
+    CHECK(!w.Write(big.data(), big.size()));
+    CHECK(r.Peek(&len) == nullptr);
+
+    for (i = 0; i < 2000; ++i) {
+        char buf[120];
+        n = (i * 37) % 121;
+        memset(buf, seq & 255, n);
+        if (w.Write(buf, n)) {
+            ++seq;
+        }
+        // read every other time, so the ring fills up now and then
+        if (i & 1) {
+            auto p = (const unsigned char*)r.Peek(&len);
+            while (p) {
+                bool same = true;
+                for (uint32_t k = 0; k < len; ++k)
+                    same = same && p[k] == (got & 255);
+                CHECK(same);
+                r.Release();
+                ++got;
+                p = (const unsigned char*)r.Peek(&len);
+            }
+        }
+    }
+    CHECK(got == seq && seq > 1000);
+}
+
+// a header that claims more than is mapped, or is no ring at all
+static void test_attach()
+{
+    std::vector<char> mem(SharedRing::MappingSize(4096));
+    SharedRing w, r1, r2, r3, r4;
+
+    CHECK(!w.Init(mem.data(), 1000));
+    CHECK(w.Init(mem.data(), 4096));
+    CHECK(!r1.Attach(mem.data(), SharedRing::MappingSize(4096) - 1));
+    CHECK(!r2.Attach(mem.data(), sizeof(RingHeader) - 1));
+
+    ((RingHeader*)mem.data())->size = 1 << 20;
+    CHECK(!r3.Attach(mem.data(), mem.size()));
+
+    ((RingHeader*)mem.data())->size = 4096;
+    ((RingHeader*)mem.data())->magic ^= 1;
+    CHECK(!r4.Attach(mem.data(), mem.size()));
+}
+
+// what a broken producer could leave in the ring
+static void test_bad_records()
+{
+    const uint32_t size = 256;
+    std::vector<char> mem(SharedRing::MappingSize(size));
+    RingHeader* h = (RingHeader*)mem.data();
+    uint32_t* data = (uint32_t*)(mem.data() + sizeof(RingHeader));
+    SharedRing w, r;
+    uint32_t len;
+
+    CHECK(w.Init(mem.data(), size));
+    CHECK(r.Attach(mem.data(), mem.size()));
+
+    // longer than any record can be
+    data[0] = size / 2;
+    h->head.store(size / 2 + 8);
+    CHECK(r.Peek(&len) == nullptr);
+
+    // longer than what was written
+    data[0] = 64;
+    h->head.store(64);
+    CHECK(r.Peek(&len) == nullptr);
+    h->head.store(72);
+    CHECK(r.Peek(&len) != nullptr && len == 64);
+
+    // more written than the ring holds
+    h->head.store(size + 8);
+    CHECK(r.Peek(&len) == nullptr);
+
+    // a skip to a record behind head
+    h->tail.store(size - 16);
+    h->head.store(size + 8);
+    data[(size - 16) / 4] = 0xffffffff;
+    data[0] = 16;
+    CHECK(r.Peek(&len) == nullptr);
+    h->head.store(size + 24);
+    CHECK(r.Peek(&len) != nullptr && len == 16);
+
+    // and the producer does not trust the consumer's tail either
+    h->tail.store(h->head.load() + 8);
+    CHECK(w.Reserve(8) == nullptr);
+}
+
+// the adapter's side: makes the ring and answers with it
+static int adapter(Transport* pipe, const char* name, int calls)
+{
+    SharedRing ring;
+    MessageHeader header;
+    std::vector<char> content;
+    OkMessage ok;
+
+    if (!ring.Create(name, 1 << 22))
+        return 1;
+
+    OpenRingMessage openRing = { (char*)name, 1 << 22 };
+    auto msg = MessageSerializer::Serialize(openRing);
+    bool sent = pipe->Write(msg, sizeof(MessageHeader) + msg->len);
+    delete[] (char*)msg;
+    if (!sent || !pipe->ReadAll(&header, sizeof header))
+        return 1;
+    content.resize(header.len);
+    if (!pipe->ReadAll(content.data(), header.len)
+        || !MessageSerializer::Deserialize(&header, content.data(), &ok))
+        return 1;
+    shm_unlink(name);
+
+    CallChannel channel(pipe);
+    channel.Rings(&ring, nullptr);
+
+    for (;;) {
+        char* c;
+        if (!channel.Receive(&header, &c))
+            break;
+        if (header.tag == FlushMessage::tag) {
+            channel.Flush();
+            continue;
+        }
+
+        CallRequestMessage rq;
+        if (!MessageSerializer::Deserialize(&header, c, &rq))
+            return 1;
+
+        // the argument back as the result
+        CallResponseMessage rs = {};
+        rs.resultSize = rq.argSize[0];
+        rs.result = (char*)rq.argv[0];
+        rs.lastError = header.id;
+        channel.Send(rs, header.id);
+
+        for (int i = 0; i < rq.argc; ++i)
+            free(rq.argv[i]);
+        free(rq.argv);
+        free(rq.argSize);
+        free(rq.function);
+        --calls;
+    }
+    return calls != 0;
+}
+
+// the host's side: opens the ring from the message and calls
+static int host(Transport* pipe, int calls, long* pipe_bytes, long* payload)
+{
+    MessageHeader header;
+    std::vector<char> content;
+    OpenRingMessage openRing;
+    SharedRing ring;
+    int i, round, bad = 0;
+
+    if (!pipe->ReadAll(&header, sizeof header))
+        return 1;
+    content.resize(header.len);
+    if (!pipe->ReadAll(content.data(), header.len)
+        || !MessageSerializer::Deserialize(&header, content.data(), &openRing)
+        || !ring.Open(openRing.name)
+        || ring.Size() != openRing.size)
+        return 1;
+    free(openRing.name);
+
+    OkMessage ok;
+    auto msg = MessageSerializer::Serialize(ok);
+    pipe->Write(msg, sizeof(MessageHeader) + msg->len);
+    delete[] (char*)msg;
+
+    CallChannel channel(pipe);
+    channel.Rings(nullptr, &ring);
+
+    std::vector<unsigned int> ids(calls), sizes(calls);
+    for (round = 0; round < 3; ++round) {
+        for (i = 0; i < calls; ++i) {
+            // small ones on the pipe, some too big for the ring
+            sizes[i] = (i * 7919) % (i % 3 ? 200 : 70000);
+            std::vector<char> v(sizes[i]);
+            for (unsigned int k = 0; k < sizes[i]; ++k)
+                v[k] = (char)(k ^ i);
+            void* argv[1] = { v.data() };
+            char fn[] = "echo";
+            CallRequestMessage rq = { fn, 1, &sizes[i], argv };
+            ids[i] = channel.Call(rq);
+            *payload += sizes[i];
+        }
+        // and the answers in the other order
+        for (i = calls - 1; i >= 0; --i) {
+            CallResponseMessage rs;
+            ErrMessage err;
+            if (!channel.Result(ids[i], &rs, &err)) {
+                free(err.error);
+                ++bad;
+                continue;
+            }
+            if (rs.resultSize != sizes[i] || rs.lastError != ids[i])
+                ++bad;
+            else
+                for (unsigned int k = 0; k < sizes[i]; ++k)
+                    if (rs.result[k] != (char)(k ^ i)) {
+                        ++bad;
+                        break;
+                    }
+            free(rs.result);
+        }
+    }
+    *pipe_bytes = ((SocketTransport*)pipe)->read_bytes;
+    return bad;
+}
+
+static void test_channel()
+{
+    const int calls = 200;
+    char name[40];
+    int sv[2], status;
+    long pipe_bytes = 0, payload = 0;
+
+    sprintf(name, "/bbtest_ring.%d", (int)getpid());
+    CHECK(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    pid_t pid = fork();
+    if (0 == pid) {
+        close(sv[1]);
+        SocketTransport pipe(sv[0]);
+        _exit(adapter(&pipe, name, 3 * calls));
+    }
+
+    close(sv[0]);
+    SocketTransport pipe(sv[1]);
+    CHECK(0 == host(&pipe, calls, &pipe_bytes, &payload));
+    shutdown(sv[1], SHUT_WR);
+    CHECK(pid == waitpid(pid, &status, 0));
+    CHECK(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+    close(sv[1]);
+
+    // the big answers came through the ring
+    CHECK(pipe_bytes > 0 && pipe_bytes < payload / 2);
+}
+
+int main()
+{
+    test_records();
+    test_attach();
+    test_bad_records();
+    test_channel();
+    return test_result("sharedring");
+}
@@ -0,0 +1,71 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// socket_transport.h - a Transport on a socket, for the pipe in tests
+
+#ifndef _BBTEST_SOCKET_TRANSPORT_H_
+#define _BBTEST_SOCKET_TRANSPORT_H_
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "PipeConnect.h"
+
+class SocketTransport : public Transport {
+public:
+    int fd;
+    long read_bytes, written_bytes;
+
+    SocketTransport(int fd) : fd(fd), read_bytes(0), written_bytes(0) {}
+
+    // for reads from now on, as PipeServer has it. 0 is none
+    void Timeout(int ms) {
+        struct timeval tv = { ms / 1000, (ms % 1000) * 1000 };
+        setsockopt(this->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    }
+
+    unsigned int Read(void* buf, unsigned int len) {
+        ssize_t n = read(this->fd, buf, len);
+        if(n <= 0)
+            return 0;
+
+        this->read_bytes += n;
+        return (unsigned int)n;
+    }
+
+    bool Write(void const* buf, unsigned int len) {
+        const char* p = (const char*)buf;
+
+        this->written_bytes += len;
+        while(len > 0) {
+            ssize_t n = write(this->fd, p, len);
+            if(n <= 0)
+                return false;
+
+            p += n;
+            len -= n;
+        }
+
+        return true;
+    }
+};
+
+#endif
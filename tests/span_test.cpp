@@ -0,0 +1,131 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// span_test.cpp - the SSE2 and AVX2 kernels of root_copy against the C one
+//
+// Random pixels, every length up to a few vectors (so all the tails), and
+// -hue/-sat values over the whole range and beyond it: each level must
+// give the bits of level 0. Levels the cpu does not have are skipped.
+
+#include <string.h>
+#include <vector>
+#include "BBApi.h"
+#include "rootimg.h"
+#include "test.h"
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+static void random_pixels(std::vector<RGBQUAD> &v)
+{
+    for (RGBQUAD &q : v) {
+        q.rgbBlue = rnd(256);
+        q.rgbGreen = rnd(256);
+        q.rgbRed = rnd(256);
+        q.rgbReserved = rnd(256);
+    }
+}
+
+// s onto a copy of d with each level, offset by 'skew' pixels so that
+// the loads are not all aligned
+static int compare(int level, int n, int skew, int hue, int sat)
+{
+    std::vector<RGBQUAD> s(n + skew), d(n + skew), want, got;
+    int bad = 0;
+
+    random_pixels(s);
+    random_pixels(d);
+    want = got = d;
+    root_get_span(0, hue, sat)(&want[skew], &s[skew], n, hue, sat);
+    root_get_span(level, hue, sat)(&got[skew], &s[skew], n, hue, sat);
+    for (int i = 0; i < n + skew; ++i)
+        if (memcmp(&want[i], &got[i], sizeof want[i])) {
+            if (++bad < 5)
+                fprintf(stderr, "level %d n %d hue %d sat %d at %d: %02x%02x%02x%02x, not %02x%02x%02x%02x\n",
+                    level, n, hue, sat, i - skew,
+                    got[i].rgbReserved, got[i].rgbRed, got[i].rgbGreen, got[i].rgbBlue,
+                    want[i].rgbReserved, want[i].rgbRed, want[i].rgbGreen, want[i].rgbBlue);
+        }
+    return bad;
+}
+
+static void test_level(int level)
+{
+    static const int edge[] = { 0, 1, 2, 127, 128, 254, 255 };
+    int n, i, k, bad = 0;
+
+    // the values the kernels treat specially, with every tail
+    for (n = 0; n <= 40; ++n)
+        for (i = 0; i < 7; ++i)
+            for (k = 0; k < 7; ++k)
+                bad += compare(level, n, n % 3, edge[i], edge[k]);
+
+    // and at random, on longer spans
+    for (i = 0; i < 2000; ++i)
+        bad += compare(level, rnd(300), rnd(8), rnd(256), rnd(256));
+
+    CHECK(0 == bad);
+}
+
+// out of 0..255 there is only the C kernel
+static void test_out_of_range(void)
+{
+    static const int odd[][2] = { { -1, 100 }, { 256, 100 }, { 100, -1 }, { 100, 256 }, { -50, 300 } };
+    for (int i = 0; i < 5; ++i)
+        for (int level = 1; level <= 2; ++level)
+            CHECK(root_get_span(level, odd[i][0], odd[i][1]) == root_get_span(0, odd[i][0], odd[i][1]));
+}
+
+// the fast path of level 0, -sat 255 and no -hue, is a copy without alpha
+static void test_copy(void)
+{
+    std::vector<RGBQUAD> s(37), d(37);
+    int i, bad = 0;
+
+    random_pixels(s);
+    random_pixels(d);
+    root_get_span(0, 0, 255)(&d[0], &s[0], 37, 0, 255);
+    for (i = 0; i < 37; ++i)
+        bad += d[i].rgbRed != s[i].rgbRed || d[i].rgbGreen != s[i].rgbGreen
+            || d[i].rgbBlue != s[i].rgbBlue || d[i].rgbReserved != 0;
+    CHECK(0 == bad);
+}
+
+int main()
+{
+    int level, top = root_cpu_level();
+
+    test_copy();
+    test_out_of_range();
+    for (level = 1; level <= 2; ++level) {
+        if (level > top) {
+            printf("span: no level %d on this cpu, not tested\n", level);
+            continue;
+        }
+        test_level(level);
+    }
+    return test_result("span");
+}
@@ -0,0 +1,87 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// SharedRing_posix.cpp - SharedRing.cpp with POSIX shared memory
+//
+// The same named mapping for two processes, so the ring is tested as
+// the adapter and the plugin host use it. map holds the descriptor.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "PipeConnect.h"
+
+SharedRing::~SharedRing() {
+    if(this->header != nullptr)
+        munmap(this->header, MappingSize(this->size));
+
+    if(this->map != nullptr)
+        close((int)(intptr_t)this->map - 1);
+}
+
+bool SharedRing::Create(const char* name, uint32_t size) {
+    if(!ValidSize(size))
+        return false;
+
+    // O_EXCL for ERROR_ALREADY_EXISTS
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0)
+        return false;
+
+    this->map = (void*)(intptr_t)(fd + 1);
+    if(ftruncate(fd, MappingSize(size)) != 0)
+        return false;
+
+    auto mem = mmap(nullptr, MappingSize(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mem == MAP_FAILED)
+        return false;
+
+    if(this->Init(mem, size))
+        return true;
+
+    munmap(mem, MappingSize(size));
+    return false;
+}
+
+bool SharedRing::Open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0)
+        return false;
+
+    this->map = (void*)(intptr_t)(fd + 1);
+
+    // the size of the object, as VirtualQuery gives the view's
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RingHeader))
+        return false;
+
+    auto mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mem == MAP_FAILED)
+        return false;
+
+    if(this->Attach(mem, st.st_size))
+        return true;
+
+    munmap(mem, st.st_size);
+    return false;
+}
@@ -0,0 +1,143 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// gdi_mem.cpp - memory dcs and 32 bit bitmaps, for the pixel work of bblib
+//
+// A bitmap is its pixels as in a dib (0x00RRGGBB), top-down or not; a dc
+// is the bitmap selected into it. BitBlt is SRCCOPY and clips as GDI
+// does. gdi_objects counts what is not deleted yet.
+
+#include <vector>
+#include <windows.h>
+#include "gdi_mem.h"
+
+int gdi_objects;
+
+struct MemBitmap {
+    int w, h;
+    bool bottom_up;
+    std::vector<DWORD> px;
+
+    DWORD *at(int x, int y) {
+        return &px[(bottom_up ? h - 1 - y : y) * w + x];
+    }
+};
+
+struct MemDC {
+    MemBitmap *bmp;
+};
+
+static MemBitmap *new_bitmap(int w, int h, bool bottom_up)
+{
+    MemBitmap *b = new MemBitmap;
+    b->w = w, b->h = h, b->bottom_up = bottom_up;
+    b->px.assign(w * h, 0);
+    ++gdi_objects;
+    return b;
+}
+
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO *bmi, UINT usage, void **bits, HANDLE section, DWORD offset)
+{
+    const BITMAPINFOHEADER *h = &bmi->bmiHeader;
+    if (32 != h->biBitCount || BI_RGB != h->biCompression || h->biWidth <= 0 || 0 == h->biHeight)
+        return NULL;
+    MemBitmap *b = new_bitmap(h->biWidth, abs(h->biHeight), h->biHeight > 0);
+    *bits = b->px.data();
+    return (HBITMAP)b;
+}
+
+HBITMAP CreateCompatibleBitmap(HDC hdc, int w, int h)
+{
+    return w > 0 && h > 0 ? (HBITMAP)new_bitmap(w, h, false) : NULL;
+}
+
+HDC CreateCompatibleDC(HDC hdc)
+{
+    MemDC *dc = new MemDC;
+    dc->bmp = NULL;
+    ++gdi_objects;
+    return (HDC)dc;
+}
+
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj)
+{
+    MemDC *dc = (MemDC*)hdc;
+    MemBitmap *old = dc->bmp;
+    dc->bmp = (MemBitmap*)obj;
+    return old;
+}
+
+HGDIOBJ GetCurrentObject(HDC hdc, UINT type)
+{
+    return OBJ_BITMAP == type ? ((MemDC*)hdc)->bmp : NULL;
+}
+
+BOOL BitBlt(HDC hdc, int x, int y, int w, int h, HDC src, int sx, int sy, DWORD rop)
+{
+    MemBitmap *d = ((MemDC*)hdc)->bmp, *s = ((MemDC*)src)->bmp;
+    int i, k;
+    if (NULL == d || NULL == s || SRCCOPY != rop)
+        return FALSE;
+    for (k = 0; k < h; ++k)
+        for (i = 0; i < w; ++i)
+            if (x + i >= 0 && x + i < d->w && y + k >= 0 && y + k < d->h
+             && sx + i >= 0 && sx + i < s->w && sy + k >= 0 && sy + k < s->h)
+                *d->at(x + i, y + k) = *s->at(sx + i, sy + k);
+    return TRUE;
+}
+
+BOOL GdiFlush(void)
+{
+    return TRUE;
+}
+
+BOOL DeleteDC(HDC hdc)
+{
+    delete (MemDC*)hdc;
+    --gdi_objects;
+    return TRUE;
+}
+
+BOOL DeleteObject(HGDIOBJ obj)
+{
+    delete (MemBitmap*)obj;
+    --gdi_objects;
+    return TRUE;
+}
+
+// COLORREF is 0x00BBGGRR, the other way round
+COLORREF GetPixel(HDC hdc, int x, int y)
+{
+    MemBitmap *b = ((MemDC*)hdc)->bmp;
+    if (NULL == b || x < 0 || x >= b->w || y < 0 || y >= b->h)
+        return CLR_INVALID;
+    DWORD p = *b->at(x, y);
+    return (p & 0xFF) << 16 | (p & 0xFF00) | (p >> 16 & 0xFF);
+}
+
+COLORREF SetPixel(HDC hdc, int x, int y, COLORREF c)
+{
+    MemBitmap *b = ((MemDC*)hdc)->bmp;
+    if (NULL == b || x < 0 || x >= b->w || y < 0 || y >= b->h)
+        return CLR_INVALID;
+    *b->at(x, y) = (c & 0xFF) << 16 | (c & 0xFF00) | (c >> 16 & 0xFF);
+    return c;
+}
@@ -0,0 +1,145 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// image_raw.cpp - the image interface of rootimg.h on plain 32 bit pixels
+//
+// For the tests of rootscale.cpp, in place of image_cx.cpp. image_save
+// keeps a copy under the path, which image_read then gives back with the
+// rows in a shuffled order, as the threads of the jpeg reader may.
+// root_cpu_level is root_test_level, so that the tests can pick it.
+
+#include <map>
+#include <string>
+#include <vector>
+#include "BBApi.h"
+#include "rootimg.h"
+#include "image_raw.h"
+
+int root_test_level;
+
+struct RawImage {
+    int w, h;
+    std::vector<RGBQUAD> px;
+};
+
+static std::map<std::string, RawImage> saved;
+
+int root_cpu_level(void)
+{
+    return root_test_level;
+}
+
+const char *image_getversion(void)
+{
+    return "raw";
+}
+
+const char *image_getlasterror(void)
+{
+    return "";
+}
+
+HIMG image_create_fromraw(int w, int h, void *pixels)
+{
+    RawImage *r = new RawImage;
+    r->w = w, r->h = h;
+    r->px.assign((RGBQUAD*)pixels, (RGBQUAD*)pixels + w * h);
+    return r;
+}
+
+HIMG image_create_fromfile(const char *path)
+{
+    return saved.count(path) ? new RawImage(saved[path]) : NULL;
+}
+
+int image_save(HIMG img, const char *path)
+{
+    saved[path] = *(RawImage*)img;
+    return 1;
+}
+
+void image_destroy(HIMG img)
+{
+    delete (RawImage*)img;
+}
+
+int image_getwidth(HIMG img)
+{
+    return ((RawImage*)img)->w;
+}
+
+int image_getheight(HIMG img)
+{
+    return ((RawImage*)img)->h;
+}
+
+RGBQUAD image_getpixel(HIMG img, int x, int y)
+{
+    RawImage *r = (RawImage*)img;
+    return r->px[y * r->w + x];
+}
+
+int image_setpixel(HIMG img, int x, int y, RGBQUAD c)
+{
+    RawImage *r = (RawImage*)img;
+    r->px[y * r->w + x] = c;
+    return 1;
+}
+
+void image_getline(HIMG img, int y, RGBQUAD *line)
+{
+    RawImage *r = (RawImage*)img;
+    memcpy(line, &r->px[y * r->w], r->w * sizeof *line);
+}
+
+int image_resample(HIMG *img, int w, int h)
+{
+    return 0;
+}
+
+int image_read(const char *path, ImageReader *ir)
+{
+    std::vector<RGBQUAD> line;
+    unsigned int seed = 1;
+    int y, k;
+
+    if (0 == saved.count(path))
+        return 0;
+    RawImage &r = saved[path];
+    if (!ir->Size(r.w, r.h) || !ir->Start(r.w, r.h))
+        return -1;
+
+    std::vector<int> order(r.h);
+    for (y = 0; y < r.h; ++y)
+        order[y] = y;
+    for (y = r.h - 1; y > 0; --y) {
+        seed = seed * 1103515245 + 12345;
+        k = (seed >> 8) % (y + 1);
+        std::swap(order[y], order[k]);
+    }
+    // with the room for one more pixel
+    line.resize(r.w + 1);
+    for (y = 0; y < r.h; ++y) {
+        memcpy(&line[0], &r.px[order[y] * r.w], r.w * sizeof line[0]);
+        ir->Row(order[y], &line[0]);
+    }
+    return 1;
+}
@@ -0,0 +1,165 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// windows.h - what the tested sources need of it, to build them on Linux
+//
+// Types and helpers, and the few system calls that have an obvious
+// POSIX counterpart (windows_posix.cpp). Code that needs more of
+// windows is not built here.
+
+#ifndef _BBTEST_WINDOWS_H_
+#define _BBTEST_WINDOWS_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <stdint.h>
+#include <stdarg.h>
+
+// the wow64adapter's serializer casts handles to DWORD, which g++ does
+// not take for a 32 bit DWORD on 64 bit linux. Its tests define this.
+#ifdef BBTEST_WIDE_DWORD
+typedef unsigned long DWORD;
+#else
+typedef uint32_t DWORD;
+#endif
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef int32_t LONG;
+typedef unsigned int UINT;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef uintptr_t UINT_PTR, DWORD_PTR;
+typedef intptr_t INT_PTR, LONG_PTR;
+typedef uint64_t ULONGLONG;
+typedef int64_t LONGLONG, __int64;
+typedef DWORD COLORREF;
+typedef UINT_PTR WPARAM;
+typedef LONG_PTR LPARAM, LRESULT;
+
+#define DECLARE_HANDLE(n) struct n##__; typedef struct n##__ *n
+typedef void *HANDLE;
+DECLARE_HANDLE(HWND);
+DECLARE_HANDLE(HDC);
+DECLARE_HANDLE(HFONT);
+DECLARE_HANDLE(HBITMAP);
+DECLARE_HANDLE(HICON);
+DECLARE_HANDLE(HINSTANCE);
+DECLARE_HANDLE(HMONITOR);
+
+#define WINAPI
+#define __declspec(x)
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+
+typedef struct tagRECT { LONG left, top, right, bottom; } RECT;
+typedef struct tagPOINT { LONG x, y; } POINT;
+typedef struct _FILETIME { DWORD dwLowDateTime, dwHighDateTime; } FILETIME;
+struct OVERLAPPED { HANDLE hEvent; };
+typedef struct tagRGBQUAD { BYTE rgbBlue, rgbGreen, rgbRed, rgbReserved; } RGBQUAD;
+typedef struct tagWINDOWPOS { HWND hwnd, hwndInsertAfter; int x, y, cx, cy; UINT flags; } WINDOWPOS;
+typedef struct _GUID { DWORD Data1; WORD Data2, Data3; BYTE Data4[8]; } GUID;
+
+// shellapi.h
+#define NIF_MESSAGE 0x00000001
+#define NIF_ICON    0x00000002
+#define NIF_TIP     0x00000004
+#define NIF_STATE   0x00000008
+#define NIF_INFO    0x00000010
+
+#define RGB(r,g,b) ((COLORREF)(((BYTE)(r)|((WORD)((BYTE)(g))<<8))|(((DWORD)(BYTE)(b))<<16)))
+#define GetRValue(c) ((BYTE)(c))
+#define GetGValue(c) ((BYTE)((c) >> 8))
+#define GetBValue(c) ((BYTE)((c) >> 16))
+
+#define _strdup strdup
+
+static inline char *_strlwr(char *s)
+{
+    for (char *p = s; *p; ++p)
+        if (*p >= 'A' && *p <= 'Z')
+            *p += 32;
+    return s;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// files, mapped read-only
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+#define GENERIC_READ 0x80000000
+#define FILE_SHARE_READ 1
+#define OPEN_EXISTING 3
+#define PAGE_READONLY 2
+#define FILE_MAP_READ 4
+
+HANDLE CreateFile(LPCSTR name, DWORD access, DWORD share, void *sa,
+    DWORD creation, DWORD flags, HANDLE templ);
+DWORD GetFileSize(HANDLE hf, DWORD *hi);
+HANDLE CreateFileMapping(HANDLE hf, void *sa, DWORD protect,
+    DWORD hi, DWORD lo, LPCSTR name);
+void *MapViewOfFile(HANDLE hm, DWORD access, DWORD hi, DWORD lo, size_t bytes);
+BOOL UnmapViewOfFile(const void *p);
+BOOL CloseHandle(HANDLE h);
+
+// threads
+BOOL SwitchToThread(void);
+void Sleep(DWORD ms);
+
+// dcs and bitmaps in memory, with the 32 bit pixels only (gdi_mem.cpp)
+typedef void *HGDIOBJ;
+typedef struct tagBITMAPINFOHEADER {
+    DWORD biSize; LONG biWidth, biHeight; WORD biPlanes, biBitCount;
+    DWORD biCompression, biSizeImage; LONG biXPelsPerMeter, biYPelsPerMeter;
+    DWORD biClrUsed, biClrImportant;
+} BITMAPINFOHEADER;
+typedef struct tagBITMAPINFO { BITMAPINFOHEADER bmiHeader; RGBQUAD bmiColors[1]; } BITMAPINFO;
+#define BI_RGB 0
+#define DIB_RGB_COLORS 0
+#define SRCCOPY 0x00CC0020
+#define OBJ_BITMAP 7
+#define CLR_INVALID 0xFFFFFFFF
+
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO *bmi, UINT usage, void **bits, HANDLE section, DWORD offset);
+HBITMAP CreateCompatibleBitmap(HDC hdc, int w, int h);
+HDC CreateCompatibleDC(HDC hdc);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj);
+HGDIOBJ GetCurrentObject(HDC hdc, UINT type);
+BOOL BitBlt(HDC hdc, int x, int y, int w, int h, HDC src, int sx, int sy, DWORD rop);
+BOOL GdiFlush(void);
+BOOL DeleteDC(HDC hdc);
+BOOL DeleteObject(HGDIOBJ obj);
+COLORREF GetPixel(HDC hdc, int x, int y);
+COLORREF SetPixel(HDC hdc, int x, int y, COLORREF c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
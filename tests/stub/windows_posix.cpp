@@ -0,0 +1,101 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// windows_posix.cpp - the system calls of windows.h, with POSIX
+//
+// A file handle is its descriptor + 1, a mapping handle the file's.
+// Views remember their size for UnmapViewOfFile.
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <map>
+#include <windows.h>
+
+static std::map<const void*, size_t> views;
+
+HANDLE CreateFile(LPCSTR name, DWORD access, DWORD share, void *sa,
+    DWORD creation, DWORD flags, HANDLE templ)
+{
+    int fd = open(name, O_RDONLY);
+    return fd < 0 ? INVALID_HANDLE_VALUE : (HANDLE)(intptr_t)(fd + 1);
+}
+
+DWORD GetFileSize(HANDLE hf, DWORD *hi)
+{
+    struct stat st;
+    if (fstat((int)(intptr_t)hf - 1, &st) != 0)
+        return (DWORD)-1;
+    *hi = (DWORD)((uint64_t)st.st_size >> 32);
+    return (DWORD)st.st_size;
+}
+
+HANDLE CreateFileMapping(HANDLE hf, void *sa, DWORD protect,
+    DWORD hi, DWORD lo, LPCSTR name)
+{
+    int fd = dup((int)(intptr_t)hf - 1);
+    return fd < 0 ? NULL : (HANDLE)(intptr_t)(fd + 1);
+}
+
+void *MapViewOfFile(HANDLE hm, DWORD access, DWORD hi, DWORD lo, size_t bytes)
+{
+    int fd = (int)(intptr_t)hm - 1;
+    struct stat st;
+    void *p;
+
+    if (0 == bytes) {
+        if (fstat(fd, &st) != 0)
+            return NULL;
+        bytes = st.st_size;
+    }
+    p = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, ((off_t)hi << 32) | lo);
+    if (MAP_FAILED == p)
+        return NULL;
+    views[p] = bytes;
+    return p;
+}
+
+BOOL UnmapViewOfFile(const void *p)
+{
+    auto v = views.find(p);
+    if (v == views.end())
+        return FALSE;
+    munmap((void*)p, v->second);
+    views.erase(v);
+    return TRUE;
+}
+
+BOOL CloseHandle(HANDLE h)
+{
+    return 0 == close((int)(intptr_t)h - 1);
+}
+
+BOOL SwitchToThread(void)
+{
+    return 0 == sched_yield();
+}
+
+void Sleep(DWORD ms)
+{
+    usleep(ms * 1000);
+}
@@ -0,0 +1,46 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// test.h - checks for the tests, a failed one is reported and counted
+//
+// main returns test_result(), which ctest takes as pass or fail.
+
+#ifndef _BBTEST_H_
+#define _BBTEST_H_
+
+#include <stdio.h>
+
+static int test_failed;
+
+#define CHECK(e) \
+    ((e) ? (void)0 : (void)(++test_failed, \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #e)))
+
+static int test_result(const char *name)
+{
+    if (test_failed)
+        printf("%s: %d checks failed\n", name, test_failed);
+    else
+        printf("%s: ok\n", name);
+    return test_failed != 0;
+}
+
+#endif
@@ -0,0 +1,484 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// tray_test.cpp - the tray's merged BB_TRAYUPDATEs, replayed from a log
+//
+// tray_stream.txt has the shell's messages of a session as LOG_TRAY
+// writes them. They go through a TrayEvent() of this test into the
+// icons of TrayIcons.cpp, with a timer of fake time. What goes out to
+// the plugins must be what a plain list of the icons gives: an icon's
+// modifies in one message per timer tick, and before any add, remove,
+// show, hide or balloon all that is pending, in list order. The plugin
+// reads each icon by the index in the message and must see it as it is.
+
+#include <limits.h>
+#include <string>
+#include <vector>
+#include "BBApi.h"
+#include "bblib.h"
+#include "TrayIcons.h"
+#include "test.h"
+
+#define NIM_ADD         0
+#define NIM_MODIFY      1
+#define NIM_DELETE      2
+#define NIM_SETVERSION  4
+#define NIS_HIDDEN      1
+#define NIS_SHAREDICON  2
+
+static unsigned int seed = 1;
+
+static int rnd(int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+// one line of the log
+struct Record {
+    int ms, cmd;
+    unsigned hwnd, id, flags, mask, state, msg, icon;
+    bool alive;
+    std::string tip;
+};
+
+// one BB_TRAYUPDATE
+struct Sent {
+    unsigned msg, changed, hwnd, id;
+    int index;
+    bool operator==(const Sent &o) const {
+        return msg == o.msg && changed == o.changed && hwnd == o.hwnd
+            && id == o.id && index == o.index;
+    }
+};
+
+static std::vector<Record> read_stream(const char *path)
+{
+    std::vector<Record> v;
+    char line[1000], cmd[8];
+    FILE *fp = fopen(path, "rb");
+
+    if (NULL == fp)
+        return v;
+    while (fgets(line, sizeof line, fp)) {
+        Record r;
+        int alive;
+        const char *p, *q;
+        if ('#' == line[0])
+            continue;
+        if (5 != sscanf(line, "%d Tray: %3s(%d) hwnd:%X(%d)", &r.ms, cmd, &r.cmd, &r.hwnd, &alive)
+            || NULL == (p = strstr(line, "\" id:"))
+            || 6 != sscanf(p, "\" id:%u flag:%X state:%X,%x msg:%X icon:%X",
+                &r.id, &r.flags, &r.mask, &r.state, &r.msg, &r.icon)
+            || NULL == (p = strstr(p, "tip:\""))
+            || NULL == (q = strchr(p + 5, '"')))
+            continue;
+        r.alive = 0 != alive;
+        r.tip.assign(p + 5, q);
+        v.push_back(r);
+    }
+    fclose(fp);
+    return v;
+}
+
+//===========================================================================
+// the tray: Tray.cpp's TrayEvent(), with windows and icons as numbers
+
+static int now, timer_due, idle_ticks;
+static bool timer_on;
+static std::vector<Sent> sent;
+static int plugin_bad;
+
+LRESULT tray_broadcast(systemTrayNode *p, unsigned msg)
+{
+    Sent s = { msg, p->uChanged, (unsigned)(DWORD_PTR)p->hWnd, p->uID, p->index };
+    sent.push_back(s);
+    // the plugin gets the icon by its index
+    if (TRAYICON_REMOVED != msg && nth_icon(p->index) != p)
+        ++plugin_bad;
+    return 0;
+}
+
+void tray_timer(bool set)
+{
+    timer_on = set;
+    if (set)
+        timer_due = now + TRAY_COALESCE_DELAY;
+}
+
+// the WM_TIMERs until 'ms'. One that finds nothing to send is idle.
+static void run_until(int ms)
+{
+    while (timer_on && timer_due <= ms) {
+        now = timer_due;
+        flush_tray_updates();
+        if (timer_on)
+            ++idle_ticks, timer_due = now + TRAY_COALESCE_DELAY;
+    }
+    now = ms;
+}
+
+static void remove_icon(systemTrayNode *p, bool post)
+{
+    if (post)
+        flush_tray_updates();
+    tray_remove_node(p);
+    if (post)
+        send_tray_message(p, NIF_ICON, TRAYICON_REMOVED);
+    m_free(p);
+}
+
+static void tray_event(const Record &r)
+{
+    HWND hWnd = (HWND)(DWORD_PTR)r.hwnd;
+    systemTrayNode *p = find_icon(hWnd, r.id);
+    unsigned uChanged, msg;
+    bool hidden, shared, was_hidden;
+
+    switch (r.cmd) {
+    case NIM_DELETE:
+        if (p)
+            remove_icon(p, true);
+        return;
+    case NIM_ADD:
+    case NIM_MODIFY:
+        if (false == r.alive) {
+            if (p)
+                remove_icon(p, true);
+            return;
+        }
+        hidden = p && p->hidden;
+        shared = p && p->shared;
+        if (r.flags & NIF_STATE) {
+            if (r.mask & NIS_HIDDEN)
+                hidden = 0 != (r.state & NIS_HIDDEN);
+            if (r.mask & NIS_SHAREDICON)
+                shared = 0 != (r.state & NIS_SHAREDICON);
+        }
+        if (p) {
+            if (NIM_ADD == r.cmd) {
+                if (p->added)
+                    return;
+                p->added = true;
+            }
+            if (p->shared != shared)
+                p->orig_icon = NULL;
+            msg = TRAYICON_MODIFIED;
+            was_hidden = p->hidden;
+        } else {
+            if (NIM_MODIFY == r.cmd)
+                return;
+            p = c_new(systemTrayNode);
+            p->hWnd = hWnd;
+            p->uID = r.id;
+            tray_add_node(p);
+            p->added = true;
+            msg = TRAYICON_ADDED;
+            was_hidden = hidden;
+        }
+        p->hidden = hidden;
+        p->shared = shared;
+        if (was_hidden != p->hidden)
+            tray_index_changed();
+        uChanged = 0;
+        if ((r.flags & NIF_MESSAGE) && r.msg != p->uCallbackMessage)
+            p->uCallbackMessage = p->t.uCallbackMessage = r.msg, uChanged |= NIF_MESSAGE;
+        if ((r.flags & NIF_TIP) && strcmp(p->t.szTip, r.tip.c_str()))
+            strcpy(p->t.szTip, r.tip.c_str()), uChanged |= NIF_TIP;
+        if (r.flags & NIF_ICON) {
+            HICON hIcon = (HICON)(DWORD_PTR)r.icon;
+            if (p->shared) {
+                systemTrayNode *o;
+                dolist (o, trayIconList)
+                    if (o->orig_icon == hIcon && false == o->shared)
+                        break;
+                if (NULL == o || NULL == o->orig_icon) {
+                    remove_icon(p, false);
+                    return;
+                }
+                if (p->orig_icon != o->orig_icon)
+                    p->orig_icon = o->orig_icon, uChanged |= NIF_ICON;
+            } else if (NULL == p->orig_icon || p->orig_icon != hIcon) {
+                p->orig_icon = p->t.hIcon = hIcon;
+                uChanged |= NIF_ICON;
+            }
+        }
+        // the log does not have the balloon's text, there is one
+        if (r.flags & NIF_INFO)
+            uChanged |= NIF_ICON;
+        tray_update(p, uChanged, msg, was_hidden, 0 != (r.flags & NIF_INFO));
+        return;
+    }
+}
+
+//===========================================================================
+// the model: the icons in a vector, the rules as plain as can be
+
+struct Icon {
+    unsigned hwnd, id, msg, icon, pending;
+    bool hidden, shared, added;
+    std::string tip;
+};
+
+struct Model {
+    std::vector<Icon> icons;
+    std::vector<Sent> out;
+    int due, queued;
+
+    Model() : due(-1), queued(0) {}
+
+    int find(unsigned hwnd, unsigned id) {
+        for (size_t k = 0; k < icons.size(); ++k)
+            if (icons[k].hwnd == hwnd && icons[k].id == id)
+                return k;
+        return -1;
+    }
+
+    int index(int k) {
+        int n = 0;
+        if (icons[k].hidden)
+            return -1;
+        for (int i = 0; i < k; ++i)
+            n += false == icons[i].hidden;
+        return n;
+    }
+
+    void send(int k, unsigned changed, unsigned msg) {
+        if (icons[k].hidden || 0 == changed)
+            return;
+        Sent s = { msg, changed, icons[k].hwnd, icons[k].id, index(k) };
+        out.push_back(s);
+    }
+
+    void flush(void) {
+        for (size_t k = 0; k < icons.size(); ++k)
+            if (icons[k].pending)
+                send(k, icons[k].pending, TRAYICON_MODIFIED), icons[k].pending = 0;
+        due = -1;
+    }
+
+    void tick(int ms) {
+        if (due >= 0 && due <= ms)
+            flush();
+    }
+
+    void remove(int k, bool post) {
+        if (post)
+            flush(), send(k, NIF_ICON, TRAYICON_REMOVED);
+        icons.erase(icons.begin() + k);
+        for (size_t i = 0; i < icons.size(); ++i)
+            if (icons[i].pending)
+                return;
+        due = -1;
+    }
+
+    void event(const Record &r) {
+        int k = find(r.hwnd, r.id);
+        unsigned changed = 0, msg;
+        bool hidden, shared, was_hidden;
+
+        if (NIM_DELETE == r.cmd || ((NIM_ADD == r.cmd || NIM_MODIFY == r.cmd) && false == r.alive)) {
+            if (k >= 0)
+                remove(k, true);
+            return;
+        }
+        if (NIM_ADD != r.cmd && NIM_MODIFY != r.cmd)
+            return;
+        hidden = k >= 0 && icons[k].hidden;
+        shared = k >= 0 && icons[k].shared;
+        if (r.flags & NIF_STATE) {
+            if (r.mask & NIS_HIDDEN)
+                hidden = 0 != (r.state & NIS_HIDDEN);
+            if (r.mask & NIS_SHAREDICON)
+                shared = 0 != (r.state & NIS_SHAREDICON);
+        }
+        if (k >= 0) {
+            if (NIM_ADD == r.cmd) {
+                if (icons[k].added)
+                    return;
+                icons[k].added = true;
+            }
+            if (icons[k].shared != shared)
+                icons[k].icon = 0;
+            msg = TRAYICON_MODIFIED;
+            was_hidden = icons[k].hidden;
+        } else {
+            if (NIM_MODIFY == r.cmd)
+                return;
+            Icon n = { r.hwnd, r.id, 0, 0, 0, hidden, shared, true, "" };
+            icons.push_back(n);
+            k = icons.size() - 1;
+            msg = TRAYICON_ADDED;
+            was_hidden = hidden;
+        }
+        Icon &i = icons[k];
+        i.hidden = hidden;
+        i.shared = shared;
+        if ((r.flags & NIF_MESSAGE) && r.msg != i.msg)
+            i.msg = r.msg, changed |= NIF_MESSAGE;
+        if ((r.flags & NIF_TIP) && r.tip != i.tip)
+            i.tip = r.tip, changed |= NIF_TIP;
+        if (r.flags & NIF_ICON) {
+            if (i.shared) {
+                int o;
+                for (o = 0; o < (int)icons.size(); ++o)
+                    if (icons[o].icon == r.icon && false == icons[o].shared)
+                        break;
+                if (o == (int)icons.size() || 0 == icons[o].icon) {
+                    remove(k, false);
+                    return;
+                }
+                if (i.icon != r.icon)
+                    i.icon = r.icon, changed |= NIF_ICON;
+            } else if (0 == i.icon || i.icon != r.icon) {
+                i.icon = r.icon, changed |= NIF_ICON;
+            }
+        }
+        if (r.flags & NIF_INFO)
+            changed |= NIF_ICON;
+
+        if (TRAYICON_MODIFIED == msg && was_hidden == i.hidden && 0 == (r.flags & NIF_INFO)) {
+            // merged until the timer or the next message of another kind
+            if (i.hidden || 0 == changed)
+                return;
+            bool any = false;
+            for (size_t n = 0; n < icons.size(); ++n)
+                any |= 0 != icons[n].pending;
+            if (false == any)
+                due = now + TRAY_COALESCE_DELAY;
+            i.pending |= changed;
+            ++queued;
+        } else {
+            flush();
+            send(k, changed, msg);
+        }
+    }
+};
+
+//===========================================================================
+
+// the tray and the model through a stream, with what it took
+static void replay(const std::vector<Record> &v, int *modifies, int *updates)
+{
+    Model m;
+    size_t i, k;
+    int bad = 0, view_bad = 0, hidden = 0;
+    systemTrayNode *p;
+
+    sent.clear();
+    plugin_bad = idle_ticks = 0;
+    now = 0, timer_on = false;
+    for (i = 0; i < v.size(); ++i) {
+        // the WM_TIMERs that come before the shell's next message
+        run_until(v[i].ms);
+        m.tick(now);
+        tray_event(v[i]);
+        m.event(v[i]);
+    }
+    run_until(INT_MAX);
+    m.flush();
+
+    CHECK(sent.size() == m.out.size());
+    for (k = 0; k < sent.size() && k < m.out.size(); ++k)
+        if (false == (sent[k] == m.out[k]) && ++bad < 5)
+            fprintf(stderr, "message %d: %u %d %X, model %u %d %X\n", (int)k,
+                sent[k].msg, sent[k].index, sent[k].changed,
+                m.out[k].msg, m.out[k].index, m.out[k].changed);
+    CHECK(0 == bad);
+    CHECK(0 == plugin_bad);
+    CHECK(0 == idle_ticks);
+
+    // the icons are the model's, in order, by index and by lookup
+    for (p = trayIconList, k = 0; k < m.icons.size(); ++k, p = p ? p->next : p) {
+        Icon &c = m.icons[k];
+        hidden += c.hidden;
+        if (NULL == p || (unsigned)(DWORD_PTR)p->hWnd != c.hwnd || p->uID != c.id
+            || find_icon(p->hWnd, p->uID) != p || nth_icon(m.index(k)) != (c.hidden ? NULL : p)
+            || c.tip != p->t.szTip)
+            ++view_bad;
+    }
+    CHECK(NULL == p && 0 == view_bad);
+    CHECK(tray_index_size() == (int)m.icons.size() - hidden);
+
+    *modifies = m.queued;
+    *updates = 0;
+    for (k = 0; k < sent.size(); ++k)
+        *updates += TRAYICON_MODIFIED == sent[k].msg;
+
+    while (trayIconList)
+        remove_icon(trayIconList, false);
+    tray_free_index();
+}
+
+static void test_recorded(void)
+{
+    std::vector<Record> v = read_stream(BBLEAN_DIR "/tests/tray_stream.txt");
+    int modifies, updates;
+
+    CHECK(v.size() > 300);
+    replay(v, &modifies, &updates);
+    printf("tray: %d shell messages, %d modifies sent as %d BB_TRAYUPDATEs\n",
+        (int)v.size(), modifies, updates);
+    // the download's progress is merged by far
+    CHECK(modifies > 200 && updates < modifies * 2 / 3);
+}
+
+// random streams of many icons, for the lookup's chains, with hidden,
+// shared and dead ones
+static void test_random(void)
+{
+    int round, n, modifies, updates;
+
+    for (round = 0; round < 300; ++round) {
+        std::vector<Record> v;
+        int icons = 1 + rnd(round < 100 ? 8 : 200), ms = 0;
+        for (n = 0; n < 400; ++n) {
+            Record r;
+            ms += rnd(4) ? rnd(8) : rnd(60);
+            r.ms = ms;
+            r.cmd = rnd(10) ? NIM_MODIFY : rnd(3) ? NIM_ADD : rnd(4) ? NIM_DELETE : NIM_SETVERSION;
+            // or all of one window, as some programs have them
+            if (round % 3) {
+                r.hwnd = 0x100 + 4 * rnd(1 + icons / 3);
+                r.id = rnd(4);
+            } else {
+                r.hwnd = 0x100;
+                r.id = rnd(icons);
+            }
+            r.alive = rnd(50);
+            r.flags = rnd(32);
+            r.mask = rnd(4);
+            r.state = rnd(5) ? 0 : rnd(4);
+            r.msg = 0x400 + rnd(3);
+            r.icon = rnd(8) ? 0x300 + rnd(6) : 0;
+            r.tip = rnd(3) ? "" : std::string(1, 'a' + rnd(4));
+            v.push_back(r);
+        }
+        replay(v, &modifies, &updates);
+    }
+}
+
+int main()
+{
+    test_recorded();
+    test_random();
+    return test_result("tray");
+}
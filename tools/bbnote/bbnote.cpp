@@ -68,6 +68,7 @@ extern char  My_Font[];
 
 extern char smart, tuse, ltup, syncolors, unix_eol;
 extern int tabs;
+extern int undomax;
 
 void makefonts(void);
 void deletefonts(void);
@@ -98,6 +99,7 @@ struct ini {
     { "colorized",      1, &syncolors },
     { "unix_eol",       1, &unix_eol },
     { "mousewheel",     4, &mousewheelfac },
+    { "undomemory",     4, &undomax },
 
     { "wx0", 2, &ewx0 },
     { "wy0", 2, &ewy0 },
@@ -793,7 +795,8 @@ struct button bts[] = {
     { "&files",   0, 182, 18,  24, 10,  0, BN_CHK, 0},
     { "&replace", 0, 210, 18,  40, 10,  0, BN_BTN, IDRPL},
     { seabuf,     0,   6,  5, 119, 10,  0, BN_EDT, 0},
-    { rplbuf,     0, 131,  5, 119, 10,  0, BN_EDT, 0},
+    { rplbuf,     0, 131,  5, 153, 10,  0, BN_EDT, 0},
+    { "&grep",    0, 254, 18,  30, 10,  0, BN_BTN, IDGREP},
     {NULL}
 };
 
@@ -980,7 +983,7 @@ int bb_search_dialog(HWND hwnd)
         return 0;
     }
 
-    dlg = fix_dlg (bts, 256, 32);
+    dlg = fix_dlg (bts, 290, 32);
 
     //place dialog to upper right corner
     GetWindowRect (ewnd, &r);
@@ -152,6 +152,8 @@
 #define CMD_NSEARCH  1101
 #define CMD_LOADFILE 1102
 #define CMD_GOTOLINE 1103
+#define CMD_GREPOUT  1104
+#define CMD_LOADMORE 1105
 
 #define CMD_PRJLIST    4000
 #define CMD_PRJLIST_M  4199
@@ -26,233 +26,6 @@ char bakdir=0;
 char unix_eol=0;
 
 #define BLS     4096
-#define EDSZ    (BLS*3)
-#define QFLSH   (BLS*2)
-#define BLN     2
-
-struct bufpage {
-    struct bufpage *next;
-    struct bufpage *prev;
-    int size;
-    char cont[BLS];
-};
-
-#define inbuff (buf_e-buf_a)
-
-/*----------------------------------------------------------------------------*/
-ST void ins_pg(void) {
-    struct bufpage *p;
-    p=(struct bufpage *)c_alloc(sizeof(struct bufpage));
-    p->next=next_pg;
-    p->prev=prev_pg;
-    if (NULL!=prev_pg) prev_pg->next=p;
-    if (NULL!=next_pg) next_pg->prev=p;
-    next_pg=p;
-}
-
-ST void del_pg(void) {
-    struct bufpage *p;
-    p=next_pg;
-    next_pg=p->next;
-    prev_pg=p->prev;
-    if (NULL!=prev_pg) prev_pg->next=next_pg;
-    if (NULL!=next_pg) next_pg->prev=prev_pg;
-    m_free(p);
-}
-
-ST int flush_out(int m) {
-    int l;
-    l=imin(inbuff,BLS);
-    ins_pg();
-    memmove(next_pg->cont,buffer+m,l);
-    next_pg->size=l;
-    return l;
-}
-
-ST void flush_last(void){
-    buf_e-=flush_out(inbuff-BLS);
-}
-
-ST void flush_first(void){
-    int o;
-    buf_a+=o=flush_out(0);
-    memmove(buffer,buffer+o,inbuff);
-    prev_pg=next_pg;
-    next_pg=next_pg->next;
-}
-
-ST void insert_first(void){
-    int s;
-    next_pg=prev_pg;
-    prev_pg=next_pg->prev;
-    s=next_pg->size;
-    memmove(buffer+s,buffer,inbuff);
-    memmove(buffer,next_pg->cont,s);
-    buf_a-=s;
-    del_pg();
-}
-
-ST void insert_last(void){
-    int s;
-    if (next_pg==NULL) return;
-    s=next_pg->size;
-    memmove(buffer+inbuff,next_pg->cont,s);
-    buf_e+=s;
-    del_pg();
-}
-
-ST void flush_all(void) {
-    for (;inbuff;) {
-        if (inbuff<BLS) insert_last();
-        flush_first();
-    }
-}
-
-ST struct bufpage *getstart(void) {
-    struct bufpage *p,*n;
-    n=next_pg; p=prev_pg;
-    for (;NULL!=p;p=(n=p)->prev);
-    return n;
-}
-
-ST void fill_buffer(int o){
-    struct bufpage *p,*n;
-    int i;
-    i=o/BLS; buf_a=buf_e=i*BLS;
-    p=NULL; n=getstart();
-    for (;i--;) n=(p=n)->next;
-    prev_pg=p; next_pg=n; i=BLN;
-    for (;i--;) insert_last();
-}
-
-ST void shift_dn(void) {
-    if (inbuff > EDSZ-BLS) flush_last();
-    insert_first();
-}
-
-ST void shift_up(void) {
-    if (inbuff > EDSZ-BLS) flush_first();
-    insert_last();
-}
-
-/*----------------------------------------------------------------------------*/
-ST char *getmem(int o) {
-
-    for (;o<buf_a;) {
-        if (buf_a-o>QFLSH) goto p2;
-        shift_dn();
-    }
-
-    for (;o+BLS>buf_e && flen>buf_e;) {
-        if (o+BLS-buf_e>QFLSH) goto p2;
-        shift_up();
-    }
-
-    goto p1;
-p2:
-    flush_all();
-    fill_buffer(o);
-p1:
-    return buffer+(o-buf_a);
-}
-
-/*----------------------------------------------------------------------------*/
-void insdelmem (int o, int len) {
-    int a,b,d,f; char *at,*to,*p;
-
-    f = len>0; if (!f) len=-len;
-
-    p=getmem(o);
-
-    for (;len;)
-    {
-        b=imin(BLS,len);
-        if (f)
-        {
-            if (inbuff+b>EDSZ)
-            {
-                if (o>=buf_a+BLS) flush_first(), p-=BLS;
-                else flush_last();
-            }
-            to=(at=p)+b,a=o,d=b;
-        }
-        else
-        {
-            at=(to=p)+b,a=o+b,d=-b;
-            if (a>buf_e) insert_last();
-        }
-
-        memmove(to,at,buf_e-a);
-
-        buf_e+=d, flen+=d, len-=b;
-    }
-}
-
-/*----------------------------------------------------------------------------*/
-void clear_buffer(void) {
-    struct bufpage *n=getstart();
-    freelist(&n);
-    next_pg = prev_pg = n;
-    buf_a   = buf_e   = 0;
-    u_reset();
-}
-
-struct edvars *new_buffer(void) {
-    return (struct edvars *)c_alloc(sizeof(struct edvars)-1+EDSZ);
-}
-
-/*----------------------------------------------------------------------------*/
-// buffer access
-
-unsigned char getchr(int o) {
-    if (o<buf_a || o>=buf_e) {
-        if (o<0 || o>=flen) return 0; 
-        return *getmem(o);
-    }
-    return *(buffer+(o-buf_a));
-}
-
-#if 0
-void setchr(int o, char c) {
-    if (o<0 || o>=flen) return;
-    *getmem(o)=c;
-    upd=1;
-}
-#endif
-
-void copyto(int dst, const char *src, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(dst);
-        memmove(p,src,b);
-        l-=b; src+=b; dst+=b;
-    }
-    upd=1;
-}
-
-void copyfrom(char *dst, int src, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(src);
-        memmove(dst,p,b);
-        l-=b; src+=b; dst+=b;
-    }
-}
-
-void clearchr(int dst, char c, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(dst);
-        memset(p,c,b);
-        l-=b; dst+=b;
-    }
-    upd=1;
-}
-
-/*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
 void revlist (void *d) {
@@ -325,12 +98,11 @@ HANDLE hopenfile(char *name, DWORD access, DWORD creation) {
 
 
 int getftime_0(char *fn, FILETIME *ft) {
-    HANDLE hf; int r;
-    hf=hopenfile(fn, 0, OPEN_EXISTING);
-    if (hf==NULL) return 0;
-    r=GetFileTime(hf, NULL, NULL, ft);
-    CloseHandle(hf);
-    return r!=0;
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    // no open here: a mapped file is held without sharing
+    if (0==GetFileAttributesEx(fn, GetFileExInfoStandard, &fad)) return 0;
+    *ft=fad.ftLastWriteTime;
+    return 1;
 }
 
 int getftime(void) {
@@ -469,55 +241,6 @@ int backupfile (char *org) {
     return 0;
 }
 
-/*----------------------------------------------------------------------------*/
-int loadfile(void) {
-
-    HANDLE fp;
-    char d,*r=NULL;
-    char *buf_i;
-    char *buf_o;
-    int a,b,n,k,e;
-    int p,tl;
-
-    flen=tl=a=b=e=0; k=tabs;
-
-    if (NULL==(buf_i = (char *)m_alloc (BLS))) goto end_0;
-    if (NULL==(buf_o = (char *)m_alloc (BLS))) goto end_1;
-    if ((fp = openf(filename))==NULL)  goto end_2;
-
-p0:
-    n=0;
-    for (;;) {
-        if (0==a && 0==(a=readf(fp, r=buf_i, BLS)))
-            break;
-
-        d=*r++, a--, b++;
-        switch (d) {
-        case 10: b=0; tl++; break;
-        case  9: d=(char)TABC; if (b%k) r--,a++; break;
-        case 13: b--; continue;
-        }
-        buf_o[n++]=d;
-        if (n>=BLS) {
-p2:
-            insdelmem(p=flen,n);
-            copyto(p, buf_o, n);
-            goto p0;
-        }
-    }
-    if (n) goto p2;
-    closef(fp);
-    getftime();
-    e=1;
-end_2:
-    m_free(buf_o);
-end_1:
-    m_free(buf_i);
-end_0:
-    tlin=tl;
-    return e;
-}
-
 /*----------------------------------------------------------------------------*/
 int is_makefile(const char *name)
 {
@@ -540,6 +263,10 @@ int savefile(char *name) {
     if (!tuse && !is_makefile(name))
         k = 0;
 
+    load_finish();
+    if (0==_stricmp(name, filename))
+        detach_file();
+
     if (0==backupfile(name)) goto end_0;
 
     if (NULL==(buf_o = (char *)m_alloc (BLS))) goto end_0;
@@ -646,6 +373,7 @@ void NewFile(void) {
 void delfile(void) {
     struct edvars *p;
     if (NULL==(p=get_prev())) p=edp->next;
+    grep_closed(edp);
     clear_buffer();
     delitem(&ed0,edp);
     edp=p;
@@ -708,16 +436,18 @@ int SaveFile(LPSTR pszFileName) {
 void clean_up(void) {
     void freehash(void);
     void clrcfg(void);
+    void rx_free(void);
 
     while(NULL!=edp)
         delfile();
     clrcfg();
     freehash();
+    rx_free();
 
 #ifdef BBOPT_MEMCHECK
     int n = m_alloc_size() - clip_s;
     if (ownd)
-        n-=sizeof(struct edvars)+EDSZ;
+        n-=sizeof(struct edvars);
     if (0!=n) {
         char buf[40];
         sprintf(buf,"alloc = %d", n);
@@ -924,31 +654,17 @@ int do_search (int msg, DWORD param)
             return 1;
 
 
-        case IDGREP: {
-            char *buf, *p, *s, c, d, e;
-            const char *q;
-            p=buf=(char*)m_alloc(1000), s=grep_cmd, d=16;
-            do {
-                q="(:)";
-                if (*q==(c=*s++))
-                    for (e=d&seamodeflg, d<<=1; *++q; e=!e)
-                      for (;(c=*s++)!=*q;) {
-                        if (0==c) goto se;
-                        if (e) *p++=c;
-                      }
-                else
-                if (c=='%') {
-                    if ((c=*s++)=='%') goto se;
-                    p+=strlen(strcpy(p,c=='2'?(rplbuf[0]?rplbuf:"*"):seabuf));
-                }
-                else
-                se: *p++=c;
-            } while(c);
-
-            SendMessage(hwnd,WM_COMMAND,CMD_RUNTOOL,(LPARAM)buf);
-
-            m_free(buf);
+        case IDGREP:
+            if (grep_busy()) {
+                grep_stop();
+                return 1;
+            }
+            if (seabuf[0]==0) return 1;
+            if (grep_start(hwnd,seabuf,seamodeflg,rplbuf)<0) {
+                sprintf(tmpbuf,"error in pattern '%s'", seabuf);
+                InfoMsg(tmpbuf);
             }
+            SendMessage(hwnd,WM_COMMAND,CMD_UPD,0);
             return 1;
 
         default:
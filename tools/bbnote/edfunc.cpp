@@ -204,98 +204,189 @@ void unmark(void) {
 /*----------------------------------------------------------------------------*/
 // undo / redo
 
+// Undo and redo are journals: the records in an array, oldest first,
+// and what was deleted in a text arena that grows and shrinks with it.
+// An insert or delete next to the one before in the same command is
+// added to that. When undo takes more than 'undomax' KB, the oldest
+// commands are dropped.
+
 #define UD_INS 1
 #define UD_DEL 2
 #define UD_POS 3
 #define UD_CHG 4
 
-typedef struct undo_s {
-    struct undo_s *next;
+struct urec {
     int p;
     int l;
+    int t;      // UD_DEL: the text in the arena
     char cmd;
-    char buf[1];
-} sud;
-
-sud **u_pp;
+};
+
+int undomax = 16384; // KB
+
+struct ujour *u_pp;
+
+ST int u_size(struct ujour *u) {
+    return u->n*sizeof(struct urec)+u->used;
+}
+
+// drop the records before 'k' and their text
+ST void u_drop(struct ujour *u, int k) {
+    int i,t;
+    for (i=k;i<u->n && u->r[i].cmd!=UD_DEL;i++);
+    t=i<u->n ? u->r[i].t : u->used;
+    for (;i<u->n;i++)
+        u->r[i].t-=t;
+    memmove(u->r,u->r+k,(u->n-=k)*sizeof(struct urec));
+    memmove(u->text,u->text+t,u->used-=t);
+}
+
+// drop whole commands from the start, down to 3/4 of the limit. The
+// command in the works stays, even if it alone is more.
+ST void u_limit(struct ujour *u) {
+    int max=undomax*1024,d,i,k,s;
+    if (max<=0 || u_size(u)<=max) return;
+    d=u_size(u)-max/4*3;
+    for (i=k=s=0;i<u->n-1;i++) {
+        s+=sizeof(struct urec);
+        if (u->r[i].cmd==UD_DEL) s+=u->r[i].l;
+        if (u->r[i].cmd>=UD_POS) {
+            k=i+1;
+            if (s>=d) break;
+        }
+    }
+    if (k) u_drop(u,k);
+}
 
-sud *u_add(int cmd, int p, int l, int b) {
-    sud *up;
+ST struct urec *u_add(int cmd, int p, int l) {
+    struct ujour *u=u_pp; struct urec *r;
 
     if (winflg&1) return NULL;
 
-    if (NULL!=(up=(struct undo_s *)m_alloc(sizeof(sud)+b))) {
-        up->next = *u_pp;
-        *u_pp    = up;
-        up->p    = p;
-        up->l    = l;
-        up->cmd  = cmd;
+    if (u->n==u->rmax) {
+        u->rmax=imax(64,u->rmax*2);
+        u->r=(struct urec*)m_realloc(u->r,u->rmax*sizeof(struct urec));
     }
-    return up;
+    r=u->r+u->n++;
+    r->p   = p;
+    r->l   = l;
+    r->t   = 0;
+    r->cmd = cmd;
+    u->seq++;
+    if (u==&undo_l) // redo holds no more than what was undone
+        u_limit(u);
+    return u->r+u->n-1;
+}
+
+// the last record, if it is a 'cmd' of the command in the works
+ST struct urec *u_last(int cmd) {
+    struct ujour *u=u_pp; struct urec *r;
+    if ((winflg&1) || 0==u->n) return NULL;
+    r=u->r+u->n-1;
+    return r->cmd==cmd ? r : NULL;
+}
+
+// room for 'l' more bytes of text
+ST char *u_text(struct ujour *u, int l) {
+    if (u->used+l>u->tmax) {
+        u->tmax=imax(u->used+l,imax(4096,u->tmax*2));
+        u->text=(char*)m_realloc(u->text,u->tmax);
+    }
+    return u->text+u->used;
+}
+
+ST void u_pop(struct ujour *u) {
+    struct urec *r=u->r+--u->n;
+    if (r->cmd==UD_DEL) u->used=r->t;
+}
+
+ST void u_free(struct ujour *u) {
+    m_free(u->r);
+    m_free(u->text);
+    memset(u,0,sizeof *u);
 }
 
 void u_setchg(int c) {
-    sud *up; int i;
-    for (i=0, up=undo_l; i<2; i++, up=redo_l)
-        for (;NULL!=up; up=up->next)
-            if (up->cmd==UD_POS)
-                up->cmd=UD_CHG;
+    struct ujour *u; int i,k;
+    for (i=0, u=&undo_l; i<2; i++, u=&redo_l)
+        for (k=0;k<u->n;k++)
+            if (u->r[k].cmd==UD_POS)
+                u->r[k].cmd=UD_CHG;
     chg=c;
 }
 
 
 void u_check(int a,int b) {     // called at exit of 'do-edit-cmd(int cmd)'
-    u_add(UD_POS+chg,a,b,0);
+    u_add(UD_POS+chg,a,b);
 
 }
 
 void u_reset(void) {            // called from 'close-the-file()'
-    freelist(&undo_l);
-    freelist(&redo_l);
+    u_free(&undo_l);
+    u_free(&redo_l);
 }
 
 void u_ins (int p, int l) {     // called from 'inschr(int pos, int cnt, char *what)'
-    u_add(UD_INS,p,l,0);
+    struct urec *r=u_last(UD_INS);
+    if (r && p>=r->p && p<=r->p+r->l)
+        r->l+=l, u_pp->seq++;
+    else
+        u_add(UD_INS,p,l);
 }
 
 void u_del (int p, int l) {     // called from 'delchr(int pos, int cnt)'
-    sud *up=u_add(UD_DEL,p,l,l);
-    if (NULL!=up) copyfrom(up->buf, p, l);
+    struct ujour *u=u_pp; struct urec *r=u_last(UD_DEL); char *q;
+    if (r && p==r->p) {         // delete
+        copyfrom(u_text(u,l), p, l);
+    } else if (r && p+l==r->p) { // backspace
+        u_text(u,l);
+        q=u->text+r->t;
+        memmove(q+l, q, r->l);
+        copyfrom(q, p, l);
+        r->p=p;
+    } else {
+        if (NULL==(r=u_add(UD_DEL,p,0)))
+            return;
+        copyfrom(u_text(u,l), p, l);
+        r->t=u->used;
+    }
+    r->l+=l, u->used+=l, u->seq++;
 }
 
 static char msg_undo[]={'u','n'};
 static char msg_redo[]={'r','e'};
 static char msg_nour[]="nothing to ..do";
 
-void unredo(sud **u_p1, sud **u_p2, char *m) { // the one and only undo-redo
-    sud *up; int p,l,a,e,c;
+void unredo(struct ujour *u1, struct ujour *u2, char *m) { // the one and only undo-redo
+    struct urec *r; int p,l,a,e,c;
 
-    if (NULL==(up=*u_p1)) {
+    if (0==u1->n) {
         *(short*)(msg_nour+sizeof(msg_nour)-5) = *(short*)m;
         InfoMsg(msg_nour);
         return;
     }
 
-    if ((a=e=up->l)!=fpos) // if not in sight
+    r=u1->r+u1->n-1;
+    if ((a=e=r->l)!=fpos) // if not in sight
         goto p1;
 
-    a=up->p;  c=up->cmd-UD_POS;  u_pp=u_p2;
+    a=r->p;  c=r->cmd-UD_POS;  u_pp=u2;
 
     for (;;) {
-        *u_p1=up->next; m_free(up);
+        u_pop(u1);
 
-        if (NULL==(up=*u_p1) || UD_POS<=up->cmd)  break;
+        if (0==u1->n || UD_POS<=(r=u1->r+u1->n-1)->cmd)  break;
 
-        p=up->p, l=up->l;
+        p=r->p, l=r->l;
 
-        switch (up->cmd) {
+        switch (r->cmd) {
 
         case UD_INS:
             delchr(p, l);
             break;
 
         case UD_DEL:
-            inschr(p, l, up->buf);
+            inschr(p, l, u1->text+r->t);
             break;
         }
     }
@@ -504,7 +595,7 @@ void inschr(int o, int n, const char *p) {
     if (NULL==p) clearchr(o,' ',n);
     else         copyto(o,p,n);
 
-    tlin+=(l=cntlf(o,o+n));
+    l=tlin, tlin=lix_count(), l=tlin-l;
 
     if (fpga>o) fpga+=n, plin+=l;
     fixmark(o,o+1,n);
@@ -517,45 +608,44 @@ void delchr(int a, int n) {
     if (n<=0) return;
     e = a + n;
 
-    tlin-=(l=cntlf(a, e));
+    u_del(a, n);
+    insdelmem (a, -n);
+    l=tlin, tlin=lix_count(), l-=tlin;
     if (fpga>a) {
         if (fpga>=e) fpga-=n,  plin-=l;
-        else         plin-=cntlf(a,fpga),fpga=fixline(a);
+        else         fpga=fixline(a), plin=lix_line(fpga);
     }
-    u_del(a, n);
-    insdelmem (a, -n);
     upd=1;
     fixmark(e, e, -n);
 }
 
 /*----------------------------------------------------------------------------*/
 // basic next/prev line
+// Short distances are scanned directly, longer ones go to the line index.
+
+#define LF_NEAR 4096
 
 int nextline_v(int o, int n, int *v) {
-    int w=0,a;
-    for (;n--;) {
-        a=o;
-        for (;;) {
-            if (o==flen) { o=a; goto p1; }
-            if (getchr(o++)==10) break;
-        }
-        w++;
-    }
+    int w=0,k,l;
+    if (n<=0) goto p1;
+    k=n, l=lix_fwd(o,imin(flen,o+LF_NEAR),&k);
+    if (k==0) { w=n, o=l; goto p1; }
+    l=lix_line(o);
+    w=imin(n,lix_count()-l);
+    if (w) o=lix_offset(l+w);
 p1:
     if (v!=NULL) *v=w;
     return o;
 }
 
 int prevline_v(int o, int n, int *v) {
-    int w=0;
-    for (;;) {
-        for (;;) {
-            if (o==0) goto p1;
-            if (getchr(--o)==10) break;
-        }
-        if (n--==0) { o++; break; }
-        w++;
-    }
+    int w,k,l,a;
+    k=n+1, a=imax(0,o-LF_NEAR), l=lix_back(o,a,&k);
+    if (k==0) { w=n, o=l+1; goto p1; }
+    if (a==0) { w=n+1-k, o=0; goto p1; }
+    l=lix_line(o);
+    w=imin(n,l);
+    o=lix_offset(l-w);
 p1:
     if (v!=NULL) *v=w;
     return o;
@@ -574,9 +664,11 @@ int fixline (int p) {
 }
 
 int linelen(int o) {
-    int m=o;
-    for (;m<flen && getchr(m)!=10;m++);
-    return m-o;
+    int k=1,e=imin(flen,o+LF_NEAR),m=lix_fwd(o,e,&k);
+    if (k==0) return m-1-o;
+    if (e==flen) return flen-o;
+    m=lix_line(o);
+    return (m<lix_count() ? lix_offset(m+1)-1 : flen) - o;
 }
 
 int movpage(int n) {
@@ -627,10 +719,11 @@ void inschr_tab(int lp, int o, int k, int n, char *q) {
 // count lines
 
 int cntlf(int a, int e) {
-    int r=0;
-    for (;a<e;a++)
-        if (getchr(a)==10) r++;
-    return r;
+    int k;
+    if (a>=e) return 0;
+    if (e-a>LF_NEAR) return lix_line(e)-lix_line(a);
+    k=e-a, lix_fwd(a,e,&k);
+    return e-a-k;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1570,7 +1663,7 @@ p2: // unterhalb
 
 p1:
     upd = 1;
-    plin = cntlf(0,fpga);
+    plin = lix_line(fpga);
 p0: // alles klar
     cury = cntlf(fpga,lpos);
     curx = fpos-lpos;
@@ -1697,12 +1790,12 @@ void ed_mark(int a, int b) {
 
 /*----------------------------------------------------------------------------*/
 void ed_cmd (int cmd, ...) {
-    int a,b,c,d; void *u; va_list vl;
+    int a,b,c,d; unsigned u; va_list vl;
 
     if (edp==NULL) return;
 
     a=fpos;
-    u=*(u_pp=&undo_l);
+    u=(u_pp=&undo_l)->seq;
 
     va_start(vl,cmd);
 
@@ -1817,9 +1910,9 @@ void ed_cmd (int cmd, ...) {
 
     ed_fixup();
 
-    if (u!=undo_l) {
+    if (u!=undo_l.seq) {
         u_check(a,fpos);
-        freelist(&redo_l);
+        u_free(&redo_l);
         chg=1;
     }
 }
@@ -1864,13 +1957,186 @@ int r_getchr(int o) {
     return c;
 }
 
+/*----------------------------------------------------------------------------*/
+// literal search: memchr for the rarest char of the string through the
+// text in memory, then compare the rest
+
+#define LIT_WIN 4096 // memchr this far at once, it is called per match
+
+ST int lit_rank(unsigned char c) {
+    static const char f[]="etaoinsrhldcumfpgwybvkxjqz";
+    if (c==' ' || c==TABC) return 60;
+    if (c>='a' && c<='z') return 50-(strchr(f,c)-f);
+    if (c>='A' && c<='Z') return 10;
+    if (c>='0' && c<='9') return 20;
+    return 5;
+}
+
+void lit_init(struct lit *L, void *lo, void *up, int n) {
+    int i,r,b;
+    L->lo=(unsigned char*)lo, L->up=(unsigned char*)up, L->n=n, L->j=0;
+    for (i=0,b=1000;i<n;i++) {
+        r=lit_rank(L->lo[i]);
+        if (L->up[i]!=L->lo[i]) r+=lit_rank(L->up[i]);
+        if (r<b) b=r, L->j=i;
+    }
+}
+
+ST int lit_match(struct lit *L, int s) {
+    unsigned char c; int i;
+    for (i=0;i<L->n;i++)
+        if ((c=getchr(s+i))!=L->lo[i] && c!=L->up[i])
+            return 0;
+    return 1;
+}
+
+// first match starting at or after 'm', or -1
+ST int lit_fwd(struct lit *L, int m) {
+    const char *p,*x,*y,*q; int a,b,o,l,e,j=L->j;
+    unsigned char c1=L->lo[j], c2=L->up[j];
+
+    e=flen-L->n+1+j; // where the anchor char can be
+    for (o=m+j;o<e;o+=l) {
+        p=getspan(o,&a,&b);
+        l=imin(imin(b,e)-o,LIT_WIN);
+        x=(const char*)memchr(p,c1,l);
+        y=c1==c2?x:(const char*)memchr(p,c2,l);
+        for (;;) {
+            q=NULL==x?y:NULL==y||x<y?x:y;
+            if (NULL==q)
+                break;
+            if (lit_match(L,o+(q-p)-j))
+                return o+(q-p)-j;
+            if (q==x) x=(const char*)memchr(q+1,c1,l-(q+1-p));
+            if (c1==c2) y=x;
+            else if (q==y) y=(const char*)memchr(q+1,c2,l-(q+1-p));
+        }
+    }
+    return -1;
+}
+
+// first match in memory from p to p+n, or -1
+int lit_mem(struct lit *L, const char *p, int n) {
+    const char *x,*y,*q,*w,*e; int i,j=L->j;
+    unsigned char c1=L->lo[j], c2=L->up[j];
+
+    e=p+n-L->n+1+j; // where the anchor char can be
+    for (w=p+j;w<e;w+=LIT_WIN) {
+        n=imin(e-w,LIT_WIN);
+        x=(const char*)memchr(w,c1,n);
+        y=c1==c2?x:(const char*)memchr(w,c2,n);
+        for (;;) {
+            q=NULL==x?y:NULL==y||x<y?x:y;
+            if (NULL==q)
+                break;
+            for (i=0;i<L->n;i++)
+                if ((unsigned char)q[i-j]!=L->lo[i] && (unsigned char)q[i-j]!=L->up[i])
+                    break;
+            if (i==L->n)
+                return q-j-p;
+            if (q==x) x=(const char*)memchr(q+1,c1,n-(q+1-w));
+            if (c1==c2) y=x;
+            else if (q==y) y=(const char*)memchr(q+1,c2,n-(q+1-w));
+        }
+    }
+    return -1;
+}
+
+// last match starting at or before 'm', or -1
+ST int lit_back(struct lit *L, int m) {
+    const unsigned char *p; int a,b,o,j=L->j;
+    unsigned char c1=L->lo[j], c2=L->up[j];
+
+    for (o=imin(m,flen-L->n)+j;o>=j;) {
+        p=(const unsigned char*)getspan(o,&a,&b);
+        for (a=imax(a,j);o>=a;o--,p--)
+            if ((*p==c1 || *p==c2) && lit_match(L,o-j))
+                return o-j;
+    }
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+// regular expressions: the lazy DFA from match3.cpp, with rmatch() when
+// it runs out of states and for the captures
+
+ST int rx_match(struct rdfa **d, int m, unsigned char *code) {
+    int n;
+    if (*d) {
+        if ((n=rdfa_match(*d,m,0,flen,r_getchr))>=0)
+            return n;
+        rdfa_free(*d), *d=NULL;
+    }
+    return rmatch(m,0,flen,code,res,r_getchr);
+}
+
+// The expression of the last search, compiled, with its DFA and the
+// chars a match can start with. F3 searches with it again, so the
+// states made so far are used again too.
+ST struct rx_cache {
+    char *str;
+    int cf, len, pn;
+    unsigned char *code;
+    struct rdfa *d;
+    char lo[128], up[128];
+    unsigned char first[256];
+} rxc;
+
+void rx_free(void) {
+    if (rxc.d) rdfa_free(rxc.d);
+    m_free(rxc.code);
+    m_free(rxc.str);
+    memset(&rxc, 0, sizeof rxc);
+}
+
+ST struct rx_cache *rx_compile(const char *q, int cf) {
+    unsigned char set[256]; int n,o;
+
+    if (rxc.code && rxc.cf==cf && 0==strcmp(rxc.str,q)) {
+        // rx_match dropped it, when it ran out of states
+        if (NULL==rxc.d)
+            rxc.d=rdfa_new(rxc.code,rxc.len);
+        return &rxc;
+    }
+
+    rx_free();
+    o=rcomp((unsigned char*)q,NULL,0,cf);
+    if (o==0) return NULL;
+    rxc.code=(unsigned char*)m_alloc(o);
+    rcomp((unsigned char*)q,rxc.code,o,cf);
+    rxc.str=strcpy((char*)m_alloc(strlen(q)+1),q);
+    rxc.cf=cf, rxc.len=o;
+    rxc.d=rdfa_new(rxc.code,o);
+
+    // where a match can start: at the literal it starts with, if any,
+    // else at the chars the DFA takes first
+    rxc.pn=rprefix(rxc.code,(unsigned char*)rxc.lo,(unsigned char*)rxc.up,sizeof rxc.lo);
+    if (0==rxc.pn) {
+        rdfa_first(rxc.d,set);
+        for (n=0;n<256;n++) rxc.first[n]=set[n==TABC?' ':n];
+    }
+    return &rxc;
+}
+
+// next position that can start a match
+ST int rx_skip(unsigned char *first, int m) {
+    const unsigned char *p; int a,e,l;
+    for (;m<flen;m+=l) {
+        p=(const unsigned char*)getspan(m,&a,&e);
+        for (l=e-m;l && 0==first[*p];l--,p++,m++);
+        if (l) return m;
+    }
+    return -1;
+}
+
 int ed_search(struct sea *sea) {
     int m=sea->from; char* q=sea->str; int sf=sea->sf;
-    int i,k,n,o,fl;
-    char *p,e;
+    int i,k,n,o,fl,pn;
+    char *p;
     char bstr[128];
     char cstr[128];
-    unsigned char *code;
+    struct rx_cache *rx;
+    struct lit L;
     static int pmat;
 
     k=1; i=fl=flen;
@@ -1884,16 +2150,14 @@ int ed_search(struct sea *sea) {
     if (0==(sf&16))             //ignore case
         _strlwr(q), _strupr(p);
 
-    for (;m!=i;m+=k)
-        if ((e=getchr(m))==q[0]||e==p[0])
-            for (o=m+(n=1);;o++,n++) {
-                if (q[n]==0) {
-                    if ((sf&32) && !checkword(m,o)) break; //words
-                    goto s01;
-                }
-                if (o>=fl || ((e=getchr(o))!=q[n] && e!=p[n])) break;
-            }
-    return 0;
+    if (0==(n=strlen(q))) return 0;
+    lit_init(&L,q,p,n);
+    for (;;m+=k) {
+        m=k>0 ? lit_fwd(&L,m) : lit_back(&L,m);
+        if (m<0) return 0;
+        o=m+n;
+        if (0==(sf&32) || checkword(m,o)) break; //words
+    }
 s01:
     sea->a=m;
     sea->e=o;
@@ -1906,16 +2170,19 @@ regsearch:
 
     if (m>=fl) return 0;
 
-    for (n=0,code=NULL;;) {
-        o=rcomp((unsigned char*)q,code,n,(sf&16)==0); //ignore case
-        if (o==0) return -1;
-        if (n) break;
-        code=(unsigned char*)m_alloc(n=o);
-    }
-    cres=code[0];
+    rx=rx_compile(q,(sf&16)==0); //ignore case
+    if (NULL==rx) return -1;
+    cres=rx->code[0];
+    if (0!=(pn=rx->pn))
+        lit_init(&L,rx->lo,rx->up,pn);
+
     for (;m!=i;m+=k) {
+        if (k>0) {
+            m=pn ? lit_fwd(&L,m) : rx_skip(rx->first,m);
+            if (m<0) break;
+        }
         for (o=0;;o=n,m--) {
-            n=rmatch(m,0,fl,code,res,r_getchr);
+            n=rx_match(&rx->d,m,rx->code);
             if (n<=o || k>0 || m==0) break;
         }
         if (o>n) n=o, m++;
@@ -1925,7 +2192,8 @@ regsearch:
         pmat=n;
         break;
     }
-    m_free(code);
+    if (pmat && cres)
+        rmatch(m,0,fl,rx->code,res,r_getchr);
     if (pmat) goto s01;
     return 0;
 }
@@ -0,0 +1,562 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDGREP.C - find in files
+
+// Searches like ed_search() does (case, words, regex) in the files of a
+// directory tree, or in the open buffers, and lists the lines found in
+// a buffer "find results". Doubleclick on a line there to go to it.
+//
+// A walker thread lists the tree and queues the files for a few worker
+// threads, which map one file at a time and search it in memory. Found
+// lines are posted in blocks to the editor window and appended to the
+// results as they come. The open buffers are searched on the main
+// thread, as they are not to be read while being edited.
+//
+// The threads use malloc, as m_alloc with BBOPT_MEMCHECK is not thread
+// safe. rcomp() is not either, the regex is compiled on the main thread
+// and each worker makes its own DFA from it.
+
+#include "edstruct.h"
+#include <ctype.h>
+
+#define GREP_THREADS    8           // workers, at most
+#define GREP_VIEW       (64<<20)    // map big files in views this large
+#define GREP_MORE       (1<<16)     // ...plus this before and after
+#define GREP_BIN        4096        // a 0 in there means a binary file
+#define GREP_LINE       200         // show this much of a line
+#define GREP_OUT        (MAX_PATH+GREP_LINE+32)
+#define GREP_BLOCK      4096        // post the results when this full
+#define GREP_POST       50          // ...or after this many ms
+
+struct gfile {
+    struct gfile *next;
+    char name[1];
+};
+
+struct gjob {
+    HWND hwnd;
+    int gen;
+    volatile LONG stop;
+    int sf;
+
+    struct lit L;                   // the string, or the regex prefix
+    unsigned char lo[128], up[128];
+    unsigned char *code;            // the regex
+    int clen;
+    unsigned char first[256];       // chars where a regex match can start
+
+    char dir[MAX_PATH];
+    char mask[128];
+
+    CRITICAL_SECTION cs;            // for the queue and rmatch()
+    HANDLE sem;                     // counts the queue, +1 per worker at the end
+    struct gfile *head, **tail;
+    HANDLE walker;
+    HANDLE worker[GREP_THREADS];
+    int nw;
+
+    LONG files, hitfiles, found;
+    DWORD t0;
+};
+
+struct gout {
+    int n;
+    char text[1];
+};
+
+// what a worker has
+struct gwork {
+    struct gjob *j;
+    struct rdfa *d;
+    struct gout *o;
+    DWORD posted;
+    const char *name;
+    int line, skip, hits;
+};
+
+ST struct gjob *g_job;
+ST int g_gen;
+ST struct edvars *g_ed;
+ST const unsigned char *g_text;
+
+/*----------------------------------------------------------------------------*/
+// "*.ini;*.txt"
+
+ST int g_wild(const char *p, const char *s) {
+    for (;*p && *p!=';';p++,s++) {
+        if (*p=='*') {
+            for (;;s++) {
+                if (g_wild(p+1,s)) return 1;
+                if (0==*s) return 0;
+            }
+        }
+        if (0==*s || (*p!='?' && tolower((unsigned char)*p)!=tolower((unsigned char)*s)))
+            return 0;
+    }
+    return 0==*s;
+}
+
+ST int g_mask(const char *m, const char *s) {
+    for (;;m++) {
+        if (g_wild(m,s)) return 1;
+        if (NULL==(m=strchr(m,';'))) return 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+// the search, in memory
+
+#define g_alnum(c) (isalnum(c) || (c)=='_')
+
+ST int g_word(const unsigned char *p, int a, int e, int len) {
+    return !((a && g_alnum(p[a-1])) || (e<len && g_alnum(p[e])));
+}
+
+ST int g_getchr(int o) {
+    int c=g_text[o];
+    return c==9 ? ' ' : c;
+}
+
+ST int g_rx(struct gwork *w, const unsigned char *p, int m, int len) {
+    struct gjob *j=w->j; struct rmres res[16]; int n;
+    if (w->d) {
+        if ((n=rdfa_mem(w->d,p,m,0,len))>=0)
+            return n;
+        // out of states, start over with an empty DFA
+        rdfa_free(w->d), w->d=rdfa_new(j->code,j->clen);
+        if ((n=rdfa_mem(w->d,p,m,0,len))>=0)
+            return n;
+    }
+    EnterCriticalSection(&j->cs);
+    g_text=p;
+    n=rmatch(m,0,len,j->code,res,g_getchr);
+    LeaveCriticalSection(&j->cs);
+    return n;
+}
+
+// first match that starts from 's' up to 'lim', or -1
+ST int g_find(struct gwork *w, const unsigned char *p, int s, int lim, int len, int *n) {
+    struct gjob *j=w->j; int m,k;
+    for (m=s;m<lim;m++) {
+        if (j->L.n) {
+            if ((k=lit_mem(&j->L,(const char*)p+m,len-m))<0)
+                return -1;
+            m+=k, k=j->L.n;
+        } else
+            for (;m<lim && 0==j->first[p[m]];m++);
+        if (m>=lim)
+            return -1;
+        if (j->code && (k=g_rx(w,p,m,len))<=0)
+            continue;
+        if ((j->sf&32) && !g_word(p,m,m+k,len))
+            continue;
+        *n=k;
+        return m;
+    }
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+// the results
+
+// "name(line): text", returns the length
+ST int g_format(char *d, const char *name, int line, const unsigned char *p, int n, int cut) {
+    char *q=d+sprintf(d,"%s(%d): %s",name,line,cut?"...":"");
+    for (;n;n--,p++) *q++ = *p==9 || *p==13 ? ' ' : *p ? *p : '.';
+    *q++=10;
+    return q-d;
+}
+
+// cut the line around 'm' to what is shown
+ST int g_cut(const unsigned char *p, int m, int len, int *a, int *e) {
+    const unsigned char *q; int cut;
+    for (*a=m;*a>0 && *a>m-GREP_LINE/2 && p[*a-1]!=10;--*a);
+    cut=*a>0 && p[*a-1]!=10;
+    q=(const unsigned char*)memchr(p+m,10,len-m);
+    *e=q ? q-p : len;
+    return cut;
+}
+
+ST void g_flush(struct gwork *w) {
+    if (NULL==w->o) return;
+    if (0==PostMessage(w->j->hwnd,CMD_GREPOUT,w->j->gen,(LPARAM)w->o))
+        free(w->o);
+    w->o=NULL;
+    w->posted=GetTickCount();
+}
+
+ST void g_put(struct gwork *w, const unsigned char *p, int m, int len) {
+    int a,e,t,cut;
+    cut=g_cut(p,m,len,&a,&e);
+    t=imin(e,a+GREP_LINE);
+    if (t>a && p[t-1]==13) t--;
+    if (NULL==w->o)
+        w->o=(struct gout*)malloc(sizeof(struct gout)+GREP_BLOCK+GREP_OUT), w->o->n=0;
+    w->o->n+=g_format(w->o->text+w->o->n,w->name,w->line,p+a,t-a,cut);
+    if (w->o->n>=GREP_BLOCK)
+        g_flush(w);
+}
+
+ST int g_lines(const unsigned char *p, int n) {
+    int r=0;
+    for (;n;n--) r+=*p++==10; // lines are short, memchr costs more
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
+// the workers
+
+// search a view of the file. Matches that start from 'pre' up to 'lim'
+// count, the rest is there to see the whole line.
+ST void g_view(struct gwork *w, const unsigned char *p, int pre, int lim, int len) {
+    int m,n,s,lp; const unsigned char *q;
+    s=imax(pre,w->skip), lp=pre;
+    while (0==w->j->stop && (m=g_find(w,p,s,lim,len,&n))>=0) {
+        w->line+=g_lines(p+lp,m-lp), lp=m;
+        g_put(w,p,m,len);
+        InterlockedIncrement(&w->j->found);
+        w->hits++;
+        // one line is listed once
+        q=(const unsigned char*)memchr(p+m,10,len-m);
+        s=q ? q-p+1 : len;
+    }
+    if (lim<len) // the next view needs the line number
+        w->line+=g_lines(p+lp,lim-lp);
+    w->skip=GREP_MORE+imax(0,s-lim);
+}
+
+ST void g_file(struct gwork *w, const char *name) {
+    struct gjob *j=w->j; HANDLE hf,hm; DWORD hi;
+    unsigned long long size,off; const unsigned char *p; int pre,len;
+
+    hf=CreateFile(name,GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+        NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+    if (hf==INVALID_HANDLE_VALUE)
+        return;
+    size=GetFileSize(hf,&hi);
+    size|=(unsigned long long)hi<<32;
+    InterlockedIncrement(&j->files);
+    if (size && NULL!=(hm=CreateFileMapping(hf,NULL,PAGE_READONLY,0,0,NULL))) {
+        w->name=name, w->line=1, w->skip=0, w->hits=0;
+        for (off=0;off<size && 0==j->stop;off+=GREP_VIEW) {
+            pre=off ? GREP_MORE : 0;
+            len=size-off<GREP_VIEW+GREP_MORE ? (int)(size-off)+pre : GREP_VIEW+GREP_MORE+pre;
+            p=(const unsigned char*)MapViewOfFile(hm,FILE_MAP_READ,
+                (DWORD)((off-pre)>>32),(DWORD)(off-pre),len);
+            if (NULL==p)
+                break;
+            if (0==off && memchr(p,0,imin(len,GREP_BIN))) {
+                UnmapViewOfFile(p);
+                break;
+            }
+            g_view(w,p,pre,imin(len,pre+GREP_VIEW),len);
+            UnmapViewOfFile(p);
+        }
+        if (w->hits)
+            InterlockedIncrement(&j->hitfiles);
+        if (w->o && GetTickCount()-w->posted>=GREP_POST)
+            g_flush(w);
+        CloseHandle(hm);
+    }
+    CloseHandle(hf);
+}
+
+ST DWORD WINAPI g_worker(void *arg) {
+    struct gjob *j=(struct gjob*)arg; struct gwork w; struct gfile *f; int more;
+    memset(&w,0,sizeof w);
+    w.j=j, w.posted=GetTickCount();
+    if (j->code)
+        w.d=rdfa_new(j->code,j->clen);
+    for (;;) {
+        WaitForSingleObject(j->sem,INFINITE);
+        EnterCriticalSection(&j->cs);
+        if (NULL!=(f=j->head) && NULL==(j->head=f->next))
+            j->tail=&j->head;
+        more=NULL!=j->head;
+        LeaveCriticalSection(&j->cs);
+        if (NULL==f) // the walker is done
+            break;
+        if (0==j->stop)
+            g_file(&w,f->name);
+        free(f);
+        if (0==more) // show what we have while waiting
+            g_flush(&w);
+    }
+    g_flush(&w);
+    if (w.d)
+        rdfa_free(w.d);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+// the walker
+
+ST void g_walk(struct gjob *j, char *path, int n) {
+    WIN32_FIND_DATA fd; HANDLE h; struct gfile *f; const char *s; int l;
+
+    strcpy(path+n,"\\*");
+    if (INVALID_HANDLE_VALUE==(h=FindFirstFile(path,&fd)))
+        return;
+    do {
+        s=fd.cFileName, l=strlen(s);
+        if (n+2+l>MAX_PATH)
+            continue;
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (0==strcmp(s,".") || 0==strcmp(s,".."))
+                continue;
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+                continue;
+            path[n]='\\', strcpy(path+n+1,s);
+            g_walk(j,path,n+1+l);
+            continue;
+        }
+        if (0==g_mask(j->mask,s))
+            continue;
+        f=(struct gfile*)malloc(sizeof(struct gfile)+n+1+l);
+        f->next=NULL;
+        memcpy(f->name,path,n), f->name[n]='\\', strcpy(f->name+n+1,s);
+        EnterCriticalSection(&j->cs);
+        *j->tail=f, j->tail=&f->next;
+        LeaveCriticalSection(&j->cs);
+        ReleaseSemaphore(j->sem,1,NULL);
+    } while (0==j->stop && FindNextFile(h,&fd));
+    FindClose(h);
+}
+
+ST DWORD WINAPI g_walker(void *arg) {
+    struct gjob *j=(struct gjob*)arg; char path[MAX_PATH]; int i,n;
+    for (i=0;i<j->nw;i++)
+        j->worker[i]=CreateThread(NULL,0,g_worker,j,0,NULL);
+    strcpy(path,j->dir);
+    if ((n=strlen(path)) && path[n-1]=='\\')
+        path[--n]=0;
+    g_walk(j,path,n);
+    ReleaseSemaphore(j->sem,j->nw,NULL);
+    WaitForMultipleObjects(j->nw,j->worker,TRUE,INFINITE);
+    for (i=0;i<j->nw;i++)
+        CloseHandle(j->worker[i]);
+    PostMessage(j->hwnd,CMD_GREPOUT,j->gen,0);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+// the results buffer
+
+ST void g_append(const char *p, int n) {
+    struct edvars *e=edp;
+    if (NULL==g_ed || n<=0) return;
+    edp=g_ed;
+    insdelmem(flen,n);
+    copyto(flen-n,p,n);
+    tlin=lix_count();
+    edp=e;
+}
+
+// a new one, in place of the old
+ST void g_newbuf(void) {
+    struct edvars *p=new_buffer();
+    if (g_ed) {
+        inslist(&ed0,g_ed,p);
+        edp=g_ed, clear_buffer();
+        delitem(&ed0,g_ed);
+    } else
+        inslist(&ed0,edp,p);
+    edp=g_ed=p;
+    strcpy(filename,"find results");
+    settitle();
+}
+
+ST void g_end(struct gjob *j, const char *msg) {
+    char buf[256];
+    sprintf(buf,"\n%s: %ld lines in %ld files, %ld files searched, %lu ms\n",
+        msg,j->found,j->hitfiles,j->files,GetTickCount()-j->t0);
+    g_append(buf,strlen(buf));
+    InfoMsg(buf+1);
+    if (j->walker) {
+        CloseHandle(j->walker);
+        CloseHandle(j->sem);
+        DeleteCriticalSection(&j->cs);
+    }
+    m_free(j->code);
+    m_free(j);
+    g_job=NULL;
+    g_gen++;
+}
+
+// the open buffers, right here
+ST void g_buffers(struct gjob *j, const char *str) {
+    struct edvars *v,*e=edp; struct sea s;
+    char buf[GREP_OUT], tmp[128]; unsigned char line[GREP_LINE];
+    int a,t,m,n;
+
+    for (v=ed0;v;v=v->next) {
+        if (v==g_ed)
+            continue;
+        edp=v, n=0;
+        for (m=0;m<flen;m=nextline(s.a,1)) {
+            s.from=m, s.str=strcpy(tmp,str), s.sf=(j->sf&(16|32|64))|1;
+            if (ed_search(&s)<=0)
+                break;
+            a=prevline(s.a,0);
+            if (s.a-a>GREP_LINE/2) a=s.a-GREP_LINE/2;
+            t=imin(a+GREP_LINE,imin(flen,s.a+linelen(s.a)));
+            copyfrom((char*)line,a,t-a);
+            t=g_format(buf,filename,lix_line(s.a)+1,line,t-a,a>0 && getchr(a-1)!=10);
+            edp=e, g_append(buf,t), edp=v;
+            j->found++, n++;
+            if (nextline(s.a,1)<=s.a)
+                break;
+        }
+        j->files++;
+        if (n) j->hitfiles++;
+    }
+    edp=e;
+}
+
+/*----------------------------------------------------------------------------*/
+// from the search dialog: 'mask' is "*.txt;*.ini" or "c:\dir\*.txt"
+// Returns -1 for a bad pattern.
+
+int grep_start(HWND hwnd, const char *str, int sf, const char *mask) {
+    struct gjob *j; struct rdfa *d; SYSTEM_INFO si; char buf[MAX_PATH+200];
+    unsigned char set[256]; const char *p; int n,o;
+
+    grep_stop();
+    j=(struct gjob*)c_alloc(sizeof(struct gjob));
+    j->sf=sf, j->hwnd=hwnd, j->gen=g_gen, j->t0=GetTickCount();
+
+    if (sf&64) {
+        for (n=0;;) {
+            o=rcomp((unsigned char*)str,j->code,n,(sf&16)==0); //ignore case
+            if (o==0) { m_free(j->code); m_free(j); return -1; }
+            if (n) break;
+            j->code=(unsigned char*)m_alloc(n=o);
+        }
+        j->clen=o;
+        if (0!=(n=rprefix(j->code,j->lo,j->up,sizeof j->lo)))
+            lit_init(&j->L,j->lo,j->up,n);
+        else {
+            d=rdfa_new(j->code,o);
+            rdfa_first(d,set);
+            rdfa_free(d);
+            for (n=0;n<256;n++) j->first[n]=set[n==9?' ':n];
+        }
+    } else {
+        strcpy((char*)j->lo,str), strcpy((char*)j->up,str);
+        if (0==(sf&16)) //ignore case
+            _strlwr((char*)j->lo), _strupr((char*)j->up);
+        lit_init(&j->L,j->lo,j->up,strlen(str));
+    }
+
+    if (sf&128) { // the open buffers
+        g_newbuf();
+        sprintf(buf,"find '%s' in the open files\n\n",str);
+        g_append(buf,strlen(buf));
+        g_buffers(j,str);
+        g_job=j;
+        g_end(j,"done");
+        return 1;
+    }
+
+    // the directory: from the mask, else where the file is
+    p=fname((char*)mask);
+    if (p>mask) {
+        memcpy(j->dir,mask,n=imin(p-mask,sizeof j->dir-1)), j->dir[n]=0;
+    } else if (fnameflg) {
+        strcpy(j->dir,filename), *fname(j->dir)=0;
+    } else
+        strcpy(j->dir,currentdir);
+    strcpy(j->mask,*p ? p : "*");
+
+    g_newbuf();
+    sprintf(buf,"find '%s' in %s%s%s\n\n",str,j->dir,
+        *j->dir && j->dir[strlen(j->dir)-1]!='\\' ? "\\" : "",j->mask);
+    g_append(buf,strlen(buf));
+
+    GetSystemInfo(&si);
+    j->nw=iminmax(si.dwNumberOfProcessors,2,GREP_THREADS);
+    InitializeCriticalSection(&j->cs);
+    j->sem=CreateSemaphore(NULL,0,0x7fffffff,NULL);
+    j->tail=&j->head;
+    g_job=j;
+    j->walker=CreateThread(NULL,0,g_walker,j,0,NULL);
+    return 1;
+}
+
+int grep_busy(void) {
+    return NULL!=g_job;
+}
+
+void grep_stop(void) {
+    struct gjob *j=g_job; struct gfile *f;
+    if (NULL==j) return;
+    j->stop=1;
+    WaitForSingleObject(j->walker,INFINITE);
+    while (NULL!=(f=j->head))
+        j->head=f->next, free(f);
+    g_end(j,"stopped");
+}
+
+// CMD_GREPOUT: lines found, or NULL at the end
+void grep_output(int gen, void *p) {
+    struct gout *o=(struct gout*)p; struct gjob *j=g_job;
+    if (j && gen==j->gen) {
+        if (NULL==o) {
+            WaitForSingleObject(j->walker,INFINITE);
+            g_end(j,"done");
+            return;
+        }
+        g_append(o->text,o->n);
+    }
+    free(o);
+}
+
+// the results buffer is closed
+void grep_closed(struct edvars *v) {
+    if (v!=g_ed) return;
+    grep_stop();
+    g_ed=NULL;
+}
+
+// doubleclick in the results: go to the line
+int grep_goto(HWND hwnd) {
+    char buf[GREP_OUT],*p; struct edvars *v; int n,l;
+    if (NULL==g_ed || edp!=g_ed)
+        return 0;
+    n=imin(linelen(lpos),sizeof buf-1);
+    copyfrom(buf,lpos,n), buf[n]=0;
+    for (p=buf;NULL!=(p=strchr(p,'('));p++) {
+        for (n=1;isdigit((unsigned char)p[n]);n++);
+        if (n>1 && p[n]==')' && p[n+1]==':')
+            break;
+    }
+    if (NULL==p)
+        return 0;
+    l=atoi(p+1), *p=0;
+    for (v=ed0;v;v=v->next)
+        if (v!=g_ed && 0==strcmp(v->sfilename,buf))
+            break;
+    if (v)
+        insfile(v);
+    else if (0==LoadFile(buf))
+        return 1;
+    SendMessage(hwnd,CMD_GOTOLINE,l,0);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,284 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDLINES.C - line index: where lines start, without reading the file
+
+// The text is cut into chunks of a few KB. Each chunk knows its length
+// and the number of linefeeds in it, and a fenwick tree over both gives
+// offset->line and line->offset in O(log n) plus a scan of one chunk.
+//
+// insdelmem() and copyto() keep the counts exact while the text is
+// changed. Chunks that grew too large are split (and tiny ones merged)
+// the next time the index is asked something.
+
+#include "edstruct.h"
+
+#define LIX_CHUNK   4096            // size of new chunks
+#define LIX_MAX     (LIX_CHUNK*4)   // split chunks above this
+
+struct lix_chunk {
+    int len, lf;
+};
+
+struct lineidx {
+    int n, a;               // chunks used, allocated
+    int top;                // highest power of 2 <= n
+    int len, lf;            // totals
+    char big;               // some chunk is over LIX_MAX
+    struct lix_chunk *c;    // the chunks
+    struct lix_chunk *t;    // the tree, t[1..n]
+};
+
+/*----------------------------------------------------------------------------*/
+// count linefeeds in memory
+
+ST int lx_cnt(const char *p, int n) {
+    const char *e=p+n; int r=0;
+    for (;NULL!=(p=(const char *)memchr(p,10,e-p));p++) r++;
+    return r;
+}
+
+// count linefeeds in the text from a to e
+ST int lx_scan(int a, int e) {
+    const char *p; int s,t,l,r=0;
+    for (;a<e;a+=l) {
+        p=getspan(a,&s,&t);
+        l=imin(t,e)-a;
+        r+=lx_cnt(p,l);
+    }
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
+// the tree
+
+ST void lx_setup(struct lineidx *x) {
+    struct lix_chunk *t=x->t; int i,k;
+    for (i=1;i<=x->n;i++) t[i]=x->c[i-1];
+    for (i=1;i<=x->n;i++)
+        if ((k=i+(i&-i))<=x->n)
+            t[k].len+=t[i].len, t[k].lf+=t[i].lf;
+    for (x->top=1;x->top*2<=x->n;x->top*=2);
+}
+
+ST void lx_alloc(struct lineidx *x, int n) {
+    if (n<=x->a) return;
+    x->a=imax(n,x->a*2);
+    x->c=(struct lix_chunk*)m_realloc(x->c,x->a*sizeof(struct lix_chunk));
+    x->t=(struct lix_chunk*)m_realloc(x->t,(x->a+1)*sizeof(struct lix_chunk));
+}
+
+ST void lx_add(struct lineidx *x, int i, int dl, int df) {
+    x->c[i].len+=dl, x->c[i].lf+=df;
+    x->len+=dl, x->lf+=df;
+    for (i++;i<=x->n;i+=i&-i)
+        x->t[i].len+=dl, x->t[i].lf+=df;
+}
+
+ST void lx_append(struct lineidx *x, int len, int lf) {
+    struct lix_chunk *t; int i,k;
+    lx_alloc(x,x->n+1);
+    x->c[x->n].len=len, x->c[x->n].lf=lf;
+    x->len+=len, x->lf+=lf;
+    k=++x->n, t=x->t, t[k].len=len, t[k].lf=lf;
+    for (i=k-1;i>k-(k&-k);i-=i&-i)
+        t[k].len+=t[i].len, t[k].lf+=t[i].lf;
+    if (x->top*2<=x->n) x->top*=2;
+}
+
+// the chunk that contains offset 'o', or x->n at the end
+ST int lx_find_ofs(struct lineidx *x, int o, int *s, int *f) {
+    int i=0,k,a=0,b=0;
+    for (k=x->top;k;k>>=1)
+        if (i+k<=x->n && a+x->t[i+k].len<=o)
+            i+=k, a+=x->t[i].len, b+=x->t[i].lf;
+    *s=a, *f=b;
+    return i;
+}
+
+// the chunk that contains the l'th linefeed, 1 <= l <= x->lf
+ST int lx_find_lf(struct lineidx *x, int l, int *s, int *f) {
+    int i=0,k,a=0,b=0;
+    for (k=x->top;k;k>>=1)
+        if (i+k<=x->n && b+x->t[i+k].lf<l)
+            i+=k, a+=x->t[i].len, b+=x->t[i].lf;
+    *s=a, *f=b;
+    return i;
+}
+
+/*----------------------------------------------------------------------------*/
+// split big chunks, merge small ones, then rebuild the tree
+
+ST void lx_rechunk(struct lineidx *x) {
+    struct lix_chunk *c,*d; int i,n,o,l;
+
+    c=x->c, n=x->n;
+    x->c=NULL, x->a=x->n=0, x->len=x->lf=0;
+    lx_alloc(x,n+1);
+
+    for (o=i=0;i<n;o+=c[i++].len) {
+        if (c[i].len>LIX_MAX) {
+            for (l=0;l<c[i].len;l+=LIX_CHUNK) {
+                lx_alloc(x,x->n+1);
+                d=x->c+x->n++;
+                d->len=imin(LIX_CHUNK,c[i].len-l);
+                d->lf=lx_scan(o+l,o+l+d->len);
+            }
+            continue;
+        }
+        if (0==c[i].len)
+            continue;
+        if (x->n && (d=x->c+x->n-1)->len+c[i].len<=LIX_CHUNK)
+            d->len+=c[i].len, d->lf+=c[i].lf;
+        else
+            lx_alloc(x,x->n+1), x->c[x->n++]=c[i];
+    }
+    m_free(c);
+
+    for (i=0;i<x->n;i++) x->len+=x->c[i].len, x->lf+=x->c[i].lf;
+    lx_setup(x);
+    x->big=0;
+}
+
+ST struct lineidx *lx_new(void) {
+    struct lineidx *x=(struct lineidx*)c_alloc(sizeof(struct lineidx));
+    x->top=1;
+    return x;
+}
+
+// get the index in a state to answer questions
+ST struct lineidx *lx_get(void) {
+    struct lineidx *x=lindex; int o,l;
+    if (NULL==x) {
+        lindex=x=lx_new();
+        for (o=0;o<flen;o+=l)
+            l=imin(LIX_CHUNK,flen-o), lx_append(x,l,lx_scan(o,o+l));
+    }
+    if (x->big || x->n>16+2*(x->len/LIX_CHUNK))
+        lx_rechunk(x);
+    return x;
+}
+
+/*----------------------------------------------------------------------------*/
+// called from insdelmem()/copyto(): 'p' points to the bytes at 'o'
+
+void lix_ins(int o, int n, const char *p) {
+    struct lineidx *x=lindex; int i,s,f;
+    if (NULL==x) {
+        if (flen) return; // not there yet, lx_get() will scan it
+        lindex=x=lx_new();
+    }
+    i=lx_find_ofs(x,o,&s,&f);
+    if (i==x->n) {
+        if (i==0 || x->c[i-1].len+n>LIX_CHUNK) {
+            lx_append(x,n,lx_cnt(p,n));
+            return;
+        }
+        --i;
+    }
+    lx_add(x,i,n,lx_cnt(p,n));
+    if (x->c[i].len>LIX_MAX) x->big=1;
+}
+
+void lix_del(int o, int n, const char *p) {
+    struct lineidx *x=lindex; int i,s,f,l;
+    if (NULL==x) return;
+    for (;n;n-=l,p+=l) {
+        i=lx_find_ofs(x,o,&s,&f);
+        l=imin(n,s+x->c[i].len-o);
+        lx_add(x,i,-l,-lx_cnt(p,l));
+    }
+}
+
+void lix_lf(int o, int n, const char *p, int sign) {
+    struct lineidx *x=lindex; int i,s,f,l;
+    if (NULL==x) return;
+    for (;n;n-=l,p+=l,o+=l) {
+        i=lx_find_ofs(x,o,&s,&f);
+        l=imin(n,s+x->c[i].len-o);
+        lx_add(x,i,0,sign*lx_cnt(p,l));
+    }
+}
+
+void lix_free(void) {
+    struct lineidx *x=lindex;
+    if (NULL==x) return;
+    m_free(x->c);
+    m_free(x->t);
+    m_free(x);
+    lindex=NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+// questions
+
+// total number of linefeeds
+int lix_count(void) {
+    return lx_get()->lf;
+}
+
+// number of linefeeds before 'o'
+int lix_line(int o) {
+    struct lineidx *x=lx_get(); int i,s,f,e;
+    if (o>=x->len) return x->lf;
+    if (o<=0) return 0;
+    i=lx_find_ofs(x,o,&s,&f);
+    e=s+x->c[i].len;
+    if (o-s<=e-o)
+        return f+lx_scan(s,o);
+    return f+x->c[i].lf-lx_scan(o,e);
+}
+
+// offset where line 'l' starts
+int lix_offset(int l) {
+    struct lineidx *x=lx_get(); int i,s,f,k;
+    if (l<=0) return 0;
+    if (l>x->lf) return x->len;
+    i=lx_find_lf(x,l,&s,&f);
+    k=l-f;
+    return lix_fwd(s,s+x->c[i].len,&k);
+}
+
+/*----------------------------------------------------------------------------*/
+// direct scans near to some offset
+
+// look for 'n' linefeeds forward from 'o' up to 'e'.
+// Returns the offset after the last one found.
+int lix_fwd(int o, int e, int *n) {
+    const char *p,*q; int s,t,l,r=o;
+    for (;*n && o<e;o+=l) {
+        p=getspan(o,&s,&t);
+        l=imin(t,e)-o;
+        for (q=p;*n && NULL!=(q=(const char *)memchr(q,10,l-(q-p)));)
+            r=o+(++q-p), --*n;
+    }
+    return r;
+}
+
+// look for 'n' linefeeds backward from 'o' down to 'a'.
+// Returns the offset of the last one found.
+int lix_back(int o, int a, int *n) {
+    const char *p; int s,t,l,r=o;
+    while (*n && o>a) {
+        p=getspan(o-1,&s,&t)+1;
+        for (l=o-imax(s,a);l && *n;l--,o--)
+            if (*--p==10) r=o-1, --*n;
+    }
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,296 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDLOAD.C - reading a file into the buffer
+
+// The text is converted on the way in: CRs go and tabs are expanded
+// with TABC up to the next tab stop. The converter looks for CR and tab
+// with memchr and passes the runs between as they are, so runs from a
+// mapped file can stay there (see edpiece.cpp).
+//
+// The first LD_SYNC bytes are loaded right away. The rest of a big file
+// is converted by a reader thread, which posts it in blocks to the
+// editor window, where it is appended to the buffer as it comes. The
+// text so far can be viewed and edited meanwhile. Esc or closing the
+// file stops it, saving waits for the rest.
+
+#include "edstruct.h"
+
+#define LD_SYNC     (1<<20)     // load this much before the file is shown
+#define LD_CHUNK    (1<<20)     // look for CR/tab in chunks this large
+#define LD_READ     65536       // when the file is not mapped
+#define LD_RUN      256         // shorter runs are copied anyway
+#define LD_RUNS     4096        // runs per block
+#define LD_TEXT     (256<<10)   // copied text per block
+#define LD_AHEAD    4           // blocks posted but not yet appended
+
+struct ldrun {
+    const char *p;
+    int n, ro;
+};
+
+struct ldblk {
+    int nr, used;
+    struct ldrun r[LD_RUNS];
+    char text[LD_TEXT];
+};
+
+struct ldjob {
+    HWND hwnd;
+    int gen;
+    volatile LONG stop;
+    HANDLE thread, sem;
+    HANDLE hf;              // read from here, when not mapped
+    char *buf;
+    int a, n;
+    const char *map;        // else the mapped file
+    int size, off;
+    int eof;
+    int tabs, col;          // col: the column where we are
+};
+
+extern HWND ewnd;
+HANDLE openf(char *name);
+DWORD readf(HANDLE hf, void *buf, DWORD l);
+int closef(HANDLE hf);
+
+ST int ld_gen;
+
+/*----------------------------------------------------------------------------*/
+// the converter, running in the thread
+
+// add a run to the block, returns how much of it did fit
+ST int ld_put(struct ldblk *b, const char *p, int n, int ro) {
+    struct ldrun *r;
+    if (b->nr==LD_RUNS)
+        return 0;
+    if (0==ro) {
+        if (0==(n=imin(n,LD_TEXT-b->used)))
+            return 0;
+        p=(const char*)memcpy(b->text+b->used,p,n);
+        b->used+=n;
+    }
+    if (b->nr) {
+        r=b->r+b->nr-1;
+        if (r->ro==ro && r->p+r->n==p) {
+            r->n+=n;
+            return n;
+        }
+    }
+    r=b->r+b->nr++;
+    r->p=p, r->n=n, r->ro=ro;
+    return n;
+}
+
+// convert from s to e, returns where it stopped when the block is full
+ST const char *ld_conv(struct ldjob *j, struct ldblk *b, const char *s, const char *e, int ro) {
+    static const char tabc[64]={
+        TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,
+        TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,
+        TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,
+        TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC,TABC
+        };
+    const char *cr=NULL,*tb=NULL,*p,*q; int n;
+    for (;;) {
+        if (cr<s && NULL==(cr=(const char*)memchr(s,13,e-s))) cr=e;
+        if (tb<s && NULL==(tb=(const char*)memchr(s,9,e-s))) tb=e;
+        for (p=cr<tb?cr:tb;s<p;s+=n) {
+            if (0==(n=ld_put(b,s,p-s,ro && p-s>=LD_RUN)))
+                return s;
+            for (q=s+n;q>s && q[-1]!=10;q--);
+            j->col=q>s ? s+n-q : j->col+n;
+        }
+        if (s==e)
+            return e;
+        if (*s==9) {
+            n=j->tabs-j->col%j->tabs;
+            if (b->nr==LD_RUNS || LD_TEXT-b->used<n)
+                return s;
+            ld_put(b,tabc,n,0), j->col+=n;
+        }
+        s++;
+    }
+}
+
+// the next block, returns 0 at the end of the file
+ST int ld_fill(struct ldjob *j, struct ldblk *b) {
+    const char *p; int e;
+    b->nr=b->used=0;
+    if (j->map) {
+        while (j->off<j->size) {
+            e=imin(j->size,j->off+LD_CHUNK);
+            p=ld_conv(j,b,j->map+j->off,j->map+e,1);
+            j->off=p-j->map;
+            if (j->off<e)
+                break;
+        }
+        j->eof=j->off==j->size;
+    } else {
+        for (;;) {
+            if (j->a==j->n) {
+                j->a=0, j->n=readf(j->hf,j->buf,LD_READ);
+                if (0==j->n) {
+                    j->eof=1;
+                    break;
+                }
+            }
+            p=ld_conv(j,b,j->buf+j->a,j->buf+j->n,0);
+            j->a=p-j->buf;
+            if (j->a<j->n)
+                break;
+        }
+    }
+    return b->nr;
+}
+
+ST DWORD WINAPI ld_thread(void *pv) {
+    struct ldjob *j=(struct ldjob*)pv; struct ldblk *b;
+    do {
+        WaitForSingleObject(j->sem,INFINITE);
+        if (j->stop)
+            break;
+        if (NULL==(b=(struct ldblk*)malloc(sizeof *b)))
+            break;
+        if (0==ld_fill(j,b))
+            free(b), b=NULL; // the end
+        if (0==PostMessage(j->hwnd,CMD_LOADMORE,j->gen,(LPARAM)b)) {
+            free(b);
+            break;
+        }
+    } while (b);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+// in the editor
+
+ST void ld_apply(struct ldblk *b) {
+    int i;
+    for (i=0;i<b->nr;i++)
+        append_text(b->r[i].p,b->r[i].n,b->r[i].ro);
+}
+
+ST void ld_free(struct ldjob *j) {
+    if (j->thread) {
+        CloseHandle(j->thread);
+        CloseHandle(j->sem);
+    }
+    if (j->hf)
+        closef(j->hf);
+    m_free(j->buf);
+    m_free(j);
+    pload=NULL;
+}
+
+// the rest, here and now
+ST void ld_rest(struct ldjob *j) {
+    struct ldblk *b=(struct ldblk*)m_alloc(sizeof *b);
+    while (ld_fill(j,b))
+        ld_apply(b);
+    m_free(b);
+    ld_free(j);
+}
+
+int loadfile(void) {
+    struct ldjob *j; struct ldblk *b; DWORD id;
+
+    flen=0;
+    j=(struct ldjob*)c_alloc(sizeof *j);
+    j->tabs=iminmax(tabs,1,64);
+    if (NULL==(j->map=map_file(filename,&j->size))) {
+        if (NULL==(j->hf=openf(filename))) {
+            m_free(j);
+            tlin=lix_count();
+            return 0;
+        }
+        j->buf=(char*)m_alloc(LD_READ);
+    }
+    getftime();
+
+    b=(struct ldblk*)m_alloc(sizeof *b);
+    while (flen<LD_SYNC && ld_fill(j,b))
+        ld_apply(b);
+    m_free(b);
+
+    pload=j;
+    if (j->eof) {
+        ld_free(j);
+    } else {
+        j->hwnd=ewnd;
+        j->gen=++ld_gen;
+        j->sem=CreateSemaphore(NULL,LD_AHEAD,LD_AHEAD,NULL);
+        j->thread=CreateThread(NULL,0,ld_thread,j,0,&id);
+        if (NULL==j->thread) {
+            CloseHandle(j->sem);
+            ld_rest(j);
+        }
+    }
+    tlin=lix_count();
+    return 1;
+}
+
+// CMD_LOADMORE: a block from the reader thread, NULL at the end
+void load_more(int gen, void *p) {
+    struct edvars *e=edp; struct ldjob *j;
+    for (edp=ed0;edp;edp=edp->next)
+        if (pload && pload->gen==gen)
+            break;
+    if (edp) {
+        j=pload;
+        if (p) {
+            ld_apply((struct ldblk*)p);
+            ReleaseSemaphore(j->sem,1,NULL);
+        } else {
+            WaitForSingleObject(j->thread,INFINITE);
+            ld_free(j);
+        }
+        tlin=lix_count();
+        upd=1;
+    }
+    free(p);
+    edp=e;
+}
+
+// stop loading, the text so far stays. Returns 1 if it was loading
+int load_stop(void) {
+    struct ldjob *j=pload;
+    if (NULL==j)
+        return 0;
+    j->stop=1;
+    ReleaseSemaphore(j->sem,1,NULL);
+    WaitForSingleObject(j->thread,INFINITE);
+    ld_free(j);
+    return 1;
+}
+
+// load the rest now, before the file is saved
+void load_finish(void) {
+    struct ldjob *j=pload; MSG msg;
+    if (NULL==j)
+        return;
+    j->stop=1;
+    ReleaseSemaphore(j->sem,1,NULL);
+    WaitForSingleObject(j->thread,INFINITE);
+    // what it has posted is still in the queue
+    while (pload && PeekMessage(&msg,j->hwnd,CMD_LOADMORE,CMD_LOADMORE,PM_REMOVE))
+        load_more(msg.wParam,(void*)msg.lParam);
+    if (pload)
+        ld_rest(j);
+    tlin=lix_count();
+}
+
+/*----------------------------------------------------------------------------*/
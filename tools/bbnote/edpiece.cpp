@@ -0,0 +1,378 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDPIECE.C - the text storage: a piece table
+
+// The text is a sequence of pieces, each pointing to a run of bytes
+// either in the original file (mapped read-only) or in the add blocks,
+// where everything inserted goes. Pieces are kept in a treap ordered
+// by text position, so finding, splitting and joining are O(log n).
+//
+// Bytes in the add blocks are never moved, so copyto() can write into
+// them directly. A piece in the mapped file is first copied to the add
+// blocks when something is written over it.
+
+#include "edstruct.h"
+
+#define ADD_BLK     65536   // default size of an add block
+#define MAP_MIN     (1<<20) // map files from this size on
+
+struct piece {
+    struct piece *l, *r;
+    unsigned pri;           // treap priority
+    int sum;                // text in this subtree
+    int len;                // text in this piece
+    char ro;                // in the mapped file
+    char *ptr;
+};
+
+struct addblk {
+    struct addblk *next;
+    int size, used;
+    char data[1];
+};
+
+struct filemap {
+    HANDLE hf, hm;
+    char *base;
+};
+
+/*----------------------------------------------------------------------------*/
+// the treap
+
+ST unsigned pt_rand(void) {
+    static unsigned s=2463534242u;
+    s^=s<<13, s^=s>>17, s^=s<<5;
+    return s;
+}
+
+#define pt_sum(t) ((t)?(t)->sum:0)
+
+ST void pt_fix(struct piece *t) {
+    t->sum=pt_sum(t->l)+t->len+pt_sum(t->r);
+}
+
+ST struct piece *pt_node(char *p, int n, int ro) {
+    struct piece *t=(struct piece*)c_alloc(sizeof(struct piece));
+    t->pri=pt_rand();
+    t->sum=t->len=n;
+    t->ptr=p;
+    t->ro=ro;
+    return t;
+}
+
+ST struct piece *pt_merge(struct piece *a, struct piece *b) {
+    if (NULL==a) return b;
+    if (NULL==b) return a;
+    if (a->pri>b->pri) {
+        a->r=pt_merge(a->r,b);
+        pt_fix(a);
+        return a;
+    }
+    b->l=pt_merge(a,b->l);
+    pt_fix(b);
+    return b;
+}
+
+// a gets the first 'o' bytes of t, b the rest
+ST void pt_split(struct piece *t, int o, struct piece **a, struct piece **b) {
+    struct piece *q; int k;
+    if (NULL==t) { *a=*b=NULL; return; }
+    k=pt_sum(t->l);
+    if (o<=k) {
+        pt_split(t->l,o,a,&t->l);
+        pt_fix(t);
+        *b=t;
+        return;
+    }
+    o-=k;
+    if (o<t->len) { // cut the piece itself
+        q=pt_node(t->ptr+o,t->len-o,t->ro);
+        t->len=o;
+        t->r=pt_merge(q,t->r);
+        o=t->len;
+    }
+    pt_split(t->r,o-t->len,&t->r,b);
+    pt_fix(t);
+    *a=t;
+}
+
+ST void pt_freetree(struct piece *t) {
+    if (NULL==t) return;
+    pt_freetree(t->l);
+    pt_freetree(t->r);
+    m_free(t);
+}
+
+// the piece that contains 'o', 's' gets where it starts
+ST struct piece *pt_find(int o, int *s) {
+    struct piece *t=proot; int a=0,k;
+    while (t) {
+        k=pt_sum(t->l);
+        if (o<a+k) { t=t->l; continue; }
+        a+=k;
+        if (o<a+t->len) break;
+        a+=t->len, t=t->r;
+    }
+    *s=a;
+    return t;
+}
+
+// grow the last piece in t by 'n'
+ST void pt_grow(struct piece *t, int n) {
+    for (;t->sum+=n,t->r;t=t->r);
+    t->len+=n;
+}
+
+ST struct piece *pt_last(struct piece *t) {
+    if (t) for (;t->r;t=t->r);
+    return t;
+}
+
+/*----------------------------------------------------------------------------*/
+// the add blocks
+
+ST char *pt_alloc(int n) {
+    struct addblk *b=padd;
+    if (NULL==b || b->used+n>b->size) {
+        int s=imax(ADD_BLK,n);
+        b=(struct addblk*)c_alloc(sizeof(struct addblk)-1+s);
+        b->size=s, b->next=padd, padd=b;
+    }
+    b->used+=n;
+    return b->data+b->used-n;
+}
+
+// the piece ends where the next pt_alloc(n) will start
+ST int pt_adjacent(struct piece *t, int n) {
+    struct addblk *b=padd;
+    return t && !t->ro && b
+        && t->ptr+t->len==b->data+b->used
+        && b->used+n<=b->size;
+}
+
+// insert 'n' new bytes at 'o', return where they are
+ST char *pt_insert(int o, int n) {
+    struct piece *a,*b; char *p;
+    pt_split(proot,o,&a,&b);
+    if (pt_adjacent(pt_last(a),n))
+        p=pt_alloc(n), pt_grow(a,n);
+    else
+        a=pt_merge(a,pt_node(p=pt_alloc(n),n,0));
+    proot=pt_merge(a,b);
+    buf_a=buf_e=0;
+    return p;
+}
+
+ST void pt_delete(int o, int n) {
+    struct piece *a,*b,*m;
+    pt_split(proot,o,&a,&b);
+    pt_split(b,n,&m,&b);
+    pt_freetree(m);
+    proot=pt_merge(a,b);
+    buf_a=buf_e=0;
+}
+
+// the text from 'o' in writable memory, for up to 'n' bytes
+ST char *pt_writable(int o, int *n) {
+    struct piece *t,*a,*b,*m; int s; char *p;
+    t=pt_find(o,&s);
+    *n=imin(*n,s+t->len-o);
+    if (0==t->ro)
+        return t->ptr+(o-s);
+    pt_split(proot,o,&a,&b);
+    pt_split(b,*n,&m,&b);
+    p=(char*)memcpy(pt_alloc(*n),m->ptr,*n);
+    m->ptr=p, m->ro=0;
+    proot=pt_merge(pt_merge(a,m),b);
+    buf_a=buf_e=0;
+    return m->ptr;
+}
+
+/*----------------------------------------------------------------------------*/
+// the mapped file
+
+// copy the text that still is in the file to memory, and unmap it
+ST void pt_copyall(struct piece *t) {
+    char *p;
+    if (NULL==t) return;
+    if (t->ro) memcpy(p=pt_alloc(t->len),t->ptr,t->len), t->ptr=p, t->ro=0;
+    pt_copyall(t->l);
+    pt_copyall(t->r);
+}
+
+ST void pt_unmap(void) {
+    struct filemap *m=pmap;
+    if (NULL==m) return;
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->hm);
+    CloseHandle(m->hf);
+    m_free(m);
+    pmap=NULL;
+}
+
+void detach_file(void) {
+    if (NULL==pmap) return;
+    pt_copyall(proot);
+    pt_unmap();
+    buf_a=buf_e=0;
+}
+
+// append 'n' bytes, from the mapped file if 'ro', else they are copied
+void append_text(const char *p, int n, int ro) {
+    struct piece *t=pt_last(proot);
+    if (ro) {
+        proot=pt_merge(proot,pt_node((char*)p,n,1));
+    } else if (pt_adjacent(t,n)) {
+        p=(char*)memcpy(pt_alloc(n),p,n);
+        pt_grow(proot,n);
+    } else {
+        p=(char*)memcpy(pt_alloc(n),p,n);
+        proot=pt_merge(proot,pt_node((char*)p,n,0));
+    }
+    lix_ins(flen,n,p);
+    flen+=n;
+    buf_a=buf_e=0;
+}
+
+// Map the file, the text then is taken from there by append_text() as
+// far as it does not need a conversion (CR/LF, tabs). The file stays
+// open without write sharing so nobody changes it under us. Returns
+// NULL if the file was not mapped (too small, or someone else has it
+// open for writing).
+const char *map_file(const char *name, int *psize) {
+    HANDLE hf,hm; DWORD hi,size; struct filemap *m; char *p;
+
+    hf=CreateFile(name,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,0,NULL);
+    if (hf==INVALID_HANDLE_VALUE) return NULL;
+    size=GetFileSize(hf,&hi);
+    if (hi || size<MAP_MIN || size>0x7fff0000)
+        goto fail_0;
+    if (NULL==(hm=CreateFileMapping(hf,NULL,PAGE_READONLY,0,0,NULL)))
+        goto fail_0;
+    if (NULL==(p=(char*)MapViewOfFile(hm,FILE_MAP_READ,0,0,0)))
+        goto fail_1;
+
+    m=(struct filemap*)m_alloc(sizeof(struct filemap));
+    m->hf=hf, m->hm=hm, m->base=p;
+    pmap=m;
+    *psize=size;
+    return p;
+
+fail_1:
+    CloseHandle(hm);
+fail_0:
+    CloseHandle(hf);
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+void insdelmem (int o, int len) {
+    int a,s,e; const char *p;
+    if (len>0) {
+        p=pt_insert(o,len);
+        lix_ins(o,len,p);
+        flen+=len;
+        return;
+    }
+    len=-len;
+    for (a=o;a<o+len;a=e) {
+        p=getspan(a,&s,&e);
+        e=imin(e,o+len);
+        lix_del(o,e-a,p);
+    }
+    pt_delete(o,len);
+    flen-=len;
+}
+
+/*----------------------------------------------------------------------------*/
+void clear_buffer(void) {
+    struct addblk *b;
+    load_stop();
+    pt_freetree(proot), proot=NULL;
+    while (NULL!=(b=padd))
+        padd=b->next, m_free(b);
+    pt_unmap();
+    buf_a = buf_e = 0;
+    lix_free();
+    u_reset();
+}
+
+struct edvars *new_buffer(void) {
+    return (struct edvars *)c_alloc(sizeof(struct edvars));
+}
+
+/*----------------------------------------------------------------------------*/
+// buffer access
+
+const char *getspan(int o, int *a, int *e) {
+    struct piece *t;
+    if (o<buf_a || o>=buf_e) {
+        t=pt_find(o,&buf_a);
+        buf_e=buf_a+t->len;
+        pspan=t->ptr;
+    }
+    *a=buf_a, *e=buf_e;
+    return pspan+(o-buf_a);
+}
+
+unsigned char getchr(int o) {
+    int a,e;
+    if (o<buf_a || o>=buf_e) {
+        if (o<0 || o>=flen) return 0;
+        getspan(o,&a,&e);
+    }
+    return pspan[o-buf_a];
+}
+
+void copyto(int dst, const char *src, int l) {
+    int b; char *p;
+    for (;l;) {
+        b=l;
+        p=pt_writable(dst,&b);
+        lix_lf(dst,b,p,-1);
+        memmove(p,src,b);
+        lix_lf(dst,b,p,1);
+        l-=b; src+=b; dst+=b;
+    }
+    upd=1;
+}
+
+void copyfrom(char *dst, int src, int l) {
+    int a,e,b; const char *p;
+    for (;l;) {
+        p=getspan(src,&a,&e);
+        b=imin(l,e-src);
+        memmove(dst,p,b);
+        l-=b; src+=b; dst+=b;
+    }
+}
+
+void clearchr(int dst, char c, int l) {
+    int b; char *p;
+    for (;l;) {
+        b=l;
+        p=pt_writable(dst,&b);
+        lix_lf(dst,b,p,-1);
+        memset(p,c,b);
+        lix_lf(dst,b,p,1);
+        l-=b; dst+=b;
+    }
+    upd=1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -76,7 +76,6 @@ void clrcfg(void) {}
 
 char prjflg;
 char syncolors = 1;
-char grep_cmd[256];
 
 
 DWORD My_Colors_d[COLORN]= {
@@ -1026,6 +1025,8 @@ mm3:
 
     case WM_LBUTTONDBLCLK:
         lf2=0;
+        if (edp && grep_goto(hwnd))
+            return;
         if (edp) {
             o=getkword(fpos, tmpbuff);
             if (tmpbuff[0]) {
@@ -1297,6 +1298,7 @@ LRESULT CALLBACK EditProc (HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam
     }
 
     case WM_DESTROY:
+        grep_stop();
         exit_edit();
         DragAcceptFiles(hwnd,FALSE);
         bb_unregister(hwnd);
@@ -1704,6 +1706,11 @@ config:
             return 0;
 
         case KEY_ESC:
+            if (edp && load_stop()) {
+                fnameflg=0; // a part of it, not to be saved over the file
+                InfoMsg("Loading stopped");
+                goto p0;
+            }
             if (drag==0) goto quit;
             dragmove=0;
             do_mouse(hwnd, 0,0,WM_LBUTTONUP);
@@ -1774,6 +1781,14 @@ config:
         r=LoadFile((char*)wParam);
         goto p0r;
 
+    case CMD_GREPOUT:
+        grep_output(wParam,(void*)lParam);
+        goto p0;
+
+    case CMD_LOADMORE:
+        load_more(wParam,(void*)lParam);
+        goto p0;
+
     case CMD_NSEARCH:
         resetmsg(hwnd);
         if (wParam&8) {
@@ -33,12 +33,24 @@
 
 /*----------------------------------------------------------------------------*/
 
+// undo/redo journal, see edfunc.cpp
+struct ujour {
+    struct urec *r;         // the records, oldest first
+    int n, rmax;
+    char *text;             // the text deleted, in the same order
+    int used, tmax;
+    unsigned seq;           // counts what was added
+};
+
 struct edvars {
     struct edvars *next;
 
-    struct bufpage *sprev_pg;
-    struct bufpage *snext_pg;
+    struct piece *sroot;
+    struct addblk *sadd;
+    struct filemap *smap;
+    struct ldjob *sload;
 
+    const char *sspan;
     int  sbuf_a,sbuf_e;
 
     int sflen;
@@ -47,7 +59,8 @@ struct edvars {
 
     int scurx,scury,sclft,slmax;
 
-    struct undo_s *sundo_l,*sredo_l;
+    struct ujour sundo_l,sredo_l;
+    struct lineidx *slindex;
 
     int  *sma,      *sme;
     int  *smxa,     *smxe;
@@ -64,8 +77,6 @@ struct edvars {
     FILETIME sfiletime;
     char sfnameflg;
     char sfilename[128];
-
-    char sbuffer[1];
 };
 
 #define changed()  (chg!=0)
@@ -73,9 +84,11 @@ struct edvars {
 
 extern struct edvars *ed0,*edp,*new_buffer(void);
 
-#define buffer  (edp->sbuffer)
-#define next_pg (edp->snext_pg)
-#define prev_pg (edp->sprev_pg)
+#define proot   (edp->sroot)
+#define padd    (edp->sadd)
+#define pmap    (edp->smap)
+#define pload   (edp->sload)
+#define pspan   (edp->sspan)
 #define buf_a   (edp->sbuf_a)
 #define buf_e   (edp->sbuf_e)
 
@@ -93,6 +106,7 @@ extern struct edvars *ed0,*edp,*new_buffer(void);
 #define undo_l  (edp->sundo_l)
 #define redo_l  (edp->sredo_l)
 #define usave   (edp->susave)
+#define lindex  (edp->slindex)
 
 #define ma      (edp->sma)
 #define me      (edp->sme)
@@ -121,6 +135,29 @@ void copyto(int,const char*,int);
 void clearchr(int,char,int);
 unsigned char getchr(int o);
 
+// the text at 'o', which is in memory from 'a' to 'e'
+const char *getspan(int o, int *a, int *e);
+const char *map_file(const char *name, int *psize);
+void append_text(const char *p, int n, int ro);
+void detach_file(void);
+
+// edload.cpp - reading files, big ones in the background
+int  loadfile(void);
+void load_more(int gen, void *p);
+int  load_stop(void);
+void load_finish(void);
+
+// edlines.cpp - line index
+void lix_ins(int o, int n, const char *p);
+void lix_del(int o, int n, const char *p);
+void lix_lf(int o, int n, const char *p, int sign);
+void lix_free(void);
+int  lix_count(void);
+int  lix_line(int o);
+int  lix_offset(int l);
+int  lix_fwd(int o, int e, int *n);
+int  lix_back(int o, int a, int *n);
+
 void u_reset(void);
 void u_setchg(int);
 
@@ -141,7 +178,6 @@ int LoadFile(char *);
 int DoFileOpenSave(HWND hwnd, int mode);
 int QueryDiscard(HWND, int f);
 int QueryDiscard_1(HWND, int f);
-int loadfile(void);
 //int savefile(char *);
 
 void InfoMsg(const char*);
@@ -210,6 +246,20 @@ void ed_cmd(int cmd,...);
 struct sea { int from; char *str; int sf; int a; int e; };
 int  ed_search(struct sea *);
 
+// literal search: the string in lower and upper case, 'j' is the char
+// to look for first
+struct lit { unsigned char *lo, *up; int n, j; };
+void lit_init(struct lit *L, void *lo, void *up, int n);
+int  lit_mem(struct lit *L, const char *p, int n);
+
+// edgrep.cpp - find in files
+int  grep_start(HWND hwnd, const char *str, int sf, const char *mask);
+int  grep_busy(void);
+void grep_stop(void);
+void grep_output(int gen, void *p);
+void grep_closed(struct edvars *v);
+int  grep_goto(HWND hwnd);
+
 int  movpage(int);
 void domarking(int);
 void unmark(void);
@@ -330,6 +380,12 @@ extern int My_CaretSize;
 int rcomp (unsigned char *in, unsigned char *out, int omax, int cf);
 struct rmres { int p; int w; };
 int rmatch(int s, int a, int e, unsigned char *m, struct rmres *m_ptr, int (*get)(int));
+struct rdfa *rdfa_new(unsigned char *code, int len);
+void rdfa_free(struct rdfa *d);
+void rdfa_first(struct rdfa *d, unsigned char *set);
+int rdfa_match(struct rdfa *d, int s, int a, int e, int (*get)(int));
+int rdfa_mem(struct rdfa *d, const unsigned char *p, int s, int a, int e);
+int rprefix(unsigned char *m, unsigned char *lo, unsigned char *up, int omax);
 
 #define OW_CLEAR 1001
 #define OW_PRINT 1002
@@ -385,7 +441,7 @@ extern int
 extern char
     smart, tuse, backup, bakdir, savedly, unix_eol,
     winhelp_1[], winhelp_2[], winhelp_3[],
-    grep_cmd[], seabuf[], rplbuf[],
+    seabuf[], rplbuf[],
     seamodeflg, moumrk, linmrk, ltup, vmark,
     hsbar,
     wrdsep[]
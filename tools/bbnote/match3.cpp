@@ -24,6 +24,12 @@
 int rcomp (unsigned char *in, unsigned char *out, int omax, int cf);
 struct rmres { int p; int w; };
 int rmatch(int s, int a, int e, unsigned char *m, struct rmres *m_ptr, int (*getchr)(int));
+struct rdfa *rdfa_new(unsigned char *code, int len);
+void rdfa_free(struct rdfa *d);
+void rdfa_first(struct rdfa *d, unsigned char *set);
+int rdfa_match(struct rdfa *d, int s, int a, int e, int (*getchr)(int));
+int rdfa_mem(struct rdfa *d, const unsigned char *p, int s, int a, int e);
+int rprefix(unsigned char *m, unsigned char *lo, unsigned char *up, int omax);
 
 enum codes {
     e_succ     = 1  ,
@@ -475,6 +481,268 @@ e_fail:
     }
 }
 
+/*---------------------------------------------------------------------------*/
+/* The same code, run as a lazy DFA.
+
+   The code is read as a program of threads: e_back, e_que and e_jmp fork
+   or jump, groups are ignored, and a DFA state is the set of positions
+   waiting for a char (plus e_eol and e_succ). States are made when first
+   needed. rmatch() always looks for the longest match, which is what a
+   DFA gives naturally. Captures still need rmatch(), on the final match
+   only.
+
+   e_bol is decided when the state is made, from the char before. An
+   e_eol thread waits in the state and goes on when the next char is a
+   linefeed, or at the end.
+
+   A state with its table is 1 KB, so they are allocated one by one;
+   most expressions need only a few. */
+
+#include <stdlib.h>
+
+#define DFA_MAX     512     /* states, then give up */
+#define D_DEAD      (-2)
+#define D_NONE      (-1)
+#define D_BOL       1
+#define D_EOL       2
+
+struct rstate {
+    int next[256];
+    short *pc, n;
+    char bol;               /* made after a linefeed or at the start */
+    char acc;               /* has e_succ */
+    char acc_eol;           /* has e_succ behind an e_eol */
+};
+
+struct rdfa {
+    unsigned char *code;
+    int len;
+    unsigned char *seen;
+    short *tmp, *tmp2;
+    int ns;
+    struct rstate *st[DFA_MAX];
+    int start[2];
+};
+
+ST short getshort(unsigned char *m) {
+    short i; memcpy(&i, m, sizeof i); return i;
+}
+
+ST int is_eol(int c) {
+    return c==10 || c==13;
+}
+
+/* follow forks and jumps from 'pc', collect where threads stop.
+   'at' has D_BOL when after a linefeed, D_EOL when before one */
+ST void d_close(struct rdfa *d, int pc, int at, short *out, int *n) {
+    unsigned char *m;
+    for (;;) {
+        if (d->seen[pc]) return;
+        d->seen[pc]=1;
+        m=d->code+pc;
+        switch (*m) {
+        case e_back:
+            d_close(d, pc+3+getshort(m+1), at, out, n);
+            pc+=3;
+            continue;
+        case e_que:
+            d_close(d, pc+3, at, out, n);
+            pc+=3+getshort(m+1);
+            continue;
+        case e_jmp:
+            pc+=3+getshort(m+1);
+            continue;
+        case e_grp_a:
+            pc+=2;
+            continue;
+        case e_grp_b:
+            pc+=1;
+            continue;
+        case e_bol:
+            if (0==(at&D_BOL)) return;
+            pc+=1;
+            continue;
+        case e_eol:
+            if (0==(at&D_EOL)) goto stop;
+            pc+=1;
+            continue;
+        default:
+        stop:
+            out[(*n)++]=pc;
+            return;
+        }
+    }
+}
+
+/* the size of a char matching instruction */
+ST int d_size(unsigned char *m) {
+    switch (*m) {
+    case e_char: case e_nocase: return 2;
+    case e_class: return 1+CLSZ;
+    default: return 1;
+    }
+}
+
+ST int d_accepts(unsigned char *m, int c) {
+    switch (*m) {
+    case e_char:   return m[1]==c;
+    case e_nocase: return m[1]==lwc_ger(c);
+    case e_class:  return 0==(m[1+((c>>3)&(CLSZ-1))] & (1<<(c&7)));
+    case e_dot:    return !is_eol(c);
+    case e_nospc:  return c!=' ' && c!=9 && !is_eol(c);
+    default:       return 0;
+    }
+}
+
+ST int d_cmp(const void *a, const void *b) {
+    return *(short*)a - *(short*)b;
+}
+
+/* find or make the state for the thread list 'pc' */
+ST int d_state(struct rdfa *d, short *pc, int n, int bol) {
+    struct rstate *s; int i,k,k2;
+    if (0==n) return D_DEAD;
+    qsort(pc, n, sizeof *pc, d_cmp);
+    for (i=0;i<d->ns;i++) {
+        s=d->st[i];
+        if (s->n==n && s->bol==bol && 0==memcmp(s->pc, pc, n*sizeof *pc))
+            return i;
+    }
+    if (d->ns==DFA_MAX)
+        return D_NONE;
+    s=d->st[d->ns]=(struct rstate*)malloc(sizeof *s);
+    s->pc=(short*)malloc(n*sizeof *pc);
+    memcpy(s->pc, pc, n*sizeof *pc);
+    s->n=n, s->bol=bol, s->acc=s->acc_eol=0;
+    for (i=0;i<256;i++) s->next[i]=D_NONE;
+
+    memset(d->seen, 0, d->len);
+    for (i=k2=0;i<n;i++) {
+        if (d->code[pc[i]]==e_succ) s->acc=1;
+        if (d->code[pc[i]]==e_eol) d_close(d, pc[i]+1, bol|D_EOL, d->tmp2, &k2);
+    }
+    for (k=0;k<k2;k++)
+        if (d->code[d->tmp2[k]]==e_succ) s->acc_eol=1;
+    return d->ns++;
+}
+
+ST int d_next(struct rdfa *d, int i, int c) {
+    struct rstate *s=d->st[i]; short *pc; int j,k,n,bol;
+    unsigned char *m;
+
+    if (D_NONE!=s->next[c])
+        return s->next[c];
+
+    pc=s->pc, n=s->n;
+    if (is_eol(c)) { /* let waiting e_eol's go on */
+        memset(d->seen, 0, d->len);
+        for (j=k=0;j<n;j++)
+            if (d->code[pc[j]]==e_eol) d_close(d, pc[j]+1, s->bol|D_EOL, d->tmp2, &k);
+            else d->tmp2[k++]=pc[j];
+        pc=d->tmp2, n=k;
+    }
+
+    bol=is_eol(c);
+    memset(d->seen, 0, d->len);
+    for (j=k=0;j<n;j++) {
+        m=d->code+pc[j];
+        if (d_accepts(m, c))
+            d_close(d, pc[j]+d_size(m), bol, d->tmp, &k);
+    }
+    return s->next[c]=d_state(d, d->tmp, k, bol);
+}
+
+struct rdfa *rdfa_new(unsigned char *code, int len) {
+    struct rdfa *d; int bol,n;
+    d=(struct rdfa*)calloc(1, sizeof *d);
+    d->code=code, d->len=len;
+    d->seen=(unsigned char*)malloc(len);
+    d->tmp=(short*)malloc(len*sizeof(short));
+    d->tmp2=(short*)malloc(2*len*sizeof(short));
+    for (bol=0;bol<2;bol++) {
+        memset(d->seen, 0, len);
+        n=0, d_close(d, 1, bol, d->tmp, &n);
+        d->start[bol]=d_state(d, d->tmp, n, bol);
+    }
+    return d;
+}
+
+void rdfa_free(struct rdfa *d) {
+    int i;
+    for (i=0;i<d->ns;i++) free(d->st[i]->pc), free(d->st[i]);
+    free(d->seen);
+    free(d->tmp);
+    free(d->tmp2);
+    free(d);
+}
+
+/* chars that can start a match */
+void rdfa_first(struct rdfa *d, unsigned char *set) {
+    int bol,c,i;
+    memset(set, 0, 256);
+    for (bol=0;bol<2;bol++)
+        for (c=0;c<256;c++)
+            if ((i=d->start[bol])>=0 && d_next(d, i, c)!=D_DEAD)
+                set[c]=1;
+}
+
+/* like rmatch(), without captures. Returns -1 when it ran out of states */
+int rdfa_match(struct rdfa *d, int s, int a, int e, int (*getchr)(int)) {
+    struct rstate *st; int i,p,r;
+    i=d->start[s==a || is_eol(getchr(s-1))];
+    if (i<0) return 0;
+    for (p=s,r=0;p<e;) {
+        i=d_next(d, i, getchr(p));
+        if (i<0) return i==D_DEAD ? r : -1;
+        st=d->st[i], p++;
+        if (st->acc || (st->acc_eol && (p==e || is_eol(getchr(p)))))
+            r=p-s;
+    }
+    return r;
+}
+
+/* the same on text in memory, where a tab reads as a space */
+#define m_chr(o) (p[o]==9 ? ' ' : p[o])
+
+int rdfa_mem(struct rdfa *d, const unsigned char *p, int s, int a, int e) {
+    struct rstate *st; int i,o,r;
+    i=d->start[s==a || is_eol(p[s-1])];
+    if (i<0) return 0;
+    for (o=s,r=0;o<e;) {
+        i=d_next(d, i, m_chr(o));
+        if (i<0) return i==D_DEAD ? r : -1;
+        st=d->st[i], o++;
+        if (st->acc || (st->acc_eol && (o==e || is_eol(p[o]))))
+            r=o-s;
+    }
+    return r;
+}
+
+/* The literal every match starts with, in lower and upper case. A ' '
+   also takes TABC, as the editor passes tabs as spaces. */
+int rprefix(unsigned char *m, unsigned char *lo, unsigned char *up, int omax) {
+    int n=0;
+    for (m++;n<omax;) switch (*m) {
+        case e_char:
+            lo[n]=m[1], up[n]=m[1]==' '?9:m[1];
+            n++, m+=2;
+            continue;
+        case e_nocase:
+            lo[n]=m[1], up[n]=upc_ger(m[1]);
+            n++, m+=2;
+            continue;
+        case e_grp_a:
+            m+=2;
+            continue;
+        case e_grp_b:
+            m+=1;
+            continue;
+        default:
+            return n;
+    }
+    return n;
+}
+
 /*---------------------------------------------------------------------------*/
 #ifdef match_main
 
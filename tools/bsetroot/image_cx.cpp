@@ -68,6 +68,24 @@ RGBQUAD image_getpixel(HIMG Img, int x, int y)
     return ((CxImage*)Img)->GetPixelColor(x, y);
 }
 
+void image_getline(HIMG hImg, int y, RGBQUAD *line)
+{
+    CxImage *Img = (CxImage*)hImg;
+    int width = Img->GetWidth(), x;
+    if (24 == Img->GetBpp()) {
+        BYTE *s = Img->GetBits() + y * Img->GetEffWidth();
+        for (x = 0; x < width; ++x, s += 3) {
+            line[x].rgbBlue = s[0];
+            line[x].rgbGreen = s[1];
+            line[x].rgbRed = s[2];
+            line[x].rgbReserved = 0;
+        }
+    } else {
+        for (x = 0; x < width; ++x)
+            line[x] = Img->GetPixelColor(x, y);
+    }
+}
+
 int image_save(HIMG Img, const char *path)
 {
     return ((CxImage*)Img)->Save(path, CXIMAGE_FORMAT_BMP);
@@ -89,7 +107,7 @@ static void set_pixels(CxImage *Img, void *pixels)
     if (NULL == s || NULL == d)
         return;
     for (int y = 0; y < height; ++y) {
-        BYTE *p = d + y * width * 3;
+        BYTE *p = d + y * Img->GetEffWidth();
         for(int x = 0; x< width;++x){
             p[0] = s[0];
             p[1] = s[1];
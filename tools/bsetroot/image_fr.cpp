@@ -100,6 +100,33 @@ RGBQUAD image_getpixel(HIMG hImg, int x, int y)
     return c;
 }
 
+void image_getline(HIMG hImg, int y, RGBQUAD *line)
+{
+    FIBITMAP *Img = (FIBITMAP*)hImg;
+    int width = FreeImage_GetWidth(Img), x;
+    BYTE *s = FreeImage_GetScanLine(Img, y);
+    if (32 == FreeImage_GetBPP(Img)) {
+        memcpy(line, s, width * sizeof *line);
+    } else if (24 == FreeImage_GetBPP(Img)) {
+        for (x = 0; x < width; ++x, s += 3) {
+            line[x].rgbBlue = s[FI_RGBA_BLUE];
+            line[x].rgbGreen = s[FI_RGBA_GREEN];
+            line[x].rgbRed = s[FI_RGBA_RED];
+            line[x].rgbReserved = 0;
+        }
+    } else {
+        for (x = 0; x < width; ++x)
+            FreeImage_GetPixelColor(Img, x, y, &line[x]);
+    }
+}
+
+// no row by row reading with FreeImage, the whole image is loaded
+struct ImageReader;
+int image_read(const char *path, struct ImageReader *ir)
+{
+    return 0;
+}
+
 /*
     Resample filters:
     -----------------
@@ -0,0 +1,545 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+
+// image_read.cpp - jpeg and png rows for big wallpapers, see rootimg.h
+//
+// Jpegs are decoded at 1/2, 1/4 or 1/8 by the IDCT when the picture is
+// to be that much smaller anyway. Baseline jpegs with restart markers
+// at the start of MCU rows are cut there into jpegs of their own, which
+// are decoded on the threads. Pngs come row by row, unless interlaced.
+
+#include "BBApi.h"
+#include "rootimg.h"
+
+// png.h wants to be the first with setjmp.h
+#include "CXIMAGE/png/png.h"
+extern "C" {
+#include "CXIMAGE/jpeg/jpeglib.h"
+#include "CXIMAGE/jpeg/jerror.h"
+}
+#include <setjmp.h>
+#include <emmintrin.h>
+#include "worker.h"
+
+#define ST static
+
+#define JPG_MT_PIXELS (2*1024*1024) // less than that is done in one go
+#define JPG_MAX_THREADS 8
+#define JPG_PARTS 4                 // parts per thread, for the balance
+
+//===========================================================================
+// jpeg from memory, with the errors back to a setjmp
+
+struct jpg_error
+{
+    struct jpeg_error_mgr pub;
+    jmp_buf jb;
+};
+
+ST void jpg_error_exit(j_common_ptr cinfo)
+{
+    longjmp(((struct jpg_error*)cinfo->err)->jb, 1);
+}
+
+ST void jpg_init_source(j_decompress_ptr cinfo)
+{
+}
+
+ST boolean jpg_fill_input_buffer(j_decompress_ptr cinfo)
+{
+    // the data is all there, so the file was short
+    static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+    WARNMS(cinfo, JWRN_JPEG_EOF);
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+}
+
+ST void jpg_skip_input_data(j_decompress_ptr cinfo, long n)
+{
+    struct jpeg_source_mgr *src = cinfo->src;
+    if (n > 0) {
+        if ((size_t)n > src->bytes_in_buffer)
+            n = (long)src->bytes_in_buffer;
+        src->next_input_byte += n;
+        src->bytes_in_buffer -= n;
+    }
+}
+
+ST void jpg_term_source(j_decompress_ptr cinfo)
+{
+}
+
+// Decode the jpeg in p/len at 1/denom, as the rows from y0 on of a
+// picture 'height' rows high. If 'start', it is the whole picture and
+// ir->Start() comes first.
+ST bool jpg_decode(const BYTE *p, size_t len, int denom,
+    int y0, int height, bool start, ImageReader *ir)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpg_error jerr;
+    struct jpeg_source_mgr src;
+    JSAMPARRAY buffer;
+    RGBQUAD *line;
+    BYTE *s;
+    int x, w, n;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpg_error_exit;
+    if (setjmp(jerr.jb)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+
+    src.next_input_byte = p;
+    src.bytes_in_buffer = len;
+    src.init_source = jpg_init_source;
+    src.fill_input_buffer = jpg_fill_input_buffer;
+    src.skip_input_data = jpg_skip_input_data;
+    src.resync_to_restart = jpeg_resync_to_restart;
+    src.term_source = jpg_term_source;
+    cinfo.src = &src;
+
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    jpeg_start_decompress(&cinfo);
+
+    w = cinfo.output_width;
+    n = cinfo.output_components;
+    if (start) {
+        height = cinfo.output_height;
+        if (false == ir->Start(w, height))
+            longjmp(jerr.jb, 1);
+    }
+
+    // the libjpeg pool frees it, with room for the pixel after the row
+    line = (RGBQUAD*)(*cinfo.mem->alloc_large)
+        ((j_common_ptr)&cinfo, JPOOL_IMAGE, (w + 1) * sizeof *line);
+    buffer = (*cinfo.mem->alloc_sarray)
+        ((j_common_ptr)&cinfo, JPOOL_IMAGE, w * n, 1);
+    memset(line, 0, (w + 1) * sizeof *line);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        jpeg_read_scanlines(&cinfo, buffer, 1);
+        s = buffer[0];
+        if (1 == n) {
+            for (x = 0; x < w; ++x, s += 1)
+                line[x].rgbBlue = line[x].rgbGreen = line[x].rgbRed = s[0];
+        } else if (3 == n) {
+            for (x = 0; x < w; ++x, s += 3)
+                line[x].rgbRed = s[0], line[x].rgbGreen = s[1], line[x].rgbBlue = s[2];
+        } else {
+            // inverted CMYK, as CxImage takes it
+            for (x = 0; x < w; ++x, s += 4) {
+                line[x].rgbRed   = (BYTE)(s[3] * s[0] / 255);
+                line[x].rgbGreen = (BYTE)(s[3] * s[1] / 255);
+                line[x].rgbBlue  = (BYTE)(s[3] * s[2] / 255);
+            }
+        }
+        ir->Row(height - 1 - y0++, line);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+//===========================================================================
+// Where a baseline jpeg can be cut: after the restart markers, when the
+// restart interval is whole MCU rows.
+
+struct jpg_layout
+{
+    size_t sof;         // the SOF marker
+    size_t data;        // the scan data, after the SOS segment
+    size_t end;         // the marker after the scan data
+    int width, height;
+    int mcu_h;          // pixel rows per MCU row
+    int rows;           // MCU rows per restart interval
+    int intervals;
+    size_t *rst;        // the restart markers, intervals - 1 of them
+};
+
+ST inline int get16(const BYTE *p)
+{
+    return p[0] << 8 | p[1];
+}
+
+ST bool jpg_layout(const BYTE *p, size_t len, struct jpg_layout *l)
+{
+    size_t i, j, n;
+    int m, k, nf = 0, hmax = 1, vmax = 1, mcu_w = 8, interval = 0, mcus;
+
+    memset(l, 0, sizeof *l);
+    for (i = 2;; i += 2 + get16(p + i + 2)) {
+        while (i + 4 <= len && 0xFF == p[i] && 0xFF == p[i+1])
+            ++i;
+        if (i + 4 > len || 0xFF != p[i])
+            return false;
+        m = p[i+1];
+        if (0xD9 == m || (m >= 0xD0 && m <= 0xD8) || 0x01 == m)
+            return false;
+        if (i + 2 + get16(p + i + 2) > len)
+            return false;
+        if (0xC0 == m || 0xC1 == m) {
+            // baseline or extended sequential huffman
+            if (i + 10 > len)
+                return false;
+            l->sof = i;
+            l->height = get16(p + i + 5);
+            l->width = get16(p + i + 7);
+            nf = p[i+9];
+            if (i + 10 + 3 * nf > len)
+                return false;
+            for (k = 0; k < nf; ++k) {
+                hmax = imax(hmax, p[i + 11 + 3*k] >> 4);
+                vmax = imax(vmax, p[i + 11 + 3*k] & 15);
+            }
+            // one component alone is not interleaved, its MCU is a block
+            if (nf > 1)
+                mcu_w = 8 * hmax, l->mcu_h = 8 * vmax;
+            else
+                l->mcu_h = 8;
+        } else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+            // progressive, lossless or arithmetic
+            return false;
+        } else if (0xDD == m) {
+            interval = get16(p + i + 4);
+        } else if (0xDA == m) {
+            // all components in the one scan
+            if (0 == l->sof || p[i+4] != nf)
+                return false;
+            l->data = i + 2 + get16(p + i + 2);
+            break;
+        }
+    }
+
+    mcus = (l->width + mcu_w - 1) / mcu_w;
+    if (interval <= 0 || l->height <= 0 || interval % mcus)
+        return false;
+    l->rows = interval / mcus;
+    l->intervals = ((l->height + l->mcu_h - 1) / l->mcu_h + l->rows - 1) / l->rows;
+    if (l->intervals < 2)
+        return false;
+    l->rst = (size_t*)malloc((l->intervals - 1) * sizeof *l->rst);
+    if (NULL == l->rst)
+        return false;
+
+    for (n = 0, j = l->data;; ) {
+        const BYTE *f = (const BYTE*)memchr(p + j, 0xFF, len - j);
+        if (NULL == f || (j = f - p) + 1 >= len) {
+            j = len;
+            break;
+        }
+        m = p[j+1];
+        if (0x00 == m || 0xFF == m) {
+            // a stuffed 0xFF or a fill byte
+            j += 1 + (0x00 == m);
+        } else if (m >= 0xD0 && m <= 0xD7) {
+            if ((int)n < l->intervals - 1)
+                l->rst[n] = j;
+            ++n, j += 2;
+        } else {
+            // EOI, most likely
+            break;
+        }
+    }
+    l->end = j;
+    if ((int)n != l->intervals - 1) {
+        free(l->rst);
+        return false;
+    }
+    return true;
+}
+
+// The intervals a..b as a jpeg of its own: the headers with the height
+// of the part, the scan data with the markers counted from RST0 again,
+// and an EOI
+ST BYTE *jpg_part(const BYTE *p, const struct jpg_layout *l,
+    int a, int b, int h, size_t *plen)
+{
+    size_t s, e, k;
+    BYTE *q;
+
+    s = a ? l->rst[a-1] + 2 : l->data;
+    e = b < l->intervals ? l->rst[b-1] : l->end;
+    q = (BYTE*)malloc(l->data + e - s + 2);
+    if (NULL == q)
+        return NULL;
+    memcpy(q, p, l->data);
+    q[l->sof + 5] = (BYTE)(h >> 8);
+    q[l->sof + 6] = (BYTE)h;
+    memcpy(q + l->data, p + s, e - s);
+    for (k = a; (int)k < b - 1; ++k)
+        q[l->data + l->rst[k] - s + 1] = (BYTE)(0xD0 + ((k - a) & 7));
+    q[l->data + e - s] = 0xFF;
+    q[l->data + e - s + 1] = JPEG_EOI;
+    *plen = l->data + e - s + 2;
+    return q;
+}
+
+// The rows of a part that are its own. The parts are decoded with an
+// interval more on each side, for the chroma upsampling at the cuts to
+// see the same neighbours as in the whole.
+struct JpgRows : ImageReader
+{
+    ImageReader *m_ir;
+    int m_lo, m_hi;
+
+    virtual bool Size (int width, int height) { return true; }
+    virtual bool Start (int width, int height) { return true; }
+    virtual void Row (int y, RGBQUAD *line)
+    {
+        if (y >= m_lo && y < m_hi)
+            m_ir->Row(y, line);
+    }
+};
+
+struct JpgParts : Runnable
+{
+    const BYTE *m_data;
+    const struct jpg_layout *m_l;
+    ImageReader *m_ir;
+    int m_denom, m_height, m_per_part, m_parts;
+    std::atomic<int> m_next;
+    std::atomic<bool> m_error;
+
+    JpgParts () : m_next(0), m_error(false) { }
+
+    // the first pixel row of interval i, or the height
+    int Top (int i)
+    {
+        return imin(i * m_l->rows * m_l->mcu_h, m_l->height);
+    }
+
+    virtual void Run ()
+    {
+        const struct jpg_layout *l = m_l;
+        JpgRows rows;
+        int i, a, b, a0, b1, d = m_denom;
+        size_t len;
+        BYTE *q;
+
+        rows.m_ir = m_ir;
+        while ((i = m_next.fetch_add(1)) < m_parts && false == m_error) {
+            a = i * m_per_part;
+            b = imin(a + m_per_part, l->intervals);
+            a0 = imax(a - 1, 0);
+            b1 = imin(b + 1, l->intervals);
+            // bottom-up, the tops of the intervals are whole MCUs so
+            // that divides
+            rows.m_lo = m_height - (Top(b) + d - 1) / d;
+            rows.m_hi = m_height - Top(a) / d;
+            q = jpg_part(m_data, l, a0, b1, Top(b1) - Top(a0), &len);
+            if (NULL == q || false == jpg_decode(q, len, d,
+                    Top(a0) / d, m_height, false, &rows))
+                m_error = true;
+            free(q);
+        }
+    }
+};
+
+// The parts of a jpeg with layout l on n threads, at 1/denom
+ST int jpg_parts(const BYTE *p, const struct jpg_layout *l,
+    int width, int height, int denom, int n, ImageReader *ir)
+{
+    JpgParts job;
+    ThreadPool pool;
+    int i;
+
+    // the parts are decoded to the same sizes as the whole would be
+    job.m_data = p;
+    job.m_l = l;
+    job.m_ir = ir;
+    job.m_denom = denom;
+    job.m_height = (height + denom - 1) / denom;
+    job.m_parts = imin(l->intervals, n * JPG_PARTS);
+    job.m_per_part = (l->intervals + job.m_parts - 1) / job.m_parts;
+    job.m_parts = (l->intervals + job.m_per_part - 1) / job.m_per_part;
+    n = imin(n, job.m_parts);
+    if (false == ir->Start((width + denom - 1) / denom, job.m_height))
+        return -1;
+    for (i = 0; i < n; ++i)
+        pool.Create(job);
+    pool.WaitForTerminate();
+    return job.m_error ? -1 : 1;
+}
+
+ST int read_jpg(const BYTE *p, size_t len, ImageReader *ir)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpg_error jerr;
+    struct jpg_layout l;
+    int width, height, denom, n, r;
+
+    // the size from the header, with a throwaway decompressor
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpg_error_exit;
+    if (setjmp(jerr.jb)) {
+        jpeg_destroy_decompress(&cinfo);
+        return -1;
+    }
+    {
+        struct jpeg_source_mgr src;
+        jpeg_create_decompress(&cinfo);
+        src.next_input_byte = p;
+        src.bytes_in_buffer = len;
+        src.init_source = jpg_init_source;
+        src.fill_input_buffer = jpg_fill_input_buffer;
+        src.skip_input_data = jpg_skip_input_data;
+        src.resync_to_restart = jpeg_resync_to_restart;
+        src.term_source = jpg_term_source;
+        cinfo.src = &src;
+        jpeg_read_header(&cinfo, TRUE);
+        width = cinfo.image_width;
+        height = cinfo.image_height;
+        jpeg_destroy_decompress(&cinfo);
+    }
+
+    ir->m_min_w = ir->m_min_h = 0;
+    if (false == ir->Size(width, height))
+        return -1;
+    denom = ir->m_min_w > 0 && ir->m_min_h > 0 ? 8 : 1;
+    for (; denom > 1; denom /= 2)
+        if ((width + denom - 1) / denom >= ir->m_min_w
+         && (height + denom - 1) / denom >= ir->m_min_h)
+            break;
+
+    n = 1;
+    if ((__int64)width * height >= JPG_MT_PIXELS)
+        n = iminmax(std::thread::hardware_concurrency(), 1, JPG_MAX_THREADS);
+    if (n < 2 || false == jpg_layout(p, len, &l))
+        return jpg_decode(p, len, denom, 0, 0, true, ir) ? 1 : -1;
+
+    r = jpg_parts(p, &l, width, height, denom, n, ir);
+    free(l.rst);
+    return r;
+}
+
+//===========================================================================
+// png row by row, with the transforms CxImage uses
+
+ST int read_png(FILE *fp, ImageReader *ir, RGBQUAD **pline)
+{
+    png_structp png_ptr;
+    png_infop info_ptr;
+    png_color_16 my_background = { 0, 192, 192, 192, 0 };
+    png_color_16 *image_background;
+    png_uint_32 width, height, y;
+    int bit_depth, color_type, interlace_type;
+
+    png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (NULL == png_ptr)
+        return -1;
+    info_ptr = png_create_info_struct(png_ptr);
+    if (NULL == info_ptr) {
+        png_destroy_read_struct(&png_ptr, NULL, NULL);
+        return -1;
+    }
+    if (setjmp(png_ptr->jmpbuf)) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return -1;
+    }
+    png_init_io(png_ptr, fp);
+    png_set_sig_bytes(png_ptr, 8);
+    png_read_info(png_ptr, info_ptr);
+    png_get_IHDR(png_ptr, info_ptr, &width, &height,
+        &bit_depth, &color_type, &interlace_type, NULL, NULL);
+
+    // Adam7 needs the whole picture anyway
+    if (interlace_type != PNG_INTERLACE_NONE) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return 0;
+    }
+
+    if (info_ptr->pixel_depth != 32) {
+        if (png_get_bKGD(png_ptr, info_ptr, &image_background))
+            png_set_background(png_ptr, image_background, PNG_BACKGROUND_GAMMA_FILE, 1, 1.0);
+        else
+            png_set_background(png_ptr, &my_background, PNG_BACKGROUND_GAMMA_SCREEN, 0, 1.0);
+    } else {
+        png_set_strip_alpha(png_ptr);
+    }
+    if (16 == bit_depth)
+        png_set_strip_16(png_ptr);
+    png_set_expand(png_ptr);
+    png_set_gray_to_rgb(png_ptr);
+    png_set_bgr(png_ptr);
+    png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+    png_read_update_info(png_ptr, info_ptr);
+    if (png_get_rowbytes(png_ptr, info_ptr) != width * 4) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return 0;
+    }
+
+    ir->m_min_w = ir->m_min_h = 0;
+    if (false == ir->Size(width, height) || false == ir->Start(width, height)) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return -1;
+    }
+    // freed by the caller, also after a longjmp
+    *pline = (RGBQUAD*)calloc(width + 1, sizeof(RGBQUAD));
+    if (NULL == *pline)
+        png_error(png_ptr, "out of memory");
+    for (y = 0; y < height; ++y) {
+        png_read_row(png_ptr, (png_bytep)*pline, NULL);
+        ir->Row(height - 1 - y, *pline);
+    }
+    png_read_end(png_ptr, NULL);
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    return 1;
+}
+
+//===========================================================================
+int image_read(const char *path, ImageReader *ir)
+{
+    static const BYTE png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    BYTE sig[8], *data;
+    RGBQUAD *line;
+    FILE *fp;
+    long len;
+    int r = 0;
+
+    fp = fopen(path, "rb");
+    if (NULL == fp)
+        return -1;
+    if (sizeof sig == fread(sig, 1, sizeof sig, fp)) {
+        if (0 == memcmp(sig, png_sig, sizeof sig)) {
+            line = NULL;
+            r = read_png(fp, ir, &line);
+            free(line);
+        } else if (0xFF == sig[0] && 0xD8 == sig[1]) {
+            // the cuts need it all in memory
+            fseek(fp, 0, SEEK_END);
+            len = ftell(fp);
+            data = (BYTE*)malloc(len);
+            fseek(fp, 0, SEEK_SET);
+            r = -1;
+            if (data && len == (long)fread(data, 1, len, fp))
+                r = read_jpg(data, len, ir);
+            free(data);
+        }
+    }
+    fclose(fp);
+    return r;
+}
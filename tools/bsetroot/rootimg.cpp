@@ -0,0 +1,328 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// the bsetroot image pipeline, see rootimg.h
+
+#include "BBApi.h"
+#include "BImage.h"
+#include "rootimg.h"
+
+#include "worker.h"
+
+#define ST static
+
+#define ROOT_BAND 32                // rows per job for the threads
+#define ROOT_MT_PIXELS (256*1024)   // less than that is done in one go
+#define ROOT_MAX_THREADS 8
+
+//===========================================================================
+void root_gradient(struct rootinfo *r, BYTE *pixels, int width, int height)
+{
+    struct bimage *b;
+    StyleItem si;
+
+    si.type = r->type,
+    si.Color = r->color1,
+    si.ColorTo = r->color2,
+    si.interlaced = !!r->interlaced,
+    si.bevelstyle = r->bevelstyle,
+    si.bevelposition = r->bevelposition;
+    si.parentRelative = false;
+
+    b = bimage_create(width, height, &si);
+    if (b) {
+        memcpy(pixels, bimage_getpixels(b), width * height * 4);
+        bimage_destroy(b);
+    } else {
+        // too small for a gradient
+        DWORD c = switch_rgb(r->color1), *d = (DWORD*)pixels;
+        int n = width * height;
+        while (n--)
+            *d++ = c;
+    }
+}
+
+//===========================================================================
+void root_modula(BYTE *pixels, int width, int height, int mx, int my, COLORREF fg)
+{
+    DWORD c, *d; int x, y;
+    c = switch_rgb(fg);
+    if (my > 1)
+        for (y = height-my; y >= 0; y-=my)
+            for (d = (DWORD*)pixels + y * width, x = 0; x < width; x++)
+                d[x] = c;
+    if (mx > 1)
+        for (y = height; --y >= 0;)
+            for (d = (DWORD*)pixels + y * width, x = mx-1; x < width; x+=mx)
+                d[x] = c;
+}
+
+//===========================================================================
+// put the image on the pixels, in bands of rows on up to ROOT_MAX_THREADS
+
+struct RootCopy : Runnable
+{
+    BYTE *m_pixels;
+    int m_width;
+    HIMG m_img;
+    int m_x0, m_y0, m_xa, m_xe, m_ya, m_ye;
+    int m_hue, m_sat;
+    root_span_fn *m_span;
+    std::atomic<int> m_next;
+
+    RootCopy () : m_next(0) { }
+
+    virtual void Run ()
+    {
+        RGBQUAD *line, *d;
+        int y, e;
+
+        line = (RGBQUAD*)malloc(image_getwidth(m_img) * sizeof *line);
+        if (NULL == line)
+            return;
+        while ((y = m_ya + m_next.fetch_add(ROOT_BAND)) < m_ye) {
+            for (e = imin(y + ROOT_BAND, m_ye); y < e; y++) {
+                image_getline(m_img, y, line);
+                d = (RGBQUAD*)m_pixels + (m_y0+y) * m_width + m_x0;
+                m_span(d + m_xa, line + m_xa, m_xe - m_xa, m_hue, m_sat);
+            }
+        }
+        free(line);
+    }
+};
+
+void root_copy(BYTE *pixels, int width, int height,
+    HIMG Img, int x0, int y0, int hueIntensity, int saturationValue)
+{
+    RootCopy job;
+    ThreadPool pool;
+    int xs, ys, i, n;
+
+    xs = image_getwidth(Img);
+    ys = image_getheight(Img);
+    // the part that is on the screen
+    job.m_xa = imax(0, -x0), job.m_xe = imin(xs, width - x0);
+    job.m_ya = imax(0, -y0), job.m_ye = imin(ys, height - y0);
+    if (job.m_xa >= job.m_xe || job.m_ya >= job.m_ye)
+        return;
+
+    job.m_pixels = pixels;
+    job.m_width = width;
+    job.m_img = Img;
+    job.m_x0 = x0, job.m_y0 = y0;
+    job.m_hue = hueIntensity, job.m_sat = saturationValue;
+    job.m_span = root_get_span(root_cpu_level(), hueIntensity, saturationValue);
+
+    n = 1;
+    if ((job.m_xe - job.m_xa) * (job.m_ye - job.m_ya) >= ROOT_MT_PIXELS)
+        n = iminmax(std::thread::hardware_concurrency(), 1, ROOT_MAX_THREADS);
+    n = imin(n, (job.m_ye - job.m_ya + ROOT_BAND - 1) / ROOT_BAND);
+    if (n < 2) {
+        job.Run();
+        return;
+    }
+    for (i = 0; i < n; ++i)
+        pool.Create(job);
+    pool.WaitForTerminate();
+}
+
+//===========================================================================
+int root_render(struct rootinfo *r, HIMG *pImg, BYTE *pixels, int width, int height)
+{
+    HIMG Img = *pImg;
+    int bmp_width, bmp_height;
+
+    bmp_width = bmp_height = 0;
+    if (Img) {
+        bmp_width  = image_getwidth(Img);
+        bmp_height = image_getheight(Img);
+        if (WP_NONE == r->wpstyle)
+            r->wpstyle = WP_FULL;
+        if (WP_FULL == r->wpstyle
+            && (bmp_width != width || bmp_height != height)) {
+            root_resample(pImg, width, height, r->filter);
+            Img = *pImg;
+            bmp_width  = image_getwidth(Img);
+            bmp_height = image_getheight(Img);
+        }
+    } else {
+        r->wpstyle = WP_NONE;
+    }
+
+    // the background texture, if any
+    if (r->gradient || r->mod || (r->solid && (r->interlaced || NULL == Img))) {
+        root_gradient(r, pixels, width, height);
+        if (r->mod)
+            root_modula(pixels, width, height, r->modx, r->mody, r->modfg);
+    } else if (NULL == Img) {
+        return 0;
+    } else if (r->sat < 255 || r->hue > 0
+        || bmp_width < width || bmp_height < height) {
+        // where the image does not cover it, or to blend with
+        if (false == r->solid)
+            r->color1 = GetSysColor(COLOR_DESKTOP);
+        root_gradient(r, pixels, width, height);
+    }
+
+    if (Img) {
+        if (WP_TILE == r->wpstyle) {
+            int x0, y0;
+            for (x0 = 0; x0 < width;  x0+=bmp_width)
+            for (y0 = 0; y0 < height; y0+=bmp_height)
+                root_copy(pixels, width, height,
+                    Img, x0, y0, r->hue, r->sat);
+        } else {
+            int x0 = (width  - bmp_width) / 2;
+            int y0 = (height - bmp_height) / 2;
+            root_copy(pixels, width, height,
+                Img, x0, y0, r->hue, r->sat);
+        }
+    }
+    return 1;
+}
+
+void root_screensize(struct rootinfo *r, int *width, int *height)
+{
+    *width = GetSystemMetrics(SM_CXSCREEN);
+    *height = GetSystemMetrics(SM_CYSCREEN);
+    if (r->vdesk) {
+        int v_screen_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        int v_screen_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+        if (v_screen_width && v_screen_height) {
+            *width = v_screen_width;
+            *height = v_screen_height;
+        }
+    }
+}
+
+//===========================================================================
+ST bool FileExists(LPCSTR szFileName)
+{
+    DWORD a = GetFileAttributes(szFileName);
+    return (DWORD)-1 != a && 0 == (a & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+char *make_full_path(char *buffer, const char *filename, const char *search_base)
+{
+    char exe_path[MAX_PATH];
+    if (search_base && search_base[0]) {
+        join_path(buffer, search_base, filename);
+        if (FileExists(buffer))
+            return buffer;
+    }
+
+    get_exe_path(NULL, exe_path, sizeof exe_path);
+    return join_path(buffer, exe_path, filename);
+}
+
+char *read_line(FILE *fp, char *buffer)
+{
+    char *s;
+    do {
+        s = buffer;
+        if (NULL==fgets(s, MAX_PATH, fp))
+            return NULL;
+
+        while (*s) { if (IS_SPC(*s)) *s = ' '; ++s; }
+        while (s > buffer && IS_SPC(s[-1])) s--;
+        *s=0;
+        s = buffer;
+        while (*s && IS_SPC(*s)) ++s;
+    } while ('#' == *s || '!' == *s || 0 == *s);
+    return strcpy(buffer, s);
+}
+
+//===========================================================================
+ST int find_bmp(const char *filename, char *found, string_node *searchpaths, const char *search_base)
+{
+    char path[MAX_PATH];
+    char temp[MAX_PATH];
+    const char *p;
+    int state;
+
+    for (state = 0;;++state) {
+        switch (state) {
+        case 0: // try original name
+            p = filename;
+            goto try_it;
+        case 1: // try from exe-path
+            p = filename;
+            break;
+        case 2: // try searchpaths listed in "bsetroot.rc"
+            if (NULL == searchpaths)
+                continue;
+            -- state; // might have still more lines
+            p = join_path(path, searchpaths->str, file_basename(filename));
+            searchpaths = searchpaths->next;
+            break;
+        case 3:  // try backgrounds/path
+            p = join_path(path, "backgrounds", filename);
+            break;
+        case 4:  // try backgrounds/file
+            p = join_path(path, "backgrounds", file_basename(filename));
+            break;
+        default: // give up
+            return 0;
+        }
+
+        if (!is_absolute_path(p))
+            p = make_full_path(path, strcpy(temp, p), search_base);
+try_it:
+        if (FileExists(p)) {
+            strcpy(found, p);
+            return 1;
+        }
+    }
+}
+
+int root_find(struct rootinfo *r, char *path)
+{
+    return find_bmp(r->wpfile, path, r->paths, r->search_base);
+}
+
+int root_load(struct rootinfo *r, HIMG *pImg)
+{
+    char path[MAX_PATH];
+    int w = 0, h = 0;
+
+    if (0 == root_find(r, path))
+        return 1;
+    // jpegs and pngs straight to the size they are shown at, if it is
+    // known here. Otherwise, or if that fails, the image library has a go
+    if (RF_CXIMAGE != r->filter && 0 == r->convert) {
+        if (WP_FULL == r->wpstyle || WP_NONE == r->wpstyle)
+            root_screensize(r, &w, &h);
+        if ((w || (r->scale && r->scale != 100))
+         && 1 == root_read(path, pImg, w, h, r->scale, r->filter))
+            return 0;
+    }
+    *pImg = image_create_fromfile(path);
+    if (NULL == *pImg)
+        return 2;
+    if (r->scale && r->scale != 100) {
+        int w = image_getwidth(*pImg) * r->scale / 100;
+        int h = image_getheight(*pImg) * r->scale / 100;
+        root_resample(pImg, w, h, r->filter);
+    }
+    return 0;
+}
+
+//===========================================================================
@@ -0,0 +1,128 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// rootimg.cpp - the bsetroot image pipeline, as a library for bsetroot.exe
+// and for blackbox, which renders the wallpaper with it in-process.
+//
+// Pixels are 32 bit BGRX with bottom-up rows, as in a BI_RGB dib, so the
+// rows can be the bits of a dib section directly.
+
+#ifndef _ROOTIMG_H_
+#define _ROOTIMG_H_
+
+#include "bbroot.h"
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Image interface (image_cx.cpp or image_fr.cpp)
+
+typedef void *HIMG;
+const char *image_getversion(void);
+const char *image_getlasterror(void);
+
+HIMG image_create_fromfile(const char *path);
+HIMG image_create_fromraw(int w, int h, void *pixels);
+int image_save(HIMG img, const char *path);
+void image_destroy(HIMG Img);
+
+int image_getwidth(HIMG img);
+int image_getheight(HIMG img);
+
+RGBQUAD image_getpixel(HIMG img, int x, int y);
+int image_setpixel(HIMG img, int x, int y, RGBQUAD c);
+int image_resample(HIMG *img, int w, int h);
+
+// one row of pixels, bottom-up like image_getpixel
+void image_getline(HIMG img, int y, RGBQUAD *line);
+
+// Rows of an image file as they are decoded, so that big wallpapers
+// need not be in memory at full size.
+struct ImageReader
+{
+    int m_min_w, m_min_h;
+
+    // The size in the file. Set m_min_w/m_min_h and jpegs are decoded
+    // at 1/2, 1/4 or 1/8 where that is still as big. false to cancel
+    virtual bool Size (int width, int height) = 0;
+    // the size of the rows that follow
+    virtual bool Start (int width, int height) = 0;
+    // One row, y bottom-up. Rows may come in any order and from several
+    // threads at once. There is room for one more pixel after the row.
+    virtual void Row (int y, RGBQUAD *line) = 0;
+};
+
+// jpeg and png files through an ImageReader (image_read.cpp). Returns 1
+// if done, 0 if the file is not for that, -1 on errors
+int image_read(const char *path, ImageReader *ir);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// pipeline steps, on a width x height pixel buffer
+
+// the -solid/-gradient background. bimage_init() must have been called
+void root_gradient(struct rootinfo *r, BYTE *pixels, int width, int height);
+
+// the -mod lines
+void root_modula(BYTE *pixels, int width, int height, int mx, int my, COLORREF fg);
+
+// put the image at x0/y0 (from bottom-left), with -hue and -sat applied
+void root_copy(BYTE *pixels, int width, int height,
+    HIMG Img, int x0, int y0, int hue, int sat);
+
+// find r->wpfile where bsetroot would look. Returns 1 if found
+int root_find(struct rootinfo *r, char *path);
+
+// find and load r->wpfile, with -scale applied.
+// Returns 0 on success, 1 if not found, 2 if it does not load
+int root_load(struct rootinfo *r, HIMG *pImg);
+
+// resample Img (or, if it is NULL, the 32 bit pixels) from sw x sh
+// to dw x dh into dst, with RF_BOX, RF_BICUBIC or RF_LANCZOS (rootscale.cpp)
+void root_scale(HIMG Img, const BYTE *pixels, int sw, int sh,
+    BYTE *dst, int dw, int dh, int filter);
+
+// replace *pImg with a w x h version, with the -filter given
+int root_resample(HIMG *pImg, int w, int h, int filter);
+
+// load path with image_read, resampled on the way to w x h, or when w
+// is 0 to scale percent. Returns as image_read
+int root_read(const char *path, HIMG *pImg, int w, int h, int scale, int filter);
+
+// what the cpu has for the kernels: 0 plain C, 1 SSE2, 2 AVX2 (rootspan.cpp)
+int root_cpu_level(void);
+
+// the -hue/-sat kernel of root_copy for a cpu level. d is the background
+// and the result, s the image. All levels give the same bits
+typedef void root_span_fn(RGBQUAD *d, const RGBQUAD *s, int n, int hueIntensity, int saturationValue);
+root_span_fn *root_get_span(int level, int hueIntensity, int saturationValue);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// the whole picture as 'bsetroot -save' makes it: background, modula and
+// the image (if any, may be resampled) tiled, centered or stretched.
+// Returns 0 if there is nothing to paint.
+int root_render(struct rootinfo *r, HIMG *pImg, BYTE *pixels, int width, int height);
+
+// the size bsetroot uses: the primary screen, or with -vdesk all of them
+void root_screensize(struct rootinfo *r, int *width, int *height);
+
+// where bsetroot.exe looks for files (bsetroot.rc, backgrounds/)
+char *make_full_path(char *buffer, const char *filename, const char *search_base);
+char *read_line(FILE *fp, char *buffer);
+
+#endif
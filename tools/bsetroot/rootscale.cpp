@@ -0,0 +1,531 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+
+// rootscale.cpp - separable resampler for the wallpaper, see rootimg.h
+//
+// Each axis gets a table of 1.14 fixed point weights per output pixel,
+// then the rows are filtered across (into a temp buffer) and the columns
+// down, in bands of rows on the threads. The SSE2 passes give the same
+// bits as the C ones.
+
+#include "BBApi.h"
+#include "rootimg.h"
+
+#include <math.h>
+#include <emmintrin.h>
+#include "worker.h"
+
+#define ST static
+
+#ifdef __GNUC__
+#define ROOT_SSE2 __attribute__((target("sse2")))
+#else
+#define ROOT_SSE2
+#endif
+
+#define SCALE_BITS 14
+#define SCALE_ONE (1 << SCALE_BITS)
+#define SCALE_BAND 16               // rows per job for the threads
+#define SCALE_MT_PIXELS (256*1024)  // less than that is done in one go
+#define SCALE_MAX_THREADS 8
+
+//===========================================================================
+// the filters, over the distance in source pixels
+
+ST double f_box(double x)
+{
+    return x > -0.5 && x <= 0.5 ? 1.0 : 0.0;
+}
+
+ST double f_bicubic(double x)
+{
+    // Catmull-Rom, a = -0.5
+    x = fabs(x);
+    if (x < 1.0)
+        return (1.5*x - 2.5)*x*x + 1.0;
+    if (x < 2.0)
+        return ((-0.5*x + 2.5)*x - 4.0)*x + 2.0;
+    return 0.0;
+}
+
+ST double sinc(double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= 3.14159265358979323846;
+    return sin(x) / x;
+}
+
+ST double f_lanczos(double x)
+{
+    if (x <= -3.0 || x >= 3.0)
+        return 0.0;
+    return sinc(x) * sinc(x / 3.0);
+}
+
+//===========================================================================
+// the weights for one axis: output i takes count[i] source pixels from
+// start[i] on, with the weights at w + i * taps. The counts are even for
+// the pairs in the SSE2 passes, so the last one may be a pixel past the end
+// with a zero weight.
+
+struct axis
+{
+    int taps;
+    int *start;
+    int *count;
+    short *w;
+};
+
+ST void free_axis(struct axis *a)
+{
+    free(a->start), free(a->count), free(a->w);
+}
+
+ST bool make_axis(struct axis *a, int src, int dst, int filter)
+{
+    double (*f)(double);
+    double radius, scale, fscale, support, center, sum, *fw;
+    int i, j, lo, hi, n, total, imax_w;
+    short *w;
+
+    if (RF_AUTO == filter)
+        filter = dst < src ? RF_BOX : RF_LANCZOS;
+    switch (filter) {
+        case RF_BOX: f = f_box, radius = 0.5; break;
+        case RF_BICUBIC: f = f_bicubic, radius = 2.0; break;
+        default: f = f_lanczos, radius = 3.0; break;
+    }
+
+    // when shrinking, the filter is widened to cover the source pixels
+    scale = (double)dst / src;
+    fscale = scale < 1.0 ? 1.0 / scale : 1.0;
+    support = radius * fscale;
+
+    a->taps = ((int)ceil(2.0 * support) + 3) & ~1;
+    a->start = (int*)malloc(dst * sizeof(int));
+    a->count = (int*)malloc(dst * sizeof(int));
+    a->w = (short*)calloc(dst * a->taps, sizeof(short));
+    fw = (double*)malloc(a->taps * sizeof(double));
+    if (NULL == a->start || NULL == a->count || NULL == a->w || NULL == fw) {
+        free(fw);
+        free_axis(a);
+        return false;
+    }
+
+    for (i = 0; i < dst; ++i) {
+        center = (i + 0.5) / scale;
+        lo = imax((int)floor(center - support), 0);
+        hi = imin((int)ceil(center + support), src);
+        n = imin(hi - lo, a->taps - 1);
+
+        for (sum = 0.0, j = 0; j < n; ++j)
+            sum += fw[j] = f((lo + j + 0.5 - center) / fscale);
+        if (sum == 0.0) {
+            // a box smaller than a pixel, take the nearest one
+            lo = iminmax((int)center, 0, src - 1), n = 1;
+            fw[0] = sum = 1.0;
+        }
+
+        // to fixed point, with the rounding error on the biggest one
+        w = a->w + i * a->taps;
+        for (total = imax_w = j = 0; j < n; ++j) {
+            w[j] = (short)floor(fw[j] / sum * SCALE_ONE + 0.5);
+            total += w[j];
+            if (w[j] > w[imax_w])
+                imax_w = j;
+        }
+        w[imax_w] += SCALE_ONE - total;
+
+        // no zeros at the ends
+        while (n > 1 && 0 == w[n-1])
+            --n;
+        for (j = 0; j < n - 1 && 0 == w[j]; ++j)
+            ;
+        if (j) {
+            memmove(w, w + j, (n - j) * sizeof *w);
+            memset(w + n - j, 0, j * sizeof *w);
+            lo += j, n -= j;
+        }
+        a->start[i] = lo;
+        a->count[i] = (n + 1) & ~1;
+    }
+    free(fw);
+    return true;
+}
+
+//===========================================================================
+// the passes, C and SSE2. Pixels are taken as 4 channels alike.
+
+ST inline BYTE clamp_255(int v)
+{
+    v = (v + (SCALE_ONE >> 1)) >> SCALE_BITS;
+    return (BYTE)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// one row across: d[0..dw) from s, with the pixel after the row there
+ST void hpass_c(BYTE *d, const BYTE *s, int dw, const struct axis *a)
+{
+    int x, k, n, c0, c1, c2, c3;
+    const BYTE *p;
+    const short *w;
+
+    for (x = 0; x < dw; ++x, d += 4) {
+        p = s + 4 * a->start[x];
+        w = a->w + x * a->taps;
+        n = a->count[x];
+        c0 = c1 = c2 = c3 = 0;
+        for (k = 0; k < n; ++k, p += 4) {
+            c0 += p[0] * w[k];
+            c1 += p[1] * w[k];
+            c2 += p[2] * w[k];
+            c3 += p[3] * w[k];
+        }
+        d[0] = clamp_255(c0);
+        d[1] = clamp_255(c1);
+        d[2] = clamp_255(c2);
+        d[3] = clamp_255(c3);
+    }
+}
+
+// one row down: d[x..n) from the rows at s[], with the weights w
+ST void vpass_c(BYTE *d, const BYTE **s, const short *w, int taps, int x, int n)
+{
+    int k, c;
+    for (; x < n; ++x) {
+        for (c = k = 0; k < taps; ++k)
+            c += s[k][x] * w[k];
+        d[x] = clamp_255(c);
+    }
+}
+
+ST ROOT_SSE2 inline __m128i sse2_pair(const short *w)
+{
+    return _mm_set1_epi32((int)((unsigned short)w[0] | (unsigned)(unsigned short)w[1] << 16));
+}
+
+ST ROOT_SSE2 inline __m128i sse2_round(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_set1_epi32(SCALE_ONE >> 1));
+    return _mm_srai_epi32(v, SCALE_BITS);
+}
+
+ST ROOT_SSE2 void hpass_sse2(BYTE *d, const BYTE *s, int dw, const struct axis *a)
+{
+    __m128i zero = _mm_setzero_si128(), acc, p;
+    int x, k, n;
+    const BYTE *q;
+    const short *w;
+
+    for (x = 0; x < dw; ++x, d += 4) {
+        q = s + 4 * a->start[x];
+        w = a->w + x * a->taps;
+        n = a->count[x];
+        acc = zero;
+        for (k = 0; k < n; k += 2, q += 8) {
+            // two pixels to b0 b1 g0 g1 r0 r1 x0 x1, times w0 w1
+            p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)q), zero);
+            p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(p, sse2_pair(w + k)));
+        }
+        acc = _mm_packs_epi32(sse2_round(acc), zero);
+        *(int*)d = _mm_cvtsi128_si32(_mm_packus_epi16(acc, zero));
+    }
+}
+
+ST ROOT_SSE2 void vpass_sse2(BYTE *d, const BYTE **s, const short *w, int taps, int n)
+{
+    __m128i zero = _mm_setzero_si128(), a0, a1, a2, a3, p, q, wp;
+    int x, k;
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        a0 = a1 = a2 = a3 = zero;
+        for (k = 0; k < taps; k += 2) {
+            // the bytes of two rows interleaved, times w0 w1
+            p = _mm_loadu_si128((const __m128i*)(s[k] + x));
+            q = _mm_loadu_si128((const __m128i*)(s[k+1] + x));
+            wp = sse2_pair(w + k);
+            a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(p, q), zero), wp));
+            a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi8(_mm_unpacklo_epi8(p, q), zero), wp));
+            a2 = _mm_add_epi32(a2, _mm_madd_epi16(_mm_unpacklo_epi8(_mm_unpackhi_epi8(p, q), zero), wp));
+            a3 = _mm_add_epi32(a3, _mm_madd_epi16(_mm_unpackhi_epi8(_mm_unpackhi_epi8(p, q), zero), wp));
+        }
+        a0 = _mm_packs_epi32(sse2_round(a0), sse2_round(a1));
+        a2 = _mm_packs_epi32(sse2_round(a2), sse2_round(a3));
+        _mm_storeu_si128((__m128i*)(d + x), _mm_packus_epi16(a0, a2));
+    }
+    vpass_c(d, s, w, taps, x, n);
+}
+
+//===========================================================================
+// the rows across from the source into m_tmp, then the rows down into
+// m_dst, in bands of rows on up to SCALE_MAX_THREADS
+
+struct RootScale : Runnable
+{
+    HIMG m_img;
+    const BYTE *m_src;
+    BYTE *m_tmp, *m_dst;
+    int m_sw, m_sh, m_dw, m_dh;
+    struct axis m_x, m_y;
+    bool m_across, m_sse2;
+    std::atomic<int> m_next;
+
+    RootScale () : m_next(0) { }
+
+    void Across ()
+    {
+        BYTE *line;
+        int y, e;
+
+        // with room for the pixel after the row
+        line = (BYTE*)calloc(m_sw + 1, 4);
+        if (NULL == line)
+            return;
+        while ((y = m_next.fetch_add(SCALE_BAND)) < m_sh) {
+            for (e = imin(y + SCALE_BAND, m_sh); y < e; y++) {
+                if (m_img)
+                    image_getline(m_img, y, (RGBQUAD*)line);
+                else
+                    memcpy(line, m_src + y * m_sw * 4, m_sw * 4);
+                if (m_sse2)
+                    hpass_sse2(m_tmp + y * m_dw * 4, line, m_dw, &m_x);
+                else
+                    hpass_c(m_tmp + y * m_dw * 4, line, m_dw, &m_x);
+            }
+        }
+        free(line);
+    }
+
+    void Down ()
+    {
+        const BYTE **rows;
+        int y, e, k, r, n;
+
+        rows = (const BYTE**)malloc(m_y.taps * sizeof *rows);
+        if (NULL == rows)
+            return;
+        while ((y = m_next.fetch_add(SCALE_BAND)) < m_dh) {
+            for (e = imin(y + SCALE_BAND, m_dh); y < e; y++) {
+                n = m_y.count[y];
+                for (k = 0; k < n; ++k) {
+                    // the one past the end has a zero weight
+                    r = imin(m_y.start[y] + k, m_sh - 1);
+                    rows[k] = m_tmp + r * m_dw * 4;
+                }
+                if (m_sse2)
+                    vpass_sse2(m_dst + y * m_dw * 4, rows,
+                        m_y.w + y * m_y.taps, n, m_dw * 4);
+                else
+                    vpass_c(m_dst + y * m_dw * 4, rows,
+                        m_y.w + y * m_y.taps, n, 0, m_dw * 4);
+            }
+        }
+        free(rows);
+    }
+
+    virtual void Run ()
+    {
+        if (m_across)
+            Across();
+        else
+            Down();
+    }
+
+    void Pass (bool across, int rows, int pixels)
+    {
+        ThreadPool pool;
+        int i, n;
+
+        m_across = across;
+        m_next = 0;
+        n = 1;
+        if (pixels >= SCALE_MT_PIXELS)
+            n = iminmax(std::thread::hardware_concurrency(), 1, SCALE_MAX_THREADS);
+        n = imin(n, (rows + SCALE_BAND - 1) / SCALE_BAND);
+        if (n < 2) {
+            Run();
+            return;
+        }
+        for (i = 0; i < n; ++i)
+            pool.Create(*this);
+        pool.WaitForTerminate();
+    }
+};
+
+void root_scale(HIMG Img, const BYTE *pixels, int sw, int sh,
+    BYTE *dst, int dw, int dh, int filter)
+{
+    RootScale job;
+    bool across, down;
+
+    across = sw != dw || NULL != Img;
+    down = sh != dh;
+    if (false == across && false == down) {
+        memcpy(dst, pixels, dw * dh * 4);
+        return;
+    }
+
+    memset(&job.m_x, 0, sizeof job.m_x);
+    memset(&job.m_y, 0, sizeof job.m_y);
+    job.m_img = Img;
+    job.m_src = pixels;
+    job.m_sw = sw, job.m_sh = sh;
+    job.m_dw = dw, job.m_dh = dh;
+    job.m_sse2 = root_cpu_level() >= 1;
+    job.m_dst = dst;
+    job.m_tmp = down ? NULL : dst;
+
+    // with sw == dw the weights come out as 1 for the same pixel
+    if (across && false == make_axis(&job.m_x, sw, dw, filter))
+        goto done;
+    if (down) {
+        if (false == make_axis(&job.m_y, sh, dh, filter))
+            goto done;
+        if (across) {
+            job.m_tmp = (BYTE*)malloc(dw * sh * 4);
+            if (NULL == job.m_tmp)
+                goto done;
+        } else {
+            job.m_tmp = (BYTE*)pixels;
+        }
+    }
+
+    if (across)
+        job.Pass(true, sh, dw * sh);
+    if (down)
+        job.Pass(false, dh, dw * dh);
+
+done:
+    if (across && down)
+        free(job.m_tmp);
+    free_axis(&job.m_x);
+    free_axis(&job.m_y);
+}
+
+int root_resample(HIMG *pImg, int w, int h, int filter)
+{
+    HIMG Img;
+    BYTE *pixels;
+
+    if (RF_CXIMAGE == filter)
+        return image_resample(pImg, w, h);
+    if (w <= 0 || h <= 0)
+        return 0;
+    pixels = (BYTE*)malloc(w * h * 4);
+    if (NULL == pixels)
+        return 0;
+    root_scale(*pImg, NULL, image_getwidth(*pImg), image_getheight(*pImg),
+        pixels, w, h, filter);
+    Img = image_create_fromraw(w, h, pixels);
+    free(pixels);
+    if (NULL == Img)
+        return 0;
+    image_destroy(*pImg);
+    *pImg = Img;
+    return 1;
+}
+
+//===========================================================================
+// the rows from image_read across into m_tmp as they come, then down
+
+struct RootReader : ImageReader
+{
+    RootScale m_job;
+    int m_w, m_h, m_scale, m_filter;
+    BYTE *m_out;
+
+    RootReader () : m_out(NULL)
+    {
+        memset(&m_job.m_x, 0, sizeof m_job.m_x);
+        memset(&m_job.m_y, 0, sizeof m_job.m_y);
+        m_job.m_img = NULL;
+        m_job.m_src = m_job.m_tmp = NULL;
+        m_job.m_sse2 = root_cpu_level() >= 1;
+    }
+
+    ~RootReader ()
+    {
+        if (m_job.m_tmp != m_out)
+            free(m_job.m_tmp);
+        free(m_out);
+        free_axis(&m_job.m_x);
+        free_axis(&m_job.m_y);
+    }
+
+    virtual bool Size (int width, int height)
+    {
+        if (0 == m_w)
+            m_w = width * m_scale / 100, m_h = height * m_scale / 100;
+        m_min_w = m_w, m_min_h = m_h;
+        return m_w > 0 && m_h > 0;
+    }
+
+    virtual bool Start (int width, int height)
+    {
+        m_job.m_sw = width, m_job.m_sh = height;
+        m_job.m_dw = m_w, m_job.m_dh = m_h;
+        m_job.m_dst = m_job.m_tmp = m_out = (BYTE*)malloc(m_w * m_h * 4);
+        if (NULL == m_out)
+            return false;
+        if (width != m_w && false == make_axis(&m_job.m_x, width, m_w, m_filter))
+            return false;
+        if (height != m_h) {
+            if (false == make_axis(&m_job.m_y, height, m_h, m_filter))
+                return false;
+            m_job.m_tmp = (BYTE*)malloc(m_w * height * 4);
+            if (NULL == m_job.m_tmp)
+                return false;
+        }
+        return true;
+    }
+
+    virtual void Row (int y, RGBQUAD *line)
+    {
+        BYTE *d = m_job.m_tmp + y * m_w * 4;
+        if (m_job.m_sw == m_w)
+            memcpy(d, line, m_w * 4);
+        else if (m_job.m_sse2)
+            hpass_sse2(d, (BYTE*)line, m_w, &m_job.m_x);
+        else
+            hpass_c(d, (BYTE*)line, m_w, &m_job.m_x);
+    }
+};
+
+int root_read(const char *path, HIMG *pImg, int w, int h, int scale, int filter)
+{
+    RootReader rd;
+    int r;
+
+    rd.m_w = w, rd.m_h = h;
+    rd.m_scale = scale ? scale : 100;
+    rd.m_filter = filter;
+    r = image_read(path, &rd);
+    if (1 == r) {
+        if (rd.m_job.m_sh != rd.m_h)
+            rd.m_job.Pass(false, rd.m_h, rd.m_w * rd.m_h);
+        *pImg = image_create_fromraw(rd.m_w, rd.m_h, rd.m_out);
+        if (NULL == *pImg)
+            r = -1;
+    }
+    return r;
+}
@@ -0,0 +1,260 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// rootspan.cpp - the -sat/-hue kernels of root_copy, in C, SSE2 and AVX2,
+// and what the cpu has of them
+
+#include "BBApi.h"
+#include "rootimg.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#define ST static
+
+#ifdef __GNUC__
+#define ROOT_SSE2 __attribute__((target("sse2")))
+#define ROOT_AVX2 __attribute__((target("avx2")))
+#else
+#define ROOT_SSE2
+#define ROOT_AVX2
+#endif
+
+//===========================================================================
+// -sat/-hue on a span of pixels: s is the image, d the background (for
+// -hue) and the result. All versions give the same bits.
+
+ST void span_c(RGBQUAD *d, const RGBQUAD *s, int n, int hueIntensity, int saturationValue)
+{
+    unsigned ih = 255 - hueIntensity; int x;
+
+    if (saturationValue >= 255 && hueIntensity <= 0) {
+        for (x = 0; x < n; x++)
+            d[x] = s[x], d[x].rgbReserved = 0;
+        return;
+    }
+    for (x = 0; x < n; x++)
+    {
+        // First we read the original pixel's color...
+        unsigned r = s[x].rgbRed;
+        unsigned g = s[x].rgbGreen;
+        unsigned b = s[x].rgbBlue;
+        // ...then we apply saturation...
+        if (saturationValue<255)
+        {
+            unsigned greyscale =
+                (79*r + 156*g + 21*b) * (255-saturationValue)/256 + 255;
+
+            r = (r*saturationValue + greyscale)>>8;
+            g = (g*saturationValue + greyscale)>>8;
+            b = (b*saturationValue + greyscale)>>8;
+        }
+        // ...and hue according to color and intensity...
+        if (hueIntensity>0)
+        {
+            r = (ih*r + hueIntensity*d[x].rgbRed   + 255)>>8;
+            g = (ih*g + hueIntensity*d[x].rgbGreen + 255)>>8;
+            b = (ih*b + hueIntensity*d[x].rgbBlue  + 255)>>8;
+        }
+        d[x].rgbRed   = r;
+        d[x].rgbGreen = g;
+        d[x].rgbBlue  = b;
+        d[x].rgbReserved = 0;
+    }
+}
+
+// The same in 16 bit lanes, one channel each. The sums above may need
+// 17 bits, so (a + b) >> 8 is taken as ((a>>1) + (b>>1) + (a&b&1)) >> 7.
+// The greyscale is (G * (255-sat)) >> 8 = mulhi(G, (255-sat) << 8).
+
+ST ROOT_SSE2 inline __m128i sse2_add_shr8(__m128i a, __m128i b)
+{
+    __m128i c = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi16(1));
+    a = _mm_add_epi16(_mm_srli_epi16(a, 1), _mm_srli_epi16(b, 1));
+    return _mm_srli_epi16(_mm_add_epi16(a, c), 7);
+}
+
+ST ROOT_SSE2 inline __m128i sse2_sat(__m128i p, __m128i vs, __m128i vk)
+{
+    // B G R x B G R x -> 21*B + 156*G + 79*R in all four lanes of a pixel
+    __m128i b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0x00), 0x00);
+    __m128i g = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0x55), 0x55);
+    __m128i r = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0xAA), 0xAA);
+    __m128i grey = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(21)), _mm_mullo_epi16(g, _mm_set1_epi16(156))),
+        _mm_mullo_epi16(r, _mm_set1_epi16(79)));
+    grey = _mm_add_epi16(_mm_mulhi_epu16(grey, vk), _mm_set1_epi16(255));
+    return sse2_add_shr8(_mm_mullo_epi16(p, vs), grey);
+}
+
+ST ROOT_SSE2 inline __m128i sse2_hue(__m128i p, __m128i q, __m128i vih, __m128i vh)
+{
+    q = _mm_add_epi16(_mm_mullo_epi16(q, vh), _mm_set1_epi16(255));
+    return sse2_add_shr8(_mm_mullo_epi16(p, vih), q);
+}
+
+ST ROOT_SSE2 void span_sse2(RGBQUAD *d, const RGBQUAD *s, int n, int hueIntensity, int saturationValue)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i vs = _mm_set1_epi16((short)saturationValue);
+    const __m128i vk = _mm_set1_epi16((short)((255-saturationValue) << 8));
+    const __m128i vh = _mm_set1_epi16((short)hueIntensity);
+    const __m128i vih = _mm_set1_epi16((short)(255-hueIntensity));
+    __m128i x, lo, hi;
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        x = _mm_loadu_si128((const __m128i*)(s + i));
+        lo = _mm_unpacklo_epi8(x, zero);
+        hi = _mm_unpackhi_epi8(x, zero);
+        if (saturationValue < 255) {
+            lo = sse2_sat(lo, vs, vk);
+            hi = sse2_sat(hi, vs, vk);
+        }
+        if (hueIntensity > 0) {
+            x = _mm_loadu_si128((const __m128i*)(d + i));
+            lo = sse2_hue(lo, _mm_unpacklo_epi8(x, zero), vih, vh);
+            hi = sse2_hue(hi, _mm_unpackhi_epi8(x, zero), vih, vh);
+        }
+        x = _mm_and_si128(_mm_packus_epi16(lo, hi), mask);
+        _mm_storeu_si128((__m128i*)(d + i), x);
+    }
+    span_c(d + i, s + i, n - i, hueIntensity, saturationValue);
+}
+
+ST ROOT_AVX2 inline __m256i avx2_add_shr8(__m256i a, __m256i b)
+{
+    __m256i c = _mm256_and_si256(_mm256_and_si256(a, b), _mm256_set1_epi16(1));
+    a = _mm256_add_epi16(_mm256_srli_epi16(a, 1), _mm256_srli_epi16(b, 1));
+    return _mm256_srli_epi16(_mm256_add_epi16(a, c), 7);
+}
+
+ST ROOT_AVX2 inline __m256i avx2_sat(__m256i p, __m256i vs, __m256i vk)
+{
+    __m256i b = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, 0x00), 0x00);
+    __m256i g = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, 0x55), 0x55);
+    __m256i r = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, 0xAA), 0xAA);
+    __m256i grey = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(21)), _mm256_mullo_epi16(g, _mm256_set1_epi16(156))),
+        _mm256_mullo_epi16(r, _mm256_set1_epi16(79)));
+    grey = _mm256_add_epi16(_mm256_mulhi_epu16(grey, vk), _mm256_set1_epi16(255));
+    return avx2_add_shr8(_mm256_mullo_epi16(p, vs), grey);
+}
+
+ST ROOT_AVX2 inline __m256i avx2_hue(__m256i p, __m256i q, __m256i vih, __m256i vh)
+{
+    q = _mm256_add_epi16(_mm256_mullo_epi16(q, vh), _mm256_set1_epi16(255));
+    return avx2_add_shr8(_mm256_mullo_epi16(p, vih), q);
+}
+
+ST ROOT_AVX2 void span_avx2(RGBQUAD *d, const RGBQUAD *s, int n, int hueIntensity, int saturationValue)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i mask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i vs = _mm256_set1_epi16((short)saturationValue);
+    const __m256i vk = _mm256_set1_epi16((short)((255-saturationValue) << 8));
+    const __m256i vh = _mm256_set1_epi16((short)hueIntensity);
+    const __m256i vih = _mm256_set1_epi16((short)(255-hueIntensity));
+    __m256i x, lo, hi;
+    int i;
+
+    // unpack and pack work within the 128 bit halves, so the order stays
+    for (i = 0; i + 8 <= n; i += 8) {
+        x = _mm256_loadu_si256((const __m256i*)(s + i));
+        lo = _mm256_unpacklo_epi8(x, zero);
+        hi = _mm256_unpackhi_epi8(x, zero);
+        if (saturationValue < 255) {
+            lo = avx2_sat(lo, vs, vk);
+            hi = avx2_sat(hi, vs, vk);
+        }
+        if (hueIntensity > 0) {
+            x = _mm256_loadu_si256((const __m256i*)(d + i));
+            lo = avx2_hue(lo, _mm256_unpacklo_epi8(x, zero), vih, vh);
+            hi = avx2_hue(hi, _mm256_unpackhi_epi8(x, zero), vih, vh);
+        }
+        x = _mm256_and_si256(_mm256_packus_epi16(lo, hi), mask);
+        _mm256_storeu_si256((__m256i*)(d + i), x);
+    }
+    span_sse2(d + i, s + i, n - i, hueIntensity, saturationValue);
+}
+
+int root_cpu_level(void)
+{
+    static int level = -1;
+    int r[4];
+    unsigned xcr0;
+
+    if (level >= 0)
+        return level;
+    level = 0;
+#ifdef _MSC_VER
+    __cpuid(r, 0);
+    if (r[0] >= 1) {
+        __cpuid(r, 1);
+        if (r[3] & (1<<26))
+            level = 1;
+        // AVX and the OS saving the ymm registers
+        if ((r[2] & (1<<27)) && (r[2] & (1<<28))) {
+            xcr0 = (unsigned)_xgetbv(0);
+            __cpuid(r, 0);
+            if (6 == (xcr0 & 6) && r[0] >= 7) {
+                __cpuidex(r, 7, 0);
+                if (r[1] & (1<<5))
+                    level = 2;
+            }
+        }
+    }
+#else
+    if (__get_cpuid(1, (unsigned*)&r[0], (unsigned*)&r[1], (unsigned*)&r[2], (unsigned*)&r[3])) {
+        if (r[3] & (1<<26))
+            level = 1;
+        if ((r[2] & (1<<27)) && (r[2] & (1<<28))) {
+            unsigned edx;
+            __asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+            if (6 == (xcr0 & 6) && __get_cpuid_max(0, NULL) >= 7) {
+                __cpuid_count(7, 0, r[0], r[1], r[2], r[3]);
+                if (r[1] & (1<<5))
+                    level = 2;
+            }
+        }
+    }
+#endif
+    return level;
+}
+
+root_span_fn *root_get_span(int level, int hueIntensity, int saturationValue)
+{
+    // the lanes hold 0..255 only, other values go the long way
+    if (hueIntensity < 0 || hueIntensity > 255
+     || saturationValue < 0 || saturationValue > 255)
+        return span_c;
+    switch (level) {
+        case 2: return span_avx2;
+        case 1: return span_sse2;
+    }
+    return span_c;
+}